@@ -153,8 +153,8 @@
 #define configUSE_RECURSIVE_MUTEXES         0
 #define configUSE_COUNTING_SEMAPHORES       1
 #define configUSE_QUEUE_SETS                1
-#define INCLUDE_vTaskPrioritySet			0
-#define INCLUDE_uxTaskPriorityGet			0
+#define INCLUDE_vTaskPrioritySet			1   ///< GameTask_t ponders at PRIORITY_LOW
+#define INCLUDE_uxTaskPriorityGet			1
 #define INCLUDE_vTaskDelete					0
 #define INCLUDE_vTaskCleanUpResources		0
 #define INCLUDE_vTaskSuspend				1
@@ -163,6 +163,8 @@
 #define INCLUDE_uxTaskGetStackHighWaterMark	1
 #define INCLUDE_xTaskGetSchedulerState      1
 #define INCLUDE_xTaskGetIdleTaskHandle      1
+#define INCLUDE_xTaskGetCurrentTaskHandle   1   ///< file_logger.c rate limits each task
+#define INCLUDE_pcTaskGetTaskName           1   ///< and names it in "log status"
 #define INCLUDE_xTimerPendFunctionCall      0   ///< Uses timer daemon task, so needs configUSE_TIMERS to 1
 
 /* FreeRTOS Timer or daemon task configuration */
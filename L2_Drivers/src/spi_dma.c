@@ -186,3 +186,53 @@ unsigned ssp1_dma_transfer_block(unsigned char* pBuffer, uint32_t num_bytes, cha
     return 0;
 }
 
+
+unsigned ssp1_dma_exchange_block(const unsigned char* pTxBuffer, unsigned char* pRxBuffer, uint32_t num_bytes)
+{
+    LPC_GPDMACH_TypeDef *pDmaRxChannel = (LPC_GPDMACH_TypeDef *)
+                                          (LPC_GPDMACH0_BASE + SPI_DMA_RX_NUM*0x20);
+    LPC_GPDMACH_TypeDef *pDmaTxChannel = (LPC_GPDMACH_TypeDef *)
+                                          (LPC_GPDMACH0_BASE + SPI_DMA_TX_NUM*0x20);
+
+    // DMA is limited to 12-bit transfer size
+    if(num_bytes >= 0x1000) {
+        return 1;
+    }
+    // DMA channels should not be busy
+    if( (pDmaRxChannel->DMACCConfig & 1) || (pDmaTxChannel->DMACCConfig & 1) ) {
+        return 2;
+    }
+    while( LPC_SSP1->SR & (1<<2)) {
+        char dummy = LPC_SSP1->DR;
+        (void)dummy;
+    }
+
+    LPC_GPDMA->DMACIntTCClear = (1 << SPI_DMA_RX_NUM) | (1 << SPI_DMA_TX_NUM);
+    LPC_GPDMA->DMACIntErrClr  = (1 << SPI_DMA_RX_NUM) | (1 << SPI_DMA_TX_NUM);
+
+    /**
+     * Full duplex, both sides increment:
+     *      - Every byte of pTxBuffer is sent out
+     *      - Every byte received is stored in pRxBuffer
+     */
+    pDmaRxChannel->DMACCSrcAddr  = (uint32_t)(&(LPC_SSP1->DR));
+    pDmaRxChannel->DMACCDestAddr = (uint32_t)pRxBuffer;
+    pDmaRxChannel->DMACCControl  = num_bytes | DST_INCR_BIT | TCIE_BIT;
+    pDmaRxChannel->DMACCLLI = 0;
+    pDmaRxChannel->DMACCConfig = (SSP1_RX_CHAN << 1) | P_TO_M_BIT;
+
+    pDmaTxChannel->DMACCSrcAddr  = (uint32_t)pTxBuffer;
+    pDmaTxChannel->DMACCDestAddr = (uint32_t)(&(LPC_SSP1->DR));
+    pDmaTxChannel->DMACCControl  = num_bytes | SRC_INCR_BIT;
+    pDmaTxChannel->DMACCLLI = 0;
+    pDmaTxChannel->DMACCConfig = (SSP1_TX_CHAN << 6) | M_TO_P_BIT;
+
+    pDmaRxChannel->DMACCConfig |= 1;
+    pDmaTxChannel->DMACCConfig |= 1;
+    LPC_SSP1->DMACR |= 3; // RX: B0, TX: B1
+
+    while( (pDmaRxChannel->DMACCControl & 0xfff) );
+    LPC_SSP1->DMACR &= ~3;
+
+    return 0;
+}
@@ -92,6 +92,17 @@ static inline void ssp1_exchange_data(void* data, int len)
  */
 unsigned ssp1_dma_transfer_block(unsigned char* pBuffer, uint32_t num_bytes, char is_write_op);
 
+/**
+ * Full-duplex transfer over SPI (SSP#1), for devices that need specific bytes
+ * sent while they are being read, ex: the Pixy's 0x5a sync byte.
+ * @param pTxBuffer  Bytes sent out, num_bytes long
+ * @param pRxBuffer  Bytes received, num_bytes long
+ * @param num_bytes  The length of the transfer in bytes (less than 4096)
+ *
+ * @return 0 upon success, or non-zero upon failure.
+ */
+unsigned ssp1_dma_exchange_block(const unsigned char* pTxBuffer, unsigned char* pRxBuffer, uint32_t num_bytes);
+
 
 
 #ifdef __cplusplus
@@ -21,6 +21,11 @@
  * @brief This is a logger that logs data to a file on the system such as an SD Card.
  * @ingroup Utilities
  *
+ * 20261017: Per call site and per task rate limiting, debug sampling, FILE_LOGGER_RATE_LIMIT
+ * 20261017: Log rotation into compressed segments, FILE_LOGGER_SEGMENT_SIZE
+ * 20261017: The file kept open is preallocated and synced in batches, FILE_LOGGER_SYNC_TIME_SEC
+ * 20261017: Binary logging mode, FILE_LOGGER_BINARY
+ * 20261017: Messages are formatted straight into one lock-free ring instead of queued buffers
  * 20140714: Fixed bugs and added more API
  * 20140529: Changed completely to C and FreeRTOS based logger
  * 20120923: modified flush() to use semaphores
@@ -32,37 +37,126 @@
 extern "C" {
 #endif
 #include <stdint.h>
+#include <stdbool.h>
 
 
 
 /**
  * @{
- * The main parameters are the buffer size, and number of message buffers. The buffer size controls how
- * much data we can cache before we are forced to write it to the output file.
+ * The main parameters are the ring size and the buffer size.  Logging calls format their message
+ * straight into the ring, and the buffer size controls how much of it we cache before the logger task
+ * is woken up to write it to the output file.
  *
- * The message buffers are the maximum number of LOGGING calls (macros) that can occur at once after which
- * the caller to LOG macro will be blocked.  Note that even a small number like 5 is good enough because
- * as soon as there is time for the logging task to run, it will transfer the LOGGED message into the
- * file buffer immediately.  So this number is kind of like a double buffer.  On the other hand, please
- * note that while the file is being written, the number of buffers need to be enough because the logger
- * task will be busy writing the buffer to the file.
- *
- * For example, if we anticipate logging every 10ms, and 1K of data takes 100ms to write, then we should
- * configure the number of logging buffers greater than 10 because while the logger task is busy writing
- * 1K of data for 100ms, we need to be able to write for 100ms, which will take at least 10 buffers.
+ * The rest of the ring is what logging calls can fill while the file is being written; once it is full,
+ * the caller to LOG macro will be blocked.  For example, if we anticipate logging 100 bytes every 10ms,
+ * and 1K of data takes 100ms to write, then the ring needs 1K on top of the buffer size.  Every message
+ * also takes one of the ring's records until it is written, so there should be enough records for the
+ * shortest messages to fill the ring.
  *
  * The flush timeout is the timeout after which point we are forced to flush the data buffer to the file.
  * So in an event when no logging calls occur and there is data in the buffer, we will write it to the
  * file after this time.
+ *
+ * If the file is kept open, it grows FILE_LOGGER_PREALLOC_SIZE at a time so that its clusters are
+ * allocated ahead of the writes, and it is only synced (its size and the FAT written) on a flush or
+ * FILE_LOGGER_SYNC_TIME_SEC after it was written.  Until a sync, a power loss loses what was written
+ * since the last one, but the file still ends on a whole message.  At boot, logging continues at the
+ * synced size and reuses the clusters allocated past it.  A disk check on a PC reports those clusters
+ * as lost until the file is closed, which logger_init() never does.
  */
 #define FILE_LOGGER_BUFFER_SIZE      (1 * 1024)     ///< Recommend multiples of 512
-#define FILE_LOGGER_NUM_BUFFERS      10             ///< Number of buffers (need to have enough while file is being written)
+#define FILE_LOGGER_RING_SIZE        (4 * 1024)     ///< Power of 2, at least twice FILE_LOGGER_LOG_MSG_MAX_LEN
+#define FILE_LOGGER_RING_RECORDS     128            ///< Power of 2, most messages waiting in the ring
 #define FILE_LOGGER_LOG_MSG_MAX_LEN  150            ///< Max length of a log message
-#define FILE_LOGGER_FILENAME         "0:log.csv"    ///< Destination filename (0: for SPI flash, 1: for SD card)
+#ifndef FILE_LOGGER_BINARY
+#define FILE_LOGGER_BINARY           (0)            ///< If non-zero, binary records are logged instead of text (see below)
+#endif
+#define FILE_LOGGER_DIR              "0:"           ///< Destination drive (0: for SPI flash, 1: for SD card)
+#if (FILE_LOGGER_BINARY)
+#define FILE_LOGGER_EXT              ".bin"
+#else
+#define FILE_LOGGER_EXT              ".csv"
+#endif
+#define FILE_LOGGER_FILENAME         FILE_LOGGER_DIR "log" FILE_LOGGER_EXT  ///< Destination filename
 #define FILE_LOGGER_STACK_SIZE       (3 * 512 / 4)  ///< Stack size in 32-bit (1 = 4 bytes for 32-bit CPU)
 #define FILE_LOGGER_FLUSH_TIME_SEC   (1 * 60)       ///< Logs are flushed after this time
-#define FILE_LOGGER_BLOCK_TIME_MS    (10)           ///< If no buffer available within this time, block time counter will increment
+#define FILE_LOGGER_BLOCK_TIME_MS    (1)            ///< A caller finding the ring full sleeps this long between tries
+#ifndef FILE_LOGGER_KEEP_FILE_OPEN
 #define FILE_LOGGER_KEEP_FILE_OPEN   (0)            ///< If non-zero, the file will be kept open
+#endif
+#define FILE_LOGGER_PREALLOC_SIZE    (64 * 1024)    ///< Multiple of 512, the file kept open grows this much at a time
+#define FILE_LOGGER_SYNC_TIME_SEC    (5)            ///< The file kept open is synced this long after it was written
+/** @} */
+
+/**
+ * @{ Log rotation
+ * Once the log file would grow past FILE_LOGGER_SEGMENT_SIZE, it is renamed to the next retired
+ * segment, "log_1.csv", "log_2.csv" and so on, and a new log file is started.  The numbers only go
+ * up, so a segment keeps its name while it is being compressed.  A task at PRIORITY_LOW compresses
+ * each retired segment into "log_<n>.lz" and deletes it, and deletes segments older than the newest
+ * FILE_LOGGER_SEGMENTS.  Segments left behind by a reboot are taken care of when it starts.
+ * tools/lzcat turns a ".lz" segment back into the file it was.
+ *
+ * A ".lz" segment is FILE_LOGGER_LZ_MAGIC, the length of the segment (4 bytes, little endian) and
+ * then its blocks of FILE_LOGGER_LZ_BLOCK_SIZE bytes, the last one shorter.  A block is its length
+ * (2 bytes, little endian) and the block compressed by lz_compress(), or the block as it was if
+ * FILE_LOGGER_LZ_STORED is set in the length.  The magic is written last: a segment compressed
+ * partly before a power loss has none and is compressed again.
+ */
+#ifndef FILE_LOGGER_SEGMENT_SIZE
+#define FILE_LOGGER_SEGMENT_SIZE     (256 * 1024)   ///< The log file is rotated at this size, 0 to let it grow
+#endif
+#ifndef FILE_LOGGER_SEGMENTS
+#define FILE_LOGGER_SEGMENTS         (4)            ///< Number of retired segments kept
+#endif
+#define FILE_LOGGER_COMPRESS         (1)            ///< If non-zero, retired segments are compressed
+#define FILE_LOGGER_SEGMENT_FORMAT   FILE_LOGGER_DIR "log_%u"   ///< Retired segment names, before the extension
+#define FILE_LOGGER_SEGMENT_STACK_SIZE (4 * 512 / 4) ///< Stack size of the task compressing the segments
+#define FILE_LOGGER_LZ_EXT           ".lz"
+#define FILE_LOGGER_LZ_MAGIC         "LOGZ"
+#define FILE_LOGGER_LZ_BLOCK_SIZE    (2 * 1024)     ///< Less than FILE_LOGGER_LZ_STORED
+#define FILE_LOGGER_LZ_STORED        0x8000
+
+/// A log segment, see logger_get_segments()
+typedef struct {
+    uint32_t seq;           ///< Retired segment number, 0 for the log file being written
+    bool     compressed;    ///< The segment is a ".lz" file
+    uint32_t size;          ///< Bytes on the disk
+    uint32_t log_size;      ///< Bytes of log it holds, 0 for a ".lz" file not finished
+} logger_segment_t;
+/** @} */
+
+/**
+ * @{ Rate limiting and sampling
+ * A task stuck in a loop that logs would otherwise fill the ring and block every other task that
+ * logs.  So each call site (a logging call, told apart by its format string) and each task has a
+ * token bucket: it may log FILE_LOGGER_SITE_BURST or FILE_LOGGER_TASK_BURST messages at once, and
+ * then FILE_LOGGER_SITE_RATE or FILE_LOGGER_TASK_RATE messages per second.  A message over either
+ * limit is dropped and counted, see logger_get_suppressed_call_count() and logger_get_limited().
+ * Debug messages are sampled before that: only the first and then 1 in every
+ * logger_set_debug_sampling() debug messages of each call site are logged.
+ *
+ * Only calls made while FreeRTOS runs are limited.  The call sites and tasks seen most recently are
+ * kept, FILE_LOGGER_LIMIT_SITES and FILE_LOGGER_LIMIT_TASKS of them: a new one takes the place of
+ * the one that logged least recently, with a full bucket.
+ */
+#ifndef FILE_LOGGER_RATE_LIMIT
+#define FILE_LOGGER_RATE_LIMIT       (1)            ///< If non-zero, messages are rate limited and sampled
+#endif
+#define FILE_LOGGER_SITE_RATE        (10)           ///< Messages per second of a call site, 0 for no limit, at most 1000
+#define FILE_LOGGER_SITE_BURST       (20)           ///< Messages a call site may log at once
+#define FILE_LOGGER_TASK_RATE        (50)           ///< Messages per second of a task, 0 for no limit, at most 1000
+#define FILE_LOGGER_TASK_BURST       (100)          ///< Messages a task may log at once
+#define FILE_LOGGER_LIMIT_SITES      (16)           ///< Number of call sites tracked
+#define FILE_LOGGER_LIMIT_TASKS      (12)           ///< Number of tasks tracked
+#define FILE_LOGGER_DEBUG_SAMPLING   (1)            ///< 1 in this many debug messages are logged at first
+
+/// A call site or task whose messages were dropped, see logger_get_limited()
+typedef struct {
+    const char * name;      ///< The call site's filename, or the task's name
+    uint16_t     line;      ///< The call site's line, 0 for a task
+    uint32_t     dropped;   ///< Messages dropped since it was last tracked
+} logger_limited_t;
 /** @} */
 
 
@@ -79,6 +173,50 @@ typedef enum {
     log_last, ///< Marks the last entry, do not use
 } logger_msg_t;
 
+/**
+ * @{ Binary log records, if FILE_LOGGER_BINARY is set
+ * A logging call then formats nothing: it records the addresses of its format string, filename and
+ * function name, the time and its raw arguments.  This costs a fraction of the sprintf() of the text
+ * header and message, and the records are a fraction of the text's size.  tools/logdecode reads the
+ * strings back out of the firmware's ELF file and prints the same CSV lines the text mode writes, so
+ * the ELF file of the build that wrote the log is needed to read it.
+ *
+ * A record is a logger_bin_header_t followed by:
+ *      - the format string itself, '\0' terminated, if it wasn't in flash (FILE_LOGGER_BIN_INLINE)
+ *      - each argument the format's conversions take, a FILE_LOGGER_BIN_ARG_* tag and its bytes
+ * Records are little endian.  logger_init() writes a FILE_LOGGER_BIN_START record whose format string
+ * is FILE_LOGGER_BIN_MARKER, which tells logdecode if the ELF file matches the log.
+ */
+#define FILE_LOGGER_BIN_MARKER       "file_logger binary v1"
+#define FILE_LOGGER_BIN_TYPE_MASK    0x0F           ///< The logger_msg_t
+#define FILE_LOGGER_BIN_RAW          0x10           ///< LOG_RAW_MSG(), without the header
+#define FILE_LOGGER_BIN_START        0x20           ///< Written by logger_init()
+#define FILE_LOGGER_BIN_TRUNCATED    0x40           ///< Not all arguments fit
+#define FILE_LOGGER_BIN_INLINE       0x80           ///< The format string follows the header
+
+#define FILE_LOGGER_BIN_ARG_INT32    'i'            ///< 4 bytes
+#define FILE_LOGGER_BIN_ARG_INT64    'I'            ///< 8 bytes
+#define FILE_LOGGER_BIN_ARG_DOUBLE   'f'            ///< 8 bytes
+#define FILE_LOGGER_BIN_ARG_PTR      'p'            ///< 4 bytes
+#define FILE_LOGGER_BIN_ARG_STR_ADDR 'S'            ///< 4 bytes, the address of a string in flash
+#define FILE_LOGGER_BIN_ARG_STR      's'            ///< The string, '\0' terminated, cut short to fit the record
+
+typedef struct {
+    uint16_t len;           ///< Of the whole record
+    uint16_t line;
+    uint8_t  flags;         ///< FILE_LOGGER_BIN_TYPE_MASK and FILE_LOGGER_BIN_* flags
+    uint8_t  month;
+    uint8_t  day;
+    uint8_t  hour;
+    uint8_t  min;
+    uint8_t  sec;
+    uint32_t uptime_ms;
+    uint32_t filename;      ///< Address of the filename, 0 if none
+    uint32_t func_name;     ///< Address of the function name, 0 if none
+    uint32_t msg;           ///< Address of the format string, 0 if FILE_LOGGER_BIN_INLINE
+} __attribute__((packed)) logger_bin_header_t;
+/** @} */
+
 /**
  * Initializes the logger; this must be done before further logging calls are used.
  * @param [in] logger_priority The priority at which logger should buffer user data and then write to file.
@@ -95,6 +233,12 @@ void logger_init(uint8_t logger_priority);
  */
 void logger_set_printf(logger_msg_t type, bool enable);
 
+/**
+ * Logs only 1 in the given number of debug messages of each call site.
+ * @param [in] one_in  1 to log every debug message
+ */
+void logger_set_debug_sampling(uint32_t one_in);
+
 /**
  * @{ Macros to log a message using printf() style API
  * @note If FreeRTOS is not running, the message is immediately output to file.  If FreeRTOS is running,
@@ -158,27 +302,68 @@ void logger_send_flush_request(void);
  */
 uint32_t logger_get_logged_call_count(logger_msg_t severity);
 
+/**
+ * @returns the number of messages of the given severity dropped by the rate limits.
+ * If a lot are, logger_get_limited() tells which call sites and tasks log too much.
+ * @param [in] severity  The severity for which to get the number of calls.
+ */
+uint32_t logger_get_suppressed_call_count(logger_msg_t severity);
+
+/**
+ * @returns the number of debug messages that were not logged because of logger_set_debug_sampling()
+ */
+uint32_t logger_get_sampled_call_count(void);
+
+/**
+ * Gets the call sites or the tasks tracked by the rate limits that had messages dropped.
+ * @param [out] limited  Where to put them
+ * @param [in]  max      The number that fit, FILE_LOGGER_LIMIT_SITES or FILE_LOGGER_LIMIT_TASKS for all of them
+ * @param [in]  tasks    If true, gets the tasks instead of the call sites
+ * @returns the number put in limited
+ */
+uint32_t logger_get_limited(logger_limited_t * limited, uint32_t max, bool tasks);
+
 /**
  * @returns the number of logging calls that ended up blocking or sleeping the task
- *          waiting for a logger buffer to be available.
+ *          waiting for space in the log ring.
  *
  * If the number is greater than zero, it indicates that you either need to slow
- * down logger calls, or increase the number of log buffers.
+ * down logger calls, or increase FILE_LOGGER_RING_SIZE or FILE_LOGGER_RING_RECORDS.
  */
 uint16_t logger_get_blocked_call_count(void);
 
 /**
  * @returns the highest time that was spend writing the logger buffer to file.
- * This can be useful to assess how many FILE_LOGGER_NUM_BUFFERS we need because we only
- * need enough buffers available while the file buffer is being written.
+ * This can be useful to assess how big FILE_LOGGER_RING_SIZE needs to be because
+ * logging calls fill the ring while the file is being written.
  */
 uint16_t logger_get_highest_file_write_time_ms(void);
 
 /**
- * @returns the highest watermark of the number of buffers available to the logger
- * This can be useful to assess how many FILE_LOGGER_NUM_BUFFERS we need in the worst case.
+ * @returns the most bytes that were waiting in the log ring to be written to file.
+ * This can be useful to assess how big FILE_LOGGER_RING_SIZE needs to be in the worst case.
+ */
+uint16_t logger_get_ring_watermark(void);
+
+/**
+ * @returns the number of bytes written to the log file(s) since logger_init()
+ * Divided by logger_get_file_write_time_ms(), this is how fast the file is written.
+ */
+uint32_t logger_get_bytes_written(void);
+
+/**
+ * @returns the total time spent writing (and syncing) the log file
+ */
+uint32_t logger_get_file_write_time_ms(void);
+
+/**
+ * Gets the log segments on the disk: the log file being written, then the retired segments from
+ * the newest.  This reads the directory, so it is slow.
+ * @param [out] segments  Where to put them
+ * @param [in]  max       The number of segments that fit, FILE_LOGGER_SEGMENTS + 2 for all of them
+ * @returns the number of segments put in segments
  */
-uint16_t logger_get_num_buffers_watermark(void);
+uint32_t logger_get_segments(logger_segment_t * segments, uint32_t max);
 
 
 
@@ -0,0 +1,62 @@
+/**
+ * @file
+ * @ingroup Utilities
+ *
+ * Small LZ compressor for blocks of up to 64K, in the LZ4 block format so that any LZ4 library
+ * can decompress its output.  It is a single pass with one hash table and no heap: it trades
+ * some ratio for speed and RAM, which suits text such as log files that repeat a lot.
+ *
+ * Example code :
+ * @code
+ *      uint16_t table[LZ_HASH_ENTRIES];
+ *      uint8_t packed[LZ_COMPRESS_BOUND(sizeof(text))];
+ *      uint32_t packed_len = lz_compress(text, sizeof(text), packed, sizeof(packed), table);
+ *      int32_t text_len = lz_decompress(packed, packed_len, text, sizeof(text));
+ * @endcode
+ */
+#ifndef LZ_COMPRESS_H_
+#define LZ_COMPRESS_H_
+
+
+/**************/
+/** INCLUDES **/
+#include <stdint.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/************/
+/** COMMON **/
+#define LZ_HASH_BITS            10                          ///< More bits find more matches, at 2 bytes each
+#define LZ_HASH_ENTRIES         (1 << LZ_HASH_BITS)         ///< Size of lz_compress()'s hash table
+#define LZ_MAX_BLOCK_SIZE       0xFFFF                      ///< Largest block lz_compress() takes
+#define LZ_COMPRESS_BOUND(n)    ((n) + (n) / 255 + 16)      ///< Output room that never runs out
+
+/**
+ * Compresses a block.
+ * @param src       The data, at most LZ_MAX_BLOCK_SIZE bytes
+ * @param src_len   Its length
+ * @param dst       Where to write the compressed block
+ * @param dst_max   The room at dst; LZ_COMPRESS_BOUND(src_len) is always enough
+ * @param table     LZ_HASH_ENTRIES scratch entries, they need not be cleared
+ * @returns the compressed length, 0 if it didn't fit in dst_max
+ */
+uint32_t lz_compress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_max, uint16_t *table);
+
+/**
+ * Decompresses a block written by lz_compress() or any LZ4 block compressor.
+ * @param src       The compressed block
+ * @param src_len   Its length
+ * @param dst       Where to write the data
+ * @param dst_max   The room at dst
+ * @returns the data's length, -1 if the block is corrupt or doesn't fit in dst_max
+ */
+int32_t lz_decompress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_max);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LZ_COMPRESS_H_ */
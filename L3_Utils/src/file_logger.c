@@ -22,29 +22,43 @@
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <ctype.h>    // tolower()
 
 #include "FreeRTOS.h"
-#include "queue.h"
+#include "semphr.h"
 #include "task.h"
 
 #include "file_logger.h"
 #include "lpc_sys.h"
 #include "rtc.h"
 #include "ff.h"
+#include "lz_compress.h"
+#include "sys_config.h"
+#if (SYS_CFG_ENABLE_TLM)
+#include "c_tlm_comp.h"
+#include "c_tlm_var.h"
+#endif
 
 
 
 #if (FILE_LOGGER_KEEP_FILE_OPEN)
 static FIL *gp_file_ptr = NULL;                     ///< The pointer to the file object
+static uint32_t g_file_alloc_end = 0;               ///< How far the file's cluster chain reaches
+static uint32_t g_file_unsynced_since = 0;          ///< Uptime of the first write not yet synced
+static bool g_file_unsynced = false;                ///< The file was written since the last sync
+static volatile bool g_flush_requested = false;     ///< logger_send_flush_request() wants it synced
 #endif
 
 static uint16_t g_blocked_calls = 0;                ///< Number of logging calls that blocked
-static uint16_t g_buffer_watermark = 0;             ///< The watermark of the number of buffers consumed
+static uint16_t g_ring_watermark = 0;               ///< Most bytes waiting in the log ring
 static uint16_t g_highest_file_write_time = 0;      ///< Highest time spend while trying to write file buffer
-static char * gp_file_buffer = NULL;                ///< Pointer to local buffer space before it is written to file
-static QueueHandle_t g_write_buffer_queue = NULL;   ///< Log message pointers are written to this queue
-static QueueHandle_t g_empty_buffer_queue = NULL;   ///< Log message pointers are available from this queue
+static uint64_t g_file_write_time_us = 0;           ///< Total time spent writing and syncing the file
+static uint32_t g_bytes_written = 0;                ///< Bytes written to the file(s)
+static uint32_t g_file_size = 0;                    ///< Bytes in the log file being written
 static uint32_t g_logger_calls[log_last] = { 0 };   ///< Number of logged messages of each severity
+static uint32_t g_suppressed_calls[log_last] = { 0 }; ///< Number of messages of each severity dropped by the rate limits
+static uint32_t g_sampled_calls = 0;                ///< Number of debug messages skipped by sampling
+static uint32_t g_debug_sampling = FILE_LOGGER_DEBUG_SAMPLING; ///< 1 in this many debug messages are logged
 
 /**
  * Chooses severity levels that are printed on stdio and logged
@@ -52,6 +66,442 @@ static uint32_t g_logger_calls[log_last] = { 0 };   ///< Number of logged messag
  */
 static uint8_t g_logger_printf_mask = (1 << log_debug);
 
+#if (FILE_LOGGER_KEEP_FILE_OPEN)
+/**
+ * @{ The file kept open
+ * Every write goes to the end of the open file without re-opening it or walking its cluster chain.
+ * FatFs writes whole sectors straight to the disk and keeps a partial last sector in its buffer
+ * until the file is synced, so syncing on a cadence rather than after every write keeps the disk
+ * written in whole sectors, and the directory entry and FAT written once per sync.
+ *
+ * Only a sync writes the file's size to its directory entry, so after a power failure the file
+ * ends at the last sync, on a whole message: what was written after that is past the end.
+ */
+
+/**
+ * Stretches the file's cluster chain ahead of the writes, FILE_LOGGER_PREALLOC_SIZE at a time, so
+ * f_write() finds its clusters already linked (and contiguous where the disk allows) instead of
+ * searching the FAT for each one.  FatFs stretches the chain when seeking past the end in write mode;
+ * the file pointer and size are put back after, the size only covers what was written.  The seek
+ * lands on a sector boundary, so it leaves the file's sector buffer alone.
+ */
+static void logger_file_prealloc(FIL * fp, const uint32_t bytes_to_write)
+{
+    const DWORD fptr = fp->fptr;
+    const DWORD clust = fp->clust;
+    const DWORD fsize = fp->fsize;
+    const uint32_t end = (fptr + bytes_to_write + FILE_LOGGER_PREALLOC_SIZE - 1) /
+                         FILE_LOGGER_PREALLOC_SIZE * FILE_LOGGER_PREALLOC_SIZE;
+
+    if (fptr + bytes_to_write <= g_file_alloc_end) {
+        return;
+    }
+
+    /* A full disk stops the chain short of end: f_write() reports it, and the next write past the
+     * chain tries again, after the segment task may have freed some space
+     */
+    if (FR_OK == f_lseek(fp, end)) {
+        g_file_alloc_end = fp->fptr;
+    }
+
+    fp->fptr = fptr;
+    fp->clust = clust;
+    fp->fsize = fsize;
+}
+
+/**
+ * Syncs the file once it has had data waiting FILE_LOGGER_SYNC_TIME_SEC, or now if forced.
+ * @returns the ms until it needs to be synced, portMAX_DELAY if it is synced
+ */
+static uint32_t logger_sync_file(const bool force)
+{
+    const uint32_t sync_time_ms = 1000 * FILE_LOGGER_SYNC_TIME_SEC;
+    uint32_t waited_ms = 0;
+
+    if (!g_file_unsynced) {
+        return portMAX_DELAY;
+    }
+
+    waited_ms = sys_get_uptime_ms() - g_file_unsynced_since;
+    if (!force && waited_ms < sync_time_ms) {
+        return sync_time_ms - waited_ms;
+    }
+
+    const uint64_t start_time_us = sys_get_uptime_us();
+    g_file_unsynced = false;
+    f_sync(gp_file_ptr);
+    g_file_write_time_us += sys_get_uptime_us() - start_time_us;
+    return portMAX_DELAY;
+}
+
+/**
+ * Opens the file to keep it open, continuing where the last sync left it: clusters allocated past the
+ * end before a power failure are written over.  A text log not ending with a new line (cut short some
+ * other way) gets one, so the first new line is whole.
+ */
+static bool logger_open_file(FIL * fp)
+{
+    UINT bytes = 0;
+    char last = '\n';
+
+    if (FR_OK != f_open(fp, FILE_LOGGER_FILENAME, FA_OPEN_ALWAYS | FA_READ | FA_WRITE)) {
+        return false;
+    }
+
+    /* Reading the last byte leaves the file pointer at the end */
+    if (f_size(fp) > 0 && (FR_OK != f_lseek(fp, f_size(fp) - 1) || FR_OK != f_read(fp, &last, 1, &bytes))) {
+        f_close(fp);
+        return false;
+    }
+    #if (!FILE_LOGGER_BINARY)
+    if ('\n' != last) {
+        f_write(fp, "\n", 1, &bytes);
+        f_sync(fp);
+    }
+    #endif
+
+    g_file_alloc_end = f_size(fp);
+    return true;
+}
+/** @} */
+#endif
+
+#if (FILE_LOGGER_SEGMENT_SIZE)
+/**
+ * @{ Log segments
+ * The logger task retires the log file, the segment task compresses and deletes retired segments.
+ * They never use the same file, and FatFs locks the drive for each call.
+ */
+#if (FILE_LOGGER_LZ_BLOCK_SIZE >= FILE_LOGGER_LZ_STORED) || (FILE_LOGGER_LZ_BLOCK_SIZE > LZ_MAX_BLOCK_SIZE)
+#error "FILE_LOGGER_LZ_BLOCK_SIZE must be less than FILE_LOGGER_LZ_STORED"
+#endif
+
+#define LOGGER_SEGMENT_NAME_LEN 32                  ///< Fits "0:log_4294967295.csv"
+#define LOGGER_LZ_HEADER_LEN    8                   ///< FILE_LOGGER_LZ_MAGIC and the segment's length
+
+static uint32_t g_segment_seq = 0;                  ///< Number of the newest retired segment
+static SemaphoreHandle_t g_segment_sem = NULL;      ///< Given when a segment is retired
+
+/// The segments on the disk, by number, 0 if there are none
+typedef struct {
+    uint32_t newest;
+    uint32_t oldest;
+    uint32_t oldest_raw;    ///< Oldest segment not compressed yet
+} logger_segment_scan_t;
+
+/// Retired segments kept from the newest, for logger_get_segments()
+typedef struct {
+    logger_segment_t * segments;
+    uint32_t max;
+    uint32_t count;
+} logger_segment_list_t;
+
+/// What the segment task needs to compress a segment, allocated only while it does
+typedef struct {
+    FIL in;
+    FIL out;
+    uint16_t table[LZ_HASH_ENTRIES];
+    uint8_t raw[FILE_LOGGER_LZ_BLOCK_SIZE];
+    uint8_t packed[2 + LZ_COMPRESS_BOUND(FILE_LOGGER_LZ_BLOCK_SIZE)];
+} logger_lz_work_t;
+
+typedef bool (*logger_segment_callback_t)(const logger_segment_t * segment, void * arg);
+
+static void logger_segment_name(char * name, const uint32_t seq, const bool compressed)
+{
+    sprintf(name, FILE_LOGGER_SEGMENT_FORMAT "%s", (unsigned) seq, compressed ? FILE_LOGGER_LZ_EXT : FILE_LOGGER_EXT);
+}
+
+/// @returns true if the name is the given lower case text, ignoring case: 8.3 names may read back in capitals
+static bool logger_name_is(const char * name, const char * lower)
+{
+    while (*lower && tolower((unsigned char) *name) == *lower) {
+        name++;
+        lower++;
+    }
+    return !*lower && !*name;
+}
+
+/// @returns true if the name is a retired segment's, with its number and kind in segment
+static bool logger_segment_parse(const char * name, logger_segment_t * segment)
+{
+    const char * prefix = strchr(FILE_LOGGER_SEGMENT_FORMAT, ':') + 1;
+    char * ext = NULL;
+
+    for ( ; '%' != *prefix; prefix++, name++) {
+        if (tolower((unsigned char) *name) != *prefix) {
+            return false;
+        }
+    }
+    if (!isdigit((unsigned char) *name) || 0 == (segment->seq = strtoul(name, &ext, 10))) {
+        return false;
+    }
+
+    segment->compressed = logger_name_is(ext, FILE_LOGGER_LZ_EXT);
+    return segment->compressed || logger_name_is(ext, FILE_LOGGER_EXT);
+}
+
+/**
+ * Calls the callback for each retired segment in the directory, until it returns false.
+ * A segment whose compression was cut short shows up twice, compressed and not.
+ */
+static void logger_for_each_segment(logger_segment_callback_t callback, void * arg)
+{
+    DIR dir;
+    FILINFO info;
+    logger_segment_t segment;
+    const char * name = NULL;
+#if _USE_LFN
+    char lfn[LOGGER_SEGMENT_NAME_LEN];
+    info.lfname = lfn;
+    info.lfsize = sizeof(lfn);
+#endif
+
+    if (FR_OK != f_opendir(&dir, FILE_LOGGER_DIR)) {
+        return;
+    }
+    while (FR_OK == f_readdir(&dir, &info) && info.fname[0])
+    {
+        name = info.fname;
+#if _USE_LFN
+        name = lfn[0] ? lfn : info.fname;
+#endif
+        if (logger_segment_parse(name, &segment)) {
+            segment.size = info.fsize;
+            segment.log_size = segment.compressed ? 0 : info.fsize;
+            if (!callback(&segment, arg)) {
+                break;
+            }
+        }
+    }
+    f_closedir(&dir);
+}
+
+static bool logger_scan_callback(const logger_segment_t * segment, void * arg)
+{
+    logger_segment_scan_t * scan = (logger_segment_scan_t *) arg;
+    if (segment->seq > scan->newest) {
+        scan->newest = segment->seq;
+    }
+    if (!scan->oldest || segment->seq < scan->oldest) {
+        scan->oldest = segment->seq;
+    }
+    if (!segment->compressed && (!scan->oldest_raw || segment->seq < scan->oldest_raw)) {
+        scan->oldest_raw = segment->seq;
+    }
+    return true;
+}
+
+static void logger_scan_segments(logger_segment_scan_t * scan)
+{
+    memset(scan, 0, sizeof(*scan));
+    logger_for_each_segment(logger_scan_callback, scan);
+}
+
+/// Keeps the segment if it is one of the list's newest, in order from the newest
+static bool logger_list_callback(const logger_segment_t * segment, void * arg)
+{
+    logger_segment_list_t * list = (logger_segment_list_t *) arg;
+    uint32_t i = 0;
+
+    while (i < list->count && list->segments[i].seq >= segment->seq) {
+        i++;
+    }
+    if (i < list->max) {
+        if (list->count < list->max) {
+            list->count++;
+        }
+        memmove(&list->segments[i + 1], &list->segments[i], (list->count - 1 - i) * sizeof(*segment));
+        list->segments[i] = *segment;
+    }
+    return true;
+}
+
+/**
+ * Retires the log file as the next segment, starts a new one and wakes the segment task.
+ * If the rename fails, the log file carries on and the next write tries again.
+ */
+static void logger_rotate_file(void)
+{
+    char name[LOGGER_SEGMENT_NAME_LEN];
+    FRESULT err = FR_OK;
+
+    logger_segment_name(name, g_segment_seq + 1, false);
+
+#if (FILE_LOGGER_KEEP_FILE_OPEN)
+    /* Give back the clusters allocated ahead, and close the file to rename it */
+    f_truncate(gp_file_ptr);
+    f_close(gp_file_ptr);
+    g_file_unsynced = false;
+#endif
+
+    err = f_rename(FILE_LOGGER_FILENAME, name);
+    if (FR_OK == err || FR_EXIST == err) {
+        /* A number already taken is skipped */
+        ++g_segment_seq;
+    }
+    if (FR_OK == err) {
+        g_file_size = 0;
+        xSemaphoreGive(g_segment_sem);
+    }
+
+#if (FILE_LOGGER_KEEP_FILE_OPEN)
+    logger_open_file(gp_file_ptr);
+#endif
+}
+
+/// Deletes a segment, compressed or not or both; @returns false if there was nothing to delete
+static bool logger_delete_segment(const uint32_t seq)
+{
+    char name[LOGGER_SEGMENT_NAME_LEN];
+    bool deleted = false;
+
+    logger_segment_name(name, seq, false);
+    deleted = (FR_OK == f_unlink(name));
+    logger_segment_name(name, seq, true);
+    deleted = (FR_OK == f_unlink(name)) || deleted;
+    return deleted;
+}
+
+/**
+ * Compresses a retired segment into its ".lz" file, then deletes the segment.
+ * @returns false if it couldn't (the disk is full), the ".lz" file is deleted then
+ */
+static bool logger_compress_segment(logger_lz_work_t * work, const uint32_t seq)
+{
+    char raw_name[LOGGER_SEGMENT_NAME_LEN];
+    char lz_name[LOGGER_SEGMENT_NAME_LEN];
+    uint32_t log_size = 0;
+    UINT bytes = 0;
+    UINT written = 0;
+    bool success = false;
+
+    logger_segment_name(raw_name, seq, false);
+    logger_segment_name(lz_name, seq, true);
+    if (FR_OK != f_open(&work->in, raw_name, FA_READ)) {
+        return false;
+    }
+    if (FR_OK != f_open(&work->out, lz_name, FA_CREATE_ALWAYS | FA_WRITE)) {
+        f_close(&work->in);
+        return false;
+    }
+
+    /* Leave room for the header, it is written once the blocks are */
+    memset(work->packed, 0, LOGGER_LZ_HEADER_LEN);
+    success = (FR_OK == f_write(&work->out, work->packed, LOGGER_LZ_HEADER_LEN, &written) &&
+               LOGGER_LZ_HEADER_LEN == written);
+
+    while (success)
+    {
+        if (FR_OK != f_read(&work->in, work->raw, sizeof(work->raw), &bytes)) {
+            success = false;
+            break;
+        }
+        if (0 == bytes) {
+            break;
+        }
+
+        /* A block that doesn't get smaller is stored as it is */
+        uint32_t len = lz_compress(work->raw, bytes, work->packed + 2, sizeof(work->packed) - 2, work->table);
+        uint32_t tag = len;
+        if (0 == len || len >= bytes) {
+            memcpy(work->packed + 2, work->raw, bytes);
+            len = bytes;
+            tag = bytes | FILE_LOGGER_LZ_STORED;
+        }
+        work->packed[0] = tag & 0xFF;
+        work->packed[1] = tag >> 8;
+
+        success = (FR_OK == f_write(&work->out, work->packed, 2 + len, &written) && 2 + len == written);
+        log_size += bytes;
+    }
+
+    if (success) {
+        memcpy(work->packed, FILE_LOGGER_LZ_MAGIC, 4);
+        work->packed[4] = log_size & 0xFF;
+        work->packed[5] = (log_size >> 8) & 0xFF;
+        work->packed[6] = (log_size >> 16) & 0xFF;
+        work->packed[7] = log_size >> 24;
+        success = (FR_OK == f_lseek(&work->out, 0) &&
+                   FR_OK == f_write(&work->out, work->packed, LOGGER_LZ_HEADER_LEN, &written) &&
+                   LOGGER_LZ_HEADER_LEN == written);
+    }
+    success = (FR_OK == f_close(&work->out)) && success;
+    f_close(&work->in);
+
+    f_unlink(success ? raw_name : lz_name);
+    return success;
+}
+
+/// @returns the length of the log in a ".lz" file, 0 if it isn't finished
+static uint32_t logger_lz_log_size(const uint32_t seq)
+{
+    char name[LOGGER_SEGMENT_NAME_LEN];
+    uint8_t header[LOGGER_LZ_HEADER_LEN];
+    UINT bytes = 0;
+    uint32_t log_size = 0;
+    FIL * fp = malloc(sizeof(*fp));
+
+    logger_segment_name(name, seq, true);
+    if (NULL != fp && FR_OK == f_open(fp, name, FA_READ)) {
+        if (FR_OK == f_read(fp, header, sizeof(header), &bytes) && sizeof(header) == bytes &&
+            0 == memcmp(header, FILE_LOGGER_LZ_MAGIC, 4)) {
+            log_size = header[4] | (header[5] << 8) | (header[6] << 16) | ((uint32_t) header[7] << 24);
+        }
+        f_close(fp);
+    }
+    free(fp);
+    return log_size;
+}
+
+/**
+ * This is the segment task: each time a segment is retired, and once at start-up for the segments
+ * a reboot left behind, it deletes the segments past FILE_LOGGER_SEGMENTS, which makes room for
+ * the ".lz" files, and then compresses the rest, oldest first.
+ */
+static void logger_segment_task(void * p)
+{
+    logger_segment_scan_t scan;
+    (void) p;
+
+    while (1)
+    {
+        logger_scan_segments(&scan);
+        while (scan.oldest && scan.oldest + FILE_LOGGER_SEGMENTS <= scan.newest && logger_delete_segment(scan.oldest)) {
+            logger_scan_segments(&scan);
+        }
+
+        #if (FILE_LOGGER_COMPRESS)
+        logger_lz_work_t * work = NULL;
+        if (scan.oldest_raw && NULL != (work = malloc(sizeof(*work)))) {
+            while (scan.oldest_raw && logger_compress_segment(work, scan.oldest_raw)) {
+                logger_scan_segments(&scan);
+            }
+            free(work);
+        }
+        #endif
+
+        xSemaphoreTake(g_segment_sem, portMAX_DELAY);
+    }
+}
+
+/**
+ * Finds the newest retired segment and the size of the log file, and starts the segment task.
+ */
+static bool logger_segments_init(uint8_t priority)
+{
+    logger_segment_scan_t scan;
+
+    logger_scan_segments(&scan);
+    g_segment_seq = scan.newest;
+
+    g_segment_sem = xSemaphoreCreateBinary();
+    return (NULL != g_segment_sem &&
+            xTaskCreate(logger_segment_task, "logseg", FILE_LOGGER_SEGMENT_STACK_SIZE, NULL, priority, NULL));
+}
+/** @} */
+#endif
+
 /**
  * Writes the buffer to the file.
  * @param [in] buffer   The data pointer to write from
@@ -64,19 +514,32 @@ static bool logger_write_to_file(const void * buffer, const uint32_t bytes_to_wr
     UINT bytes_written = 0;
     const UINT bytes_to_write_uint = bytes_to_write;
     const uint32_t start_time = sys_get_uptime_ms();
+    const uint64_t start_time_us = sys_get_uptime_us();
 
     #if (!FILE_LOGGER_KEEP_FILE_OPEN)
     FIL fatfs_file = { 0 };
     #endif
 
+    #if (FILE_LOGGER_SEGMENT_SIZE)
+    if (g_file_size > 0 && g_file_size + bytes_to_write_uint > FILE_LOGGER_SEGMENT_SIZE) {
+        logger_rotate_file();
+    }
+    #endif
+    #if (FILE_LOGGER_KEEP_FILE_OPEN)
+    logger_file_prealloc(gp_file_ptr, bytes_to_write_uint);
+    #endif
+
     if (0 == bytes_to_write_uint) {
         success = true;
     }
-    /* File already open, so just write the data */
+    /* File already open, so just write the data, it is synced later by logger_sync_file() */
     #if (FILE_LOGGER_KEEP_FILE_OPEN)
     else if (FR_OK == (err = f_write(gp_file_ptr, buffer, bytes_to_write_uint, &bytes_written)))
     {
-        f_sync(gp_file_ptr);
+        if (!g_file_unsynced) {
+            g_file_unsynced = true;
+            g_file_unsynced_since = start_time;
+        }
     }
     #else
     /* File not opened, open it, seek it, and then write it */
@@ -98,6 +561,9 @@ static bool logger_write_to_file(const void * buffer, const uint32_t bytes_to_wr
     if (diff_time > g_highest_file_write_time) {
         g_highest_file_write_time = diff_time;
     }
+    g_file_write_time_us += sys_get_uptime_us() - start_time_us;
+    g_bytes_written += bytes_written;
+    g_file_size += bytes_written;
 
     /* To be successful, bytes written should be the same count as the bytes intended to be written */
     success = (bytes_to_write_uint == bytes_written);
@@ -116,139 +582,368 @@ static bool logger_write_to_file(const void * buffer, const uint32_t bytes_to_wr
 }
 
 /**
- * @returns a logger buffer pointer
- * @param [in] os_running If FreeRTOS is running, this will grab from the queue while potentially blocking
- *             otherwise it will return a buffer pointer without blocking since buffer will always be
- *             available if OS is not running since no multi-threaded operation is going on.
+ * @{ The log ring
+ * Producers claim space in one contiguous byte ring and format their message straight into it,
+ * the logger task writes the ring to the file in spans as long as it can make them.  Nothing is
+ * copied and nothing locks: a claim is one compare-and-swap on g_head (LDREX/STREX on the
+ * Cortex-M3), which holds both the ring position and a ticket numbering the claims.
+ *
+ * A producer doesn't know how long its message is until it has formatted it, so it claims
+ * FILE_LOGGER_LOG_MSG_MAX_LEN bytes and gives back what it didn't use if no one claimed after it,
+ * which is the usual case.  Otherwise the unused bytes stay behind as a hole the file never sees.
+ * A claim never wraps around the end of the ring, the bytes skipped to avoid that are its pad.
+ *
+ * Each ticket has a record, written when the message is complete (committed):
+ *      bit 31      : committed
+ *      bits 20..29 : pad
+ *      bits 10..19 : hole
+ *      bits  0..9  : length of the message, '\n' included
+ * The logger task writes messages in ticket order, so it stops at the first one still being
+ * formatted; a producer preempted mid-message holds back the ones after it, not their space.
+ */
+#define LOGGER_POS_MASK         0xFFFF          ///< Ring positions and tickets count modulo 64K
+#define LOGGER_TICKET_SHIFT     16              ///< g_head is (ticket << 16) | position
+#define LOGGER_REC_DONE         (1UL << 31)
+#define LOGGER_REC(pad, hole, len)  (LOGGER_REC_DONE | ((uint32_t)(pad) << 20) | ((uint32_t)(hole) << 10) | (len))
+#define LOGGER_REC_PAD(rec)     (((rec) >> 20) & 0x3FF)
+#define LOGGER_REC_HOLE(rec)    (((rec) >> 10) & 0x3FF)
+#define LOGGER_REC_LEN(rec)     ((rec) & 0x3FF)
+
+#if (FILE_LOGGER_RING_SIZE & (FILE_LOGGER_RING_SIZE - 1)) || FILE_LOGGER_RING_SIZE > 32768
+#error "FILE_LOGGER_RING_SIZE must be a power of 2, at most 32K"
+#endif
+#if (FILE_LOGGER_RING_RECORDS & (FILE_LOGGER_RING_RECORDS - 1)) || FILE_LOGGER_RING_RECORDS > 32768
+#error "FILE_LOGGER_RING_RECORDS must be a power of 2, at most 32K"
+#endif
+#if FILE_LOGGER_LOG_MSG_MAX_LEN > 1023 || FILE_LOGGER_LOG_MSG_MAX_LEN > FILE_LOGGER_RING_SIZE / 2
+#error "FILE_LOGGER_LOG_MSG_MAX_LEN must fit in 10 bits and twice in the ring"
+#endif
+
+static char * gp_ring = NULL;                       ///< FILE_LOGGER_RING_SIZE bytes
+static uint32_t * gp_records = NULL;                ///< FILE_LOGGER_RING_RECORDS records, by ticket
+static uint32_t g_head = 0;                         ///< Next claim: (ticket << 16) | position
+static uint32_t g_tail_pos = 0;                     ///< First position not yet written to the file
+static uint32_t g_tail_ticket = 0;                  ///< First ticket not yet written to the file
+static SemaphoreHandle_t g_wake_sem = NULL;         ///< Given to make the logger task write the ring
+/** @} */
+
+/// A claim on the ring
+typedef struct {
+    char *   ptr;       ///< FILE_LOGGER_LOG_MSG_MAX_LEN bytes to format the message into
+    uint32_t pos;       ///< Ring position of ptr
+    uint32_t ticket;
+    uint32_t pad;
+} logger_claim_t;
+
+/**
+ * Claims FILE_LOGGER_LOG_MSG_MAX_LEN contiguous bytes of the ring.
+ * @returns false if the ring doesn't have them or is out of records
  */
-static char * logger_get_buffer_ptr(const bool os_running)
+static bool logger_claim(logger_claim_t *claim)
 {
-    char * buffer = NULL;
+    const uint32_t need = FILE_LOGGER_LOG_MSG_MAX_LEN;
+    uint32_t head = __atomic_load_n(&g_head, __ATOMIC_RELAXED);
+    uint32_t next = 0;
+    uint32_t pos = 0;
+    uint32_t pad = 0;
 
-    /* Get an available buffer to write the data to, and if OS is not running, we will always get a buffer */
-    if (!os_running) {
-        xQueueReceive(g_empty_buffer_queue, &buffer, 0);
-    }
-    else if (!xQueueReceive(g_empty_buffer_queue, &buffer, OS_MS(FILE_LOGGER_BLOCK_TIME_MS))) {
-        ++g_blocked_calls;
+    do {
+        /* Stale tails are older, so they only make the ring look fuller */
+        const uint32_t tail_pos = __atomic_load_n(&g_tail_pos, __ATOMIC_ACQUIRE);
+        const uint32_t tail_ticket = __atomic_load_n(&g_tail_ticket, __ATOMIC_ACQUIRE);
+        const uint32_t ticket = head >> LOGGER_TICKET_SHIFT;
+        const uint32_t offset = head & (FILE_LOGGER_RING_SIZE - 1);
+
+        pos = head & LOGGER_POS_MASK;
+        pad = (offset + need > FILE_LOGGER_RING_SIZE) ? (FILE_LOGGER_RING_SIZE - offset) : 0;
+        if (((pos - tail_pos) & LOGGER_POS_MASK) + pad + need > FILE_LOGGER_RING_SIZE ||
+            ((ticket - tail_ticket) & LOGGER_POS_MASK) >= FILE_LOGGER_RING_RECORDS) {
+            return false;
+        }
+        next = (((ticket + 1) & LOGGER_POS_MASK) << LOGGER_TICKET_SHIFT) | ((pos + pad + need) & LOGGER_POS_MASK);
+    } while (!__atomic_compare_exchange_n(&g_head, &head, next, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
 
-        /* This time, just block forever until we get a buffer */
-        xQueueReceive(g_empty_buffer_queue, &buffer, portMAX_DELAY);
-    }
+    claim->ticket = head >> LOGGER_TICKET_SHIFT;
+    claim->pad = pad;
+    claim->pos = (pos + pad) & LOGGER_POS_MASK;
+    claim->ptr = gp_ring + (claim->pos & (FILE_LOGGER_RING_SIZE - 1));
 
-    return buffer;
+    const uint32_t waiting = ((next - __atomic_load_n(&g_tail_pos, __ATOMIC_RELAXED)) & LOGGER_POS_MASK);
+    if (waiting > g_ring_watermark) {
+        g_ring_watermark = waiting;
+    }
+    return true;
 }
 
 /**
- * Writes the buffer pointer to either file buffer, or directly to file if OS is not running
- * @param [in] buffer The buffer pointer to write
- * @param [in] os_running If OS is running, it will just queue the pointer, and not write directly to the file.
+ * Hands a formatted message to the logger task.
+ * @param [in] len  The message's length, its '\n' included
  */
-static void logger_write_log_message(char * buffer, const bool os_running)
+static void logger_commit(const logger_claim_t *claim, const uint32_t len)
 {
-    /* Send the buffer to the queue for the logger task to write */
-    if (os_running) {
-        xQueueSend(g_write_buffer_queue, &buffer, portMAX_DELAY);
+    const uint32_t ticket_bits = ((claim->ticket + 1) & LOGGER_POS_MASK) << LOGGER_TICKET_SHIFT;
+    uint32_t claimed_head = ticket_bits | ((claim->pos + FILE_LOGGER_LOG_MSG_MAX_LEN) & LOGGER_POS_MASK);
+    const uint32_t shrunk_head = ticket_bits | ((claim->pos + len) & LOGGER_POS_MASK);
+    uint32_t hole = FILE_LOGGER_LOG_MSG_MAX_LEN - len;
+
+    /* Give the unused bytes back unless someone claimed after us */
+    if (__atomic_compare_exchange_n(&g_head, &claimed_head, shrunk_head, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        hole = 0;
     }
-    /* No logging task to write the data, so we need to do it ourselves */
-    else {
-        size_t len = strlen(buffer);
-        buffer[len] = '\n';
-        buffer[++len] = '\0';
-        logger_write_to_file(buffer, len);
+    __atomic_store_n(&gp_records[claim->ticket & (FILE_LOGGER_RING_RECORDS - 1)],
+                     LOGGER_REC(claim->pad, hole, len), __ATOMIC_RELEASE);
+}
 
-        /* OS not running, so put the buffer back to the empty queue instead of write queue */
-        xQueueSend(g_empty_buffer_queue, &buffer, 0);
+/**
+ * Frees the ring up to the given position and ticket, after they were written to the file.
+ */
+static void logger_release(const uint32_t pos, const uint32_t ticket)
+{
+    uint32_t t = 0;
+    for (t = g_tail_ticket; t != ticket; t = (t + 1) & LOGGER_POS_MASK) {
+        gp_records[t & (FILE_LOGGER_RING_RECORDS - 1)] = 0;
     }
+    __atomic_store_n(&g_tail_pos, pos, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_tail_ticket, ticket, __ATOMIC_RELEASE);
 }
 
 /**
- * This is the actual FreeRTOS logger task responsible for:
- *      - Retrieve a log message written to the write queue
- *      - Copy it to our local buffer
- *      - If local buffer is full, write it to the file
- *      - Put-back the log message buffer to available queue
+ * Writes the committed messages to the file, in as few contiguous spans as the ring allows:
+ * one, two when they wrap around the end of the ring, more only after holes.
+ * Only the logger task calls this while FreeRTOS runs.
  */
-static void logger_task(void *p)
+static void logger_write_ring(void)
 {
-    /* Use "char * const" to disallow this pointer to be moved.
-     * We don't want to use "const char *" because we do want to be able to
-     * write to this pointer instead of using excessive casts later.
-     */
-    char * const start_ptr = gp_file_buffer;
-    char * const end_ptr = start_ptr + FILE_LOGGER_BUFFER_SIZE;
-
-    char * log_msg = NULL;
-    char * write_ptr = start_ptr;
-    size_t len = 0;
-    size_t buffer_overflow_cnt = 0;
+    uint32_t pos = g_tail_pos;
+    uint32_t ticket = g_tail_ticket;
+    uint32_t span_pos = pos;
+    uint32_t span_len = 0;
 
     while (1)
     {
-        /* Receive the log message we wish to write to our buffer.
-         * Timeout or NULL pointer received is the signal to flush the data.
-         */
-        log_msg = NULL;
-        if (!xQueueReceive(g_write_buffer_queue, &log_msg, OS_MS(1000 * FILE_LOGGER_FLUSH_TIME_SEC)) ||
-            NULL == log_msg)
-        {
-            logger_write_to_file(start_ptr, (write_ptr - start_ptr));
-            write_ptr = start_ptr;
-            continue;
+        const uint32_t rec = __atomic_load_n(&gp_records[ticket & (FILE_LOGGER_RING_RECORDS - 1)], __ATOMIC_ACQUIRE);
+        if (!(rec & LOGGER_REC_DONE)) {
+            break;
         }
 
-        /* Update the watermark of the number of messages we see in the queue and note that we
-         * add one to account for the message we just dequeued.
-         */
-        if ((len = (1 + uxQueueMessagesWaiting(g_write_buffer_queue)) ) > g_buffer_watermark) {
-            g_buffer_watermark = len;
+        /* A pad, a hole or the end of the ring ends the span */
+        const uint32_t msg_pos = (pos + LOGGER_REC_PAD(rec)) & LOGGER_POS_MASK;
+        if (span_len > 0 && (msg_pos != ((span_pos + span_len) & LOGGER_POS_MASK) ||
+                             0 == (msg_pos & (FILE_LOGGER_RING_SIZE - 1)))) {
+            logger_write_to_file(gp_ring + (span_pos & (FILE_LOGGER_RING_SIZE - 1)), span_len);
+            logger_release(pos, ticket);
+            span_len = 0;
         }
+        if (0 == span_len) {
+            span_pos = msg_pos;
+        }
+        span_len += LOGGER_REC_LEN(rec);
+        pos = (msg_pos + LOGGER_REC_LEN(rec) + LOGGER_REC_HOLE(rec)) & LOGGER_POS_MASK;
+        ticket = (ticket + 1) & LOGGER_POS_MASK;
+    }
 
-        /* Get the length and append the newline character */
-        len = strlen(log_msg);
-        log_msg[len] = '\n';
-        log_msg[++len] = '\0';
+    if (span_len > 0) {
+        logger_write_to_file(gp_ring + (span_pos & (FILE_LOGGER_RING_SIZE - 1)), span_len);
+    }
+    logger_release(pos, ticket);
+}
 
-        /* This is test code to immediately write data to the file.  It is highly in-efficient and is
-         * included here just for reference or test purposes.
-         */
-        #if 0
-        {
-            logger_write_to_file(log_msg, len);
-            xQueueSend(g_empty_buffer_queue, &log_msg, portMAX_DELAY);
-            continue;
-        }
+/**
+ * @returns true if FILE_LOGGER_BUFFER_SIZE bytes or more are waiting for the logger task
+ */
+static bool logger_buffer_full(void)
+{
+    const uint32_t head_pos = __atomic_load_n(&g_head, __ATOMIC_RELAXED) & LOGGER_POS_MASK;
+    return ((head_pos - __atomic_load_n(&g_tail_pos, __ATOMIC_RELAXED)) & LOGGER_POS_MASK) >= FILE_LOGGER_BUFFER_SIZE;
+}
+
+/**
+ * Claims ring space for a message, waiting for the logger task to make room if the ring is full.
+ * @param [in] os_running If FreeRTOS is not running, there is no logger task: the caller writes
+ *             the ring to the file itself.
+ */
+static void logger_claim_or_wait(logger_claim_t *claim, const bool os_running)
+{
+    if (logger_claim(claim)) {
+        return;
+    }
+    if (!os_running) {
+        logger_write_ring();
+        logger_claim(claim);
+        return;
+    }
+
+    ++g_blocked_calls;
+    do {
+        xSemaphoreGive(g_wake_sem);
+        vTaskDelay(OS_MS(FILE_LOGGER_BLOCK_TIME_MS));
+    } while (!logger_claim(claim));
+}
+
+/**
+ * Commits a message and sees it written: straight away if FreeRTOS is not running, otherwise
+ * by the logger task once a buffer's worth is waiting.
+ */
+static void logger_commit_and_write(const logger_claim_t *claim, const uint32_t len, const bool os_running)
+{
+    logger_commit(claim, len);
+
+    if (!os_running) {
+        logger_write_ring();
+        #if (FILE_LOGGER_KEEP_FILE_OPEN)
+        logger_sync_file(true);
         #endif
+    }
+    else if (logger_buffer_full()) {
+        xSemaphoreGive(g_wake_sem);
+    }
+}
 
-        /* If we will overflow our buffer we need to write the full buffer and do partial copy */
-        if (len + write_ptr >= end_ptr)
-        {
-            /* This could be zero when we write the last byte in the buffer */
-            buffer_overflow_cnt = (len + write_ptr - end_ptr);
+#if (FILE_LOGGER_RATE_LIMIT)
+/**
+ * @{ Rate limiting
+ * A token bucket is kept as the uptime at which it is full again: each message moves it 1000 / rate
+ * ms later, and a message that would move it more than the burst's worth past now is dropped.  The
+ * call sites and tasks are looked up in small tables by a linear search, under a critical section
+ * since any task may log.
+ */
+#if (FILE_LOGGER_SITE_RATE > 1000) || (FILE_LOGGER_TASK_RATE > 1000)
+#error "FILE_LOGGER_SITE_RATE and FILE_LOGGER_TASK_RATE must be at most 1000 messages per second"
+#endif
 
-            /* Copy the partial message up until the end of the buffer */
-            memcpy(write_ptr, log_msg, (end_ptr - write_ptr));
+typedef struct {
+    const void * key;           ///< The call site's format string, or the task's handle, NULL if unused
+    const char * name;          ///< The call site's filename, NULL for a task
+    uint16_t     line;          ///< The call site's line, 0 for a task
+    uint32_t     full_ms;       ///< Uptime at which the bucket is full again
+    uint32_t     last_ms;       ///< Uptime of the last call, the entry used least recently is reused
+    uint32_t     debug_calls;   ///< Debug calls, for the sampling
+    uint32_t     dropped;       ///< Messages dropped by the bucket
+} logger_limit_t;
 
-            /* Write the entire buffer to the file */
-            logger_write_to_file(start_ptr, (end_ptr - start_ptr));
+static logger_limit_t g_limit_sites[FILE_LOGGER_LIMIT_SITES];
+static logger_limit_t g_limit_tasks[FILE_LOGGER_LIMIT_TASKS];
 
-            /* Optional: Zero out the buffer space */
-            // memset(start_ptr, '\0', buffer_size);
+/**
+ * @returns the table's entry for the key, reusing the least recently used one if it has none
+ */
+static logger_limit_t * logger_limit_find(logger_limit_t * table, const uint32_t size, const void * key,
+                                          const char * name, const uint16_t line, const uint32_t now)
+{
+    logger_limit_t * entry = &table[0];
+    uint32_t i = 0;
 
-            /* Copy the left-over message to the start of "fresh" buffer space (after writing to the file) */
-            if (buffer_overflow_cnt > 0) {
-                memcpy(start_ptr, (log_msg + len - buffer_overflow_cnt), buffer_overflow_cnt);
-            }
-            write_ptr = start_ptr + buffer_overflow_cnt;
+    /* Entries are used in order and never freed, so the first unused one ends the search */
+    for (i = 0; i < size; i++) {
+        if (key == table[i].key) {
+            return &table[i];
         }
-        /* Buffer has enough space, write the entire message to the buffer */
-        else {
-            memcpy(write_ptr, log_msg, len);
-            write_ptr += len;
+        if (NULL == table[i].key) {
+            entry = &table[i];
+            break;
         }
+        if ((int32_t) (table[i].last_ms - entry->last_ms) < 0) {
+            entry = &table[i];
+        }
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->key = key;
+    entry->name = name;
+    entry->line = line;
+    entry->full_ms = now;
+    return entry;
+}
+
+/// @returns true if the bucket has a message's worth left
+static bool logger_limit_has_room(logger_limit_t * limit, const uint32_t now, const uint32_t rate, const uint32_t burst)
+{
+    if (0 == rate) {
+        return true;
+    }
+    if ((int32_t) (limit->full_ms - now) < 0) {
+        limit->full_ms = now;
+    }
+    return (limit->full_ms - now) + (1000 / rate) <= burst * (1000 / rate);
+}
+
+static void logger_limit_take(logger_limit_t * limit, const uint32_t rate)
+{
+    if (0 != rate) {
+        limit->full_ms += 1000 / rate;
+    }
+}
+
+/**
+ * Samples debug messages and applies the call site's and the task's rate limits.
+ * @returns false if the message is to be dropped, it is counted then
+ */
+static bool logger_limit(const logger_msg_t type, const void * site, const char * filename, const unsigned line_num)
+{
+    const uint32_t now = sys_get_uptime_ms();
+    const TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    logger_limit_t * site_limit = NULL;
+    logger_limit_t * task_limit = NULL;
+    bool pass = true;
+
+    taskENTER_CRITICAL();
+    site_limit = logger_limit_find(g_limit_sites, FILE_LOGGER_LIMIT_SITES, site, filename, line_num, now);
+    task_limit = logger_limit_find(g_limit_tasks, FILE_LOGGER_LIMIT_TASKS, task, NULL, 0, now);
+    site_limit->last_ms = now;
+    task_limit->last_ms = now;
+
+    if (log_debug == type && 0 != (site_limit->debug_calls++ % g_debug_sampling)) {
+        ++g_sampled_calls;
+        pass = false;
+    }
+    else if (!logger_limit_has_room(site_limit, now, FILE_LOGGER_SITE_RATE, FILE_LOGGER_SITE_BURST)) {
+        ++site_limit->dropped;
+        ++g_suppressed_calls[type];
+        pass = false;
+    }
+    else if (!logger_limit_has_room(task_limit, now, FILE_LOGGER_TASK_RATE, FILE_LOGGER_TASK_BURST)) {
+        ++task_limit->dropped;
+        ++g_suppressed_calls[type];
+        pass = false;
+    }
+    else {
+        logger_limit_take(site_limit, FILE_LOGGER_SITE_RATE);
+        logger_limit_take(task_limit, FILE_LOGGER_TASK_RATE);
+    }
+    taskEXIT_CRITICAL();
+
+    return pass;
+}
+/** @} */
+#endif
 
-        /* Put the data pointer back to the available buffers */
-        xQueueSend(g_empty_buffer_queue, &log_msg, portMAX_DELAY);
+/**
+ * This is the actual FreeRTOS logger task: it sleeps until a buffer's worth of messages is
+ * waiting in the ring, a flush is requested or FILE_LOGGER_FLUSH_TIME_SEC passes, and then
+ * writes every committed message to the file.  A file kept open is also synced on a flush,
+ * and otherwise FILE_LOGGER_SYNC_TIME_SEC after it was written.
+ */
+static void logger_task(void *p)
+{
+    const uint32_t flush_time_ms = 1000 * FILE_LOGGER_FLUSH_TIME_SEC;
+    uint32_t timeout_ms = flush_time_ms;
+
+    while (1)
+    {
+        const bool timed_out = !xSemaphoreTake(g_wake_sem, OS_MS(timeout_ms));
+        logger_write_ring();
+
+        #if (FILE_LOGGER_KEEP_FILE_OPEN)
+        do {
+            const bool force = timed_out || g_flush_requested;
+            g_flush_requested = false;
+            const uint32_t sync_ms = logger_sync_file(force);
+            timeout_ms = (sync_ms < flush_time_ms) ? sync_ms : flush_time_ms;
+        } while (0);
+        #else
+        (void) timed_out;
+        #endif
     }
 }
 
@@ -257,7 +952,7 @@ static void logger_task(void *p)
  */
 static bool logger_initialized(void)
 {
-    return (NULL != gp_file_buffer);
+    return (NULL != gp_ring);
 }
 
 /**
@@ -267,51 +962,46 @@ static bool logger_initialized(void)
  */
 static bool logger_internal_init(UBaseType_t logger_priority)
 {
-    uint32_t i = 0;
-    char * ptr = NULL;
     const bool success = true;
 
-    /* Create the buffer space we write the logged messages to (before we flush it to the file) */
-    gp_file_buffer = (char*) malloc(FILE_LOGGER_BUFFER_SIZE);
-    if (NULL == gp_file_buffer) {
+    /* Create the ring the messages are formatted into, and its records */
+    gp_ring = (char*) malloc(FILE_LOGGER_RING_SIZE);
+    gp_records = (uint32_t*) calloc(FILE_LOGGER_RING_RECORDS, sizeof(*gp_records));
+    g_wake_sem = xSemaphoreCreateBinary();
+    if (NULL == gp_ring || NULL == gp_records || NULL == g_wake_sem) {
         goto failure;
     }
 
-    /* Create the queues that keep track of the written buffers, and available buffers */
-    g_write_buffer_queue = xQueueCreate(FILE_LOGGER_NUM_BUFFERS, sizeof(char*));
-    g_empty_buffer_queue = xQueueCreate(FILE_LOGGER_NUM_BUFFERS, sizeof(char*));
-    if (NULL == g_write_buffer_queue || NULL == g_empty_buffer_queue) {
-        goto failure;
-    }
-
-    /* Create the actual buffers for log messages */
-    for (i = 0; i < FILE_LOGGER_NUM_BUFFERS; i++)
-    {
-        ptr = (char*) malloc(FILE_LOGGER_LOG_MSG_MAX_LEN);
-
-        if (NULL == ptr) {
-            goto failure;
-        }
-
-        /* DO NOT USE xQueueSendFromISR().
-         * It causes weird file write errors and corrupts the entire file system
-         * when the logger task is running.
-         */
-        xQueueSend(g_empty_buffer_queue, &ptr, 0);
-    }
-
 #if (FILE_LOGGER_KEEP_FILE_OPEN)
     gp_file_ptr = malloc (sizeof(*gp_file_ptr));
-    if(FR_OK != f_open(gp_file_ptr, FILE_LOGGER_FILENAME, FA_OPEN_ALWAYS | FA_WRITE))
+    if(NULL == gp_file_ptr || !logger_open_file(gp_file_ptr))
     {
         goto failure;
     }
 #endif
 
+    /* Logging carries on where the file ends */
+    do {
+        FILINFO info;
+#if _USE_LFN
+        info.lfname = NULL;
+        info.lfsize = 0;
+#endif
+        g_file_size = (FR_OK == f_stat(FILE_LOGGER_FILENAME, &info)) ? info.fsize : 0;
+    } while (0);
+
 #if BUILD_CFG_MPU
     logger_priority |= portPRIVILEGE_BIT;
 #endif
 
+#if (FILE_LOGGER_SEGMENT_SIZE)
+    /* Compressing segments is the least urgent work there is, short of idling */
+    if (!logger_segments_init(PRIORITY_LOW | (logger_priority & portPRIVILEGE_BIT)))
+    {
+        goto failure;
+    }
+#endif
+
     if (!xTaskCreate(logger_task, "logger", FILE_LOGGER_STACK_SIZE, NULL, logger_priority, NULL))
     {
         goto failure;
@@ -321,21 +1011,26 @@ static bool logger_internal_init(UBaseType_t logger_priority)
 
     /* failure case to delete allocated memory */
     failure:
-        if (gp_file_buffer) {
-            free(gp_file_buffer);
-            gp_file_buffer = NULL;
+        if (gp_ring) {
+            free(gp_ring);
+            gp_ring = NULL;
         }
-
-        if (g_empty_buffer_queue) {
-            for (i = 0; i < FILE_LOGGER_NUM_BUFFERS; i++) {
-                if (xQueueReceive(g_empty_buffer_queue, &ptr, 0)) {
-                    free (ptr);
-                }
-            }
+        if (gp_records) {
+            free(gp_records);
+            gp_records = NULL;
         }
-
-        /* Delete g_write_buffer_queue */
-        /* Delete g_empty_buffer_queue */
+        if (g_wake_sem) {
+            vSemaphoreDelete(g_wake_sem);
+            g_wake_sem = NULL;
+        }
+#if (FILE_LOGGER_KEEP_FILE_OPEN)
+        if (gp_file_ptr) {
+            /* f_open() clears the file object first, so this is harmless if it failed */
+            f_close(gp_file_ptr);
+            free(gp_file_ptr);
+            gp_file_ptr = NULL;
+        }
+#endif
 
         return (!success);
 }
@@ -344,8 +1039,10 @@ void logger_send_flush_request(void)
 {
     if (taskSCHEDULER_RUNNING == xTaskGetSchedulerState() && logger_initialized())
     {
-        char * null_ptr_to_flush = NULL;
-        xQueueSend(g_write_buffer_queue, &null_ptr_to_flush, portMAX_DELAY);
+        #if (FILE_LOGGER_KEEP_FILE_OPEN)
+        g_flush_requested = true;
+        #endif
+        xSemaphoreGive(g_wake_sem);
     }
 }
 
@@ -354,6 +1051,16 @@ uint32_t logger_get_logged_call_count(logger_msg_t severity)
     return (severity < log_last) ? g_logger_calls[severity] : 0;
 }
 
+uint32_t logger_get_suppressed_call_count(logger_msg_t severity)
+{
+    return (severity < log_last) ? g_suppressed_calls[severity] : 0;
+}
+
+uint32_t logger_get_sampled_call_count(void)
+{
+    return g_sampled_calls;
+}
+
 uint16_t logger_get_blocked_call_count(void)
 {
     return g_blocked_calls;
@@ -364,11 +1071,364 @@ uint16_t logger_get_highest_file_write_time_ms(void)
     return g_highest_file_write_time;
 }
 
-uint16_t logger_get_num_buffers_watermark(void)
+uint16_t logger_get_ring_watermark(void)
+{
+    return g_ring_watermark;
+}
+
+uint32_t logger_get_bytes_written(void)
+{
+    return g_bytes_written;
+}
+
+uint32_t logger_get_file_write_time_ms(void)
+{
+    return g_file_write_time_us / 1000;
+}
+
+uint32_t logger_get_segments(logger_segment_t * segments, uint32_t max)
+{
+    uint32_t count = 0;
+
+    if (max > 0) {
+        segments[0].seq = 0;
+        segments[0].compressed = false;
+        segments[0].size = g_file_size;
+        segments[0].log_size = g_file_size;
+        count = 1;
+    }
+
+#if (FILE_LOGGER_SEGMENT_SIZE)
+    if (max > 1) {
+        uint32_t i = 0;
+        logger_segment_list_t list = { segments + 1, max - 1, 0 };
+        logger_for_each_segment(logger_list_callback, &list);
+        for (i = 0; i < list.count; i++) {
+            if (list.segments[i].compressed) {
+                list.segments[i].log_size = logger_lz_log_size(list.segments[i].seq);
+            }
+        }
+        count += list.count;
+    }
+#endif
+
+    return count;
+}
+
+uint32_t logger_get_limited(logger_limited_t * limited, uint32_t max, bool tasks)
 {
-    return g_buffer_watermark;
+    uint32_t count = 0;
+
+#if (FILE_LOGGER_RATE_LIMIT)
+    const logger_limit_t * table = tasks ? g_limit_tasks : g_limit_sites;
+    const uint32_t size = tasks ? FILE_LOGGER_LIMIT_TASKS : FILE_LOGGER_LIMIT_SITES;
+    uint32_t i = 0;
+
+    taskENTER_CRITICAL();
+    for (i = 0; i < size && count < max && NULL != table[i].key; i++) {
+        if (table[i].dropped > 0) {
+            /* Tasks are never deleted, so their handles stay good */
+            limited[count].name = tasks ? pcTaskGetTaskName((TaskHandle_t) table[i].key) : table[i].name;
+            limited[count].line = table[i].line;
+            limited[count].dropped = table[i].dropped;
+            count++;
+        }
+    }
+    taskEXIT_CRITICAL();
+#else
+    (void) limited;
+    (void) max;
+    (void) tasks;
+#endif
+
+    return count;
+}
+
+/**
+ * vsnprintf() to the end of a claim
+ * @returns the new length, at most FILE_LOGGER_LOG_MSG_MAX_LEN - 2 to leave room for "\n\0"
+ *
+ * Note: vsnprintf() returns the number of chars that would've been printed if n was sufficiently
+ *       large, so it is clamped to what fit instead of taking strlen().
+ */
+static uint32_t logger_vprintf(char * buffer, uint32_t len, const char * msg, va_list args)
+{
+    const uint32_t max_len = FILE_LOGGER_LOG_MSG_MAX_LEN - 2;
+    if (len < max_len) {
+        const int printed = vsnprintf(buffer + len, max_len + 1 - len, msg, args);
+        if (printed > 0) {
+            len += printed;
+        }
+    }
+    return (len < max_len) ? len : max_len;
+}
+
+static uint32_t logger_printf(char * buffer, uint32_t len, const char * msg, ...)
+{
+    va_list args;
+    va_start(args, msg);
+    len = logger_vprintf(buffer, len, msg, args);
+    va_end(args);
+    return len;
+}
+
+/**
+ * Formats a log message as a line of text, without its '\n'
+ * @returns the length of the line
+ */
+static uint32_t logger_format(char * buffer, logger_msg_t type, const rtc_t * time, unsigned int uptime,
+                              const char * filename, const char * func_name, unsigned line_num,
+                              const char * msg, va_list args)
+{
+    uint32_t len = 0;
+
+    /* This must match up with the logger_msg_t enumeration */
+    const char * const type_str[] = { "debug", "info", "warn", "error" };
+
+    do {
+        int mon = time->month;
+        int day = time->day;
+        int hr = time->hour;
+        int min = time->min;
+        int sec = time->sec;
+        unsigned int up = uptime;
+        const char *log_type_str = type_str[type];
+        const char *func_parens  = func_name[0] ? "()" : "";
+
+        /* Write the header including time, filename, function name etc */
+        len = logger_printf(buffer, 0, "%d/%d,%02d:%02d:%02d,%u,%s,%s,%s%s,%u,",
+                            mon, day, hr, min, sec, up, log_type_str, filename, func_name, func_parens, line_num);
+    } while (0);
+
+    /* Append actual user message */
+    return logger_vprintf(buffer, len, msg, args);
 }
 
+#if (FILE_LOGGER_BINARY)
+/**
+ * @{ Binary records, see FILE_LOGGER_BINARY in file_logger.h
+ * Nothing is formatted: strings in flash are logged by their address, which tools/logdecode looks up
+ * in the firmware's ELF file, anything else is copied.
+ */
+extern const char _etext[];     ///< End of the flash image, from loader.ld
+
+static const char g_bin_marker[] = FILE_LOGGER_BIN_MARKER;
+
+/**
+ * @returns true if str is in flash, so its address is enough to find it in the ELF file
+ */
+static bool logger_in_flash(const void * str)
+{
+    return (uintptr_t) str < (uintptr_t) _etext;
+}
+
+/**
+ * Appends a tagged argument to a record.
+ * @returns false if it didn't fit
+ */
+static bool logger_bin_put(char ** p, const char * end, char tag, const void * data, uint32_t size)
+{
+    if (*p + 1 + size > end) {
+        return false;
+    }
+    *(*p)++ = tag;
+    memcpy(*p, data, size);
+    *p += size;
+    return true;
+}
+
+/**
+ * Appends an integer argument as wide as it was passed, 4 or 8 bytes
+ */
+static bool logger_bin_put_int(char ** p, const char * end, int64_t value, uint32_t size)
+{
+    const int32_t value32 = (int32_t) value;
+    return (8 == size) ? logger_bin_put(p, end, FILE_LOGGER_BIN_ARG_INT64, &value, 8) :
+                         logger_bin_put(p, end, FILE_LOGGER_BIN_ARG_INT32, &value32, 4);
+}
+
+/**
+ * Appends a string argument: its address if it is in flash, otherwise the string itself, cut short to fit
+ */
+static bool logger_bin_put_str(char ** p, const char * end, const char * str)
+{
+    char * out = *p;
+
+    if (NULL == str) {
+        str = "(null)";
+    }
+    if (logger_in_flash(str)) {
+        const uint32_t addr = (uint32_t) (uintptr_t) str;
+        return logger_bin_put(p, end, FILE_LOGGER_BIN_ARG_STR_ADDR, &addr, 4);
+    }
+    if (out + 2 > end) {
+        return false;
+    }
+    *out++ = FILE_LOGGER_BIN_ARG_STR;
+    while (*str && out < end - 1) {
+        *out++ = *str++;
+    }
+    *out++ = '\0';
+    *p = out;
+    return true;
+}
+
+/**
+ * Appends the arguments the format string's conversions take, in order; logdecode walks the format
+ * the same way to put them back.
+ * @param [in] args  NULL if the format takes none
+ * @returns false if they didn't all fit
+ */
+static bool logger_bin_put_args(char ** p, const char * end, const char * fmt, va_list * args)
+{
+    bool fits = true;
+
+    while (fits && NULL != (fmt = strchr(fmt, '%')))
+    {
+        char length = 0;
+        uint32_t longs = 0;
+        ++fmt;
+
+        /* Flags, width and precision, a '*' takes an int */
+        for ( ; *fmt && strchr("-+ #0'.123456789*", *fmt); fmt++) {
+            if ('*' == *fmt) {
+                fits = fits && logger_bin_put_int(p, end, va_arg(*args, int), sizeof(int));
+            }
+        }
+        for ( ; *fmt && strchr("hlLqjzt", *fmt); fmt++) {
+            length = *fmt;
+            longs += ('l' == *fmt);
+        }
+
+        switch (*fmt)
+        {
+            case '%':
+                break;
+
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+                if (longs > 1 || 'q' == length || 'j' == length) {
+                    fits = fits && logger_bin_put_int(p, end, va_arg(*args, long long), sizeof(long long));
+                }
+                else if (longs) {
+                    fits = fits && logger_bin_put_int(p, end, va_arg(*args, long), sizeof(long));
+                }
+                else if ('z' == length || 't' == length) {
+                    fits = fits && logger_bin_put_int(p, end, va_arg(*args, size_t), sizeof(size_t));
+                }
+                else {
+                    fits = fits && logger_bin_put_int(p, end, va_arg(*args, int), sizeof(int));
+                }
+                break;
+
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                do {
+                    const double value = ('L' == length) ? (double) va_arg(*args, long double) : va_arg(*args, double);
+                    fits = fits && logger_bin_put(p, end, FILE_LOGGER_BIN_ARG_DOUBLE, &value, 8);
+                } while (0);
+                break;
+
+            case 's':
+                fits = fits && logger_bin_put_str(p, end, va_arg(*args, const char *));
+                break;
+
+            case 'p':
+                do {
+                    const uint32_t value = (uint32_t) (uintptr_t) va_arg(*args, void *);
+                    fits = fits && logger_bin_put(p, end, FILE_LOGGER_BIN_ARG_PTR, &value, 4);
+                } while (0);
+                break;
+
+            case 'n':
+                (void) va_arg(*args, void *);
+                break;
+
+            default:
+                /* The end of the format, or a conversion printf() doesn't know either */
+                return fits;
+        }
+        ++fmt;
+    }
+    return fits;
+}
+
+/**
+ * Writes a binary record of a log message: a logger_bin_header_t, the format string if it isn't in
+ * flash, and the arguments.
+ * @returns the length of the record, at most FILE_LOGGER_LOG_MSG_MAX_LEN
+ */
+static uint32_t logger_bin_record(char * buffer, uint8_t flags, const rtc_t * time, unsigned int uptime,
+                                  const char * filename, const char * func_name, unsigned line_num,
+                                  const char * msg, va_list * args)
+{
+    const char * const end = buffer + FILE_LOGGER_LOG_MSG_MAX_LEN;
+    char * p = buffer + sizeof(logger_bin_header_t);
+    logger_bin_header_t header;
+
+    /* A format string not in flash is copied, cut short to leave room for the arguments */
+    if (!logger_in_flash(msg)) {
+        const char * const inline_end = p + (end - p) / 2;
+        flags |= FILE_LOGGER_BIN_INLINE;
+        header.msg = 0;
+        while (*msg && p < inline_end) {
+            *p++ = *msg++;
+        }
+        *p++ = '\0';
+        msg = buffer + sizeof(header);
+    }
+    else {
+        header.msg = (uint32_t) (uintptr_t) msg;
+    }
+
+    if (!logger_bin_put_args(&p, end, msg, args)) {
+        flags |= FILE_LOGGER_BIN_TRUNCATED;
+    }
+
+    header.len = p - buffer;
+    header.line = (line_num > 0xFFFF) ? 0xFFFF : line_num;
+    header.flags = flags;
+    header.month = time->month;
+    header.day = time->day;
+    header.hour = time->hour;
+    header.min = time->min;
+    header.sec = time->sec;
+    header.uptime_ms = uptime;
+    header.filename = logger_in_flash(filename) ? (uint32_t) (uintptr_t) filename : 0;
+    header.func_name = logger_in_flash(func_name) ? (uint32_t) (uintptr_t) func_name : 0;
+    memcpy(buffer, &header, sizeof(header));
+
+    return header.len;
+}
+
+static void logger_bin_log_start(void)
+{
+    logger_claim_t claim;
+    const rtc_t time = rtc_gettime();
+    const bool os_running = (taskSCHEDULER_RUNNING == xTaskGetSchedulerState());
+
+    logger_claim_or_wait(&claim, os_running);
+    const uint32_t len = logger_bin_record(claim.ptr, FILE_LOGGER_BIN_START, &time, sys_get_uptime_ms(),
+                                           NULL, NULL, 0, g_bin_marker, NULL);
+    logger_commit_and_write(&claim, len, os_running);
+}
+/** @} */
+#endif
+
+#if (SYS_CFG_ENABLE_TLM)
+/**
+ * Registers the counters of the calls that were blocked or dropped with the debug telemetry component
+ */
+static void logger_reg_tlm(void)
+{
+    tlm_component * debug = tlm_component_get_by_name(SYS_CFG_DEBUG_TLM_NAME);
+    if (!TLM_REG_ARR(debug, g_logger_calls, tlm_uint) ||
+        !TLM_REG_ARR(debug, g_suppressed_calls, tlm_uint) ||
+        !TLM_REG_VAR(debug, g_sampled_calls, tlm_uint) ||
+        !TLM_REG_VAR(debug, g_blocked_calls, tlm_uint)) {
+        printf("ERROR: logger telemetry registration failure\n");
+    }
+}
+#endif
+
 void logger_init(uint8_t logger_priority)
 {
     /* Prevent double init */
@@ -377,6 +1437,15 @@ void logger_init(uint8_t logger_priority)
         if (!logger_internal_init(logger_priority)) {
             printf("ERROR: logger initialization failure\n");
         }
+#if (FILE_LOGGER_BINARY)
+        else {
+            /* logdecode checks this record against the ELF file it is given */
+            logger_bin_log_start();
+        }
+#endif
+#if (SYS_CFG_ENABLE_TLM)
+        logger_reg_tlm();
+#endif
     }
 }
 
@@ -391,6 +1460,11 @@ void logger_set_printf(logger_msg_t type, bool enable)
     }
 }
 
+void logger_set_debug_sampling(uint32_t one_in)
+{
+    g_debug_sampling = (one_in > 0) ? one_in : 1;
+}
+
 void logger_log(logger_msg_t type, const char * filename, const char * func_name, unsigned line_num,
                 const char * msg, ...)
 {
@@ -399,15 +1473,13 @@ void logger_log(logger_msg_t type, const char * filename, const char * func_name
     }
 
     uint32_t len = 0;
-    char * buffer = NULL;
+    logger_claim_t claim;
     char * temp_ptr = NULL;
+    va_list args;
     const rtc_t time = rtc_gettime();
     const unsigned int uptime = sys_get_uptime_ms();
     const bool os_running = (taskSCHEDULER_RUNNING == xTaskGetSchedulerState());
 
-    /* This must match up with the logger_msg_t enumeration */
-    const char * const type_str[] = { "debug", "info", "warn", "error" };
-
     // Find the back-slash or forward-slash to get filename only, not absolute or relative path
     if(0 != filename) {
         temp_ptr = strrchr(filename, '/');
@@ -423,51 +1495,42 @@ void logger_log(logger_msg_t type, const char * filename, const char * func_name
         func_name = "";
     }
 
-    /* Get an available buffer */
-    buffer = logger_get_buffer_ptr(os_running);
-
-    do {
-        int mon = time.month;
-        int day = time.day;
-        int hr = time.hour;
-        int min = time.min;
-        int sec = time.sec;
-        unsigned int up = uptime;
-        const char *log_type_str = type_str[type];
-        const char *func_parens  = func_name[0] ? "()" : "";
+#if (FILE_LOGGER_RATE_LIMIT)
+    if (os_running && !logger_limit(type, msg, filename, line_num)) {
+        return;
+    }
+#endif
 
-        /* Write the header including time, filename, function name etc */
-        len = sprintf(buffer, "%d/%d,%02d:%02d:%02d,%u,%s,%s,%s%s,%u,",
-                      mon, day, hr, min, sec, up, log_type_str, filename, func_name, func_parens, line_num);
-    } while (0);
+    /* Claim ring space, the message is formatted (or recorded) right into it */
+    logger_claim_or_wait(&claim, os_running);
 
-    /* Append actual user message, and leave one space for \n to be appended by the logger task.
-     * There is no efficient way to append \n here since we will have to use strlen(),
-     * but since the logger task will take strlen() anyway, it can append it there.
-     *
-     * Example: max length = 10, and say we printed 5 chars so far "hello"
-     *          we will sprintf "world" to "hello" where n = 10-5-1 = 4
-     *          So, this sprintf will append and make it: "hellowor\0" leaving space to add \n
-     *
-     * Note: You cannot use returned value from vsnprintf() because snprintf() returns:
-     *       "number of chars that would've been printed if n was sufficiently large"
-     *
-     * Note: "size" of snprintf() includes the NULL character
-     */
-    do {
-        va_list args;
-        va_start(args, msg);
-        vsnprintf(buffer + len, FILE_LOGGER_LOG_MSG_MAX_LEN-len-1, msg, args);
-        va_end(args);
-    } while (0);
+    va_start(args, msg);
+#if (FILE_LOGGER_BINARY)
+    len = logger_bin_record(claim.ptr, type, &time, uptime, filename, func_name, line_num, msg, &args);
+#else
+    len = logger_format(claim.ptr, type, &time, uptime, filename, func_name, line_num, msg, args);
+#endif
+    va_end(args);
 
     ++g_logger_calls[type];
-    logger_write_log_message(buffer, os_running);
 
-    /* Print the message out if the printf mask was set */
+    /* Print the message out if the printf mask was set, while the claim is still ours */
     if (g_logger_printf_mask & (1 << type)) {
-        puts(buffer);
+#if (FILE_LOGGER_BINARY)
+        char line[FILE_LOGGER_LOG_MSG_MAX_LEN];
+        va_start(args, msg);
+        logger_format(line, type, &time, uptime, filename, func_name, line_num, msg, args);
+        va_end(args);
+        puts(line);
+#else
+        puts(claim.ptr);
+#endif
     }
+
+#if (!FILE_LOGGER_BINARY)
+    claim.ptr[len++] = '\n';
+#endif
+    logger_commit_and_write(&claim, len, os_running);
 }
 
 void logger_log_raw(const char * msg, ...)
@@ -476,16 +1539,30 @@ void logger_log_raw(const char * msg, ...)
         return;
     }
 
+    uint32_t len = 0;
+    logger_claim_t claim;
+    va_list args;
     const bool os_running = (taskSCHEDULER_RUNNING == xTaskGetSchedulerState());
-    char * buffer = logger_get_buffer_ptr(os_running);
 
-    /* Print the actual user message to the buffer */
+#if (FILE_LOGGER_RATE_LIMIT)
+    if (os_running && !logger_limit(log_info, msg, "", 0)) {
+        return;
+    }
+#endif
+    logger_claim_or_wait(&claim, os_running);
+
+    /* Print the actual user message to the ring */
+    va_start(args, msg);
+#if (FILE_LOGGER_BINARY)
     do {
-        va_list args;
-        va_start(args, msg);
-        vsnprintf(buffer, FILE_LOGGER_LOG_MSG_MAX_LEN-1, msg, args);
-        va_end(args);
+        const rtc_t time = rtc_gettime();
+        len = logger_bin_record(claim.ptr, FILE_LOGGER_BIN_RAW, &time, sys_get_uptime_ms(), NULL, NULL, 0, msg, &args);
     } while (0);
+#else
+    len = logger_vprintf(claim.ptr, 0, msg, args);
+    claim.ptr[len++] = '\n';
+#endif
+    va_end(args);
 
-    logger_write_log_message(buffer, os_running);
+    logger_commit_and_write(&claim, len, os_running);
 }
@@ -0,0 +1,184 @@
+#include "lz_compress.h"
+#include <stdbool.h>
+#include <string.h>
+
+
+/**
+ * A block is a run of sequences, each one a token, literals and a match:
+ *      token       : literal length (high 4 bits) and match length - LZ_MIN_MATCH (low 4 bits),
+ *                    15 meaning more length bytes follow, 255 meaning yet more
+ *      literals    : copied as they are
+ *      offset      : 2 bytes little endian, how far back the match starts
+ * The last sequence stops after its literals.  The LZ4 format wants the last match to start
+ * LZ_MATCH_LIMIT bytes before the end of the block, and at least LZ_LAST_LITERALS after it.
+ */
+#define LZ_MIN_MATCH        4
+#define LZ_LAST_LITERALS    5
+#define LZ_MATCH_LIMIT      12
+#define LZ_MAX_OFFSET       0xFFFF
+
+static inline uint32_t lz_read32(const uint8_t *p)
+{
+    uint32_t value = 0;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t lz_hash(const uint32_t value)
+{
+    return (uint32_t) (value * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/// @returns the number of length bytes that follow a token for the given length
+static inline uint32_t lz_len_bytes(const uint32_t len)
+{
+    return (len >= 15) ? (len - 15) / 255 + 1 : 0;
+}
+
+static uint8_t * lz_put_len(uint8_t *p, uint32_t len)
+{
+    for (len -= 15; len >= 255; len -= 255) {
+        *p++ = 255;
+    }
+    *p++ = len;
+    return p;
+}
+
+/**
+ * Writes a sequence, without a match if match_len is 0
+ * @returns the end of the sequence, NULL if it doesn't fit before end
+ */
+static uint8_t * lz_put_sequence(uint8_t *p, const uint8_t *end, const uint8_t *lit, const uint32_t lit_len,
+                                 const uint32_t offset, const uint32_t match_len)
+{
+    const uint32_t need = 1 + lz_len_bytes(lit_len) + lit_len +
+                          (match_len ? 2 + lz_len_bytes(match_len - LZ_MIN_MATCH) : 0);
+    uint8_t *token = p;
+
+    if ((uint32_t)(end - p) < need) {
+        return NULL;
+    }
+
+    *p++ = ((lit_len >= 15) ? 15 : lit_len) << 4;
+    if (lit_len >= 15) {
+        p = lz_put_len(p, lit_len);
+    }
+    memcpy(p, lit, lit_len);
+    p += lit_len;
+
+    if (match_len) {
+        *p++ = offset & 0xFF;
+        *p++ = offset >> 8;
+        *token |= (match_len - LZ_MIN_MATCH >= 15) ? 15 : (match_len - LZ_MIN_MATCH);
+        if (match_len - LZ_MIN_MATCH >= 15) {
+            p = lz_put_len(p, match_len - LZ_MIN_MATCH);
+        }
+    }
+    return p;
+}
+
+/// Reads the length bytes after a token's 15, if there are any
+static bool lz_get_len(const uint8_t **src, const uint8_t *end, uint32_t *len)
+{
+    uint8_t byte = 0;
+    if (15 == *len) {
+        do {
+            if (*src == end) {
+                return false;
+            }
+            byte = *(*src)++;
+            *len += byte;
+        } while (255 == byte);
+    }
+    return true;
+}
+
+uint32_t lz_compress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_max, uint16_t *table)
+{
+    const uint8_t * const dst_end = dst + dst_max;
+    uint8_t *p = dst;
+    uint32_t anchor = 0;
+    uint32_t i = 0;
+
+    if (src_len > LZ_MAX_BLOCK_SIZE) {
+        return 0;
+    }
+
+    /* Only positions the table was given in this block are used: each match is checked anyway */
+    while (i + LZ_MATCH_LIMIT <= src_len)
+    {
+        const uint32_t hash = lz_hash(lz_read32(src + i));
+        uint32_t cand = table[hash];
+        uint32_t len = LZ_MIN_MATCH;
+        table[hash] = i;
+
+        if (cand >= i || i - cand > LZ_MAX_OFFSET || lz_read32(src + cand) != lz_read32(src + i)) {
+            i++;
+            continue;
+        }
+
+        /* Grow the match back over the literals, then forward up to the last literals */
+        while (i > anchor && cand > 0 && src[i - 1] == src[cand - 1]) {
+            i--;
+            cand--;
+        }
+        while (i + len < src_len - LZ_LAST_LITERALS && src[i + len] == src[cand + len]) {
+            len++;
+        }
+
+        if (NULL == (p = lz_put_sequence(p, dst_end, src + anchor, i - anchor, i - cand, len))) {
+            return 0;
+        }
+        i += len;
+        anchor = i;
+    }
+
+    p = lz_put_sequence(p, dst_end, src + anchor, src_len - anchor, 0, 0);
+    return p ? (p - dst) : 0;
+}
+
+int32_t lz_decompress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_max)
+{
+    const uint8_t * const src_end = src + src_len;
+    uint32_t out = 0;
+
+    while (src < src_end)
+    {
+        const uint8_t token = *src++;
+        uint32_t len = token >> 4;
+        uint32_t offset = 0;
+
+        if (!lz_get_len(&src, src_end, &len) || (uint32_t)(src_end - src) < len || dst_max - out < len) {
+            return -1;
+        }
+        memcpy(dst + out, src, len);
+        src += len;
+        out += len;
+
+        /* The last sequence has no match */
+        if (src == src_end) {
+            break;
+        }
+        if (src_end - src < 2) {
+            return -1;
+        }
+        offset = src[0] | ((uint32_t)src[1] << 8);
+        src += 2;
+
+        len = token & 0x0F;
+        if (0 == offset || offset > out || !lz_get_len(&src, src_end, &len)) {
+            return -1;
+        }
+        len += LZ_MIN_MATCH;
+        if (dst_max - out < len) {
+            return -1;
+        }
+
+        /* Byte by byte: the match may overlap what it copies */
+        for ( ; len > 0; len--, out++) {
+            dst[out] = dst[out - offset];
+        }
+    }
+
+    return out;
+}
@@ -3,19 +3,20 @@
 
 #include <cstdio>
 #include <iostream>
-#include <map>
-#include <functional>
+#include <memory>
 
 #include "shared_handles.h"
 #include "storage.hpp"
 
 #include "pixy/config.hpp"
 #include "pixy/common.hpp"
-#include "pixy/common/func_map.hpp"
 #include "pixy/common/board.hpp"
+#include "pixy/common/event_trace.hpp"
+#include "pixy/common/state_table.hpp"
 #include "pixy/pixy_brain.hpp"
 #include "pixy/pixy_eyes.hpp"
 #include "pixy/pixy_mouth.hpp"
+#include "pixy/pixy_source.hpp"
 
 #include "printf_lib.h"
 
@@ -36,7 +37,8 @@ class Pixy_t
             RESET_BUTTON=0x01,  // SW(1)
             CALIB_BUTTON=0x02,  // SW(2)
             EMA_ALPHA_UP=0x04,  // SW(3)
-            EMA_ALPHA_DOWN=0x08 // SW(4)
+            EMA_ALPHA_DOWN=0x08, // SW(4)
+            BUTTON_COUNT=4       // bits above
         };
 
         enum State_t
@@ -46,10 +48,13 @@ class Pixy_t
             WAITING_FOR_HUMAN,
             WAITING_FOR_BOT,
             WAITING_FOR_RESET,
-            ERROR
+            ERROR,
+            STATE_COUNT
         };
 
-        Pixy_t(uint32_t ulChipsAtATime, uint32_t ulChipsToCalib, ChipColor_t eColorCalib);
+        /// Takes ownership of pPixySource, see pxBoardPixySource()
+        Pixy_t(uint32_t ulChipsAtATime, uint32_t ulChipsToCalib, ChipColor_t eColorCalib,
+               PixySource_t* pPixySource);
         void vAction(Button_t eButton);
 
         bool bCalibPressed;
@@ -60,20 +65,52 @@ class Pixy_t
     private:
         bool bReceivedResetFromBotAsync();
         void vUpdateState(Pixy_t::State_t eState_new);
-        void vInitMapFunc();
-        void vInitMapStr();
+
+        // State handlers, one per State_t, dispatched by vAction()
+        void vCalibState();
+        void vResetState();
+        void vWaitingForHuman();
+        void vWaitingForBot();
+        void vWaitingForReset();
+        void vErrorState();
 
         std::unique_ptr<pixy::PixyBrain_t> pPixyBrain;
+        std::unique_ptr<pixy::PixySource_t> pPixySource;
         std::unique_ptr<pixy::PixyEyes_t> pPixyEyes;
         std::unique_ptr<pixy::PixyMouth_t> pPixyMouth;
 
-        std::map<Button_t, std::string> xButtonStrMap;
-        std::map<State_t, std::string> xStateStrMap;
-        std::unique_ptr<FuncMap_t<State_t, void>> xFuncMap;
 
         std::unique_ptr<Corners_t> xCornersPtr;
+
+        /// A human move seen before GameTask_t was done with the bot's, or -1
+        int lPendingHumanCol;
 };
 
+/// Indexed by Pixy_t::State_t
+constexpr NameTable_t<Pixy_t::State_t, Pixy_t::STATE_COUNT> xPixyStateNames = {{
+    "CALIB_STATE",
+    "RESET_STATE",
+    "WAITING_FOR_HUMAN",
+    "WAITING_FOR_BOT",
+    "WAITING_FOR_RESET",
+    "ERROR"
+}};
+static_assert(xPixyStateNames.bComplete(), "every Pixy_t::State_t needs a name");
+
+/// Indexed by the bit of a Pixy_t::Button_t
+constexpr NameTable_t<int, Pixy_t::BUTTON_COUNT> xPixyButtonNames = {{
+    "RESET",
+    "CALIB",
+    "EMA_ALPHA_UP",
+    "EMA_ALPHA_DOWN"
+}};
+static_assert(xPixyButtonNames.bComplete(), "every Pixy_t::Button_t needs a name");
+
+inline const char* pcPixyButtonName(Pixy_t::Button_t eButton)
+{
+    return eButton ? xPixyButtonNames.pcName(__builtin_ctz(eButton)) : "?";
+}
+
 } // namespace pixy
 } // namespace team9
 
@@ -16,7 +16,9 @@
 
 #include "printf_lib.h"
 
-#define F() printf("Line: %d, func: %s\n", __LINE__, __func__); u0_dbg_printf("Line: %d, func: %s\n", __LINE__, __func__)
+#include "pixy/common/trace.hpp"
+
+#define F() PIXY_DEBUG("Line: %d, func: %s\n", __LINE__, __func__)
 
 namespace team9
 {
@@ -33,11 +35,6 @@ enum Quadrant_t
     TOP_LEFT = 0, TOP_RIGHT = 1, BOT_LEFT = 2, BOT_RIGHT = 3, ERROR = 4
 };
 
-enum StatEnum_t
-{
-    M, V, S, C
-};
-
 } // namespace pixy
 } // namespace team9
 
@@ -5,13 +5,19 @@
 #include <utility>
 #include <queue>
 
-#include "printf_lib.h"
+#include "shared_handles.h"
 
 #include "pixy/config.hpp"
 #include "pixy/common.hpp"
+#include "pixy/common/cell_grid.hpp"
 #include "pixy/common/chip.hpp"
 #include "pixy/common/corners.hpp"
+#include "pixy/common/event_trace.hpp"
+#include "pixy/common/frame.hpp"
+#include "pixy/common/frontier.hpp"
+#include "pixy/common/homography.hpp"
 #include "pixy/common/point.hpp"
+#include "pixy/common/point_batch.hpp"
 #include "pixy/common/stat.hpp"
 
 namespace team9
@@ -27,26 +33,33 @@ class Board_t
 
         Board_t() :
             xWatchedChips(7),
-            xWatchedCols(7, 0),
+            xFrontier(6, 7),
             ulRows(6),
             ulCols(7),
             ulDistBetweenRows(0),
             ulDistBetweenCols(0),
             xPointEMA_alpha(CHIP_LOC_EMA_ALPHA),
-            xTolerance(CHIP_PROXIM_TOLERANCE)
+            xTolerance(CHIP_PROXIM_TOLERANCE),
+            ulExpectedCols(0),
+            ulSeenBotCols(0),
+            usExpectFrames(),
+            eExpectedColors()
         {}
 
         Board_t(const Corners_t& xCorners, const ChipColor_t eHumanChipColor) :
                 xWatchedChips(7),
-                xWatchedCols(7, 0),
+                xFrontier(6, 7),
                 ulRows(6),
                 ulCols(7),
                 ulDistBetweenRows(0),
                 ulDistBetweenCols(0),
                 xPointEMA_alpha(CHIP_LOC_EMA_ALPHA),
-                xTolerance(CHIP_PROXIM_TOLERANCE)
+                xTolerance(CHIP_PROXIM_TOLERANCE),
+                ulExpectedCols(0),
+                ulSeenBotCols(0),
+                usExpectFrames(),
+                eExpectedColors()
         {
-            vInitStringMap();
             vBuildGrid(xCorners, eHumanChipColor);
         }
 
@@ -59,109 +72,255 @@ class Board_t
 
         int vBuildGrid (const Corners_t& xCorners_arg, const ChipColor_t eHumanChipColor)
         {
-            std::vector<Point_t<float>> xTLBLPoints;
-            std::vector<Point_t<float>> xTRBRPoints;
-            Point_t<float>::xPointsOnLine(xCorners_arg(TOP_LEFT),
-                                          xCorners_arg(BOT_LEFT), 6,
-                                          xTLBLPoints);
-            Point_t<float>::xPointsOnLine(xCorners_arg(TOP_RIGHT),
-                                          xCorners_arg(BOT_RIGHT), 6,
-                                          xTRBRPoints);
-            std::ostringstream oss;
-            oss << "xTLBLPoints:\n";
-            for (auto& pt : xTLBLPoints)
+            if (!xHomography.bFit(xCorners_arg(TOP_LEFT), xCorners_arg(TOP_RIGHT),
+                                  xCorners_arg(BOT_LEFT), xCorners_arg(BOT_RIGHT),
+                                  ulCols, ulRows))
             {
-                oss << pt.xStr() << "\n";
+                PIXY_ERROR("Error: corners do not make a board\n");
+                return 3;
             }
-            oss << "xTRBRPoints:\n";
-            for (auto& pt : xTRBRPoints)
+
+            // Chip centers in xAllChips order, top row first
+            std::vector<Point_t<float>> xCenters;
+            std::ostringstream oss;
+            oss << "xCenters:\n";
+            for (int lRow = 0; lRow < ulRows; ++lRow)
             {
-                oss << pt.xStr() << "\n";
+                for (int lCol = 0; lCol < ulCols; ++lCol)
+                {
+                    xCenters.push_back(xHomography.xToCamera(fix16_from_int(lRow),
+                                                             fix16_from_int(lCol)));
+                    oss << xCenters.back().xStr() << " ";
+                }
+                oss << "\n";
             }
-            printf("\n%s\n", oss.str().c_str());
-            u0_dbg_printf("\n%s\n", oss.str().c_str());
+            PIXY_TRACE_TEXT(TRACE_INFO, oss.str().c_str());
             ulDistBetweenRows = Point_t<float>::xCalcDist(
                     xCorners_arg(TOP_LEFT), xCorners_arg(BOT_LEFT)) / ulRows;
             ulDistBetweenCols = Point_t<float>::xCalcDist(
                     xCorners_arg(TOP_LEFT), xCorners_arg(TOP_RIGHT)) / ulCols;
-            return xFillBoard(xTLBLPoints, xTRBRPoints, eHumanChipColor);
+            return xFillBoard(xCenters, eHumanChipColor);
         }
 
-        int xFillBoard(std::vector<Point_t<float>>& xTLBLPoints,
-                       std::vector<Point_t<float>>& xTRBRPoints,
+        int xFillBoard(std::vector<Point_t<float>>& xCenters,
                        ChipColor_t eHumanChipColor)
         {
-            if ((int)xTLBLPoints.size() != ulRows ||
-                (int)xTRBRPoints.size() != ulRows)
+            if ((int)xCenters.size() != ulRows * ulCols)
             {
                 return 1; // Invalid number of points
             }
-            int xRightPtIdx = 0;
             xAllChips.clear();
             xAllChips.resize(ulRows * ulCols);
-            int lPtIdx = 0;
-            for (Point_t<float>& xLeftPt : xTLBLPoints)
+            for (int lPtIdx = 0; lPtIdx < ulRows * ulCols; ++lPtIdx)
             {
-                std::vector<Point_t<float>> xPts;
-                Point_t<float>& xRightPt = xTRBRPoints[xRightPtIdx++];
-                Point_t<float>::xPointsOnLine(xLeftPt, xRightPt, ulCols, xPts);
-                for (auto& xPt : xPts)
-                {
-                    Chip_t xChip(xPointEMA_alpha, eHumanChipColor);
-                    xChip.xPtLoc.vUpdate(xPt);
-                    xAllChips[lPtIdx++] = xChip;
-                }
+                Chip_t xChip(xPointEMA_alpha, eHumanChipColor);
+                xChip.xPtLoc.vUpdate(xCenters[lPtIdx]);
+                xAllChips[lPtIdx] = xChip;
+            }
+            vBuildCellGrid();
+            return 0;
+        }
+
+        /// Indexes the chip locations for vChipAlgoGrid(), redo after they move
+        void vBuildCellGrid()
+        {
+            Point_t<float> xCenters[CellGrid_t::MAX_CELLS];
+            uint32_t ulCells = std::min<uint32_t>(xAllChips.size(), CellGrid_t::MAX_CELLS);
+            for (uint32_t ulI = 0; ulI < ulCells; ++ulI)
+            {
+                xCenters[ulI] = xAllChips[ulI].xPtLoc.xPoint();
             }
-            return (lPtIdx == ulRows * ulCols) ? 0 : 2;
+            xCellGrid.vBuild(xCenters, ulCells, xMatchDist());
         }
 
-        void vCalcSeenChips(std::vector<Block_t>& xBlocks,
-                std::vector<std::pair<int, ChipColor_t>>& xSeenChips)
+        /**
+         * One vision cycle: matches the frame's blocks to the watched chips,
+         * updates their color statistics and returns lColChanged().  Works
+         * in xFrame only, nothing is allocated.
+         */
+        int lProcessFrame(Frame_t& xFrame)
+        {
+            xFrame.xSeenChips.clear();
+            vCalcSeenChips(xFrame.xBlocks, xFrame.xSeenChips);
+            vUpdate(xFrame.xSeenChips);
+            return lColChanged();
+        }
+
+        void vCalcSeenChips(Span_t<Block_t> xBlocks, SeenChips_t& xSeenChips)
         {
             switch (eSeenChipAlgo)
             {
                 case STUPID: vChipAlgoStupid(xBlocks, xSeenChips); break;
                 case DOWN_RIGHT: vChipAlgoDownRight(xBlocks, xSeenChips); break;
-                default: printf("Error selecting seen chip algo.\n");
-                         u0_dbg_printf("Error selecting seen chip algo.\n"); break;
+                case GRID: vChipAlgoGrid(xBlocks, xSeenChips); break;
+                case HOMOGRAPHY: vChipAlgoHomography(xBlocks, xSeenChips); break;
+                default: PIXY_ERROR("Error selecting seen chip algo.\n"); break;
             }
         }
 
-        void vChipAlgoStupid(std::vector<Block_t>& xBlocks,
-                std::vector<std::pair<int, ChipColor_t>>& xSeenChips)
+        /**
+         * Every watched chip against every block: the blocks go into a
+         * PointBatch_t once, then ulNearest() finds the closest to one chip
+         * at a time, kept if it is close enough.
+         */
+        void vChipAlgoStupid(Span_t<Block_t> xBlocks, SeenChips_t& xSeenChips)
         {
-            float xMaxDist = (float)ulDistBetweenCols * xTolerance;
+            const Dist2_t xMaxDist2 = xToDist2(xMatchDist());
+            xBlockBatch.clear();
+            for (const Block_t& xBlock : xBlocks)
+            {
+                xBlockBatch.push_back(xToDistCoord(xBlock.xPoint.xY), xToDistCoord(xBlock.xPoint.xX));
+            }
+
             for (int lCol = 0; lCol < (int)xWatchedChips.size(); ++lCol)
             {
-                int xRow = xWatchedCols[lCol];
-                if (xRow < 0 || xRow > (int)ulRows)
+                int xRow = xFrontier.lRow(lCol);
+                if (!bInBounds<ROW>(xRow))
                 {
                     continue;
                 }
                 int xIdx = (ulRows-xRow-1) * ulCols + lCol;
-                Chip_t& xChip = xAllChips[xIdx];
-                ChipColor_t xTempColor = NONE;
-                float xTempDist = 9999;
-                for (int lJ = 0; lJ < (int)xBlocks.size(); ++lJ)
+                const Point_t<float>& xChipPt = xAllChips[xIdx].xPtLoc.xPoint();
+                Dist2_t xDist2 = 0;
+                uint32_t ulBlock = ulNearest(xBlockBatch, xToDistCoord(xChipPt.xY), xToDistCoord(xChipPt.xX),
+                                             xDist2);
+                if (ulBlock < xBlockBatch.size() && xDist2 < xMaxDist2)
                 {
-                    Point_t<uint16_t>& xBlockPt = xBlocks[lJ].xPoint;
-                    const Point_t<float>& xChipPt = xChip.xPtLoc.xPoint();
-                    float xDist = Point_t<float>::xCalcDist(xChipPt, xBlockPt);
-                    if (xDist < xTempDist)
-                    {
-                        xTempColor = (ChipColor_t)xBlocks[lJ].usSignature;
-                        xTempDist = xDist;
-                    }
+                    xSeenChips.push_back(std::make_pair(xIdx, (ChipColor_t)xBlocks[ulBlock].usSignature));
+                }
+            }
+        }
+
+        /**
+         * vChipAlgoStupid() in O(blocks): the cell grid gives each block its
+         * cell, a table built per frame gives the watched chip of that cell's
+         * column, and the block is compared (integer squared distance) with
+         * that chip only.  No sqrt, no float, no division.  A block is only
+         * ever tried against its own cell's column, so one just across a
+         * cell boundary that STUPID would pick is missed; pixy_match_bench
+         * counts the frames where the two disagree.
+         */
+        void vChipAlgoGrid(Span_t<Block_t> xBlocks, SeenChips_t& xSeenChips)
+        {
+            static const int MAX_COLS = 7;
+            const int64_t llMaxDist2 = CellGrid_t::llToDist2(xMatchDist());
+            const int lCells = std::min<int>(ulRows * ulCols, CellGrid_t::MAX_CELLS);
+
+            // Indexed by cell, only the watched cells' best entries are used
+            int8_t cWatched[CellGrid_t::MAX_CELLS];
+            int64_t llBestDist2[CellGrid_t::MAX_CELLS];
+            ChipColor_t eBestColor[CellGrid_t::MAX_CELLS];
+            for (int lCol = 0; lCol < ulCols; ++lCol)
+            {
+                int lRow = xFrontier.lRow(lCol);
+                int lTarget = (lCol < MAX_COLS && bInBounds<ROW>(lRow)) ? lBoardIdx(lRow, lCol) : -1;
+                if (lTarget >= lCells)
+                {
+                    lTarget = -1;
+                }
+                for (int lCell = lCol; lCell < lCells; lCell += ulCols)
+                {
+                    cWatched[lCell] = (int8_t)lTarget;
+                }
+                if (lTarget >= 0)
+                {
+                    llBestDist2[lTarget] = llMaxDist2;
+                    eBestColor[lTarget] = NONE;
+                }
+            }
+
+            for (const Block_t& xBlock : xBlocks)
+            {
+                int lCell = xCellGrid.lCellAt(xBlock.xPoint.xY, xBlock.xPoint.xX);
+                if (lCell == CellGrid_t::NO_CELL || lCell >= lCells)
+                {
+                    continue;
+                }
+                int lTarget = cWatched[lCell];
+                if (lTarget < 0)
+                {
+                    continue;
+                }
+                int64_t llDist2 = xCellGrid.llDist2(lTarget, xBlock.xPoint.xY, xBlock.xPoint.xX);
+                if (llDist2 < llBestDist2[lTarget])
+                {
+                    llBestDist2[lTarget] = llDist2;
+                    eBestColor[lTarget] = (ChipColor_t)xBlock.usSignature;
+                }
+            }
+
+            for (int lCol = 0; lCol < MAX_COLS && lCol < ulCols && lCol < lCells; ++lCol)
+            {
+                int lTarget = cWatched[lCol];
+                if (lTarget >= 0 && llBestDist2[lTarget] < llMaxDist2)
+                {
+                    xSeenChips.push_back(std::make_pair(lTarget, eBestColor[lTarget]));
                 }
-                if (xTempDist < xMaxDist)
+            }
+        }
+
+        /**
+         * Projects every block onto the board with the calibration's
+         * homography and measures its distance to the watched chip of the
+         * column it lands in, in cells, so chips far from the camera get
+         * the same tolerance as near ones.  Integer only.
+         */
+        void vChipAlgoHomography(Span_t<Block_t> xBlocks, SeenChips_t& xSeenChips)
+        {
+            static const int MAX_COLS = 7;
+            const fix16_t xMaxDist = fix16_from_float(xTolerance);
+            const int64_t llMaxDist2 = (int64_t)xMaxDist * xMaxDist;
+            int64_t llBestDist2[MAX_COLS];
+            ChipColor_t eBestColor[MAX_COLS];
+            for (int lCol = 0; lCol < MAX_COLS; ++lCol)
+            {
+                llBestDist2[lCol] = llMaxDist2;
+                eBestColor[lCol] = NONE;
+            }
+            if (!xHomography.bIsValid())
+            {
+                return;
+            }
+
+            for (const Block_t& xBlock : xBlocks)
+            {
+                fix16_t xRow, xCol;
+                if (!xHomography.bToBoard(xBlock.xPoint.xY, xBlock.xPoint.xX, xRow, xCol))
+                {
+                    continue;
+                }
+                int lCol = fix16_to_int(xCol);
+                if (lCol < 0 || lCol >= ulCols || lCol >= MAX_COLS)
+                {
+                    continue;
+                }
+                int lRow = xFrontier.lRow(lCol);
+                if (!bInBounds<ROW>(lRow))
+                {
+                    continue;
+                }
+                // xAllChips rows count from the top, xFrontier from the bottom
+                int64_t llDRow = (int64_t)xRow - fix16_from_int(ulRows - lRow - 1);
+                int64_t llDCol = (int64_t)xCol - fix16_from_int(lCol);
+                int64_t llDist2 = llDRow * llDRow + llDCol * llDCol;
+                if (llDist2 < llBestDist2[lCol])
+                {
+                    llBestDist2[lCol] = llDist2;
+                    eBestColor[lCol] = (ChipColor_t)xBlock.usSignature;
+                }
+            }
+
+            for (int lCol = 0; lCol < MAX_COLS && lCol < ulCols; ++lCol)
+            {
+                if (llBestDist2[lCol] < llMaxDist2)
                 {
-                    xSeenChips.push_back(std::make_pair(xIdx, xTempColor));
+                    xSeenChips.push_back(std::make_pair(lBoardIdx(xFrontier.lRow(lCol), lCol),
+                                                        eBestColor[lCol]));
                 }
             }
         }
 
-        void vChipAlgoDownRight(std::vector<Block_t>& xBlocks,
-                std::vector<std::pair<int, ChipColor_t>>& xSeenChips)
+        void vChipAlgoDownRight(Span_t<Block_t> xBlocks, SeenChips_t& xSeenChips)
         {
             for (Block_t& xBlock : xBlocks)
             {
@@ -234,103 +393,134 @@ class Board_t
             }
         }
 
-        void vUpdate(std::vector<std::pair<int, ChipColor_t>>& xSeenChips)
+        /**
+         * Votes the seen chips into their columns, then updates the color
+         * statistics of the columns that got votes.  A column whose chip
+         * becomes known is queued for lColChanged().
+         */
+        void vUpdate(Span_t<const SeenChip_t> xSeenChips)
         {
-            for (int lCol = 0; lCol < (int)xWatchedCols.size(); ++lCol)
+            xFrontier.vClearVotes();
+            for (const SeenChip_t& xSeenChip : xSeenChips)
             {
-                if (xWatchedCols[lCol] < 0)
+                xFrontier.bVote(xSeenChip.first, xSeenChip.second);
+            }
+            for (uint32_t ulMask = xFrontier.ulVotedMask(); ulMask; ulMask &= ulMask - 1)
+            {
+                int lCol = __builtin_ctz(ulMask);
+                Chip_t& xChip = xWatchedChips[lCol];
+                if (xChip.bChipKnown())
                 {
-                    continue;
+                    continue; // waiting for lColChanged()
                 }
-                int lNoneCnt = 0;
-                int lGreenCnt = 0;
-                int lRedCnt = 0;
-                int lRow = xWatchedCols[lCol];
-                for (auto& xSeenChip : xSeenChips)
+                const uint16_t* pusVotes = xFrontier.pusVotes(lCol);
+                xChip.vUpdateFreq(pusVotes[NONE], pusVotes[GREEN], pusVotes[RED]);
+                if (xChip.bChipKnown())
                 {
-                    if (!bInBounds<ROW>(lRow))
+                    if (ulExpectedCols & (1u << lCol))
                     {
-                        printf("Warning, lRow in vUpdate is: %d, xWatchedCols[%d]: %d\n",
-                               lRow, lCol, xWatchedCols[lCol]);
-                        u0_dbg_printf("Warning, lRow in vUpdate is: %d, xWatchedCols[%d]: %d\n",
-                                      lRow, lCol, xWatchedCols[lCol]);
+                        vStoreExpected(lCol, true);
                     }
-                    if (xSeenChip.first == lBoardIdx(lRow, lCol))
+                    else
                     {
-                        switch (xSeenChip.second)
-                        {
-                            case NONE: lNoneCnt++; break;
-                            case GREEN: lGreenCnt++; break;
-                            case RED: lRedCnt++; break;
-                        }
+                        xFrontier.vMarkChanged(lCol);
                     }
                 }
-                if (lNoneCnt || lGreenCnt || lRedCnt)
+            }
+            xEvents().vLog(EV_BOARD_UPDATE, (uint16_t)xFrontier.ulVotedMask(), (int32_t)xSeenChips.size());
+
+            for (uint32_t ulMask = ulExpectedCols; ulMask; ulMask &= ulMask - 1)
+            {
+                int lCol = __builtin_ctz(ulMask);
+                if (++usExpectFrames[lCol] >= BOT_VERIFY_FRAMES)
                 {
-                    printf("Seen in row %d, col: %d\t[N: %d\tG: %d\tR: %d]\n", lRow, lCol, lNoneCnt, lGreenCnt, lRedCnt);
-                    u0_dbg_printf("Seen in row %d, col: %d\t[N: %d\tG: %d\tR: %d]\n", lRow, lCol, lNoneCnt, lGreenCnt, lRedCnt);
-                    xWatchedChips[lCol].vUpdateFreq(lNoneCnt, lGreenCnt, lRedCnt);
+                    vStoreExpected(lCol, false);
                 }
             }
         }
 
+        /**
+         * Takes the lowest column whose watched chip became known, stores
+         * the chip and moves the column's frontier up.
+         * @returns the column, -1 if no chip became known
+         */
         int lColChanged()
         {
-            // Poll all of the watched chips (indexes stored in xWatchedCols)
-            // asking if they are "not none and the same N times"
-
-            // For every entry in size 7 vector of "watched col heights"
-            // (ex: [-1 0 0 0 0 0 -1])
-            int lCols = xWatchedCols.size();
-            printf("Now watching (lCols: %d): ", lCols);
-            u0_dbg_printf("Now watching (lCols: %d): ", lCols);
-
-            for (int lCol = 0; lCol < lCols; ++lCol)
+            int lCol = xFrontier.lPopChanged();
+            if (lCol < 0)
             {
+                return -1;
+            }
+            int lRow = xFrontier.lRow(lCol);
+            Chip_t& xChip = xWatchedChips[lCol];
+            xAllChips[lBoardIdx(lRow, lCol)].vSet(xChip.xMaxChip());
+            xChip.vResetCounters();
+            xFrontier.vAdvance(lCol);
+            xEvents().vLog(EV_BOARD_CHIP_KNOWN, lCol, lRow);
+            PIXY_INFO("Chip known in row %d, col %d\n", lRow, lCol);
+            return lCol;
+        }
 
-                // Get current column height/rows
-                int lRow = xWatchedCols[lCol];
-
-                printf(" %d", lRow);
-                u0_dbg_printf(" %d", lRow);
-
-                if (!bInBounds<ROW>(lRow)) continue;
-
-                // Dereference chip in current column (xWatchedChips same
-                // size as xWatchedCols
-                Chip_t& xChip = xWatchedChips[lCol];
-
-                // Ask if it has been the same for the last two samples
-                if (xChip.bChipKnown())
-                {
-                    xAllChips[lBoardIdx(lRow, lCol)].vSet(xChip.xMaxChip());
-                    xWatchedChips[lCol].vResetCounters();
-                    xWatchedCols[lCol]++;
-                    return lCol;
-                }
+        /**
+         * The bot is dropping a chip of eColor into lCol.  Until the camera
+         * sees it, the column's watched chip looks for that color instead
+         * of the human's; then the chip is stored as lInsert() would and
+         * lPopSeenBot() hands out the column.  A chip still not seen after
+         * BOT_VERIFY_FRAMES frames is stored anyway.
+         * @returns the column's height once it lands, -1 if the column is
+         * full, -2 if it is off the board
+         */
+        int lExpect(int lCol, ChipColor_t eColor)
+        {
+            if (!bInBounds<COL>(lCol) || lCol >= Frontier_t::MAX_COLS)
+            {
+                return -2;
+            }
+            if (ulExpectedCols & (1u << lCol))
+            {
+                vStoreExpected(lCol, false); // a second chip before the first was seen
+            }
+            int lRow = xFrontier.lRow(lCol);
+            if (!bInBounds<ROW>(lRow))
+            {
+                return -1;
             }
-            printf("\n");
-            u0_dbg_printf("\n");
+            Chip_t& xChip = xWatchedChips[lCol];
+            xChip.vResetCounters();
+            xChip.vExpect(eColor);
+            eExpectedColors[lCol] = eColor;
+            usExpectFrames[lCol] = 0;
+            ulExpectedCols |= 1u << lCol;
+            return lRow + 1;
+        }
 
-            return -1;
+        /// @returns the lowest column whose expected bot chip the camera saw, -1 if none
+        int lPopSeenBot()
+        {
+            if (!ulSeenBotCols)
+            {
+                return -1;
+            }
+            int lCol = __builtin_ctz(ulSeenBotCols);
+            ulSeenBotCols &= ~(1u << lCol);
+            return lCol;
         }
 
         int lInsert(PixyCmd_t& xInsertCmd)
         {
             int lCol = xInsertCmd.lColumn;
-            printf("lCol: %d\n", lCol);
-            u0_dbg_printf("lCol: %d\n", lCol);
+            PIXY_DEBUG("lCol: %d\n", lCol);
 
             if (bInBounds<COL>(lCol))
             {
                 ChipColor_t xChipColor = (ChipColor_t)xInsertCmd.lColor;
-                int lRow = xWatchedCols[lCol];
-                printf("lRow: %d\n", lRow);
-                u0_dbg_printf("lRow: %d\n", lRow);
+                int lRow = xFrontier.lRow(lCol);
+                PIXY_DEBUG("lRow: %d\n", lRow);
                 if (!bInBounds<ROW>(lRow)) return -1;
                 xAllChips[lBoardIdx(lRow, lCol)].vSet(xChipColor);
                 xWatchedChips[lCol].vResetCounters();
-                xWatchedCols[lCol]++;
+                xFrontier.vAdvance(lCol);
+                xEvents().vLog(EV_BOARD_INSERT, lCol, lRow + 1);
                 return lRow + 1;
             }
             return -2;
@@ -353,6 +543,23 @@ class Board_t
             return (ulRows - lRow - 1) * ulCols + lCol;
         }
 
+        /// Row the next chip of lCol lands in
+        int lWatchedRow(const int lCol) const
+        {
+            return xFrontier.lRow(lCol);
+        }
+
+        /// Pixels from a chip within which a block is that chip
+        float xMatchDist() const
+        {
+            return (float)ulDistBetweenCols * xTolerance;
+        }
+
+        Point_t<float> xChipPoint(const int lBoardIdx_arg) const
+        {
+            return xAllChips[lBoardIdx_arg].xPtLoc.xPoint();
+        }
+
         int lRowFromIdx(const int lBoardIdx_arg) const
         {
             return (ulRows - (lBoardIdx_arg / ulCols) - 1);
@@ -368,6 +575,12 @@ class Board_t
             return xAllChips.size();
         }
 
+        /// false if vBuildGrid() failed, nothing may be matched or inserted then
+        bool bHasGrid() const
+        {
+            return ulActualTotalChips() == ulExpectedTotalChips();
+        }
+
         float xGetAlpha() const
         {
             return xPointEMA_alpha;
@@ -375,15 +588,12 @@ class Board_t
 
         void vPrintChips(
                 PrintMode_t xPrintStyle = LOCATION,
-                const std::vector<std::pair<int, ChipColor_t>> xSeenChips =
-                      std::vector<std::pair<int, ChipColor_t>>())
+                Span_t<const SeenChip_t> xSeenChips = Span_t<const SeenChip_t>())
         {
             if ((int)xAllChips.size() != ulRows * ulCols)
             {
-                printf("Chip print error: Num chips: %d, rows: %d, cols: %d\n",
-                        xAllChips.size(), ulRows, ulCols);
-                u0_dbg_printf("Chip print error: Num chips: %d, rows: %d, cols: %d\n",
-                            xAllChips.size(), ulRows, ulCols);
+                PIXY_ERROR("Chip print error: Num chips: %d, rows: %d, cols: %d\n",
+                           (int)xAllChips.size(), ulRows, ulCols);
                 return;
             }
             switch (xPrintStyle)
@@ -407,8 +617,7 @@ class Board_t
                  }
                  xOss << "\n";
              }
-            printf("%s\n", xOss.str().c_str());
-            u0_dbg_printf("%s\n", xOss.str().c_str());
+            PIXY_TRACE_TEXT(TRACE_INFO, xOss.str().c_str());
         }
 
         std::string xChipColorRow(std::ostringstream& xOss,
@@ -417,67 +626,63 @@ class Board_t
                                   ChipColor_t lCol4, ChipColor_t lCol5,
                                   ChipColor_t lCol6)
         {
-            xOss << xStringMap[lCol0] << " "
-                 << xStringMap[lCol1] << " "
-                 << xStringMap[lCol2] << " "
-                 << xStringMap[lCol3] << " "
-                 << xStringMap[lCol4] << " "
-                 << xStringMap[lCol5] << " "
-                 << xStringMap[lCol6];
+            xOss << cColorChar(lCol0) << " "
+                 << cColorChar(lCol1) << " "
+                 << cColorChar(lCol2) << " "
+                 << cColorChar(lCol3) << " "
+                 << cColorChar(lCol4) << " "
+                 << cColorChar(lCol5) << " "
+                 << cColorChar(lCol6);
             std::string xRowStr(xOss.str());
             xOss.str("");
             xOss.clear();
             return xRowStr;
         }
 
+        /**
+         * The last seen colors (if any) beside the known ones, one row per
+         * board row.  The seen chips are laid out in one pass and the text
+         * goes into a fixed buffer, this runs once per move.
+         */
         void vColorPrint(
-                const std::vector<std::pair<int, ChipColor_t>> xSeenChips =
-                      std::vector<std::pair<int, ChipColor_t>>(),
+                Span_t<const SeenChip_t> xSeenChips = Span_t<const SeenChip_t>(),
                 bool bPrintStdDev = false)
         {
-            std::ostringstream xOss;
-            int lIdx1 = 0;
-            int lIdx2 = 0;
-            xOss << "Col:   0 1 2 3 4 5 6            0 1 2 3 4 5 6\n";
-            for (int xI = (int)ulRows - 1; xI >= 0; --xI)
-            {
-               if (!xSeenChips.empty())
-               {
-                    xOss << "Row " << xI << ":";
-                    //// Print incoming chip colors
+            const int lCells = ulRows * ulCols;
+            char cSeen[Frontier_t::MAX_ROWS * Frontier_t::MAX_COLS];
+            memset(cSeen, cColorChar(NONE), sizeof(cSeen));
+            for (const SeenChip_t& xSeenChip : xSeenChips)
+            {
+                if (xSeenChip.first >= 0 && xSeenChip.first < lCells)
+                {
+                    cSeen[xSeenChip.first] = cColorChar(xSeenChip.second);
+                }
+            }
+
+            // A row is at most 52 characters with Frontier_t::MAX_COLS columns
+            static char cBuf[64 * (Frontier_t::MAX_ROWS + 1)];
+            int lLen = snprintf(cBuf, sizeof(cBuf), "Col:   0 1 2 3 4 5 6            0 1 2 3 4 5 6\n");
+            int lIdx = 0;
+            for (int xI = (int)ulRows - 1; xI >= 0 && lIdx < lCells; --xI, lIdx += ulCols)
+            {
+                if (!xSeenChips.empty())
+                {
+                    lLen += snprintf(cBuf + lLen, sizeof(cBuf) - lLen, "Row %d:", xI);
                     for (int xJ = 0; xJ < (int)ulCols; ++xJ)
                     {
-                       ChipColor_t xChipColor = NONE;
-                       for (auto& xChipColorPair : xSeenChips)
-                       {
-                           if (xChipColorPair.first == lIdx1)
-                           {
-                               xChipColor = xChipColorPair.second;
-                           }
-                       }
-                       lIdx1++;
-                       xOss << " " << xStringMap[xChipColor];
+                        lLen += snprintf(cBuf + lLen, sizeof(cBuf) - lLen, " %c", cSeen[lIdx + xJ]);
                     }
-                    xOss << "     ";
+                    lLen += snprintf(cBuf + lLen, sizeof(cBuf) - lLen, "     ");
                 }
-                Chip_t& xChipRowICol0 = xAllChips[lIdx2++];
-                Chip_t& xChipRowICol1 = xAllChips[lIdx2++];
-                Chip_t& xChipRowICol2 = xAllChips[lIdx2++];
-                Chip_t& xChipRowICol3 = xAllChips[lIdx2++];
-                Chip_t& xChipRowICol4 = xAllChips[lIdx2++];
-                Chip_t& xChipRowICol5 = xAllChips[lIdx2++];
-                Chip_t& xChipRowICol6 = xAllChips[lIdx2++];
-                xOss << "Row: " << xI << " "
-                     << xStringMap[xChipRowICol0.xMaxChip()] << " "
-                     << xStringMap[xChipRowICol1.xMaxChip()] << " "
-                     << xStringMap[xChipRowICol2.xMaxChip()] << " "
-                     << xStringMap[xChipRowICol3.xMaxChip()] << " "
-                     << xStringMap[xChipRowICol4.xMaxChip()] << " "
-                     << xStringMap[xChipRowICol5.xMaxChip()] << " "
-                     << xStringMap[xChipRowICol6.xMaxChip()] << "\n";
-            }
-            printf("%s\n", xOss.str().c_str());
-            u0_dbg_printf("%s\n", xOss.str().c_str());
+                lLen += snprintf(cBuf + lLen, sizeof(cBuf) - lLen, "Row: %d", xI);
+                for (int xJ = 0; xJ < (int)ulCols; ++xJ)
+                {
+                    lLen += snprintf(cBuf + lLen, sizeof(cBuf) - lLen, " %c",
+                                     cColorChar(xAllChips[lIdx + xJ].xMaxChip()));
+                }
+                lLen += snprintf(cBuf + lLen, sizeof(cBuf) - lLen, "\n");
+            }
+            PIXY_TRACE_TEXT(TRACE_INFO, cBuf);
         }
 
         void vOpenCVPrint()
@@ -490,8 +695,7 @@ class Board_t
                      << Point_t<float>::xOpenCVPt(
                         xChip.xPtLoc.xPoint()) << ");\n";
             }
-            printf("%s\n", xOss.str().c_str());
-            u0_dbg_printf("%s\n", xOss.str().c_str());
+            PIXY_TRACE_TEXT(TRACE_INFO, xOss.str().c_str());
         }
 
         void vPrintFillStatus()
@@ -502,7 +706,7 @@ class Board_t
                 xOss << "Row " << xI << ":";
                 for (int xJ = 0; xJ < (int)ulCols; ++xJ)
                 {
-                    if (xWatchedCols[xJ] == (int)xI)
+                    if (xFrontier.lRow(xJ) == (int)xI)
                     {
                         xOss << " " << xI;
                     }
@@ -520,23 +724,23 @@ class Board_t
                 xOss.clear();
                 return;
             }
-            printf("%s\n", xOss.str().c_str());
-            u0_dbg_printf("%s\n", xOss.str().c_str());
+            PIXY_TRACE_TEXT(TRACE_INFO, xOss.str().c_str());
         }
 
     private:
-        void vInitStringMap()
+        /// How the prints show a ChipColor_t
+        static constexpr char cColorChar(ChipColor_t eColor)
         {
-            xStringMap[NONE] = "-";
-            xStringMap[GREEN] = "G";
-            xStringMap[RED] = "R";
+            return (eColor == GREEN) ? 'G' : ((eColor == RED) ? 'R' : '-');
         }
 
         std::vector<Chip_t> xAllChips;
+        Homography_t xHomography;
+        CellGrid_t xCellGrid;
+        // vChipAlgoStupid()'s scratch, kept here to stay off the task's stack
+        PointBatch_t<DistCoord_t, CHIPS_AT_A_TIME> xBlockBatch;
         std::vector<Chip_t> xWatchedChips;
-        std::vector<int> xWatchedCols;
-
-        std::map<ChipColor_t, std::string> xStringMap;
+        Frontier_t xFrontier;
 
         int ulRows;
         int ulCols;
@@ -544,6 +748,32 @@ class Board_t
         int ulDistBetweenCols;
         float xPointEMA_alpha;
         float xTolerance;
+
+        // Bot chips lExpect() is waiting to see, bit per column
+        uint32_t ulExpectedCols;
+        uint32_t ulSeenBotCols;
+        uint16_t usExpectFrames[Frontier_t::MAX_COLS];
+        ChipColor_t eExpectedColors[Frontier_t::MAX_COLS];
+
+        void vStoreExpected(int lCol, bool bSeen)
+        {
+            int lRow = xFrontier.lRow(lCol);
+            xAllChips[lBoardIdx(lRow, lCol)].vSet(eExpectedColors[lCol]);
+            xWatchedChips[lCol].vResetCounters();
+            xFrontier.vAdvance(lCol);
+            ulExpectedCols &= ~(1u << lCol);
+            xEvents().vLog(bSeen ? EV_BOARD_BOT_SEEN : EV_BOARD_BOT_MISSED, lCol, usExpectFrames[lCol]);
+            xEvents().vLog(EV_BOARD_INSERT, lCol, lRow + 1);
+            if (bSeen)
+            {
+                ulSeenBotCols |= 1u << lCol;
+            }
+            else
+            {
+                PIXY_WARN("Bot chip in col %d not seen in %d frames, stored anyway\n",
+                          lCol, (int)usExpectFrames[lCol]);
+            }
+        }
 };
 
 } // namespace pixy
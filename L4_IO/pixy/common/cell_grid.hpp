@@ -0,0 +1,116 @@
+#ifndef CELL_GRID_HPP
+#define CELL_GRID_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include "pixy/config.hpp"
+#include "pixy/common/point.hpp"
+#include "L4_IO/pixy/libfixmath/fix16.h"
+
+namespace team9
+{
+namespace pixy
+{
+
+/**
+ * Maps a camera pixel to the board cell it belongs to in O(1).
+ *
+ * The image is cut in square buckets of 2^GRID_BUCKET_SHIFT pixels and each
+ * bucket remembers the nearest chip center within the match tolerance, or
+ * NO_CELL.  vBuild() does the floating point work once per calibration;
+ * lookups and distances afterwards are integer only.  Centers are kept as
+ * fix16_t, the format the chip means come from, so equal distances stay
+ * equal and ties between blocks break like the float compare.
+ */
+class CellGrid_t
+{
+    public:
+        static const int8_t NO_CELL = -1;
+        static const int MAX_CELLS = 42;
+
+        CellGrid_t() : ulCells(0)
+        {
+            memset(cBuckets, NO_CELL, sizeof(cBuckets));
+        }
+
+        /**
+         * @param pxCenters  Chip centers, indexed like Board_t::xAllChips
+         * @param xMaxDist   Pixels from a center beyond which nothing matches
+         */
+        void vBuild(const Point_t<float>* pxCenters, uint32_t ulCells_arg, float xMaxDist)
+        {
+            ulCells = (ulCells_arg < (uint32_t)MAX_CELLS) ? ulCells_arg : MAX_CELLS;
+            for (uint32_t ulI = 0; ulI < ulCells; ++ulI)
+            {
+                xCenterY[ulI] = fix16_from_float(pxCenters[ulI].xY);
+                xCenterX[ulI] = fix16_from_float(pxCenters[ulI].xX);
+            }
+
+            // A bucket is kept if any of its pixels can be within xMaxDist
+            const float xBucketHalf = (float)(1 << GRID_BUCKET_SHIFT) / 2;
+            const float xReach = xMaxDist + xBucketHalf * 1.4143f;
+            for (int lRow = 0; lRow < GRID_ROWS; ++lRow)
+            {
+                for (int lCol = 0; lCol < GRID_COLS; ++lCol)
+                {
+                    float xY = (lRow << GRID_BUCKET_SHIFT) + xBucketHalf;
+                    float xX = (lCol << GRID_BUCKET_SHIFT) + xBucketHalf;
+                    float xBest = xReach * xReach;
+                    int8_t cBest = NO_CELL;
+                    for (uint32_t ulI = 0; ulI < ulCells; ++ulI)
+                    {
+                        float xDY = xY - pxCenters[ulI].xY;
+                        float xDX = xX - pxCenters[ulI].xX;
+                        float xDist2 = xDY * xDY + xDX * xDX;
+                        if (xDist2 < xBest)
+                        {
+                            xBest = xDist2;
+                            cBest = (int8_t)ulI;
+                        }
+                    }
+                    cBuckets[lRow][lCol] = cBest;
+                }
+            }
+        }
+
+        /// @returns the cell index at pixel (usY, usX) or NO_CELL
+        int lCellAt(uint16_t usY, uint16_t usX) const
+        {
+            if (usY >= PIXY_CAM_ROWS || usX >= PIXY_CAM_COLS)
+            {
+                return NO_CELL;
+            }
+            return cBuckets[usY >> GRID_BUCKET_SHIFT][usX >> GRID_BUCKET_SHIFT];
+        }
+
+        /// @returns the squared distance from pixel (usY, usX) to a cell's center, in 2^-32 pixel^2
+        int64_t llDist2(int lCell, uint16_t usY, uint16_t usX) const
+        {
+            int64_t llDY = (int64_t)fix16_from_int(usY) - xCenterY[lCell];
+            int64_t llDX = (int64_t)fix16_from_int(usX) - xCenterX[lCell];
+            return llDY * llDY + llDX * llDX;
+        }
+
+        /// @returns xDist in the units of llDist2(), rounded up so "<" matches the float compare
+        static int64_t llToDist2(float xDist)
+        {
+            double xDist2 = (double)xDist * xDist * fix16_one * fix16_one;
+            int64_t llDist2 = (int64_t)xDist2;
+            return ((double)llDist2 < xDist2) ? llDist2 + 1 : llDist2;
+        }
+
+    private:
+        static const int GRID_ROWS = (PIXY_CAM_ROWS + (1 << GRID_BUCKET_SHIFT) - 1) >> GRID_BUCKET_SHIFT;
+        static const int GRID_COLS = (PIXY_CAM_COLS + (1 << GRID_BUCKET_SHIFT) - 1) >> GRID_BUCKET_SHIFT;
+
+        int8_t cBuckets[GRID_ROWS][GRID_COLS];
+        fix16_t xCenterY[MAX_CELLS];
+        fix16_t xCenterX[MAX_CELLS];
+        uint32_t ulCells;
+};
+
+} // namespace pixy
+} // namespace team9
+
+#endif
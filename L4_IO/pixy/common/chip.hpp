@@ -4,30 +4,37 @@
 #include "pixy/config.hpp"
 #include "pixy/common/stat.hpp"
 #include "pixy/common/point_stat.hpp"
+#include "pixy/common/trace.hpp"
 
 namespace team9
 {
 namespace pixy
 {
 
+/**
+ * A cell of the board: where its chip is, and for a watched chip, the
+ * votes for its color.  Each frame's votes per color are averaged by an
+ * EMA in fix16; the chip is known once the color it expects, the human's
+ * unless vExpect() says otherwise, led the other two by more than
+ * CHIP_COLOR_MARGIN in CHIP_VOTES_TO_KNOW of the last CHIP_VOTE_WINDOW
+ * frames that voted on it.
+ */
 class Chip_t
 {
     public:
         Chip_t() : Chip_t(CHIP_PROXIM_TOLERANCE, ChipColor_t::GREEN) {}
         Chip_t(const float xPointEMA_alpha, const ChipColor_t eHumanChipColor_arg) :
+                xPtLoc(xPointEMA_alpha),
+                xChipColorNone(CHIP_COLOR_EMA_ALPHA),
+                xChipColorGreen(CHIP_COLOR_EMA_ALPHA),
+                xChipColorRed(CHIP_COLOR_EMA_ALPHA),
+                xColorVote(CHIP_VOTES_TO_KNOW, CHIP_VOTE_WINDOW),
+                xMargin(StatNum_t<Fix16>::xFromFloat(CHIP_COLOR_MARGIN)),
                 eKnownChipColor(ChipColor_t::NONE),
-                eLastChipColor(ChipColor_t::NONE),
                 eHumanChipColor(eHumanChipColor_arg),
-                bNoneGreatest(false),
-                bGreenGreatest(false),
-                bRedGreatest(false),
-                bEnabled(true),
-                lInARowCnt(0),
-                lTimesRepeatedForMax(NUM_TIMES_FOR_CNT),
-                xLastKnownColorFreq(0.0f)
-        {
-            xPtLoc.vSetAlpha(xPointEMA_alpha);
-        }
+                eExpectedColor(eHumanChipColor_arg),
+                bEnabled(true)
+        {}
 
         void vReset()
         {
@@ -45,16 +52,10 @@ class Chip_t
             return eKnownChipColor;
         }
 
-        float xMeanVal()
-        {
-            return (eKnownChipColor == GREEN) ? xChipColorGreen.xMean() :
-                    ((eKnownChipColor == RED) ? xChipColorRed.xMean() : 0.0);
-        }
-
-        float xStdDevVal()
+        /// Looks for eColor until vResetCounters(), e.g. the bot's chip
+        void vExpect(ChipColor_t eColor)
         {
-            return (eKnownChipColor == GREEN) ? xChipColorGreen.xStdDev() :
-                    ((eKnownChipColor == RED) ? xChipColorRed.xStdDev() : 0.0);
+            eExpectedColor = eColor;
         }
 
         std::string xLocStr()
@@ -62,72 +63,32 @@ class Chip_t
             return xPtLoc.xStr();
         }
 
-        std::string xStdDevStr()
-        {
-            char buff[16];
-            snprintf(buff, 16, "%2.1f", xStdDevVal());
-            return buff;
-        }
-
-        std::string xRangeStr()
-        {
-            char buff[16];
-            snprintf(buff, 16, "%2.1f < x < %2.1f", xMeanVal() + xStdDevVal(),
-                                                    xMeanVal() - xStdDevVal());
-            return buff;
-        }
-
         void vUpdateFreq(int xNoneFreq, int xGreenFreq, int xRedFreq)
         {
             if (bEnabled)
             {
-                xChipColorNone.vUpdate(xNoneFreq);
-                xChipColorGreen.vUpdate(xGreenFreq);
-                xChipColorRed.vUpdate(xRedFreq);
-
-                float xIsNone = xChipColorNone.xMean();
-                float xIsGreen = xChipColorGreen.xMean();
-                float xIsRed = xChipColorRed.xMean();
+                xChipColorNone.vUpdate(StatNum_t<Fix16>::xFromInt(xNoneFreq));
+                xChipColorGreen.vUpdate(StatNum_t<Fix16>::xFromInt(xGreenFreq));
+                xChipColorRed.vUpdate(StatNum_t<Fix16>::xFromInt(xRedFreq));
 
-                bGreenGreatest = bRedGreatest = bNoneGreatest = false;
-                bGreenGreatest = (xIsGreen > xIsNone) && (xIsGreen > xIsRed);
-                bRedGreatest = (xIsRed > xIsNone) && (xIsRed > xIsGreen);
+                fix16_t xIsNone = xChipColorNone.xMean().value;
+                fix16_t xIsGreen = xChipColorGreen.xMean().value;
+                fix16_t xIsRed = xChipColorRed.xMean().value;
+                fix16_t xLead = xMargin.value;
 
                 ChipColor_t eTempChipColor = NONE;
-                if (bGreenGreatest) eTempChipColor = GREEN;
-                else if (bRedGreatest) eTempChipColor = RED;
-
-//                if (eTempChipColor == NONE)
-                if (eTempChipColor != eHumanChipColor)
-                {
-                    lInARowCnt = 0;
-                    return;
-                }
+                if (xIsGreen - xLead > xIsNone && xIsGreen - xLead > xIsRed) eTempChipColor = GREEN;
+                else if (xIsRed - xLead > xIsNone && xIsRed - xLead > xIsGreen) eTempChipColor = RED;
 
-                if (eLastChipColor == NONE)
+                if (xColorVote.bPush(eTempChipColor == eExpectedColor))
                 {
-                    eLastChipColor = eTempChipColor;
-                    lInARowCnt = 1;
-                    return;
-                }
-
-                if (eTempChipColor == eLastChipColor)
-                {
-                    if (lInARowCnt++ == (int)lTimesRepeatedForMax)
-                    {
-                        eKnownChipColor = eLastChipColor;
-                        bEnabled = false;
-                    }
-                }
-                else
-                {
-                    lInARowCnt = 1;
+                    eKnownChipColor = eExpectedColor;
+                    bEnabled = false;
                 }
             }
             else
             {
-                printf("Error in vUpdateFreq: Enabled is false\n");
-                u0_dbg_printf("Error in vUpdateFreq: Enabled is false\n");
+                PIXY_ERROR("Error in vUpdateFreq: Enabled is false\n");
             }
         }
 
@@ -141,50 +102,28 @@ class Chip_t
             xChipColorNone.vReset();
             xChipColorGreen.vReset();
             xChipColorRed.vReset();
+            xColorVote.vReset();
 
             eKnownChipColor = NONE;
-            eLastChipColor = NONE;
-
-            bNoneGreatest = true;
-            bGreenGreatest = false;
-            bRedGreatest = false;
+            eExpectedColor = eHumanChipColor;
             bEnabled = true;
         }
 
-        int lGetInARowCnt()
-        {
-            return lInARowCnt;
-        }
-
-        float xGetColor(StatEnum_t xStatEnum)
-        {
-            if (bNoneGreatest) return xChipColorNone.xStat(xStatEnum);
-            if (bGreenGreatest) return xChipColorGreen.xStat(xStatEnum);
-            if (bRedGreatest) return xChipColorRed.xStat(xStatEnum);
-            return xChipColorNone.xStat(xStatEnum);
-        }
-
         PointEMA_t xPtLoc;
 
     private:
 
-        StatEMA_t xChipColorNone;
-        StatEMA_t xChipColorGreen;
-        StatEMA_t xChipColorRed;
+        Ema_t<Fix16> xChipColorNone;
+        Ema_t<Fix16> xChipColorGreen;
+        Ema_t<Fix16> xChipColorRed;
+        Vote_t<> xColorVote;
+        Fix16 xMargin;
 
         ChipColor_t eKnownChipColor;
-        ChipColor_t eLastChipColor;
         ChipColor_t eHumanChipColor;
+        ChipColor_t eExpectedColor;
 
-        bool bNoneGreatest;
-        bool bGreenGreatest;
-        bool bRedGreatest;
         bool bEnabled;
-
-        int lInARowCnt;
-        int lTimesRepeatedForMax; // Enterprise strength!
-        float xLastKnownColorFreq;
-
 };
 
 } // namespace pixy
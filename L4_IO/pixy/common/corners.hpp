@@ -1,39 +1,36 @@
 #ifndef CORNERS_HPP
 #define CORNERS HPP
 
-#include <vector>
-
 #include "storage.hpp"
 
 #include "pixy/common.hpp"
 #include "pixy/common/block.hpp"
 #include "pixy/common/point.hpp"
-#include "pixy/common/stat.hpp"
+#include "pixy/common/point_stat.hpp"
 
 namespace team9
 {
 namespace pixy
 {
 
-// TODO: Refactor to use PointStat_t, deprecate Stat_t
+/// The calibration chip seen in each quadrant, averaged by an EMA
 class Corners_t
 {
     public:
         Corners_t() :
-                xStats(8),
+                xStats{PointEMA_t(CHIP_COLOR_EMA_ALPHA), PointEMA_t(CHIP_COLOR_EMA_ALPHA),
+                       PointEMA_t(CHIP_COLOR_EMA_ALPHA), PointEMA_t(CHIP_COLOR_EMA_ALPHA)},
                 bSet(false)
         {}
 
         Point_t<float> operator() (Quadrant_t xQuadrant) const
         {
-            return Point_t<float>(xStats[2*xQuadrant].xMean(),
-                                  xStats[2*xQuadrant+1].xMean());
+            return xStats[xQuadrant].xPoint();
         }
 
         void vUpdate(Quadrant_t& xQuadrant, Block_t& xBlock)
         {
-            xStats[2*xQuadrant].vUpdate(xBlock.xPoint.xY);
-            xStats[2*xQuadrant+1].vUpdate(xBlock.xPoint.xX);
+            xStats[xQuadrant].vUpdate(xBlock.xPoint);
         }
 
         static std::string xCornerStr(const Corners_t& xCorners,
@@ -41,32 +38,24 @@ class Corners_t
         {
             static const uint32_t ulBuffSize = 32;
             char buff[ulBuffSize];
-            snprintf(buff, ulBuffSize, "[%3.2f %3.2f]",
-                     xCorners.xStats[2*xQuadrant].xMean(),
-                     xCorners.xStats[2*xQuadrant+1].xMean());
+            Point_t<float> xCorner = xCorners(xQuadrant);
+            snprintf(buff, ulBuffSize, "[%3.2f %3.2f]", xCorner.xY, xCorner.xX);
             return std::string(buff);
         }
 
+        /// Callers write all 256 bytes of the buffer to /corners.calib, so it is static
         static char* pcCornerStrRaw(const Corners_t& xCorners)
         {
-            if ((int)xCorners.xStats.size() == 8)
-            {
-                static const uint32_t ulBuffSize = 256;
-                char buff[ulBuffSize] = "";
-                snprintf(buff, ulBuffSize,
-                         "%3.2f %3.2f %3.2f %3.2f %3.2f %3.2f %3.2f %3.2f",
-                          xCorners.xStats[2 * TOP_LEFT].xMean(),
-                          xCorners.xStats[2 * TOP_LEFT + 1].xMean(),
-                          xCorners.xStats[2 * TOP_RIGHT].xMean(),
-                          xCorners.xStats[2 * TOP_RIGHT + 1].xMean(),
-                          xCorners.xStats[2 * BOT_LEFT].xMean(),
-                          xCorners.xStats[2 * BOT_LEFT + 1].xMean(),
-                          xCorners.xStats[2 * BOT_RIGHT].xMean(),
-                          xCorners.xStats[2 * BOT_RIGHT + 1].xMean());
-                return buff;
-            }
-            std::cout << "Error, need 8 corners to return xCornerStrRaw";
-            return "";
+            static const uint32_t ulBuffSize = 256;
+            static char buff[ulBuffSize];
+            memset(buff, 0, ulBuffSize);
+            snprintf(buff, ulBuffSize,
+                     "%3.2f %3.2f %3.2f %3.2f %3.2f %3.2f %3.2f %3.2f",
+                      xCorners(TOP_LEFT).xY, xCorners(TOP_LEFT).xX,
+                      xCorners(TOP_RIGHT).xY, xCorners(TOP_RIGHT).xX,
+                      xCorners(BOT_LEFT).xY, xCorners(BOT_LEFT).xX,
+                      xCorners(BOT_RIGHT).xY, xCorners(BOT_RIGHT).xX);
+            return buff;
         }
 
         static bool bReadCorners(const char* calib_file_path, Corners_t& xCorners)
@@ -74,8 +63,7 @@ class Corners_t
             char corner_str[256] = "";
             if (Storage::read("/corners.calib", corner_str, 256, 0) == FR_NO_FILE)
             {
-                printf("/corners.calib doesn't exist\n");
-                u0_dbg_printf("/corners.calib doesn't exist\n");
+                PIXY_WARN("/corners.calib doesn't exist\n");
                 return false;
             }
             float tl_y;
@@ -94,52 +82,32 @@ class Corners_t
                                 &br_y, &br_x);
             if (corner_tokens == 8)
             {
-                xCorners.xStats[2 * TOP_LEFT].vSetMean(tl_y);
-                xCorners.xStats[2 * TOP_LEFT + 1].vSetMean(tl_x);
-                xCorners.xStats[2 * TOP_RIGHT].vSetMean(tr_y);
-                xCorners.xStats[2 * TOP_RIGHT + 1].vSetMean(tr_x);
-                xCorners.xStats[2 * BOT_LEFT].vSetMean(bl_y);
-                xCorners.xStats[2 * BOT_LEFT + 1].vSetMean(bl_x);
-                xCorners.xStats[2 * BOT_RIGHT].vSetMean(br_y);
-                xCorners.xStats[2 * BOT_RIGHT + 1].vSetMean(br_x);
+                xCorners.xStats[TOP_LEFT].vSet(Point_t<float>(tl_y, tl_x));
+                xCorners.xStats[TOP_RIGHT].vSet(Point_t<float>(tr_y, tr_x));
+                xCorners.xStats[BOT_LEFT].vSet(Point_t<float>(bl_y, bl_x));
+                xCorners.xStats[BOT_RIGHT].vSet(Point_t<float>(br_y, br_x));
                 return true;
             }
-            printf("Error reading corners "
-                   "(read %d floats instead of 8\n)",
-                   corner_tokens);
+            PIXY_ERROR("Error reading corners "
+                       "(read %d floats instead of 8)\n",
+                       corner_tokens);
             return false;
         }
 
         static void vPrint(const Corners_t& xCorners)
         {
-            printf("[\n"
-                   "\t[%f %f] [%f %f]\n"
-                   "\t[%f %f] [%f %f]\n"
-                   "]\n",
-                    xCorners.xStats[2 * TOP_LEFT].xMean(),
-                    xCorners.xStats[2 * TOP_LEFT + 1].xMean(),
-                    xCorners.xStats[2 * TOP_RIGHT].xMean(),
-                    xCorners.xStats[2 * TOP_RIGHT + 1].xMean(),
-                    xCorners.xStats[2 * BOT_LEFT].xMean(),
-                    xCorners.xStats[2 * BOT_LEFT + 1].xMean(),
-                    xCorners.xStats[2 * BOT_RIGHT].xMean(),
-                    xCorners.xStats[2 * BOT_RIGHT + 1].xMean());
-            u0_dbg_printf("[\n"
-                   "\t[%f %f] [%f %f]\n"
-                   "\t[%f %f] [%f %f]\n"
-                   "]\n",
-                    xCorners.xStats[2 * TOP_LEFT].xMean(),
-                    xCorners.xStats[2 * TOP_LEFT + 1].xMean(),
-                    xCorners.xStats[2 * TOP_RIGHT].xMean(),
-                    xCorners.xStats[2 * TOP_RIGHT + 1].xMean(),
-                    xCorners.xStats[2 * BOT_LEFT].xMean(),
-                    xCorners.xStats[2 * BOT_LEFT + 1].xMean(),
-                    xCorners.xStats[2 * BOT_RIGHT].xMean(),
-                    xCorners.xStats[2 * BOT_RIGHT + 1].xMean());
+            PIXY_INFO("[\n"
+                      "\t[%f %f] [%f %f]\n"
+                      "\t[%f %f] [%f %f]\n"
+                      "]\n",
+                      xCorners(TOP_LEFT).xY, xCorners(TOP_LEFT).xX,
+                      xCorners(TOP_RIGHT).xY, xCorners(TOP_RIGHT).xX,
+                      xCorners(BOT_LEFT).xY, xCorners(BOT_LEFT).xX,
+                      xCorners(BOT_RIGHT).xY, xCorners(BOT_RIGHT).xX);
         }
 
     private:
-        std::vector<StatEMA_t> xStats;
+        PointEMA_t xStats[4];
         bool bSet;
 };
 
@@ -0,0 +1,258 @@
+#ifndef EVENT_TRACE_HPP
+#define EVENT_TRACE_HPP
+
+#include <stdint.h>
+
+#include "pixy/config.hpp"
+#include "pixy/common/state_table.hpp"
+
+namespace team9
+{
+namespace pixy
+{
+
+/// What happened, in the order pixy_trace_decode knows them; only append
+enum EventId_t
+{
+    EV_NONE = 0,
+    EV_PIXY_STATE,       // from State_t, to State_t
+    EV_EYES_FRAME,       // blocks, checksum errors
+    EV_EYES_TIMEOUT,     // blocks so far
+    EV_BOARD_UPDATE,     // voted columns (bits), seen chips
+    EV_BOARD_CHIP_KNOWN, // column, row
+    EV_BOARD_INSERT,     // column, new height
+    EV_MOTOR_START,      // direction, steps
+    EV_MOTOR_END,        // direction, steps counted
+    EV_GAME_HUMAN,       // column
+    EV_GAME_MOVE,        // eGame_t, column
+    EV_GAME_SERVO,       // drops
+    EV_BOARD_BOT_SEEN,   // column, frames it took
+    EV_BOARD_BOT_MISSED, // column, frames waited
+    EV_GAME_DROP,        // column, ms the gate was open
+    EV_GAME_CYCLE,       // column, ms from the human's move to the gantry home
+    EV_COUNT
+};
+
+/// Indexed by EventId_t
+constexpr NameTable_t<EventId_t, EV_COUNT> xEventNames = {{
+    "NONE",
+    "PIXY_STATE",
+    "EYES_FRAME",
+    "EYES_TIMEOUT",
+    "BOARD_UPDATE",
+    "BOARD_CHIP_KNOWN",
+    "BOARD_INSERT",
+    "MOTOR_START",
+    "MOTOR_END",
+    "GAME_HUMAN",
+    "GAME_MOVE",
+    "GAME_SERVO",
+    "BOARD_BOT_SEEN",
+    "BOARD_BOT_MISSED",
+    "GAME_DROP",
+    "GAME_CYCLE"
+}};
+static_assert(xEventNames.bComplete(), "every EventId_t needs a name");
+
+/// Indexed by EventId_t, how pixy_trace_decode prints usArg and lArg
+constexpr NameTable_t<EventId_t, EV_COUNT> xEventArgs = {{
+    "",
+    "state %d -> %d",
+    "%d blocks, %d checksum errors",
+    "after %d blocks",
+    "voted cols 0x%02x, %d seen chips",
+    "col %d, row %d",
+    "col %d, height %d",
+    "dir %d, %d steps",
+    "dir %d, %d steps counted",
+    "col %d",
+    "game %d, col %d",
+    "%d drops",
+    "col %d, after %d frames",
+    "col %d, not seen in %d frames",
+    "col %d, gate open %d ms",
+    "col %d, %d ms"
+}};
+static_assert(xEventArgs.bComplete(), "every EventId_t needs an argument format");
+
+/// One event, 16 bytes, little endian in a dump
+struct EventRecord_t
+{
+    uint32_t ulSeq;    // position in the trace, NO_SEQ while being written
+    uint32_t ulTimeUs; // low 32 bits of the uptime, wraps every 71 minutes
+    uint16_t usEvent;  // EventId_t
+    uint16_t usArg;
+    int32_t lArg;
+};
+static_assert(sizeof(EventRecord_t) == 16, "pixy_trace_decode reads 16 byte records");
+
+/// What a dump starts with, then its EventRecord_t oldest first up to the end
+struct EventDumpHeader_t
+{
+    static const uint32_t MAGIC = 0x52545645; // "EVTR"
+    static const uint16_t VERSION = 1;
+
+    uint32_t ulMagic;
+    uint16_t usVersion;
+    uint16_t usRecordBytes;
+    uint32_t ulCapacity; // of the ring, at most this many records follow
+    uint32_t ulLogged;   // events logged since boot when the dump began
+};
+static_assert(sizeof(EventDumpHeader_t) == 16, "pixy_trace_decode reads a 16 byte header");
+
+/**
+ * The last EVENT_TRACE_RECORDS events in RAM, for when the text trace is
+ * too slow or too late.  vLog() claims a slot with one atomic add (LDREX /
+ * STREX on the Cortex-M3) and fills it in place: no lock, no formatting,
+ * safe from any task or ISR.  The slot's sequence number is written last,
+ * so a reader copying the ring while it is written skips the half-written
+ * slots instead of reading them.  Formatting waits for pixy_trace_decode.
+ */
+class EventTrace_t
+{
+    public:
+        typedef uint64_t (*Clock_t)(void);
+
+        static const uint32_t CAPACITY = EVENT_TRACE_RECORDS;
+        static const uint32_t NO_SEQ = 0xFFFFFFFF;
+        static const uint32_t DUMP_CHUNK = 16; // records ulDump() copies at a time, on the stack
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "EVENT_TRACE_RECORDS must be a power of 2");
+
+        constexpr EventTrace_t() :
+            pxClock(nullptr),
+            ulHead(0),
+            ulStart(0),
+            xRecords()
+        {}
+
+        /// Microseconds, e.g. sys_get_uptime_us; without one every time is 0
+        void vSetClock(Clock_t pxClock_arg)
+        {
+            pxClock = pxClock_arg;
+        }
+
+        void vLog(EventId_t eEvent, uint16_t usArg = 0, int32_t lArg = 0)
+        {
+            uint32_t ulSeq = __atomic_fetch_add(&ulHead, 1, __ATOMIC_RELAXED);
+            EventRecord_t& xRecord = xRecords[ulSeq & (CAPACITY - 1)];
+            __atomic_store_n(&xRecord.ulSeq, NO_SEQ, __ATOMIC_RELAXED);
+            xRecord.ulTimeUs = pxClock ? (uint32_t)pxClock() : 0;
+            xRecord.usEvent = (uint16_t)eEvent;
+            xRecord.usArg = usArg;
+            xRecord.lArg = lArg;
+            __atomic_store_n(&xRecord.ulSeq, ulSeq, __ATOMIC_RELEASE);
+        }
+
+        /// Events logged since boot, the next one's sequence number
+        uint32_t ulLogged() const
+        {
+            return __atomic_load_n(&ulHead, __ATOMIC_ACQUIRE);
+        }
+
+        /// Sequence number of the oldest event still kept
+        uint32_t ulOldest() const
+        {
+            uint32_t ulLoggedNow = ulLogged();
+            uint32_t ulOldestNow = (ulLoggedNow > CAPACITY) ? ulLoggedNow - CAPACITY : 0;
+            uint32_t ulStartNow = __atomic_load_n(&ulStart, __ATOMIC_ACQUIRE);
+            return (ulStartNow > ulOldestNow) ? ulStartNow : ulOldestNow;
+        }
+
+        /// @returns false if event ulSeq was overwritten or is being written
+        bool bRead(uint32_t ulSeq, EventRecord_t& xOut) const
+        {
+            const EventRecord_t& xRecord = xRecords[ulSeq & (CAPACITY - 1)];
+            if (__atomic_load_n(&xRecord.ulSeq, __ATOMIC_ACQUIRE) != ulSeq)
+            {
+                return false;
+            }
+            xOut.ulSeq = ulSeq;
+            xOut.ulTimeUs = xRecord.ulTimeUs;
+            xOut.usEvent = xRecord.usEvent;
+            xOut.usArg = xRecord.usArg;
+            xOut.lArg = xRecord.lArg;
+            // Overwritten while it was copied
+            return __atomic_load_n(&xRecord.ulSeq, __ATOMIC_ACQUIRE) == ulSeq;
+        }
+
+        /**
+         * Copies events ulFromSeq up to ulToSeq, oldest first, skipping the
+         * ones that are gone.
+         * @returns how many went into pxOut
+         * @param ulFromSeq  is moved past the last event looked at
+         */
+        uint32_t ulRead(uint32_t& ulFromSeq, uint32_t ulToSeq, EventRecord_t* pxOut, uint32_t ulMax) const
+        {
+            uint32_t ulOldestNow = ulOldest();
+            if (ulFromSeq < ulOldestNow)
+            {
+                ulFromSeq = ulOldestNow;
+            }
+            uint32_t ulCount = 0;
+            for (; ulFromSeq < ulToSeq && ulCount < ulMax; ++ulFromSeq)
+            {
+                ulCount += bRead(ulFromSeq, pxOut[ulCount]) ? 1 : 0;
+            }
+            return ulCount;
+        }
+
+        /**
+         * A dump for pixy_trace_decode: the header, then the events kept
+         * when it began, DUMP_CHUNK at a time, through
+         * bool xWrite(const void* pvData, uint32_t ulBytes).  Events logged
+         * meanwhile may overwrite the oldest ones before they are copied,
+         * those are left out.
+         * @returns the events written
+         */
+        template<typename WRITE_T>
+        uint32_t ulDump(WRITE_T xWrite) const
+        {
+            uint32_t ulSeq = ulOldest();
+            uint32_t ulEnd = ulLogged();
+            EventDumpHeader_t xHeader = {EventDumpHeader_t::MAGIC, EventDumpHeader_t::VERSION,
+                                         sizeof(EventRecord_t), CAPACITY, ulEnd};
+            if (!xWrite(&xHeader, sizeof(xHeader)))
+            {
+                return 0;
+            }
+            EventRecord_t xChunk[DUMP_CHUNK];
+            uint32_t ulWritten = 0;
+            while (ulSeq < ulEnd)
+            {
+                uint32_t ulCount = ulRead(ulSeq, ulEnd, xChunk, DUMP_CHUNK);
+                if (ulCount && !xWrite(xChunk, ulCount * sizeof(EventRecord_t)))
+                {
+                    break;
+                }
+                ulWritten += ulCount;
+            }
+            return ulWritten;
+        }
+
+        /**
+         * Drops every event logged so far.  The ring is left alone, the
+         * readers just start after it, so vLog() may run meanwhile.
+         */
+        void vClear()
+        {
+            __atomic_store_n(&ulStart, ulLogged(), __ATOMIC_RELEASE);
+        }
+
+    private:
+        Clock_t pxClock;
+        uint32_t ulHead;
+        uint32_t ulStart; // first sequence number after the last vClear()
+        EventRecord_t xRecords[CAPACITY];
+};
+
+/// The one everything logs to, constant initialized
+inline EventTrace_t& xEvents()
+{
+    static EventTrace_t xInstance;
+    return xInstance;
+}
+
+} // namespace pixy
+} // namespace team9
+
+#endif
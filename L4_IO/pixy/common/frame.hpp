@@ -0,0 +1,41 @@
+#ifndef FRAME_HPP
+#define FRAME_HPP
+
+#include <utility>
+
+#include "pixy/config.hpp"
+#include "pixy/common.hpp"
+#include "pixy/common/block.hpp"
+#include "pixy/common/span.hpp"
+
+namespace team9
+{
+namespace pixy
+{
+
+/// Board index and color of a block matched to a chip
+typedef std::pair<int, ChipColor_t> SeenChip_t;
+
+typedef FixedVector_t<Block_t, CHIPS_AT_A_TIME> BlockArena_t;
+typedef FixedVector_t<SeenChip_t, CHIPS_AT_A_TIME> SeenChips_t;
+
+/**
+ * Everything one vision cycle produces.  PixyBrain_t owns a single Frame_t
+ * and refills it every cycle, so sampling chips never allocates.
+ */
+struct Frame_t
+{
+    BlockArena_t xBlocks;
+    SeenChips_t xSeenChips;
+
+    void vClear()
+    {
+        xBlocks.clear();
+        xSeenChips.clear();
+    }
+};
+
+} // namespace pixy
+} // namespace team9
+
+#endif
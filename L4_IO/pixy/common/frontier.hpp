@@ -0,0 +1,153 @@
+#ifndef FRONTIER_HPP
+#define FRONTIER_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include "pixy/common.hpp"
+
+namespace team9
+{
+namespace pixy
+{
+
+/**
+ * The frontier of the board: the one cell per column the next chip can
+ * land in, and the votes the current frame casts for its color.
+ *
+ * bVote() buckets a seen chip into its column in O(1) and drops it unless it
+ * is on the frontier, so a frame costs one pass over its seen chips plus the
+ * columns that got votes.  Columns whose chip became known are queued with
+ * vMarkChanged() and handed out lowest column first by lPopChanged().
+ * Everything is fixed size, nothing is allocated or printed.
+ */
+class Frontier_t
+{
+    public:
+        static const int MAX_ROWS = 8;
+        static const int MAX_COLS = 8;
+
+        Frontier_t(int lRows_arg, int lCols_arg) :
+            lRows(lRows_arg < MAX_ROWS ? lRows_arg : MAX_ROWS),
+            lCols(lCols_arg < MAX_COLS ? lCols_arg : MAX_COLS)
+        {
+            // Board index to column and row, see Board_t::lBoardIdx()
+            for (int lIdx = 0; lIdx < lRows * lCols; ++lIdx)
+            {
+                cIdxCol[lIdx] = (int8_t)(lIdx % lCols);
+                cIdxRow[lIdx] = (int8_t)(lRows - lIdx / lCols - 1);
+            }
+            vReset();
+        }
+
+        /// Empty board, nothing voted or changed
+        void vReset()
+        {
+            memset(cRow, 0, sizeof(cRow));
+            memset(usVotes, 0, sizeof(usVotes));
+            ulVotedCols = 0;
+            ulChangedCols = 0;
+        }
+
+        int lColCount() const
+        {
+            return lCols;
+        }
+
+        /// @returns the row the next chip in lCol lands in, lRows once it is full
+        int lRow(int lCol) const
+        {
+            return cRow[lCol];
+        }
+
+        /// Moves lCol's frontier up a row and drops its pending change
+        void vAdvance(int lCol)
+        {
+            if (cRow[lCol] < lRows)
+            {
+                cRow[lCol]++;
+            }
+            vClearChanged(lCol);
+        }
+
+        /// Forgets the last frame's votes, only the columns that got some
+        void vClearVotes()
+        {
+            for (uint32_t ulMask = ulVotedCols; ulMask; ulMask &= ulMask - 1)
+            {
+                memset(usVotes[__builtin_ctz(ulMask)], 0, sizeof(usVotes[0]));
+            }
+            ulVotedCols = 0;
+        }
+
+        /**
+         * Counts a seen chip if lBoardIdx is a frontier cell.
+         * @returns false if it is off the board or off the frontier
+         */
+        bool bVote(int lBoardIdx, ChipColor_t eColor)
+        {
+            if (lBoardIdx < 0 || lBoardIdx >= lRows * lCols || (unsigned)eColor >= COLORS)
+            {
+                return false;
+            }
+            int lCol = cIdxCol[lBoardIdx];
+            if (cIdxRow[lBoardIdx] != cRow[lCol])
+            {
+                return false;
+            }
+            usVotes[lCol][eColor]++;
+            ulVotedCols |= 1u << lCol;
+            return true;
+        }
+
+        /// Bit per column that got votes this frame
+        uint32_t ulVotedMask() const
+        {
+            return ulVotedCols;
+        }
+
+        /// This frame's votes for lCol, indexed by ChipColor_t
+        const uint16_t* pusVotes(int lCol) const
+        {
+            return usVotes[lCol];
+        }
+
+        void vMarkChanged(int lCol)
+        {
+            ulChangedCols |= 1u << lCol;
+        }
+
+        void vClearChanged(int lCol)
+        {
+            ulChangedCols &= ~(1u << lCol);
+        }
+
+        /// @returns the lowest column whose chip became known, -1 if none
+        int lPopChanged()
+        {
+            if (!ulChangedCols)
+            {
+                return -1;
+            }
+            int lCol = __builtin_ctz(ulChangedCols);
+            vClearChanged(lCol);
+            return lCol;
+        }
+
+    private:
+        static const unsigned COLORS = 3; // NONE, GREEN, RED
+
+        int lRows;
+        int lCols;
+        int8_t cRow[MAX_COLS];
+        int8_t cIdxCol[MAX_ROWS * MAX_COLS];
+        int8_t cIdxRow[MAX_ROWS * MAX_COLS];
+        uint16_t usVotes[MAX_COLS][COLORS];
+        uint32_t ulVotedCols;
+        uint32_t ulChangedCols;
+};
+
+} // namespace pixy
+} // namespace team9
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef HOMOGRAPHY_HPP
+#define HOMOGRAPHY_HPP
+
+#include <stdint.h>
+
+#include "pixy/common.hpp"
+#include "pixy/common/point.hpp"
+#include "L4_IO/pixy/libfixmath/fix16.h"
+
+namespace team9
+{
+namespace pixy
+{
+
+/**
+ * Perspective map between the board and the camera, fitted to the four
+ * corner chip centers of the calibration.
+ *
+ * Board coordinates are in cells: column 0 to ulCols-1 from the left, row 0
+ * to ulRows-1 from the top, like Board_t::xAllChips.  Unlike interpolating
+ * along the board's edges, the map keeps rows and columns evenly spaced on
+ * the board when the camera looks at it at an angle.
+ *
+ * Everything is fix16_t.  Pixels are divided by 2^NORM_SHIFT first so the
+ * coefficients stay near 1, where fix16_t has plenty of precision.
+ * libfixmatrix's mf16 solver is not in the tree, so the fit is the closed
+ * form for a square to a quadrilateral, inverted through the adjugate.
+ */
+class Homography_t
+{
+    public:
+        Homography_t() : bValid(false)
+        {}
+
+        /**
+         * Fits the map, the corners are the centers of the corner cells.
+         * @returns false if the corners do not make a usable quadrilateral
+         */
+        bool bFit(const Point_t<float>& xTL, const Point_t<float>& xTR,
+                  const Point_t<float>& xBL, const Point_t<float>& xBR,
+                  int lCols, int lRows)
+        {
+            bValid = false;
+            if (lCols < 2 || lRows < 2)
+            {
+                return false;
+            }
+
+            // Unit square (s, t) to the image: (0, 0) TL, (1, 0) TR, (1, 1) BR, (0, 1) BL
+            fix16_t x0 = xNorm(xTL.xX), y0 = xNorm(xTL.xY);
+            fix16_t x1 = xNorm(xTR.xX), y1 = xNorm(xTR.xY);
+            fix16_t x2 = xNorm(xBR.xX), y2 = xNorm(xBR.xY);
+            fix16_t x3 = xNorm(xBL.xX), y3 = xNorm(xBL.xY);
+
+            fix16_t xSX = fix16_add(fix16_sub(x0, x1), fix16_sub(x2, x3));
+            fix16_t xSY = fix16_add(fix16_sub(y0, y1), fix16_sub(y2, y3));
+            fix16_t xDX1 = fix16_sub(x1, x2), xDX2 = fix16_sub(x3, x2);
+            fix16_t xDY1 = fix16_sub(y1, y2), xDY2 = fix16_sub(y3, y2);
+            fix16_t xDen = fix16_sub(fix16_mul(xDX1, xDY2), fix16_mul(xDX2, xDY1));
+            if (xDen == 0)
+            {
+                return false;
+            }
+
+            // A parallelogram gives g = h = 0, the affine case
+            fix16_t xG = fix16_div(fix16_sub(fix16_mul(xSX, xDY2), fix16_mul(xDX2, xSY)), xDen);
+            fix16_t xH = fix16_div(fix16_sub(fix16_mul(xDX1, xSY), fix16_mul(xSX, xDY1)), xDen);
+            fix16_t xFwd[9] = {
+                fix16_add(fix16_sub(x1, x0), fix16_mul(xG, x1)),
+                fix16_add(fix16_sub(x3, x0), fix16_mul(xH, x3)),
+                x0,
+                fix16_add(fix16_sub(y1, y0), fix16_mul(xG, y1)),
+                fix16_add(fix16_sub(y3, y0), fix16_mul(xH, y3)),
+                y0,
+                xG, xH, fix16_one
+            };
+
+            // Adjugate, the inverse up to a scale the division cancels
+            fix16_t xInv[9] = {
+                xDet2(xFwd[4], xFwd[5], xFwd[7], xFwd[8]),
+                xDet2(xFwd[2], xFwd[1], xFwd[8], xFwd[7]),
+                xDet2(xFwd[1], xFwd[2], xFwd[4], xFwd[5]),
+                xDet2(xFwd[5], xFwd[3], xFwd[8], xFwd[6]),
+                xDet2(xFwd[0], xFwd[2], xFwd[6], xFwd[8]),
+                xDet2(xFwd[2], xFwd[0], xFwd[5], xFwd[3]),
+                xDet2(xFwd[3], xFwd[4], xFwd[6], xFwd[7]),
+                xDet2(xFwd[1], xFwd[0], xFwd[7], xFwd[6]),
+                xDet2(xFwd[0], xFwd[1], xFwd[3], xFwd[4])
+            };
+
+            // Scale the unit square up to cells
+            for (int lI = 0; lI < 3; ++lI)
+            {
+                xInv[lI] = fix16_mul(xInv[lI], fix16_from_int(lCols - 1));
+                xInv[3 + lI] = fix16_mul(xInv[3 + lI], fix16_from_int(lRows - 1));
+            }
+
+            for (int lI = 0; lI < 9; ++lI)
+            {
+                if (xFwd[lI] == fix16_overflow || xInv[lI] == fix16_overflow)
+                {
+                    return false;
+                }
+                xToImage[lI] = xFwd[lI];
+                xToBoard[lI] = xInv[lI];
+            }
+
+            // Points on the board must come out with a positive divisor
+            int64_t llCenterDen = llDot(xToBoard + 6, (x0 + x2) / 2, (y0 + y2) / 2);
+            if (llCenterDen == 0)
+            {
+                return false;
+            }
+            if (llCenterDen < 0)
+            {
+                for (int lI = 0; lI < 9; ++lI)
+                {
+                    xToBoard[lI] = -xToBoard[lI];
+                }
+            }
+            xColScale = fix16_div(fix16_one, fix16_from_int(lCols - 1));
+            xRowScale = fix16_div(fix16_one, fix16_from_int(lRows - 1));
+            bValid = true;
+            return true;
+        }
+
+        bool bIsValid() const
+        {
+            return bValid;
+        }
+
+        /**
+         * Board cell to camera pixel, used to place the chip centers once
+         * per calibration.
+         */
+        Point_t<float> xToCamera(fix16_t xRow, fix16_t xCol) const
+        {
+            fix16_t xS = fix16_mul(xCol, xColScale);
+            fix16_t xT = fix16_mul(xRow, xRowScale);
+            fix16_t xW = fix16_add(fix16_add(fix16_mul(xToImage[6], xS),
+                                             fix16_mul(xToImage[7], xT)), xToImage[8]);
+            fix16_t xX = fix16_add(fix16_add(fix16_mul(xToImage[0], xS),
+                                             fix16_mul(xToImage[1], xT)), xToImage[2]);
+            fix16_t xY = fix16_add(fix16_add(fix16_mul(xToImage[3], xS),
+                                             fix16_mul(xToImage[4], xT)), xToImage[5]);
+            return Point_t<float>(fix16_to_float(fix16_div(xY, xW)) * (1 << NORM_SHIFT),
+                                  fix16_to_float(fix16_div(xX, xW)) * (1 << NORM_SHIFT));
+        }
+
+        /**
+         * Camera pixel to board cell, integer only.
+         * @returns false if the pixel maps to the far side of the horizon
+         */
+        bool bToBoard(uint16_t usY, uint16_t usX, fix16_t& xRow, fix16_t& xCol) const
+        {
+            fix16_t xX = (fix16_t)usX << (16 - NORM_SHIFT);
+            fix16_t xY = (fix16_t)usY << (16 - NORM_SHIFT);
+            int64_t llDen = llDot(xToBoard + 6, xX, xY);
+            if (llDen <= 0)
+            {
+                return false;
+            }
+            // 2^32 scaled products, shifted to 2^48 so the quotient is fix16_t
+            int64_t llCol = (llDot(xToBoard, xX, xY) << 16) / llDen;
+            int64_t llRow = (llDot(xToBoard + 3, xX, xY) << 16) / llDen;
+            if (llCol < -FAR || llCol > FAR || llRow < -FAR || llRow > FAR)
+            {
+                return false;
+            }
+            xCol = (fix16_t)llCol;
+            xRow = (fix16_t)llRow;
+            return true;
+        }
+
+    private:
+        static const int NORM_SHIFT = 8;
+        static const int64_t FAR = (int64_t)1024 << 16; // cells, nowhere near the board
+
+        static fix16_t xNorm(float xPixels)
+        {
+            return fix16_from_float(xPixels / (1 << NORM_SHIFT));
+        }
+
+        /// | xA xB |
+        /// | xC xD |
+        static fix16_t xDet2(fix16_t xA, fix16_t xB, fix16_t xC, fix16_t xD)
+        {
+            return fix16_sub(fix16_mul(xA, xD), fix16_mul(xB, xC));
+        }
+
+        /// Row of a matrix times (xX, xY, 1), scaled by 2^32
+        static int64_t llDot(const fix16_t* pxRow, fix16_t xX, fix16_t xY)
+        {
+            return (int64_t)pxRow[0] * xX + (int64_t)pxRow[1] * xY + ((int64_t)pxRow[2] << 16);
+        }
+
+        fix16_t xToImage[9];
+        fix16_t xToBoard[9];
+        fix16_t xColScale;
+        fix16_t xRowScale;
+        bool bValid;
+};
+
+} // namespace pixy
+} // namespace team9
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef POINT_BATCH_HPP
+#define POINT_BATCH_HPP
+
+#include <stdint.h>
+
+#include "L4_IO/pixy/libfixmath/fix16.h"
+
+// Host builds only.  LPC17xx.h's __I and __O macros clash with parameter
+// names in the intrinsics headers, so they are put aside while those are read.
+#if defined(__SSE2__)
+#pragma push_macro("__I")
+#pragma push_macro("__O")
+#undef __I
+#undef __O
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PIXY_DIST_SIMD "AVX"
+#else
+#include <emmintrin.h>
+#define PIXY_DIST_SIMD "SSE2"
+#endif
+#pragma pop_macro("__O")
+#pragma pop_macro("__I")
+#endif
+
+namespace team9
+{
+namespace pixy
+{
+
+/**
+ * Up to N points stored as two arrays, all the Y then all the X, so the
+ * distance kernels below read them a vector register at a time.
+ */
+template<typename T, uint32_t N>
+class PointBatch_t
+{
+    public:
+        PointBatch_t() : ulSize(0)
+        {}
+
+        /// @returns false if the batch is full
+        bool push_back(T xY_arg, T xX_arg)
+        {
+            if (ulSize >= N)
+            {
+                return false;
+            }
+            xY[ulSize] = xY_arg;
+            xX[ulSize] = xX_arg;
+            ulSize++;
+            return true;
+        }
+
+        void clear()
+        {
+            ulSize = 0;
+        }
+
+        uint32_t size() const
+        {
+            return ulSize;
+        }
+
+        static uint32_t capacity()
+        {
+            return N;
+        }
+
+        const T* pxY() const
+        {
+            return xY;
+        }
+
+        const T* pxX() const
+        {
+            return xX;
+        }
+
+    private:
+        T xY[N];
+        T xX[N];
+        uint32_t ulSize;
+};
+
+/// Squared distances from ulN points to (xCY, xCX), one at a time
+inline void vDist2Scalar(const float* pxY, const float* pxX, uint32_t ulN,
+                         float xCY, float xCX, float* pxDist2)
+{
+    for (uint32_t ulI = 0; ulI < ulN; ++ulI)
+    {
+        float xDY = pxY[ulI] - xCY;
+        float xDX = pxX[ulI] - xCX;
+        pxDist2[ulI] = xDY * xDY + xDX * xDX;
+    }
+}
+
+/// vDist2Scalar() 8 (AVX) or 4 (SSE2) points at a time, scalar if neither is enabled
+inline void vDist2Simd(const float* pxY, const float* pxX, uint32_t ulN,
+                       float xCY, float xCX, float* pxDist2)
+{
+    uint32_t ulI = 0;
+#if defined(__AVX__)
+    const __m256 xCY8 = _mm256_set1_ps(xCY);
+    const __m256 xCX8 = _mm256_set1_ps(xCX);
+    for (; ulI + 8 <= ulN; ulI += 8)
+    {
+        __m256 xDY = _mm256_sub_ps(_mm256_loadu_ps(pxY + ulI), xCY8);
+        __m256 xDX = _mm256_sub_ps(_mm256_loadu_ps(pxX + ulI), xCX8);
+        _mm256_storeu_ps(pxDist2 + ulI, _mm256_add_ps(_mm256_mul_ps(xDY, xDY),
+                                                      _mm256_mul_ps(xDX, xDX)));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128 xCY4 = _mm_set1_ps(xCY);
+    const __m128 xCX4 = _mm_set1_ps(xCX);
+    for (; ulI + 4 <= ulN; ulI += 4)
+    {
+        __m128 xDY = _mm_sub_ps(_mm_loadu_ps(pxY + ulI), xCY4);
+        __m128 xDX = _mm_sub_ps(_mm_loadu_ps(pxX + ulI), xCX4);
+        _mm_storeu_ps(pxDist2 + ulI, _mm_add_ps(_mm_mul_ps(xDY, xDY), _mm_mul_ps(xDX, xDX)));
+    }
+#endif
+    vDist2Scalar(pxY + ulI, pxX + ulI, ulN - ulI, xCY, xCX, pxDist2 + ulI);
+}
+
+/**
+ * The nearest of ulN points to (xCY, xCX) in one pass, vDist2Simd() with
+ * the minimum kept in registers.  Ties go to the lower index, like
+ * ulArgMin() over vDist2Scalar().
+ * @returns the index, ulN (and xBestDist2 0) if there are no points
+ */
+inline uint32_t ulNearestSimd(const float* pxY, const float* pxX, uint32_t ulN,
+                              float xCY, float xCX, float& xBestDist2)
+{
+    uint32_t ulBest = ulN;
+    xBestDist2 = 0;
+    uint32_t ulI = 0;
+#if defined(__SSE2__)
+    if (ulN >= 4)
+    {
+        const __m128 xCY4 = _mm_set1_ps(xCY);
+        const __m128 xCX4 = _mm_set1_ps(xCX);
+        const __m128 xStep = _mm_set1_ps(4.0f);
+        __m128 xIdx = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        __m128 xMin = _mm_set1_ps(3.4e38f);
+        __m128 xMinIdx = _mm_setzero_ps();
+        for (; ulI + 4 <= ulN; ulI += 4)
+        {
+            __m128 xDY = _mm_sub_ps(_mm_loadu_ps(pxY + ulI), xCY4);
+            __m128 xDX = _mm_sub_ps(_mm_loadu_ps(pxX + ulI), xCX4);
+            __m128 xDist2 = _mm_add_ps(_mm_mul_ps(xDY, xDY), _mm_mul_ps(xDX, xDX));
+            __m128 xLess = _mm_cmplt_ps(xDist2, xMin);
+            xMin = _mm_min_ps(xDist2, xMin);
+            xMinIdx = _mm_or_ps(_mm_and_ps(xLess, xIdx), _mm_andnot_ps(xLess, xMinIdx));
+            xIdx = _mm_add_ps(xIdx, xStep);
+        }
+        float xLaneMin[4], xLaneIdx[4];
+        _mm_storeu_ps(xLaneMin, xMin);
+        _mm_storeu_ps(xLaneIdx, xMinIdx);
+        for (int lLane = 0; lLane < 4; ++lLane)
+        {
+            uint32_t ulLaneIdx = (uint32_t)xLaneIdx[lLane];
+            if (ulBest == ulN || xLaneMin[lLane] < xBestDist2 ||
+                (xLaneMin[lLane] == xBestDist2 && ulLaneIdx < ulBest))
+            {
+                xBestDist2 = xLaneMin[lLane];
+                ulBest = ulLaneIdx;
+            }
+        }
+    }
+#endif
+    for (; ulI < ulN; ++ulI)
+    {
+        float xDY = pxY[ulI] - xCY;
+        float xDX = pxX[ulI] - xCX;
+        float xDist2 = xDY * xDY + xDX * xDX;
+        if (ulBest == ulN || xDist2 < xBestDist2)
+        {
+            xBestDist2 = xDist2;
+            ulBest = ulI;
+        }
+    }
+    return ulBest;
+}
+
+/**
+ * Squared distances for fix16_t points, exact, in 2^-32 pixel^2.  No FPU
+ * needed, the products are single 32x32->64 multiplies on a Cortex-M3.
+ */
+inline void vDist2Int(const fix16_t* pxY, const fix16_t* pxX, uint32_t ulN,
+                      fix16_t xCY, fix16_t xCX, int64_t* pllDist2)
+{
+    for (uint32_t ulI = 0; ulI < ulN; ++ulI)
+    {
+        int32_t lDY = pxY[ulI] - xCY;
+        int32_t lDX = pxX[ulI] - xCX;
+        pllDist2[ulI] = (int64_t)lDY * lDY + (int64_t)lDX * lDX;
+    }
+}
+
+/// vDist2Int() and ulArgMin() in one pass, the board's ulNearestSimd()
+inline uint32_t ulNearestInt(const fix16_t* pxY, const fix16_t* pxX, uint32_t ulN,
+                             fix16_t xCY, fix16_t xCX, int64_t& llBestDist2)
+{
+    uint32_t ulBest = ulN;
+    llBestDist2 = 0;
+    for (uint32_t ulI = 0; ulI < ulN; ++ulI)
+    {
+        int32_t lDY = pxY[ulI] - xCY;
+        int32_t lDX = pxX[ulI] - xCX;
+        int64_t llDist2 = (int64_t)lDY * lDY + (int64_t)lDX * lDX;
+        if (ulBest == ulN || llDist2 < llBestDist2)
+        {
+            llBestDist2 = llDist2;
+            ulBest = ulI;
+        }
+    }
+    return ulBest;
+}
+
+/// @returns the index of the first smallest of ulN values, ulN if there are none
+template<typename T>
+uint32_t ulArgMin(const T* pxValues, uint32_t ulN)
+{
+    uint32_t ulBest = ulN;
+    for (uint32_t ulI = 0; ulI < ulN; ++ulI)
+    {
+        if (ulBest == ulN || pxValues[ulI] < pxValues[ulBest])
+        {
+            ulBest = ulI;
+        }
+    }
+    return ulBest;
+}
+
+/**
+ * What Board_t measures with: SIMD floats where the host has them, exact
+ * integers on the board, where floats are software.  Either way distances
+ * stay squared and are compared against a squared tolerance, no sqrt.
+ */
+#ifdef PIXY_DIST_SIMD
+typedef float DistCoord_t;
+typedef float Dist2_t;
+
+inline DistCoord_t xToDistCoord(float xPixels) { return xPixels; }
+inline DistCoord_t xToDistCoord(uint16_t usPixels) { return usPixels; }
+inline Dist2_t xToDist2(float xDist) { return xDist * xDist; }
+
+template<uint32_t N>
+uint32_t ulNearest(const PointBatch_t<DistCoord_t, N>& xPoints, DistCoord_t xCY, DistCoord_t xCX,
+                   Dist2_t& xBestDist2)
+{
+    return ulNearestSimd(xPoints.pxY(), xPoints.pxX(), xPoints.size(), xCY, xCX, xBestDist2);
+}
+#else
+typedef fix16_t DistCoord_t;
+typedef int64_t Dist2_t;
+
+inline DistCoord_t xToDistCoord(float xPixels) { return fix16_from_float(xPixels); }
+inline DistCoord_t xToDistCoord(uint16_t usPixels) { return fix16_from_int(usPixels); }
+
+/// Rounded up so "<" matches the float compare
+inline Dist2_t xToDist2(float xDist)
+{
+    double xDist2 = (double)xDist * xDist * fix16_one * fix16_one;
+    int64_t llDist2 = (int64_t)xDist2;
+    return ((double)llDist2 < xDist2) ? llDist2 + 1 : llDist2;
+}
+
+template<uint32_t N>
+uint32_t ulNearest(const PointBatch_t<DistCoord_t, N>& xPoints, DistCoord_t xCY, DistCoord_t xCX,
+                   Dist2_t& xBestDist2)
+{
+    return ulNearestInt(xPoints.pxY(), xPoints.pxX(), xPoints.size(), xCY, xCX, xBestDist2);
+}
+#endif
+
+} // namespace pixy
+} // namespace team9
+
+#endif
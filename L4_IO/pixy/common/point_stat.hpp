@@ -1,158 +1,77 @@
 #ifndef POINT_STAT_HPP
 #define POINT_STAT_HPP
 
+#include <string>
+
 #include "pixy/common/point.hpp"
+#include "pixy/common/stat.hpp"
 
 namespace team9
 {
 namespace pixy
 {
 
-extern "C"
-{
-    #include "L4_IO/pixy/libfixmatrix/fixvector2d.h"
-}
-
+/**
+ * A stat from stat.hpp per coordinate of a point.  Points come in and go
+ * out as Point_t<float>, the camera's; in between they are STAT_T's type.
+ */
+template<typename STAT_T, typename T = Fix16>
 class PointStat_t
 {
     public:
+        typedef StatNum_t<T> Num_t;
 
-        enum StatMode_t {SIMPLE_MOVING_AVG, EXPONENTIAL_MOVING_AVG} eStatMode;
+        PointStat_t() {}
 
-        PointStat_t()
+        explicit PointStat_t(float xAlpha_arg) :
+            xY(xAlpha_arg),
+            xX(xAlpha_arg)
         {}
 
-        void vReset()
+        void vUpdate(const Point_t<float>& xNewPoint)
         {
-            xNewMean = {int16_t(0), int16_t(0)};
-            xNewStdDev = {int16_t(0), int16_t(0)};
-            xOldMean = {int16_t(0), int16_t(0)};
-            xOldStdDev = {int16_t(0), int16_t(0)};
-            ulCnt = 0;
+            xY.vUpdate(Num_t::xFromFloat(xNewPoint.xY));
+            xX.vUpdate(Num_t::xFromFloat(xNewPoint.xX));
         }
 
-        virtual void vUpdate(Point_t<float>& xNewPoint) = 0;
-
-        Point_t<float> xPoint() const
+        void vSet(const Point_t<float>& xPoint_arg)
         {
-            return Point_t<float>(fix16_to_float(xNewMean.y),
-                                  fix16_to_float(xNewMean.x));
+            xY.vSet(Num_t::xFromFloat(xPoint_arg.xY));
+            xX.vSet(Num_t::xFromFloat(xPoint_arg.xX));
         }
 
-        std::string xStr() const
+        void vReset()
         {
-            return Point_t<float>::xPointStr(fix16_to_float(xNewMean.y),
-                                             fix16_to_float(xNewMean.x));
+            xY.vReset();
+            xX.vReset();
         }
 
-        v2d xNewMean;
-        v2d xNewStdDev;
-
-    protected:
-        v2d xOldMean;
-        v2d xOldStdDev;
-        uint64_t ulCnt = 0;
-};
-
-class PointSMA_t : public PointStat_t
-{
-    public:
-        virtual void vUpdate(Point_t<float>& xNewPoint)
+        Point_t<float> xPoint() const
         {
-            v2d xNewVec = {fix16_from_float(xNewPoint.xX),
-                           fix16_from_float(xNewPoint.xY)};
-            if (++ulCnt == 1)
-            {
-                this->xNewMean = this->xOldMean = xNewVec;
-                this->xNewStdDev = {fix16_from_float(0.0f),
-                                    fix16_from_float(0.0f)};
-            }
-            else
-            {
-                v2d xTempMean;
-                v2d_sub(&xTempMean, &xNewVec, &xOldMean);
-                v2d_div_s(&xTempMean, &xTempMean, fix16_from_float(ulCnt));
-                v2d_add(&xNewMean, &xOldMean, &xTempMean);
-
-                v2d xDx, xDxx, xTempStdDev;
-                v2d_sub(&xDx, &xNewVec, &xNewMean);
-                v2d_sub(&xDxx, &xNewVec, &xOldMean);
-
-                xTempStdDev.y = fix16_mul(xDx.y, xDxx.y);
-                xTempStdDev.x = fix16_mul(xDx.x, xDxx.x);
-
-                v2d_add(&xNewStdDev, &xOldStdDev, &xTempStdDev);
-
-                xOldMean = xNewMean;
-                xOldStdDev = xNewStdDev;
-            }
+            return Point_t<float>(Num_t::xToFloat(xY.xMean()),
+                                  Num_t::xToFloat(xX.xMean()));
         }
-};
 
-class PointEMA_t : public PointStat_t
-{
-    public:
-
-        PointEMA_t() : bInit(false) {}
-
-        void vSetAlpha(float xAlpha_arg)
+        Point_t<float> xStdDev() const
         {
-            if (xAlpha_arg <= 0.0f || xAlpha_arg >= 1.0f)
-            {
-                std::cout << "ERROR: PointEMA alpha must be between 0 and 1\n";
-                return;
-            }
-            xAlpha = fix16_from_float(xAlpha_arg);
-            xOneMinusAlpha = fix16_from_float(1.0f - xAlpha_arg);
-            bInit = true;
+            return Point_t<float>(Num_t::xToFloat(xY.xStdDev()),
+                                  Num_t::xToFloat(xX.xStdDev()));
         }
 
-        virtual void vUpdate(Point_t<float>& xNewPoint)
+        std::string xStr() const
         {
-            if (bInit)
-            {
-                v2d xNewVec = {fix16_from_float(xNewPoint.xX),
-                               fix16_from_float(xNewPoint.xY)};
-                if (++ulCnt == 1)
-                {
-                    this->xNewMean = this->xOldMean = xNewVec;
-                    this->xNewStdDev = {fix16_from_float(0.0f),
-                                        fix16_from_float(0.0f)};
-                }
-                else
-                {
-                    // New mean = (alpha * new_value) + (1.0 - alpha) * old mean
-                    v2d xTempMean;
-                    v2d_mul_s(&xNewVec, &xNewVec, xAlpha);
-                    v2d_mul_s(&xTempMean, &xOldMean, xOneMinusAlpha);
-                    v2d_add(&xNewMean, &xNewVec, &xTempMean);
-
-                    v2d xDx, xDxx, xTempStdDev;
-                    v2d_sub(&xDx, &xNewVec, &xNewMean);
-                    v2d_sub(&xDxx, &xNewVec, &xOldMean);
-
-                    xTempStdDev.y = xDx.y * xDxx.y;
-                    xTempStdDev.x = xDx.x * xDxx.x;
-
-                    v2d_add(&xNewStdDev, &xOldStdDev, &xTempStdDev);
-
-                    xOldMean = xNewMean;
-                    xOldStdDev = xNewStdDev;
-                }
-            }
-            else
-            {
-                printf("ERROR: Attempt to update PointEMA before init\n");
-                u0_dbg_printf("ERROR: Attempt to update PointEMA before init\n");
-            }
+            return Point_t<float>::xPointStr(Num_t::xToFloat(xY.xMean()),
+                                             Num_t::xToFloat(xX.xMean()));
         }
 
     private:
-        bool bInit;
-        fix16_t xAlpha;
-        fix16_t xOneMinusAlpha;
+        STAT_T xY;
+        STAT_T xX;
 };
 
+typedef PointStat_t<Ema_t<Fix16>> PointEMA_t;
+typedef PointStat_t<Welford_t<Fix16>> PointMean_t;
+
 }
 }
 
@@ -0,0 +1,92 @@
+#ifndef SPAN_HPP
+#define SPAN_HPP
+
+#include <stddef.h>
+
+namespace team9
+{
+namespace pixy
+{
+
+/**
+ * Non-owning view of contiguous elements, passed by value instead of a
+ * std::vector reference so the callee can't allocate through it.
+ */
+template<typename T>
+class Span_t
+{
+    public:
+        Span_t() : pData(NULL), ulSize(0) {}
+        Span_t(T* pData_arg, size_t ulSize_arg) : pData(pData_arg), ulSize(ulSize_arg) {}
+
+        /// A Span_t<T> converts to a Span_t<const T>
+        template<typename T1>
+        Span_t(const Span_t<T1>& xOther) : pData(xOther.begin()), ulSize(xOther.size()) {}
+
+        T* begin() const { return pData; }
+        T* end() const { return pData + ulSize; }
+        size_t size() const { return ulSize; }
+        bool empty() const { return ulSize == 0; }
+        T& operator [] (size_t ulIdx) const { return pData[ulIdx]; }
+
+        /// @returns the first ulCount elements (all of them if there are fewer)
+        Span_t xFirst(size_t ulCount) const
+        {
+            return Span_t(pData, (ulCount < ulSize) ? ulCount : ulSize);
+        }
+
+    private:
+        T* pData;
+        size_t ulSize;
+};
+
+/**
+ * Vector with its storage inline, it never touches the heap.  push_back()
+ * returns false once N elements are in, and xStorage() exposes the whole
+ * capacity so a producer can fill it in place and vResize() afterwards.
+ */
+template<typename T, size_t N>
+class FixedVector_t
+{
+    public:
+        FixedVector_t() : ulSize(0) {}
+
+        bool push_back(const T& xValue)
+        {
+            if (ulSize == N)
+            {
+                return false;
+            }
+            xData[ulSize++] = xValue;
+            return true;
+        }
+
+        void clear() { ulSize = 0; }
+        void vResize(size_t ulSize_arg) { ulSize = (ulSize_arg < N) ? ulSize_arg : N; }
+
+        size_t size() const { return ulSize; }
+        static size_t capacity() { return N; }
+        bool empty() const { return ulSize == 0; }
+
+        T* begin() { return xData; }
+        T* end() { return xData + ulSize; }
+        const T* begin() const { return xData; }
+        const T* end() const { return xData + ulSize; }
+        T& operator [] (size_t ulIdx) { return xData[ulIdx]; }
+        const T& operator [] (size_t ulIdx) const { return xData[ulIdx]; }
+
+        /// All N slots, whatever size() is
+        Span_t<T> xStorage() { return Span_t<T>(xData, N); }
+
+        operator Span_t<T> () { return Span_t<T>(xData, ulSize); }
+        operator Span_t<const T> () const { return Span_t<const T>(xData, ulSize); }
+
+    private:
+        T xData[N];
+        size_t ulSize;
+};
+
+} // namespace pixy
+} // namespace team9
+
+#endif
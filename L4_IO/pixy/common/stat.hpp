@@ -1,7 +1,8 @@
 #ifndef STAT_HPP
 #define STAT_HPP
 
-#include <iomanip>
+#include <math.h>
+#include <stdint.h>
 
 #include "pixy/config.hpp"
 #include "L4_IO/pixy/libfixmath/fix16.hpp"
@@ -11,142 +12,267 @@ namespace team9
 namespace pixy
 {
 
-class Stat_t
-{
-    // johndcook.com/blog/standard_deviation
-    // See Knuth TAOCP vol 2, 3rd edition, page 232
-    public:
+/**
+ * The arithmetic the streaming statistics below need from their numeric
+ * type.  Fix16 stays in fix16_t from the first sample to the last: counts
+ * and votes come in as integers, nothing goes through float unless a caller
+ * asks for xToFloat().  float is there for the host tools to compare against.
+ */
+template<typename T>
+struct StatNum_t;
 
-        Stat_t() {}
+template<>
+struct StatNum_t<Fix16>
+{
+    static Fix16 xFromInt(int32_t lVal)   { return Fix16(fix16_from_int(lVal)); }
+    static Fix16 xFromFloat(float xVal)   { return Fix16(fix16_from_float(xVal)); }
+    static float xToFloat(Fix16 xVal)     { return fix16_to_float(xVal.value); }
+    static Fix16 xMul(Fix16 xA, Fix16 xB) { return Fix16(fix16_mul(xA.value, xB.value)); }
 
-        bool operator () ()
+    /// Bit by bit on the raw value, fix16_sqrt is declared but not in the tree
+    static Fix16 xSqrt(Fix16 xVal)
+    {
+        if (xVal.value <= 0)
         {
-            return xNewMean.value != 0;
+            return Fix16();
         }
-
-        virtual void vUpdate(const float xVal_arg, bool bPrint) = 0;
-
-        bool vPreOp(float xVal)
+        uint64_t ullRem = (uint64_t)xVal.value << 16;
+        uint64_t ullRoot = 0;
+        uint64_t ullBit = 1ull << 46; // highest power of 4 below 2^47
+        while (ullBit > ullRem)
         {
-            xCnt += int16_t(1);
-            if (xCnt == int16_t(1))
+            ullBit >>= 2;
+        }
+        while (ullBit)
+        {
+            if (ullRem >= ullRoot + ullBit)
             {
-                xNewMean = xOldMean = Fix16(xVal);
-                xNewStdDev = xOldStdDev = Fix16();
-                return false;
+                ullRem -= ullRoot + ullBit;
+                ullRoot = (ullRoot >> 1) + ullBit;
             }
-            return true;
+            else
+            {
+                ullRoot >>= 1;
+            }
+            ullBit >>= 2;
         }
+        return Fix16(fix16_t(ullRoot));
+    }
 
-        void vPostOp(Fix16 xVal)
-        {
-            xNewStdDev = xOldStdDev + (xVal - xOldMean) * (xVal - xNewMean);
-            xOldMean = xNewMean;
-            xOldStdDev = xNewStdDev;
-        }
+    /// Exact, an integer divide of the raw value
+    static Fix16 xDivCnt(Fix16 xVal, uint32_t ulCnt)
+    {
+        return Fix16(fix16_t(xVal.value / (int32_t)ulCnt));
+    }
+};
 
-        void vReset()
+template<>
+struct StatNum_t<float>
+{
+    static float xFromInt(int32_t lVal)   { return (float)lVal; }
+    static float xFromFloat(float xVal)   { return xVal; }
+    static float xToFloat(float xVal)     { return xVal; }
+    static float xMul(float xA, float xB) { return xA * xB; }
+    static float xSqrt(float xVal)        { return sqrtf(xVal); }
+
+    static float xDivCnt(float xVal, uint32_t ulCnt)
+    {
+        return xVal / (float)ulCnt;
+    }
+};
+
+/**
+ * Running mean and population variance, Welford's update (Knuth TAOCP
+ * vol 2, 3rd edition, page 232).  The variance is kept instead of the sum
+ * of squared deviations, which would outgrow fix16's 32767 after a few
+ * hundred pixel-sized samples.
+ */
+template<typename T>
+class Welford_t
+{
+    public:
+        typedef StatNum_t<T> Num_t;
+
+        Welford_t() :
+            ulCnt(0),
+            xMeanVal(),
+            xVarVal()
+        {}
+
+        void vUpdate(T xVal)
         {
-            xNewMean = int16_t(0);
-            xOldMean = int16_t(0);
-            xNewStdDev = int16_t(0);
-            xOldStdDev = int16_t(0);
-            xCnt = int16_t(0);
+            ulCnt++;
+            T xDelta = xVal - xMeanVal;
+            xMeanVal = xMeanVal + Num_t::xDivCnt(xDelta, ulCnt);
+            xVarVal = xVarVal + Num_t::xDivCnt(Num_t::xMul(xDelta, xVal - xMeanVal) - xVarVal, ulCnt);
         }
 
-        void vSetMean(float xVal)
+        /// As one sample of xVal
+        void vSet(T xVal)
         {
-            xNewMean = Fix16(xVal);
-            xOldMean = Fix16(xVal);
-            xCnt = int16_t(1);
+            ulCnt = 1;
+            xMeanVal = xVal;
+            xVarVal = T();
         }
 
-        float xMean() const
+        void vReset()
         {
-            return (xCnt >= int16_t(1)) ? fix16_to_float(xNewMean) : 0.0;
+            *this = Welford_t();
         }
 
-        float xVariance() const
+        uint32_t ulCount() const { return ulCnt; }
+        T xMean() const          { return xMeanVal; }
+        T xVariance() const      { return xVarVal; }
+        T xStdDev() const        { return Num_t::xSqrt(xVarVal); }
+
+    private:
+        uint32_t ulCnt;
+        T xMeanVal;
+        T xVarVal;
+};
+
+/**
+ * Exponential moving average and variance: the first sample is the mean,
+ * then mean += alpha * (x - mean).  The higher alpha, the more a new sample
+ * weighs.
+ */
+template<typename T>
+class Ema_t
+{
+    public:
+        typedef StatNum_t<T> Num_t;
+
+        explicit Ema_t(float xAlpha_arg = CHIP_COLOR_EMA_ALPHA) :
+            bSeen(false),
+            xMeanVal(),
+            xVarVal()
         {
-            return (xCnt >= int16_t(1)) ? fix16_to_float(xNewStdDev/xCnt) : 0.0;
+            vSetAlpha(xAlpha_arg);
         }
 
-        float xStdDev() const
+        /// Takes effect from the next sample, alpha outside (0, 1) is refused
+        bool bSetAlpha(float xAlpha_arg)
         {
-            return std::sqrt(xVariance());
+            if (xAlpha_arg <= 0.0f || xAlpha_arg >= 1.0f)
+            {
+                return false;
+            }
+            vSetAlpha(xAlpha_arg);
+            return true;
         }
 
-        float xStat(StatEnum_t xStatType)
+        void vUpdate(T xVal)
         {
-            switch(xStatType)
+            if (!bSeen)
             {
-                case M:  return xMean();
-                case V:  return xVariance();
-                case S:  return xStdDev();
-                default: return -999.99;
+                vSet(xVal);
+                return;
             }
+            T xDelta = xVal - xMeanVal;
+            T xStep = Num_t::xMul(xAlpha, xDelta);
+            xMeanVal = xMeanVal + xStep;
+            xVarVal = Num_t::xMul(xOneMinusAlpha, xVarVal + Num_t::xMul(xStep, xDelta));
         }
 
-    protected:
-        Fix16 xNewMean;
-        Fix16 xOldMean;
-        Fix16 xNewStdDev;
-        Fix16 xOldStdDev;
-        Fix16 xCnt;
-};
+        void vSet(T xVal)
+        {
+            bSeen = true;
+            xMeanVal = xVal;
+            xVarVal = T();
+        }
 
+        /// Forgets the samples, keeps alpha
+        void vReset()
+        {
+            bSeen = false;
+            xMeanVal = T();
+            xVarVal = T();
+        }
 
-class StatSMA_t : public Stat_t
-{
-    public:
-        StatSMA_t() {}
+        bool bSampled() const   { return bSeen; }
+        T xMean() const         { return xMeanVal; }
+        T xVariance() const     { return xVarVal; }
+        T xStdDev() const       { return Num_t::xSqrt(xVarVal); }
+        float xGetAlpha() const { return Num_t::xToFloat(xAlpha); }
+
+    private:
+        bool bSeen;
+        T xAlpha;
+        T xOneMinusAlpha;
+        T xMeanVal;
+        T xVarVal;
 
-        virtual void vUpdate(float xNewVal, bool bPrint = false)
+        void vSetAlpha(float xAlpha_arg)
         {
-            Fix16 xVal(xNewVal);
-            if (vPreOp(xVal))
-            {
-                xNewMean = xOldMean + (xVal - xOldMean) / xCnt;
-                vPostOp(xVal);
-            }
+            xAlpha = Num_t::xFromFloat(xAlpha_arg);
+            xOneMinusAlpha = Num_t::xFromFloat(1.0f) - xAlpha;
         }
-
 };
 
-class StatEMA_t : public Stat_t
+/**
+ * k of the last n votes, with hysteresis: bPush() turns true once ulOn of
+ * the last ulWindow votes were yes, and back to false only once ulOff or
+ * fewer were.  The votes are the bits of a WORD_T, so ulWindow is at most
+ * its width.  Counts, no numbers to average: it is templated on the word
+ * alone.
+ */
+template<typename WORD_T = uint32_t>
+class Vote_t
 {
     public:
-        StatEMA_t(float xAlpha_arg = CHIP_COLOR_EMA_ALPHA) :
-                xAlpha(xAlpha_arg),
-                xOneMinusAlpha(1.0f-xAlpha_arg)
+        static const uint32_t MAX_WINDOW = sizeof(WORD_T) * 8;
+
+        Vote_t(uint32_t ulOn_arg, uint32_t ulWindow_arg, uint32_t ulOff_arg = 0) :
+            ulWindow(ulWindow_arg < MAX_WINDOW ? ulWindow_arg : MAX_WINDOW),
+            ulOn(ulOn_arg),
+            ulOff(ulOff_arg),
+            xMask(ulWindow == MAX_WINDOW ? WORD_T(~WORD_T(0)) : WORD_T((WORD_T(1) << ulWindow) - 1)),
+            xHistory(0),
+            bOn(false)
         {}
 
-        void vSetAlpha(float xAlpha_arg)
+        /// @returns whether the vote is on, after counting bYes
+        bool bPush(bool bYes)
         {
-            if (xAlpha_arg <= 0.0f || xAlpha_arg >= 1.0f)
+            xHistory = WORD_T(((xHistory << 1) | (bYes ? 1 : 0)) & xMask);
+            uint32_t ulYes = ulYesCount();
+            if (!bOn && ulYes >= ulOn)
             {
-                std::cout << "ERROR: PointEMA alpha must be between 0 and 1\n";
-                return;
+                bOn = true;
             }
-            xAlpha = fix16_from_float(xAlpha_arg);
-            xOneMinusAlpha = fix16_from_float(1.0f-xAlpha_arg);
+            else if (bOn && ulYes <= ulOff)
+            {
+                bOn = false;
+            }
+            return bOn;
         }
 
-        virtual void vUpdate(float xVal, bool bPrint = false)
+        bool bIsOn() const
         {
-            if (vPreOp(xVal))
-            {
-                xNewMean = (xAlpha * xVal) + (xOneMinusAlpha * xOldMean);
-                vPostOp(xVal);
-            }
+            return bOn;
+        }
+
+        /// Yes votes among the last ulWindow
+        uint32_t ulYesCount() const
+        {
+            return __builtin_popcountll((unsigned long long)xHistory);
+        }
+
+        void vReset()
+        {
+            xHistory = 0;
+            bOn = false;
         }
 
     private:
-        Fix16 xAlpha;
-        Fix16 xOneMinusAlpha;
+        uint32_t ulWindow;
+        uint32_t ulOn;
+        uint32_t ulOff;
+        WORD_T xMask;
+        WORD_T xHistory;
+        bool bOn;
 };
 
-
 } // namespace pixy
 } // namespace team9
 
@@ -0,0 +1,65 @@
+#ifndef STATE_TABLE_HPP
+#define STATE_TABLE_HPP
+
+#include <stddef.h>
+
+namespace team9
+{
+namespace pixy
+{
+
+/**
+ * Names of an enum that counts from 0 to N-1, N usually being a trailing
+ * FOO_COUNT value.  Built at compile time into flash, nothing to initialize
+ * or allocate; static_assert(bComplete()) catches a value without a name.
+ */
+template<typename ENUM_T, size_t N>
+struct NameTable_t
+{
+    const char* pcNames[N];
+
+    constexpr const char* pcName(ENUM_T eValue) const
+    {
+        return ((size_t)eValue < N && pcNames[eValue]) ? pcNames[eValue] : "?";
+    }
+
+    constexpr bool bComplete(size_t ulI = 0) const
+    {
+        return ulI == N || (pcNames[ulI] != nullptr && bComplete(ulI + 1));
+    }
+};
+
+/**
+ * State machine dispatch: one OWNER_T member function per STATE_T value,
+ * called through an array index instead of a std::map lookup and a
+ * std::function.  Define the table constexpr where the handlers are
+ * accessible and static_assert(bComplete()) next to it.
+ */
+template<typename OWNER_T, typename STATE_T, size_t N>
+struct StateTable_t
+{
+    typedef void (OWNER_T::*Handler_t)();
+
+    Handler_t pxHandlers[N];
+
+    constexpr bool bComplete(size_t ulI = 0) const
+    {
+        return ulI == N || (pxHandlers[ulI] != nullptr && bComplete(ulI + 1));
+    }
+
+    /// @returns false if eState has no handler
+    bool bDispatch(OWNER_T& xOwner, STATE_T eState) const
+    {
+        if ((size_t)eState >= N)
+        {
+            return false;
+        }
+        (xOwner.*pxHandlers[eState])();
+        return true;
+    }
+};
+
+} // namespace pixy
+} // namespace team9
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pixy/config.hpp"
+
+/// 0 compiles every PIXY_TRACE() out, vPrintf() and the stats stay
+#ifndef PIXY_TRACE_ENABLED
+#define PIXY_TRACE_ENABLED 1
+#endif
+
+namespace team9
+{
+namespace pixy
+{
+
+/// What a PIXY_TRACE() call site remembers for the repeat filter
+struct TraceSite_t
+{
+    uint32_t ulHash;       // of the last line it printed, 0 if none yet
+    uint32_t ulSuppressed; // repeats of that line dropped since
+    uint64_t ullLastUs;    // when it printed it
+};
+
+/**
+ * Debug output of the vision loop.  A line is formatted once into a stack
+ * buffer and handed to every sink; printf and u0_dbg_printf both end up on
+ * UART0, so printing a line through each sent it twice at 38400 baud.
+ *
+ * Levels below eTraceLevel (config.hpp) are compiled out.  Once a clock is
+ * set, a call site repeating its last line within TRACE_REPEAT_MS prints
+ * nothing and counts it instead; the count comes out as "last message
+ * repeated N times" before that site's next line.
+ */
+class Trace_t
+{
+    public:
+        typedef void (*Sink_t)(const char* pcText);
+        typedef uint64_t (*Clock_t)(void);
+
+        static const uint32_t MAX_SINKS = 3;
+        static const uint32_t LINE_MAX = 256; // as u0_dbg_printf
+
+        struct Stats_t
+        {
+            uint32_t ulLines;
+            uint32_t ulBytes;
+            uint32_t ulSuppressed;
+            uint32_t ulTruncated;
+            uint64_t ullUs; // spent formatting and in the sinks, with a clock
+        };
+
+        constexpr Trace_t() :
+            pxSinks{vStdoutSink, nullptr, nullptr},
+            ulSinks(1),
+            pxClock(nullptr),
+            ullRepeatUs(TRACE_REPEAT_MS * 1000ull),
+            xStats{0, 0, 0, 0, 0}
+        {}
+
+        /// printf()'s way out, UART0 on the board
+        static void vStdoutSink(const char* pcText)
+        {
+            fputs(pcText, stdout);
+        }
+
+        /// @returns false if all MAX_SINKS are taken
+        bool bAddSink(Sink_t pxSink)
+        {
+            if (ulSinks >= MAX_SINKS)
+            {
+                return false;
+            }
+            pxSinks[ulSinks++] = pxSink;
+            return true;
+        }
+
+        void vClearSinks()
+        {
+            ulSinks = 0;
+        }
+
+        /// Microseconds, e.g. sys_get_uptime_us; without one nothing is filtered or timed
+        void vSetClock(Clock_t pxClock_arg)
+        {
+            pxClock = pxClock_arg;
+        }
+
+        /// 0 lets every repeat through
+        void vSetRepeatUs(uint64_t ullRepeatUs_arg)
+        {
+            ullRepeatUs = ullRepeatUs_arg;
+        }
+
+        const Stats_t& xGetStats() const
+        {
+            return xStats;
+        }
+
+        /// Every line, no level or repeat filter: for what something parses
+        void vPrintf(const char* pcFormat, ...) __attribute__((format(printf, 2, 3)))
+        {
+            va_list xArgs;
+            va_start(xArgs, pcFormat);
+            vFormat(nullptr, pcFormat, xArgs);
+            va_end(xArgs);
+        }
+
+        /// PIXY_TRACE()
+        void vSitePrintf(TraceSite_t& xSite, const char* pcFormat, ...) __attribute__((format(printf, 3, 4)))
+        {
+            va_list xArgs;
+            va_start(xArgs, pcFormat);
+            vFormat(&xSite, pcFormat, xArgs);
+            va_end(xArgs);
+        }
+
+        /// PIXY_TRACE_TEXT(): pcText and a newline, any length, not copied
+        void vSiteText(TraceSite_t& xSite, const char* pcText)
+        {
+            uint64_t ullStart = ullNow();
+            if (bRepeat(xSite, ulHash(pcText), ullStart))
+            {
+                return;
+            }
+            vWrite(pcText);
+            vWrite("\n");
+            vDone(ullStart);
+        }
+
+    private:
+        Sink_t pxSinks[MAX_SINKS];
+        uint32_t ulSinks;
+        Clock_t pxClock;
+        uint64_t ullRepeatUs;
+        Stats_t xStats;
+
+        uint64_t ullNow() const
+        {
+            return pxClock ? pxClock() : 0;
+        }
+
+        /// FNV-1a, never 0
+        static uint32_t ulHash(const char* pcText)
+        {
+            uint32_t ulHash = 2166136261u;
+            while (*pcText)
+            {
+                ulHash = (ulHash ^ (uint8_t)*pcText++) * 16777619u;
+            }
+            return ulHash ? ulHash : 1;
+        }
+
+        void vWrite(const char* pcText)
+        {
+            for (uint32_t ulI = 0; ulI < ulSinks; ++ulI)
+            {
+                pxSinks[ulI](pcText);
+            }
+            xStats.ulBytes += strlen(pcText);
+        }
+
+        void vDone(uint64_t ullStart)
+        {
+            xStats.ulLines++;
+            xStats.ullUs += ullNow() - ullStart;
+        }
+
+        /**
+         * @returns true if xSite printed this line within the repeat window,
+         * else lets it through after owning up to the repeats it dropped
+         */
+        bool bRepeat(TraceSite_t& xSite, uint32_t ulLineHash, uint64_t ullNowUs)
+        {
+            if (pxClock && ullRepeatUs && ulLineHash == xSite.ulHash &&
+                ullNowUs - xSite.ullLastUs < ullRepeatUs)
+            {
+                xSite.ulSuppressed++;
+                xStats.ulSuppressed++;
+                return true;
+            }
+            if (xSite.ulSuppressed)
+            {
+                char cNote[48];
+                snprintf(cNote, sizeof(cNote), "last message repeated %u times\n",
+                         (unsigned)xSite.ulSuppressed);
+                vWrite(cNote);
+                xSite.ulSuppressed = 0;
+            }
+            xSite.ulHash = ulLineHash;
+            xSite.ullLastUs = ullNowUs;
+            return false;
+        }
+
+        void vFormat(TraceSite_t* pxSite, const char* pcFormat, va_list xArgs)
+        {
+            uint64_t ullStart = ullNow();
+            char cLine[LINE_MAX];
+            int lLen = vsnprintf(cLine, sizeof(cLine), pcFormat, xArgs);
+            if (lLen < 0)
+            {
+                return;
+            }
+            if ((uint32_t)lLen >= LINE_MAX)
+            {
+                cLine[LINE_MAX - 2] = '\n';
+                xStats.ulTruncated++;
+            }
+            if (pxSite && bRepeat(*pxSite, ulHash(cLine), ullStart))
+            {
+                return;
+            }
+            vWrite(cLine);
+            vDone(ullStart);
+        }
+};
+
+/// The one everything traces through, constant initialized
+inline Trace_t& xTrace()
+{
+    static Trace_t xInstance;
+    return xInstance;
+}
+
+} // namespace pixy
+} // namespace team9
+
+/**
+ * PIXY_TRACE(TRACE_INFO, "State: %s\n", pcName) prints if TRACE_INFO is at
+ * least eTraceLevel; below it the call and its arguments are compiled out.
+ */
+#if PIXY_TRACE_ENABLED
+#define PIXY_TRACE(eLevel, ...)                                               \
+    do                                                                        \
+    {                                                                         \
+        if ((eLevel) >= eTraceLevel)                                          \
+        {                                                                     \
+            static team9::pixy::TraceSite_t xTraceSite_;                      \
+            team9::pixy::xTrace().vSitePrintf(xTraceSite_, __VA_ARGS__);      \
+        }                                                                     \
+    } while (0)
+
+/// A prebuilt block of text, longer than Trace_t::LINE_MAX allows
+#define PIXY_TRACE_TEXT(eLevel, pcText)                                       \
+    do                                                                        \
+    {                                                                         \
+        if ((eLevel) >= eTraceLevel)                                          \
+        {                                                                     \
+            static team9::pixy::TraceSite_t xTraceSite_;                      \
+            team9::pixy::xTrace().vSiteText(xTraceSite_, (pcText));           \
+        }                                                                     \
+    } while (0)
+#else
+/// Never called, keeps the arguments type checked and their variables used
+inline void vTraceNone(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void vTraceNone(const char*, ...)
+{}
+
+#define PIXY_TRACE(eLevel, ...) do { if (0) { vTraceNone(__VA_ARGS__); } } while (0)
+#define PIXY_TRACE_TEXT(eLevel, pcText) do { if (0) { vTraceNone("%s", (pcText)); } } while (0)
+#endif
+
+#define PIXY_DEBUG(...) PIXY_TRACE(TRACE_DEBUG, __VA_ARGS__)
+#define PIXY_INFO(...)  PIXY_TRACE(TRACE_INFO, __VA_ARGS__)
+#define PIXY_WARN(...)  PIXY_TRACE(TRACE_WARN, __VA_ARGS__)
+#define PIXY_ERROR(...) PIXY_TRACE(TRACE_ERROR, __VA_ARGS__)
+
+#endif
@@ -1,13 +1,26 @@
 #ifndef PIXY_CONFIG_HPP
 #define PIXY_CONFIG_HPP
 
+#include <stdint.h>
+
 const uint32_t CHIPS_AT_A_TIME    = 200;
 const uint32_t CHIPS_TO_CALIB     = 1000;
-const uint32_t NUM_TIMES_FOR_CNT  = 2;
+const uint32_t CHIP_VOTE_WINDOW   = 3;     // Chip_t knows its color once it led in CHIP_VOTES_TO_KNOW
+const uint32_t CHIP_VOTES_TO_KNOW = 3;     // of the last CHIP_VOTE_WINDOW frames (at most 32)
+const uint32_t PIXY_DMA_CHUNK_BYTES = 512; // SPI bytes per DMA transfer, even
+const char* const PIXY_RECORD_PATH = 0;    // e.g. "1:pixy.raw" records the SPI stream to SD
+const uint16_t PIXY_CAM_ROWS      = 200;
+const uint16_t PIXY_CAM_COLS      = 320;
+const int GRID_BUCKET_SHIFT       = 3;     // CellGrid_t buckets are 8x8 pixels
 const float EMA_ALPHA_ADJ         = 0.01f;
 const float CHIP_PROXIM_TOLERANCE = 0.5f;
 const float CHIP_LOC_EMA_ALPHA    = 0.90f; // higher - new values weigh more
 const float CHIP_COLOR_EMA_ALPHA  = 0.95f; // lower - old values weigh more
-const enum SEEN_CHIP_ALGO {STUPID=0, DOWN_RIGHT=1} eSeenChipAlgo = STUPID;
+const float CHIP_COLOR_MARGIN     = 0.0f;  // votes a color's EMA must lead the other two by
+const uint16_t BOT_VERIFY_FRAMES  = 150;   // Board_t stores a bot chip the camera has not seen after this many frames
+const enum SEEN_CHIP_ALGO {STUPID=0, DOWN_RIGHT=1, GRID=2, HOMOGRAPHY=3} eSeenChipAlgo = GRID;
+const uint32_t EVENT_TRACE_RECORDS = 128;   // EventTrace_t keeps the last 128 events, 2 KB
+const uint32_t TRACE_REPEAT_MS    = 1000;  // a call site repeating its last line within this is counted, not printed
+const enum TRACE_LEVEL {TRACE_DEBUG=0, TRACE_INFO=1, TRACE_WARN=2, TRACE_ERROR=3, TRACE_OFF=4} eTraceLevel = TRACE_INFO;
 
 #endif
@@ -15,6 +15,7 @@
 #include "pixy/common.hpp"
 #include "pixy/common/board.hpp"
 #include "pixy/common/block.hpp"
+#include "pixy/common/frame.hpp"
 
 namespace team9
 {
@@ -55,10 +56,14 @@ class PixyBrain_t
             uint32_t ulCalibChips = 0;
             while (ulChips < ulChipsToCalib)
             {
-                std::vector<Block_t> xBlocks;
+                BlockArena_t& xBlocks = xFrame.xBlocks;
                 int lSeenBlocks = pPixyEyes->lSeenBlocks(xBlocks);
                 if (lSeenBlocks < 0)
                 {
+                    if (pPixyEyes->bEnded())
+                    {
+                        return;
+                    }
                     continue;
                 }
                 ulChips += lSeenBlocks;
@@ -77,24 +82,22 @@ class PixyBrain_t
             }
         }
 
+        /// Steady-state vision cycle, reuses xFrame and does not allocate
         int lSampleChips(PixyEyes_t* pPixyEyes)
         {
-            std::vector<Block_t> xBlocks;
-            std::vector<std::pair<int, ChipColor_t>> xSeenChips;
-            if (pPixyEyes->lSeenBlocks(xBlocks) < 0)
+            xFrame.vClear();
+            if (pPixyEyes->lSeenBlocks(xFrame.xBlocks) < 0)
             {
                 return -1;
             }
-            this->pBoard->vCalcSeenChips(xBlocks, xSeenChips);
-            this->xLastSeen = xSeenChips;
-            this->pBoard->vUpdate(xSeenChips);
-            int lLastChipInserted = this->pBoard->lColChanged();
+            int lLastChipInserted = this->pBoard->lProcessFrame(xFrame);
             return lLastChipInserted;
         }
 
+        /// The bot's chip is on its way, see Board_t::lExpect()
         int lBotInsert(PixyCmd_t& xInsertCmd)
         {
-            int lNewRow = pBoard->lInsert(xInsertCmd);
+            int lNewRow = pBoard->lExpect(xInsertCmd.lColumn, (ChipColor_t)xInsertCmd.lColor);
             if (lNewRow == -1)
             {
                 xErrorQueue.push("Row overflowing!");
@@ -106,13 +109,18 @@ class PixyBrain_t
             return lNewRow;
         }
 
+        int lBotSeen()
+        {
+            return pBoard->lPopSeenBot();
+        }
+
         void vPrintChips(Board_t::PrintMode_t xPrintMode,
                          bool bPrintLastSeen = false)
         {
-            std::vector<std::pair<int, ChipColor_t>> xSeenChips;
+            Span_t<const SeenChip_t> xSeenChips;
             if (bPrintLastSeen)
             {
-                xSeenChips = this->xLastSeen;
+                xSeenChips = xFrame.xSeenChips;
             }
             switch (xPrintMode)
             {
@@ -177,7 +185,8 @@ class PixyBrain_t
         std::queue<int> xUpdateQueue;
         std::stack<int> xColUpdate;
 
-        std::vector<std::pair<int, ChipColor_t>> xLastSeen;
+        // Blocks and seen chips of the last cycle, reused every cycle
+        Frame_t xFrame;
         Corners_t xLastCorners;
         int lLastInsertCol;
 
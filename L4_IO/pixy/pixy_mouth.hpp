@@ -1,8 +1,6 @@
 #ifndef PIXY_MOUTH_HPP
 #define PIXY_MOUTH_HPP
 
-#include "printf_lib.h"
-
 #include "pixy/common.hpp"
 
 namespace team9
@@ -22,11 +20,10 @@ class PixyMouth_t
 		    {
 		        return false;
 		    }
-		    printf("Trying to send %d over queue\n", lColUpdate);
-            u0_dbg_printf("Trying to send %d over queue\n", lColUpdate);
+		    PIXY_DEBUG("Trying to send %d over queue\n", lColUpdate);
 
-		    printf("player move A5B6_%d\n", lColUpdate);
-		    u0_dbg_printf("player move A5B6_%d\n", lColUpdate);
+		    // game_socket.py matches this one, it is never filtered
+		    xTrace().vPrintf("player move A5B6_%d\n", lColUpdate);
 
 		    QueueHandle_t xQueueTXHandle = scheduler_task::getSharedObject(shared_PixyQueueTX);
 		    xQueueSend(xQueueTXHandle, &lColUpdate, portMAX_DELAY);
@@ -0,0 +1,206 @@
+#ifndef PIXY_PARSER_HPP
+#define PIXY_PARSER_HPP
+
+#include <stdint.h>
+
+#include "pixy/common.hpp"
+#include "pixy/common/block.hpp"
+#include "pixy/common/span.hpp"
+
+namespace team9
+{
+namespace pixy
+{
+
+/**
+ * Parses the Pixy's SPI byte stream out of memory, no hardware involved so
+ * the same code runs on the board (PixyEyes_t) and on captured streams
+ * (tools/pixy_replay.cpp).
+ *
+ * Stream format, 16-bit words sent high byte first:
+ *      0xaa55 0xaa55       start of frame, then the first block
+ *      0xaa55 / 0xaa56     start of a normal / color coded block
+ *      checksum            sum of the block words that follow
+ *      signature x y width height [angle, color coded only]
+ *      0x0000              no more blocks in this frame
+ *
+ * ulParse() can be fed any number of bytes at a time, a word or block split
+ * across two calls resumes where it stopped.
+ */
+class PixyParser_t
+{
+public:
+
+    enum State_t {START, READ_FIRST, READ_BLOCK, READ_NEXT};
+    enum BlockType_t {NORMAL, COLOR_CODED};
+
+    PixyParser_t()
+    {
+        vReset();
+    }
+
+    /// Forgets any partial word or block, the next byte starts a new word
+    void vReset()
+    {
+        eState = START;
+        eBlockType = NORMAL;
+        bHaveHigh = false;
+        bSkipByte = false;
+        ulWordIdx = 0;
+        usChecksum = 0x0000;
+        usRecvLast = 0xffff;
+        usHigh = 0x0000;
+        ulChecksumErrors = 0;
+    }
+
+    /**
+     * Parses ulBytes of the stream and stores the blocks in xBlocks, from
+     * index ulCount on, until xBlocks is full.
+     * @returns the number of bytes used, less than ulBytes only if xBlocks filled up
+     */
+    uint32_t ulParse(const uint8_t* pucData, uint32_t ulBytes,
+                     Span_t<Block_t> xBlocks, uint32_t& ulCount)
+    {
+        const uint32_t ulMax = xBlocks.size();
+        uint32_t ulI = 0;
+
+        while (ulI < ulBytes && ulCount < ulMax)
+        {
+            if (bSkipByte)
+            {
+                bSkipByte = false;
+                ulI++;
+            }
+            else if (bHaveHigh)
+            {
+                bHaveHigh = false;
+                vWord(usHigh | pucData[ulI++], xBlocks, ulCount);
+            }
+            else if (ulI + 1 < ulBytes)
+            {
+                vWord((pucData[ulI] << 8) | pucData[ulI + 1], xBlocks, ulCount);
+                ulI += 2;
+            }
+            else
+            {
+                usHigh = pucData[ulI++] << 8;
+                bHaveHigh = true;
+            }
+        }
+        return ulI;
+    }
+
+    /// Blocks dropped since vReset() because their checksum did not match
+    uint32_t ulGetChecksumErrors() const
+    {
+        return ulChecksumErrors;
+    }
+
+private:
+
+    /// Number of words in a block after the checksum
+    static const uint32_t NORMAL_WORDS = 5;
+    static const uint32_t COLOR_CODED_WORDS = 6;
+
+    __inline void vWord(uint16_t usRecv, Span_t<Block_t> xBlocks, uint32_t& ulCount)
+    {
+        switch (eState)
+        {
+            case START:
+            {
+                if (usRecv == 0xaa55 && usRecvLast == 0xaa55)
+                {
+                    eBlockType = NORMAL;
+                    eState = READ_FIRST;
+                }
+                else if (usRecv == 0xaa56 && usRecvLast == 0xaa55)
+                {
+                    eBlockType = COLOR_CODED;
+                    eState = READ_FIRST;
+                }
+                else if (usRecv == 0x55aa)
+                {
+                    bSkipByte = true; // out of sync
+                }
+                break;
+            }
+            case READ_FIRST:
+            {
+                switch (usRecv)
+                {
+                    case 0xaa55: eBlockType = NORMAL; break;
+                    case 0xaa56: eBlockType = COLOR_CODED; break;
+                    case 0x0000: eState = START; break;
+                    default:
+                    {
+                        usChecksum = usRecv;
+                        ulWordIdx = 0;
+                        eState = READ_BLOCK;
+                        break;
+                    }
+                }
+                break;
+            }
+            case READ_BLOCK:
+            {
+                usBlockWords[ulWordIdx++] = usRecv;
+                if (ulWordIdx == COLOR_CODED_WORDS ||
+                    (eBlockType == NORMAL && ulWordIdx == NORMAL_WORDS))
+                {
+                    vEndBlock(xBlocks, ulCount);
+                    eState = READ_NEXT;
+                }
+                break;
+            }
+            case READ_NEXT:
+            {
+                switch (usRecv)
+                {
+                    case 0xaa55: eBlockType = NORMAL; eState = READ_FIRST; break;
+                    case 0xaa56: eBlockType = COLOR_CODED; eState = READ_FIRST; break;
+                    default: eState = START; break;
+                }
+                break;
+            }
+        }
+        usRecvLast = usRecv;
+    }
+
+    __inline void vEndBlock(Span_t<Block_t> xBlocks, uint32_t& ulCount)
+    {
+        Block_t& xBlock = xBlocks[ulCount];
+        xBlock.usSignature = usBlockWords[0];
+        xBlock.xPoint.xX = usBlockWords[1];
+        xBlock.xPoint.xY = usBlockWords[2];
+        xBlock.usWidth = usBlockWords[3];
+        xBlock.usHeight = usBlockWords[4];
+        xBlock.usAngle = (eBlockType == NORMAL) ? 0 : usBlockWords[5];
+
+        // A bad block is overwritten by the next one
+        uint16_t usBlockSum = xBlock++;
+        if (usChecksum == usBlockSum)
+        {
+            ulCount++;
+        }
+        else
+        {
+            ulChecksumErrors++;
+        }
+    }
+
+    State_t eState;
+    BlockType_t eBlockType;
+    bool bHaveHigh;
+    bool bSkipByte;
+    uint32_t ulWordIdx;
+    uint16_t usBlockWords[COLOR_CODED_WORDS];
+    uint16_t usChecksum;
+    uint16_t usRecvLast;
+    uint16_t usHigh;
+    uint32_t ulChecksumErrors;
+};
+
+} // namespace pixy
+} // namespace team9
+
+#endif
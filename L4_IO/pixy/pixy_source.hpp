@@ -0,0 +1,176 @@
+#ifndef PIXY_SOURCE_HPP
+#define PIXY_SOURCE_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+
+#include "ssp1.h"
+#include "spi_sem.h"
+#include "storage.hpp"
+
+#include "pixy/config.hpp"
+#include "pixy/common/trace.hpp"
+
+namespace team9
+{
+namespace pixy
+{
+
+/**
+ * Where PixyEyes_t gets the Pixy's SPI byte stream from.  On the board it
+ * is SSP1 (SspPixySource_t), on a PC a recording of it (MemoryPixySource_t,
+ * see tools/pixy_sim.cpp).
+ */
+class PixySource_t
+{
+public:
+
+    virtual ~PixySource_t()
+    {}
+
+    /**
+     * Reads up to ulBytes of the stream into pucData.
+     * @returns the number of bytes read, 0 at the end of a recording,
+     *          negative if the bus failed
+     */
+    virtual int32_t lRead(uint8_t* pucData, uint32_t ulBytes) = 0;
+};
+
+/// The camera on SSP1, PIXY_DMA_CHUNK_BYTES at most per read
+class SspPixySource_t : public PixySource_t
+{
+public:
+
+    SspPixySource_t()
+    {
+        // The Pixy expects the sync byte ahead of every word it sends
+        for (uint32_t ulI = 0; ulI < PIXY_DMA_CHUNK_BYTES; ulI += 2)
+        {
+            ucTxPattern[ulI] = 0x5a;
+            ucTxPattern[ulI + 1] = 0x00;
+        }
+    }
+
+    int32_t lRead(uint8_t* pucData, uint32_t ulBytes)
+    {
+        if (ulBytes > PIXY_DMA_CHUNK_BYTES)
+        {
+            ulBytes = PIXY_DMA_CHUNK_BYTES;
+        }
+
+        // The SD card and flash share SSP1 and its DMA channels
+        spi1_lock();
+        unsigned ulError = ssp1_dma_exchange_block(ucTxPattern, pucData, ulBytes);
+        spi1_unlock();
+        if (ulError)
+        {
+            PIXY_ERROR("Error: ssp1_dma_exchange_block %u\n", ulError);
+            return -1;
+        }
+        return (int32_t)ulBytes;
+    }
+
+private:
+    uint8_t ucTxPattern[PIXY_DMA_CHUNK_BYTES];
+};
+
+/**
+ * Passes another source through and appends every byte read to pcPath with
+ * Storage::append, so a session can be replayed off-board.  The file holds
+ * exactly the bytes PixyEyes_t parsed, in order.
+ */
+class RecordingPixySource_t : public PixySource_t
+{
+public:
+
+    /// Takes ownership of pSource
+    RecordingPixySource_t(PixySource_t* pSource_arg, const char* pcPath_arg) :
+        pSource(pSource_arg),
+        pcPath(pcPath_arg),
+        ulWriteErrors(0)
+    {}
+
+    int32_t lRead(uint8_t* pucData, uint32_t ulBytes)
+    {
+        int32_t lBytes = pSource->lRead(pucData, ulBytes);
+        if (lBytes > 0 && Storage::append(pcPath, pucData, lBytes, 0) != FR_OK)
+        {
+            // Keep the camera running, the recording just has a gap
+            if (ulWriteErrors++ == 0)
+            {
+                PIXY_ERROR("Error: cannot append to %s\n", pcPath);
+            }
+        }
+        return lBytes;
+    }
+
+    uint32_t ulGetWriteErrors() const
+    {
+        return ulWriteErrors;
+    }
+
+private:
+    std::unique_ptr<PixySource_t> pSource;
+    const char* pcPath;
+    uint32_t ulWriteErrors;
+};
+
+/// Plays back a recording held in memory, does not own it
+class MemoryPixySource_t : public PixySource_t
+{
+public:
+
+    MemoryPixySource_t(const uint8_t* pucData_arg, uint32_t ulSize_arg) :
+        pucData(pucData_arg),
+        ulSize(ulSize_arg),
+        ulPos(0)
+    {}
+
+    int32_t lRead(uint8_t* pucOut, uint32_t ulBytes)
+    {
+        if (ulBytes > PIXY_DMA_CHUNK_BYTES)
+        {
+            ulBytes = PIXY_DMA_CHUNK_BYTES;
+        }
+        if (ulBytes > ulSize - ulPos)
+        {
+            ulBytes = ulSize - ulPos;
+        }
+        memcpy(pucOut, pucData + ulPos, ulBytes);
+        ulPos += ulBytes;
+        return (int32_t)ulBytes;
+    }
+
+    bool bEnded() const
+    {
+        return ulPos == ulSize;
+    }
+
+    uint32_t ulGetPos() const
+    {
+        return ulPos;
+    }
+
+private:
+    const uint8_t* pucData;
+    uint32_t ulSize;
+    uint32_t ulPos;
+};
+
+/// The board's source: SSP1, recorded to PIXY_RECORD_PATH if it is set
+inline PixySource_t* pxBoardPixySource()
+{
+    PixySource_t* pSource = new SspPixySource_t;
+    if (PIXY_RECORD_PATH)
+    {
+        pSource = new RecordingPixySource_t(pSource, PIXY_RECORD_PATH);
+    }
+    return pSource;
+}
+
+} // namespace pixy
+} // namespace team9
+
+#endif
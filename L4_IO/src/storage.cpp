@@ -85,7 +85,8 @@ FRESULT Storage::copy(const char* pExistingFile, const char* pNewFile,
     return status;
 }
 
-FRESULT Storage::read(const char* pFilename,  void* pData, unsigned int bytesToRead, unsigned int offset)
+FRESULT Storage::read(const char* pFilename,  void* pData, unsigned int bytesToRead, unsigned int offset,
+                      unsigned int* pBytesRead)
 {
     FRESULT status = FR_INT_ERR;
     FIL file;
@@ -101,6 +102,9 @@ FRESULT Storage::read(const char* pFilename,  void* pData, unsigned int bytesToR
         f_close(&file);
     }
 
+    if(0 != pBytesRead) {
+        *pBytesRead = bytesRead;
+    }
     return status;
 }
 
@@ -76,8 +76,11 @@ class Storage
          * @param pData       The buffer to save the file data
          * @param bytesToRead Number of bytes to read
          * @param offset      Optional Parameter: file offset to read data from
+         * @param pBytesRead  Optional: Provide pointer to get the number of bytes read,
+         *                    which is less than bytesToRead at the end of the file
          */
-        static FRESULT read(const char* pFilename,  void* pData, unsigned int bytesToRead, unsigned int offset=0);
+        static FRESULT read(const char* pFilename,  void* pData, unsigned int bytesToRead, unsigned int offset=0,
+                            unsigned int* pBytesRead=0);
 
         /**
          * Writes an existing file.
@@ -0,0 +1,42 @@
+#ifndef C4_CONFIG_HPP
+#define C4_CONFIG_HPP
+
+/// If true, GameTask_t picks the robot's column with the on-board solver
+/// instead of waiting for a 'gameplay' command from the host AI
+const bool GAME_ONBOARD_AI = false;
+
+/// The on-board solver thinks while the gantry heads for the column a
+/// GAME_GUESS_DEPTH ply search picked, for as long as that trip takes but
+/// at least GAME_MIN_THINK_MS (the gantry may already be over it)
+const unsigned GAME_GUESS_DEPTH = 6;
+const unsigned GAME_MIN_THINK_MS = 500;
+
+/// How long GameTask_t waits for the host AI before playing the on-board
+/// solver's move instead
+const unsigned GAME_HOST_AI_TIMEOUT_MS = 20000;
+
+/// The most GameTask_t holds the gate open waiting for the camera to see
+/// the chip land, and the time it then gives the gate to shut
+const unsigned GAME_SERVO_OPEN_MS = 650;
+const unsigned GAME_SERVO_CLOSE_MS = 300;
+
+/// If true the gantry goes home after every drop, as it always did before
+/// the column table.  Otherwise it stays over the column and the next move
+/// starts from there; set it if the parked gantry gets in the human's way.
+const bool GAME_PARK_HOME = false;
+
+/// Opening book written by "tools/c4 book", read from the flash drive.
+/// Set GAME_LINKED_OPENING_BOOK to 1 to link connect_four/opening_book_data.hpp
+/// (made with "c4 book <plies> opening_book_data.hpp") into flash instead.
+#define GAME_LINKED_OPENING_BOOK 0
+const char* const GAME_OPENING_BOOK_FILE = "/opening.bin";
+
+/// Transposition table size as log2 of 8-byte entries, 0 disables the table.
+/// The board only has 64K of RAM, the host tools can afford 32M.
+#if defined(__arm__)
+const unsigned GAME_TT_LOG2_ENTRIES = 9;
+#else
+const unsigned GAME_TT_LOG2_ENTRIES = 22;
+#endif
+
+#endif
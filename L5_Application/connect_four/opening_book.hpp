@@ -0,0 +1,237 @@
+#ifndef C4_OPENING_BOOK_HPP
+#define C4_OPENING_BOOK_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "connect_four/position.hpp"
+
+namespace team9
+{
+namespace c4
+{
+
+/**
+ * Read-only opening book made offline by "c4 book" (see tools/c4.cpp).
+ *
+ * Image layout, all little endian:
+ *      magic    4 bytes : "C4BK"
+ *      entries  4 bytes : number of 8-byte entries that follow
+ *      entry    8 bytes : key << 10 | column << 7 | (score + 64)
+ *
+ * Entries are sorted by key and a position and its mirror image share one
+ * entry (stored under the smaller key), so a lookup is a binary search over
+ * fixed-size records.  The image is either linked into flash as const data
+ * or read on demand, ex: with Storage::read() from /opening.bin, in which
+ * case nothing but the entry count is kept in RAM.
+ */
+class OpeningBook_t
+{
+    public:
+        static const unsigned HEADER_BYTES = 8;
+        static const unsigned ENTRY_BYTES = 8;
+
+        /// Reads ulBytes at ulOffset of the book image, returns false on error
+        typedef bool (*ReadFn_t)(void* pData, uint32_t ulBytes, uint32_t ulOffset);
+
+        OpeningBook_t() : pucImage(NULL), pfRead(NULL), ulEntries(0) {}
+
+        /// Uses a book image in memory, ex: a const array linked into flash
+        bool bAttach(const uint8_t* pucImage_arg, uint32_t ulBytes)
+        {
+            vDetach();
+            uint32_t ulCount = 0;
+            if (ulBytes < HEADER_BYTES || !bParseHeader(pucImage_arg, ulCount) ||
+                !bFits(ulCount, ulBytes))
+            {
+                return false;
+            }
+            pucImage = pucImage_arg;
+            ulEntries = ulCount;
+            return true;
+        }
+
+        /**
+         * Uses a book that is read entry by entry through pfRead_arg
+         * @param ulBytes  the image's size, a truncated image is rejected
+         */
+        bool bAttach(ReadFn_t pfRead_arg, uint32_t ulBytes)
+        {
+            vDetach();
+            uint8_t ucHeader[HEADER_BYTES];
+            uint32_t ulCount = 0;
+            if (ulBytes < HEADER_BYTES || !pfRead_arg(ucHeader, HEADER_BYTES, 0) ||
+                !bParseHeader(ucHeader, ulCount) || !bFits(ulCount, ulBytes))
+            {
+                return false;
+            }
+            pfRead = pfRead_arg;
+            ulEntries = ulCount;
+            return true;
+        }
+
+        void vDetach()
+        {
+            pucImage = NULL;
+            pfRead = NULL;
+            ulEntries = 0;
+        }
+
+        uint32_t ulSize() const
+        {
+            return ulEntries;
+        }
+
+        /**
+         * @returns true and the book move (0-based column) and exact score if
+         *          xPosition or its mirror image is in the book
+         */
+        bool bLookup(const Position_t& xPosition, int& lCol, int& lScore) const
+        {
+            bool bMirrored = false;
+            uint64_t ulKey = ulCanonicalKey(xPosition, bMirrored);
+
+            uint32_t ulLow = 0;
+            uint32_t ulHigh = ulEntries;
+            while (ulLow < ulHigh)
+            {
+                uint32_t ulMid = ulLow + (ulHigh - ulLow) / 2;
+                uint64_t ulEntry = 0;
+                if (!bReadEntry(ulMid, ulEntry))
+                {
+                    return false;
+                }
+
+                uint64_t ulEntryKey = ulEntry >> DATA_BITS;
+                if (ulEntryKey == ulKey)
+                {
+                    lCol = lEntryColumn(ulEntry);
+                    lScore = lEntryScore(ulEntry);
+                    if (bMirrored)
+                    {
+                        lCol = Position_t::WIDTH - 1 - lCol;
+                    }
+                    return true;
+                }
+                if (ulEntryKey < ulKey)
+                {
+                    ulLow = ulMid + 1;
+                }
+                else
+                {
+                    ulHigh = ulMid;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @returns the key the book stores xPosition under, the smaller of its
+         *          own key and its mirror's.  bMirrored tells which one.
+         */
+        static uint64_t ulCanonicalKey(const Position_t& xPosition, bool& bMirrored)
+        {
+            uint64_t ulKey = xPosition.ulKey();
+            uint64_t ulMirrorKey = xPosition.xMirror().ulKey();
+            bMirrored = ulMirrorKey < ulKey;
+            return bMirrored ? ulMirrorKey : ulKey;
+        }
+
+        /// Packs an entry, lCol must already be relative to the canonical key
+        static uint64_t ulPackEntry(uint64_t ulKey, int lCol, int lScore)
+        {
+            return (ulKey << DATA_BITS) | ((uint64_t)lCol << SCORE_BITS) |
+                   (uint64_t)(lScore + SCORE_OFFSET);
+        }
+
+        static int lEntryColumn(uint64_t ulEntry)
+        {
+            return (ulEntry >> SCORE_BITS) & 7;
+        }
+
+        static int lEntryScore(uint64_t ulEntry)
+        {
+            return (int)(ulEntry & ((1 << SCORE_BITS) - 1)) - SCORE_OFFSET;
+        }
+
+        static void vWriteHeader(uint8_t* pucOut, uint32_t ulCount)
+        {
+            pucOut[0] = 'C';
+            pucOut[1] = '4';
+            pucOut[2] = 'B';
+            pucOut[3] = 'K';
+            vStoreLE(pucOut + 4, ulCount, 4);
+        }
+
+        static void vWriteEntry(uint8_t* pucOut, uint64_t ulEntry)
+        {
+            vStoreLE(pucOut, ulEntry, ENTRY_BYTES);
+        }
+
+    protected:
+        static const unsigned SCORE_BITS = 7;
+        static const unsigned DATA_BITS = SCORE_BITS + 3;
+        static const int SCORE_OFFSET = 64;
+
+        static bool bParseHeader(const uint8_t* pucHeader, uint32_t& ulCount)
+        {
+            if (pucHeader[0] != 'C' || pucHeader[1] != '4' ||
+                pucHeader[2] != 'B' || pucHeader[3] != 'K')
+            {
+                return false;
+            }
+            ulCount = (uint32_t)ulLoadLE(pucHeader + 4, 4);
+            return true;
+        }
+
+        /// Whether ulCount entries fit in an image of ulBytes
+        static bool bFits(uint32_t ulCount, uint32_t ulBytes)
+        {
+            return (uint64_t)HEADER_BYTES + (uint64_t)ulCount * ENTRY_BYTES <= ulBytes;
+        }
+
+        bool bReadEntry(uint32_t ulIndex, uint64_t& ulEntry) const
+        {
+            uint32_t ulOffset = HEADER_BYTES + ulIndex * ENTRY_BYTES;
+            if (pucImage)
+            {
+                ulEntry = ulLoadLE(pucImage + ulOffset, ENTRY_BYTES);
+                return true;
+            }
+
+            uint8_t ucBuffer[ENTRY_BYTES];
+            if (!pfRead || !pfRead(ucBuffer, ENTRY_BYTES, ulOffset))
+            {
+                return false;
+            }
+            ulEntry = ulLoadLE(ucBuffer, ENTRY_BYTES);
+            return true;
+        }
+
+        static uint64_t ulLoadLE(const uint8_t* pucIn, unsigned ulBytes)
+        {
+            uint64_t ulValue = 0;
+            for (unsigned ulI = ulBytes; ulI > 0; --ulI)
+            {
+                ulValue = (ulValue << 8) | pucIn[ulI - 1];
+            }
+            return ulValue;
+        }
+
+        static void vStoreLE(uint8_t* pucOut, uint64_t ulValue, unsigned ulBytes)
+        {
+            for (unsigned ulI = 0; ulI < ulBytes; ++ulI)
+            {
+                pucOut[ulI] = (uint8_t)(ulValue >> (8 * ulI));
+            }
+        }
+
+        const uint8_t* pucImage;
+        ReadFn_t pfRead;
+        uint32_t ulEntries;
+};
+
+} // namespace c4
+} // namespace team9
+
+#endif
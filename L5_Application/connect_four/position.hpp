@@ -0,0 +1,269 @@
+#ifndef C4_POSITION_HPP
+#define C4_POSITION_HPP
+
+#include <stdint.h>
+
+namespace team9
+{
+namespace c4
+{
+
+/**
+ * Connect Four position stored as two 64-bit bitboards.
+ *
+ * Each column uses HEIGHT+1 bits (the extra bit is a sentinel row that stays
+ * empty), so bit (col * (HEIGHT+1) + row) is the cell at row 0 (bottom) to
+ * row 5 (top).  ulCurrent holds the stones of the player to move and ulMask
+ * holds every stone on the board.  Playing a move is two adds and an xor,
+ * and four-in-a-row is found with shift-and-mask instead of walking cells.
+ */
+class Position_t
+{
+    public:
+        static const int WIDTH = 7;
+        static const int HEIGHT = 6;
+        static const int MIN_SCORE = -(WIDTH * HEIGHT) / 2 + 3;
+        static const int MAX_SCORE = (WIDTH * HEIGHT + 1) / 2 - 3;
+
+        Position_t() : ulCurrent(0), ulMask(0), ulMoves(0) {}
+
+        /// @returns true if column lCol (0 is left) has room for another chip
+        bool bCanPlay(int lCol) const
+        {
+            return (ulMask & ulTopMaskCol(lCol)) == 0;
+        }
+
+        /// Drops a chip for the player to move into lCol, lCol must be playable
+        void vPlay(int lCol)
+        {
+            vPlayMove((ulMask + ulBottomMaskCol(lCol)) & ulColumnMask(lCol));
+        }
+
+        /// Plays a move given as its single-bit board mask
+        void vPlayMove(uint64_t ulMove)
+        {
+            ulCurrent ^= ulMask;
+            ulMask |= ulMove;
+            ulMoves++;
+        }
+
+        /**
+         * Plays a sequence of 1-based column digits, ex: "4453".
+         * @returns the number of moves played, stops at the first invalid,
+         *          full or game-ending move.
+         */
+        unsigned ulPlaySequence(const char* pcSeq)
+        {
+            unsigned ulPlayed = 0;
+            for (; pcSeq[ulPlayed] != '\0'; ++ulPlayed)
+            {
+                int lCol = pcSeq[ulPlayed] - '1';
+                if (lCol < 0 || lCol >= WIDTH || !bCanPlay(lCol) ||
+                    bIsWinningMove(lCol))
+                {
+                    break;
+                }
+                vPlay(lCol);
+            }
+            return ulPlayed;
+        }
+
+        /// @returns true if the player to move wins by playing lCol
+        bool bIsWinningMove(int lCol) const
+        {
+            return (ulWinningPosition() & ulPossible() & ulColumnMask(lCol)) != 0;
+        }
+
+        /// @returns true if the player to move has an immediate win
+        bool bCanWinNext() const
+        {
+            return (ulWinningPosition() & ulPossible()) != 0;
+        }
+
+        /// @returns true if the last move made four in a row
+        bool bLastMoveWon() const
+        {
+            return bAlignment(ulCurrent ^ ulMask);
+        }
+
+        /// @returns true if every cell is taken
+        bool bFull() const
+        {
+            return ulMoves == WIDTH * HEIGHT;
+        }
+
+        unsigned ulNbMoves() const
+        {
+            return ulMoves;
+        }
+
+        /// @returns a key that uniquely identifies the position (49 bits used)
+        uint64_t ulKey() const
+        {
+            return ulCurrent + ulMask;
+        }
+
+        /// @returns a bitmap of the cells where the next chip of each column lands
+        uint64_t ulPossible() const
+        {
+            return (ulMask + BOTTOM_MASK) & BOARD_MASK;
+        }
+
+        /// @returns the cells that would complete four for the player to move
+        uint64_t ulWinningPosition() const
+        {
+            return ulComputeWinningPosition(ulCurrent, ulMask);
+        }
+
+        /// @returns the cells that would complete four for the opponent
+        uint64_t ulOpponentWinningPosition() const
+        {
+            return ulComputeWinningPosition(ulCurrent ^ ulMask, ulMask);
+        }
+
+        /**
+         * @returns the moves that do not hand the opponent an immediate win.
+         * Assumes the player to move cannot win right away.
+         */
+        uint64_t ulPossibleNonLosingMoves() const
+        {
+            uint64_t ulPossibleMask = ulPossible();
+            uint64_t ulOpponentWin = ulOpponentWinningPosition();
+            uint64_t ulForced = ulPossibleMask & ulOpponentWin;
+            if (ulForced)
+            {
+                // More than one forced move means we lose next turn
+                if (ulForced & (ulForced - 1))
+                {
+                    return 0;
+                }
+                ulPossibleMask = ulForced;
+            }
+            // Never play directly below an opponent's winning cell
+            return ulPossibleMask & ~(ulOpponentWin >> 1);
+        }
+
+        /// @returns the player-to-move stones and the full mask (for printing)
+        uint64_t ulCurrentStones() const { return ulCurrent; }
+        uint64_t ulAllStones() const { return ulMask; }
+
+        /// @returns the row (0 is bottom) the next chip in lCol lands on
+        int lColumnHeight(int lCol) const
+        {
+            int lRow = 0;
+            while (lRow < HEIGHT && (ulMask & ulCellMask(lRow, lCol)))
+            {
+                lRow++;
+            }
+            return lRow;
+        }
+
+        /// @returns a copy with the columns mirrored left to right
+        Position_t xMirror() const
+        {
+            Position_t xMirrored;
+            for (int lCol = 0; lCol < WIDTH; ++lCol)
+            {
+                int lShift = (WIDTH - 1 - 2 * lCol) * (HEIGHT + 1);
+                uint64_t ulCurrentCol = ulCurrent & ulColumnMask(lCol);
+                uint64_t ulMaskCol = ulMask & ulColumnMask(lCol);
+                xMirrored.ulCurrent |= (lShift >= 0) ? (ulCurrentCol << lShift) :
+                                                       (ulCurrentCol >> -lShift);
+                xMirrored.ulMask |= (lShift >= 0) ? (ulMaskCol << lShift) :
+                                                    (ulMaskCol >> -lShift);
+            }
+            xMirrored.ulMoves = ulMoves;
+            return xMirrored;
+        }
+
+        static uint64_t ulTopMaskCol(int lCol)
+        {
+            return UINT64_C(1) << ((HEIGHT - 1) + lCol * (HEIGHT + 1));
+        }
+
+        static uint64_t ulBottomMaskCol(int lCol)
+        {
+            return UINT64_C(1) << (lCol * (HEIGHT + 1));
+        }
+
+        static uint64_t ulColumnMask(int lCol)
+        {
+            return ((UINT64_C(1) << HEIGHT) - 1) << (lCol * (HEIGHT + 1));
+        }
+
+        static uint64_t ulCellMask(int lRow, int lCol)
+        {
+            return UINT64_C(1) << (lRow + lCol * (HEIGHT + 1));
+        }
+
+        /// @returns the 0-based column of a single-bit move mask
+        static int lColumnOf(uint64_t ulMove)
+        {
+            for (int lCol = 0; lCol < WIDTH; ++lCol)
+            {
+                if (ulMove & ulColumnMask(lCol))
+                {
+                    return lCol;
+                }
+            }
+            return -1;
+        }
+
+        static unsigned ulPopCount(uint64_t ulBits)
+        {
+            return __builtin_popcountll(ulBits);
+        }
+
+        /// @returns true if xPosition contains four in a row (any direction)
+        static bool bAlignment(uint64_t ulPosition)
+        {
+            // Horizontal, diagonal /, diagonal \ and vertical neighbour shifts
+            static const int lShifts[4] = {HEIGHT + 1, HEIGHT + 2, HEIGHT, 1};
+            for (int lI = 0; lI < 4; ++lI)
+            {
+                uint64_t ulPairs = ulPosition & (ulPosition >> lShifts[lI]);
+                if (ulPairs & (ulPairs >> (2 * lShifts[lI])))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @returns the empty cells that would complete four in a row for the
+         *          stones in ulPosition.  This is the bit-parallel version of
+         *          walking every direction from every cell.
+         */
+        static uint64_t ulComputeWinningPosition(uint64_t ulPosition, uint64_t ulMask)
+        {
+            // Vertical: three stacked stones, win is the cell above
+            uint64_t ulWin = (ulPosition << 1) & (ulPosition << 2) & (ulPosition << 3);
+
+            static const int lShifts[3] = {HEIGHT + 1, HEIGHT, HEIGHT + 2};
+            for (int lI = 0; lI < 3; ++lI)
+            {
+                const int lS = lShifts[lI];
+                uint64_t ulPair = (ulPosition << lS) & (ulPosition << 2 * lS);
+                ulWin |= ulPair & (ulPosition << 3 * lS); // xxx.
+                ulWin |= ulPair & (ulPosition >> lS);     // xx.x
+                ulPair = (ulPosition >> lS) & (ulPosition >> 2 * lS);
+                ulWin |= ulPair & (ulPosition << lS);     // x.xx
+                ulWin |= ulPair & (ulPosition >> 3 * lS); // .xxx
+            }
+            return ulWin & (BOARD_MASK ^ ulMask);
+        }
+
+        static const uint64_t BOTTOM_MASK = UINT64_C(0x0040810204081);
+        static const uint64_t BOARD_MASK = BOTTOM_MASK * ((UINT64_C(1) << HEIGHT) - 1);
+
+    private:
+        uint64_t ulCurrent;
+        uint64_t ulMask;
+        unsigned ulMoves;
+};
+
+} // namespace c4
+} // namespace team9
+
+#endif
@@ -0,0 +1,527 @@
+#ifndef C4_SOLVER_HPP
+#define C4_SOLVER_HPP
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "connect_four/position.hpp"
+#include "connect_four/threats.hpp"
+#include "connect_four/transposition_table.hpp"
+
+namespace team9
+{
+namespace c4
+{
+
+/**
+ * Keeps up to WIDTH moves sorted by score, highest popped first.
+ * Insertion sort is the fastest choice for seven entries.
+ */
+class MoveSorter_t
+{
+    public:
+        MoveSorter_t() : ulSize(0) {}
+
+        void vAdd(uint64_t ulMove, int lScore)
+        {
+            unsigned ulPos = ulSize++;
+            for (; ulPos && xEntries[ulPos - 1].lScore > lScore; --ulPos)
+            {
+                xEntries[ulPos] = xEntries[ulPos - 1];
+            }
+            xEntries[ulPos].ulMove = ulMove;
+            xEntries[ulPos].lScore = lScore;
+        }
+
+        /// @returns the next best move, or 0 when empty
+        uint64_t ulNext()
+        {
+            return ulSize ? xEntries[--ulSize].ulMove : 0;
+        }
+
+    private:
+        struct Entry_t
+        {
+            uint64_t ulMove;
+            int lScore;
+        } xEntries[Position_t::WIDTH];
+        unsigned ulSize;
+};
+
+/**
+ * Negamax search with alpha-beta pruning over Position_t.
+ *
+ * An optional transposition table remembers bounds and best moves of
+ * positions reached through different move orders.
+ *
+ * xSolve() searches to the end of the game.  xSearch() is the anytime
+ * version: it deepens one ply at a time, scores the horizon with
+ * lEvaluate(), and returns the best move of the deepest finished iteration
+ * once the deadline passes.  With ENDGAME_EMPTIES or fewer empty cells left
+ * it goes straight from a one ply search to the end of the game, which is
+ * cheap that late and proves the outcome.
+ *
+ * On the board the table is 2^9 entries and a mid-game solve is out of
+ * reach: "c4 solve 4453" takes 62M nodes.  "c4 board" estimates that a
+ * one second budget gets 12 to 19 plies deep in the middle game and
+ * proves the result from about 21 empty cells on.
+ * Scores follow the usual convention: a positive score means the player to
+ * move wins, and the magnitude is how early (number of own chips left when
+ * the win happens, plus one).  Zero is a draw.
+ *
+ * Inside the search and the table scores are multiplied by SCORE_SCALE
+ * and a horizon score stays strictly between -SCORE_SCALE and SCORE_SCALE,
+ * so a heuristic leaf never outranks a proven win, even the slowest one.
+ */
+class Solver_t
+{
+    public:
+        struct Result_t
+        {
+            Result_t() : lScore(0), lBestCol(-1), ulNodes(0), ulDepth(0), bExact(false) {}
+            int lScore;
+            int lBestCol;
+            uint64_t ulNodes;
+            unsigned ulDepth;   ///< Plies searched from the root
+            bool bExact;        ///< lScore is the game theoretic value
+        };
+
+        /// Millisecond clock used for deadlines, ex: sys_get_uptime_ms()
+        typedef uint64_t (*ClockMs_t)(void);
+
+        /// Polled with the clock, ex: "has the opponent moved", true stops the search
+        typedef bool (*StopFn_t)(void);
+
+        static const unsigned ENDGAME_EMPTIES = 20;
+
+        /// 21 * 3 still fits the table's 7 bit values
+        static const int SCORE_SCALE = 3;
+
+        /// @param ulTTLog2Entries  Transposition table size as log2 of entries, 0 for none
+        Solver_t(unsigned ulTTLog2Entries = 0) :
+                pOwnedTable(ulTTLog2Entries ? new TranspositionTable_t(ulTTLog2Entries) : NULL),
+                pTable(pOwnedTable.get())
+        {
+            vInit();
+        }
+
+        /// Searches with a table owned by the caller, ex: shared between threads
+        explicit Solver_t(TranspositionTable_t& xSharedTable) :
+                pTable(&xSharedTable)
+        {
+            vInit();
+        }
+
+        virtual ~Solver_t() {}
+
+        /**
+         * Solves xPosition completely.
+         * @returns the exact score and a best column for the player to move.
+         *          lBestCol is -1 only if the board is full or already won.
+         */
+        Result_t xSolve(const Position_t& xPosition)
+        {
+            Result_t xResult;
+            vStart(0);
+
+            if (!bTrivial(xPosition, xResult))
+            {
+                unsigned ulEmpties = Position_t::WIDTH * Position_t::HEIGHT -
+                                     xPosition.ulNbMoves();
+                if (bSearchRoot(xPosition, ulEmpties, xResult))
+                {
+                    xResult.ulDepth = ulEmpties;
+                    xResult.bExact = true;
+                }
+            }
+            xResult.ulNodes = ulNodes;
+            return xResult;
+        }
+
+        /**
+         * Iterative deepening search that stops at ulDeadlineMs_arg of the
+         * clock given to vSetClock() (no clock means no deadline), or after
+         * ulMaxDepth plies if that is not 0.
+         * @returns the best move found so far.  bExact is set if the search
+         *          reached the end of the game on every line.
+         */
+        Result_t xSearch(const Position_t& xPosition, uint64_t ulDeadlineMs_arg,
+                         unsigned ulMaxDepth = 0)
+        {
+            Result_t xResult;
+            vStart(ulDeadlineMs_arg);
+
+            if (!bTrivial(xPosition, xResult))
+            {
+                unsigned ulEmpties = Position_t::WIDTH * Position_t::HEIGHT -
+                                     xPosition.ulNbMoves();
+                if (ulMaxDepth == 0 || ulMaxDepth > ulEmpties)
+                {
+                    ulMaxDepth = ulEmpties;
+                }
+                for (unsigned ulDepth = ulFirstDepth; ulDepth <= ulMaxDepth; ++ulDepth)
+                {
+                    bHorizonHit = false;
+                    if (!bSearchRoot(xPosition, ulDepth, xResult))
+                    {
+                        break;
+                    }
+                    xResult.ulDepth = ulDepth;
+                    if (!bHorizonHit)
+                    {
+                        xResult.bExact = true;
+                        break;
+                    }
+                    if (ulEmpties <= ENDGAME_EMPTIES && ulDepth < ulMaxDepth)
+                    {
+                        ulDepth = ulMaxDepth - 1;
+                    }
+                }
+            }
+            xResult.ulNodes = ulNodes;
+            return xResult;
+        }
+
+        void vSetClock(ClockMs_t pfClock_arg)
+        {
+            pfClock = pfClock_arg;
+        }
+
+        /// NULL for none, a search stopped by it returns like one out of time
+        void vSetStop(StopFn_t pfStop_arg)
+        {
+            pfStop = pfStop_arg;
+        }
+
+        uint64_t ulGetNodeCount() const
+        {
+            return ulNodes;
+        }
+
+        /// @returns the transposition table or NULL if the solver has none
+        TranspositionTable_t* pGetTable() const
+        {
+            return pTable;
+        }
+
+        /// Forgets every stored position, ex: at the start of a new game
+        void vClearTable()
+        {
+            if (pTable)
+            {
+                pTable->vClear();
+            }
+        }
+
+    protected:
+        /// The clock is read once every DEADLINE_CHECK_MASK + 1 nodes
+        static const uint64_t DEADLINE_CHECK_MASK = 1023;
+
+        /// Below any search score, never stored
+        static const int INFINITE_SCORE = Position_t::WIDTH * Position_t::HEIGHT * SCORE_SCALE;
+
+        void vInit()
+        {
+            pfClock = NULL;
+            pfStop = NULL;
+            ulDeadlineMs = 0;
+            ulFirstDepth = 1;
+            ulNodes = 0;
+            bStop = false;
+            bHorizonHit = false;
+
+            // Explore the center columns first, they take part in more lines
+            for (int lI = 0; lI < Position_t::WIDTH; ++lI)
+            {
+                lColumnOrder[lI] = Position_t::WIDTH / 2 +
+                                   (1 - 2 * (lI % 2)) * (lI + 1) / 2;
+            }
+        }
+
+        /// Polled during the search, the search unwinds once it returns true
+        virtual bool bTimeUp()
+        {
+            return (pfClock && ulDeadlineMs && pfClock() >= ulDeadlineMs) || (pfStop && pfStop());
+        }
+
+        void vStart(uint64_t ulDeadlineMs_arg)
+        {
+            ulNodes = 0;
+            ulDeadlineMs = ulDeadlineMs_arg;
+            bStop = false;
+        }
+
+        /**
+         * Handles the root positions that need no search: finished games, an
+         * immediate win and a position where every move loses.
+         * Otherwise sets a playable default column and returns false.
+         */
+        bool bTrivial(const Position_t& xPosition, Result_t& xResult)
+        {
+            xResult.bExact = true;
+            if (xPosition.bFull() || xPosition.bLastMoveWon())
+            {
+                return true;
+            }
+
+            for (int lI = 0; lI < Position_t::WIDTH; ++lI)
+            {
+                int lCol = lColumnOrder[lI];
+                if (xPosition.bCanPlay(lCol) && xPosition.bIsWinningMove(lCol))
+                {
+                    xResult.lScore = lWinScore(xPosition);
+                    xResult.lBestCol = lCol;
+                    ++ulNodes;
+                    return true;
+                }
+            }
+
+            // Default to the first playable column in case every move loses
+            for (int lI = 0; lI < Position_t::WIDTH && xResult.lBestCol < 0; ++lI)
+            {
+                if (xPosition.bCanPlay(lColumnOrder[lI]))
+                {
+                    xResult.lBestCol = lColumnOrder[lI];
+                }
+            }
+
+            if (!xPosition.ulPossibleNonLosingMoves())
+            {
+                xResult.lScore = -lLossScore(xPosition);
+                ++ulNodes;
+                return true;
+            }
+            xResult.bExact = false;
+            return false;
+        }
+
+        /**
+         * Searches every root move ulDepth plies deep, xResult.lBestCol first.
+         * @returns false if the deadline hit.  xResult still gets the best of
+         *          the moves that finished, which were compared against the
+         *          previous best move since that one is searched first.
+         */
+        bool bSearchRoot(const Position_t& xPosition, unsigned ulDepth, Result_t& xResult)
+        {
+            int lAlpha = -INFINITE_SCORE;
+            int lBestCol = -1;
+            MoveSorter_t xMoves;
+            int lFirstCol = lTableMove(xPosition);
+            vSortMoves(xPosition, xPosition.ulPossibleNonLosingMoves(), xMoves,
+                       (xResult.ulDepth > 0) ? xResult.lBestCol : lFirstCol);
+            while (uint64_t ulMove = xMoves.ulNext())
+            {
+                Position_t xChild(xPosition);
+                xChild.vPlayMove(ulMove);
+                int lScore = -lNegamax(xChild, -INFINITE_SCORE, -lAlpha, ulDepth - 1);
+                if (bStop)
+                {
+                    break;
+                }
+                if (lScore > lAlpha)
+                {
+                    lAlpha = lScore;
+                    lBestCol = Position_t::lColumnOf(ulMove);
+                }
+            }
+            if (lBestCol >= 0)
+            {
+                xResult.lScore = lAlpha / SCORE_SCALE;
+                xResult.lBestCol = lBestCol;
+            }
+            return !bStop;
+        }
+
+        /**
+         * Alpha-beta negamax searching ulDepth plies, searching to the end of
+         * the game when ulDepth is the number of empty cells.
+         * @pre The player to move cannot win with the next move.
+         * @returns the exact score if it lies in ]lAlpha, lBeta[, otherwise a
+         *          bound on the same side as the true score.  Meaningless if
+         *          bStop got set.
+         */
+        int lNegamax(const Position_t& xPosition, int lAlpha, int lBeta, unsigned ulDepth)
+        {
+            ulNodes++;
+            if ((ulNodes & DEADLINE_CHECK_MASK) == 0 && bTimeUp())
+            {
+                bStop = true;
+            }
+            if (bStop)
+            {
+                return 0;
+            }
+
+            uint64_t ulNext = xPosition.ulPossibleNonLosingMoves();
+            if (!ulNext)
+            {
+                return -lLossScore(xPosition) * SCORE_SCALE;
+            }
+            if (xPosition.ulNbMoves() >= Position_t::WIDTH * Position_t::HEIGHT - 2)
+            {
+                return 0; // Draw, no room left for either side to win
+            }
+
+            // We cannot lose on the opponent's next move, so tighten the window
+            int lMin = -(Position_t::WIDTH * Position_t::HEIGHT - 2 -
+                         (int)xPosition.ulNbMoves()) / 2 * SCORE_SCALE;
+            if (lAlpha < lMin)
+            {
+                lAlpha = lMin;
+                if (lAlpha >= lBeta) return lAlpha;
+            }
+            int lMax = (Position_t::WIDTH * Position_t::HEIGHT - 1 -
+                        (int)xPosition.ulNbMoves()) / 2 * SCORE_SCALE;
+            if (lBeta > lMax)
+            {
+                lBeta = lMax;
+                if (lAlpha >= lBeta) return lBeta;
+            }
+
+            const int lAlphaOrig = lAlpha;
+            int lTableMove = -1;
+            TranspositionTable_t::Entry_t xEntry;
+            if (pTable && pTable->bGet(xPosition.ulKey(), xEntry))
+            {
+                lTableMove = xEntry.lMove;
+                // Results of a shallower search only help move ordering
+                bool bUsable = (xEntry.ulDepth >= ulDepth);
+                // A bound from a search that stopped short of the end of the
+                // game may rest on lEvaluate(), ex: stored by a deeper helper
+                if (bUsable && xEntry.ulDepth <
+                        Position_t::WIDTH * Position_t::HEIGHT - xPosition.ulNbMoves())
+                {
+                    bHorizonHit = true;
+                }
+                switch (bUsable ? xEntry.eBound : TranspositionTable_t::NONE)
+                {
+                    case TranspositionTable_t::EXACT: return xEntry.lValue;
+                    case TranspositionTable_t::LOWER:
+                        if (xEntry.lValue > lAlpha) lAlpha = xEntry.lValue;
+                        break;
+                    case TranspositionTable_t::UPPER:
+                        if (xEntry.lValue < lBeta) lBeta = xEntry.lValue;
+                        break;
+                    default: break;
+                }
+                if (lAlpha >= lBeta)
+                {
+                    return xEntry.lValue;
+                }
+            }
+
+            if (ulDepth == 0)
+            {
+                bHorizonHit = true;
+                int lScore = lEvaluate(xPosition);
+                lScore = (lScore < 1 - SCORE_SCALE) ? 1 - SCORE_SCALE :
+                         (lScore > SCORE_SCALE - 1) ? SCORE_SCALE - 1 : lScore;
+                return (lScore < lMin) ? lMin : (lScore > lMax) ? lMax : lScore;
+            }
+
+            int lBest = -INFINITE_SCORE;
+            int lBestCol = -1;
+            MoveSorter_t xMoves;
+            vSortMoves(xPosition, ulNext, xMoves, lTableMove);
+            while (uint64_t ulMove = xMoves.ulNext())
+            {
+                Position_t xChild(xPosition);
+                xChild.vPlayMove(ulMove);
+                int lScore = -lNegamax(xChild, -lBeta, -lAlpha, ulDepth - 1);
+                if (bStop)
+                {
+                    return 0;
+                }
+                if (lScore > lBest)
+                {
+                    lBest = lScore;
+                    lBestCol = Position_t::lColumnOf(ulMove);
+                }
+                if (lScore >= lBeta)
+                {
+                    break;
+                }
+                if (lScore > lAlpha)
+                {
+                    lAlpha = lScore;
+                }
+            }
+
+            if (pTable)
+            {
+                TranspositionTable_t::Bound_t eBound =
+                        (lBest <= lAlphaOrig) ? TranspositionTable_t::UPPER :
+                        (lBest >= lBeta) ? TranspositionTable_t::LOWER :
+                                           TranspositionTable_t::EXACT;
+                pTable->vPut(xPosition.ulKey(), lBest, eBound, lBestCol, ulDepth);
+            }
+            return lBest;
+        }
+
+        /// @returns the best column stored for xPosition, or -1
+        int lTableMove(const Position_t& xPosition)
+        {
+            TranspositionTable_t::Entry_t xEntry;
+            if (pTable && pTable->bGet(xPosition.ulKey(), xEntry))
+            {
+                return xEntry.lMove;
+            }
+            return -1;
+        }
+
+        /**
+         * Orders the moves in ulNext by the number of threats they create.
+         * lFirstCol (ex: the stored best move) is always tried first.
+         */
+        void vSortMoves(const Position_t& xPosition, uint64_t ulNext,
+                        MoveSorter_t& xMoves, int lFirstCol = -1) const
+        {
+            for (int lI = Position_t::WIDTH - 1; lI >= 0; --lI)
+            {
+                uint64_t ulMove = ulNext & Position_t::ulColumnMask(lColumnOrder[lI]);
+                if (ulMove)
+                {
+                    uint64_t ulOwn = (xPosition.ulCurrentStones() | ulMove);
+                    uint64_t ulThreats = Position_t::ulComputeWinningPosition(
+                            ulOwn, xPosition.ulAllStones() | ulMove);
+                    int lScore = Position_t::ulPopCount(ulThreats);
+                    if (lColumnOrder[lI] == lFirstCol)
+                    {
+                        lScore += Position_t::WIDTH * Position_t::HEIGHT;
+                    }
+                    xMoves.vAdd(ulMove, lScore);
+                }
+            }
+        }
+
+        /// @returns the score of the player to move winning on this move
+        static int lWinScore(const Position_t& xPosition)
+        {
+            return (Position_t::WIDTH * Position_t::HEIGHT + 1 -
+                    (int)xPosition.ulNbMoves()) / 2;
+        }
+
+        /// @returns the magnitude of losing on the opponent's next move
+        static int lLossScore(const Position_t& xPosition)
+        {
+            return (Position_t::WIDTH * Position_t::HEIGHT -
+                    (int)xPosition.ulNbMoves()) / 2;
+        }
+
+        std::unique_ptr<TranspositionTable_t> pOwnedTable;
+        TranspositionTable_t* pTable;
+        ClockMs_t pfClock;
+        StopFn_t pfStop;
+        uint64_t ulDeadlineMs;
+        unsigned ulFirstDepth;  ///< First iteration of xSearch()
+        int lColumnOrder[Position_t::WIDTH];
+        uint64_t ulNodes;
+        bool bStop;
+        bool bHorizonHit;
+};
+
+} // namespace c4
+} // namespace team9
+
+#endif
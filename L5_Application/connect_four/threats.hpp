@@ -0,0 +1,117 @@
+#ifndef C4_THREATS_HPP
+#define C4_THREATS_HPP
+
+#include <stdint.h>
+
+#include "connect_four/position.hpp"
+
+namespace team9
+{
+namespace c4
+{
+
+/**
+ * Threat analysis of a position with bitboard shifts, the replacement for
+ * walking direction vectors cell by cell (heuristic_generic in
+ * connect_four_AI/four_connect.py).
+ *
+ * A window is four aligned cells.  An open three is a window holding three
+ * stones of one player and one empty cell, an open two holds two of each.
+ * Index 0 of every pair is the player to move, index 1 the opponent.
+ */
+struct Threats_t
+{
+    uint64_t ulWinCells[2];      ///< Empty cells that would complete four
+    uint64_t ulImmediateWins;    ///< Playable cells that win right now
+    uint64_t ulForcedBlocks;     ///< Playable cells the opponent wins on next turn
+    unsigned ulOpenThrees[2];    ///< Windows with three stones and an empty cell
+    unsigned ulOpenTwos[2];      ///< Windows with two stones and two empty cells
+
+    static Threats_t xAnalyze(const Position_t& xPosition)
+    {
+        Threats_t xThreats;
+        const uint64_t ulOwn = xPosition.ulCurrentStones();
+        const uint64_t ulOther = xPosition.ulCurrentStones() ^ xPosition.ulAllStones();
+        const uint64_t ulEmpty = Position_t::BOARD_MASK & ~xPosition.ulAllStones();
+        const uint64_t ulPlayable = xPosition.ulPossible();
+
+        xThreats.ulWinCells[0] = xPosition.ulWinningPosition();
+        xThreats.ulWinCells[1] = xPosition.ulOpponentWinningPosition();
+        xThreats.ulImmediateWins = xThreats.ulWinCells[0] & ulPlayable;
+        xThreats.ulForcedBlocks = xThreats.ulWinCells[1] & ulPlayable;
+        vCountWindows(ulOwn, ulEmpty, xThreats.ulOpenThrees[0], xThreats.ulOpenTwos[0]);
+        vCountWindows(ulOther, ulEmpty, xThreats.ulOpenThrees[1], xThreats.ulOpenTwos[1]);
+        return xThreats;
+    }
+
+    /**
+     * @returns the win cells on rows that favour the player who owns them.
+     * With every other column full, the first player fills the odd rows
+     * (1, 3, 5 counting from 1) and the second player the even ones, so
+     * a threat on a row of its own parity tends to be decisive.
+     */
+    static uint64_t ulGoodParity(uint64_t ulWinCells, bool bFirstPlayer)
+    {
+        // Rows 0, 2 and 4 counting from 0 are the odd rows counting from 1
+        static const uint64_t ODD_ROWS = Position_t::BOTTOM_MASK * 0x15;
+        return ulWinCells & (bFirstPlayer ? ODD_ROWS : (Position_t::BOARD_MASK ^ ODD_ROWS));
+    }
+
+    /**
+     * Counts the windows holding three and two stones of ulPlayer with the
+     * rest in ulEmpty.  Sentinel cells are in neither mask, so windows
+     * wrapping across columns never count.
+     */
+    static void vCountWindows(uint64_t ulPlayer, uint64_t ulEmpty,
+                              unsigned& ulThrees, unsigned& ulTwos)
+    {
+        // Horizontal, diagonal /, diagonal \ and vertical neighbour shifts
+        static const int lShifts[4] = {Position_t::HEIGHT + 1, Position_t::HEIGHT + 2,
+                                       Position_t::HEIGHT, 1};
+        ulThrees = 0;
+        ulTwos = 0;
+        for (int lD = 0; lD < 4; ++lD)
+        {
+            const int lS = lShifts[lD];
+            // Bit b is set if cell k of the window starting at b is a stone (or empty)
+            const uint64_t ulS1 = ulPlayer >> lS, ulS2 = ulPlayer >> 2 * lS, ulS3 = ulPlayer >> 3 * lS;
+            const uint64_t ulE1 = ulEmpty >> lS, ulE2 = ulEmpty >> 2 * lS, ulE3 = ulEmpty >> 3 * lS;
+
+            ulThrees += Position_t::ulPopCount((ulEmpty & ulS1 & ulS2 & ulS3) |
+                                               (ulPlayer & ulE1 & ulS2 & ulS3) |
+                                               (ulPlayer & ulS1 & ulE2 & ulS3) |
+                                               (ulPlayer & ulS1 & ulS2 & ulE3));
+            ulTwos += Position_t::ulPopCount((ulPlayer & ulS1 & ulE2 & ulE3) |
+                                             (ulPlayer & ulE1 & ulS2 & ulE3) |
+                                             (ulPlayer & ulE1 & ulE2 & ulS3) |
+                                             (ulEmpty & ulS1 & ulS2 & ulE3) |
+                                             (ulEmpty & ulS1 & ulE2 & ulS3) |
+                                             (ulEmpty & ulE1 & ulS2 & ulS3));
+        }
+    }
+};
+
+/**
+ * Static score for the player to move, used at the search horizon.
+ * Win cells count most, double on a row of the right parity, open threes
+ * and twos break ties.  Only the sign and a rough size mean anything:
+ * Solver_t clamps it below its slowest proven win.
+ */
+static inline int lEvaluate(const Position_t& xPosition)
+{
+    const Threats_t xThreats = Threats_t::xAnalyze(xPosition);
+    const bool bFirst = (xPosition.ulNbMoves() % 2) == 0;
+
+    int lScore = 4 * ((int)Position_t::ulPopCount(xThreats.ulWinCells[0]) -
+                      (int)Position_t::ulPopCount(xThreats.ulWinCells[1]));
+    lScore += 4 * ((int)Position_t::ulPopCount(Threats_t::ulGoodParity(xThreats.ulWinCells[0], bFirst)) -
+                   (int)Position_t::ulPopCount(Threats_t::ulGoodParity(xThreats.ulWinCells[1], !bFirst)));
+    lScore += 2 * ((int)xThreats.ulOpenThrees[0] - (int)xThreats.ulOpenThrees[1]);
+    lScore += (int)xThreats.ulOpenTwos[0] - (int)xThreats.ulOpenTwos[1];
+    return lScore / 8;
+}
+
+} // namespace c4
+} // namespace team9
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef C4_TRANSPOSITION_TABLE_HPP
+#define C4_TRANSPOSITION_TABLE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <memory>
+#if !defined(__arm__)
+#include <atomic>
+#endif
+
+namespace team9
+{
+namespace c4
+{
+
+/**
+ * Fixed-size transposition table of 2^N packed 64-bit entries.
+ *
+ * The 49-bit position key is first scrambled by multiplying with an odd
+ * constant modulo 2^49.  That is a bijection, so the top N-1 bits can pick the
+ * bucket and only the remaining bits have to be stored to tell keys apart.
+ * Raw keys make poor indexes: their low bits are the mostly empty left column.
+ *
+ * Entry layout (most to least significant):
+ *      tag   50-N : the scrambled key bits not implied by the bucket index
+ *      depth  6b  : remaining depth the value was searched to
+ *      move   3b  : best column, 7 if unknown
+ *      bound  2b  : NONE, LOWER, UPPER or EXACT
+ *      value  7b  : search score (see Solver_t::SCORE_SCALE) + VALUE_OFFSET
+ *
+ * Entries are grouped in buckets of two.  The first slot keeps the deepest
+ * result seen for the bucket, the second is always replaced, so shallow
+ * nodes near the leaves cannot flush the expensive results near the root.
+ *
+ * On the host several search threads share one table.  Every entry is one
+ * word carrying its own tag, so relaxed atomic loads and stores are enough:
+ * a racing store replaces a whole entry and a lost update only costs a
+ * re-search.  The board has a single searcher and keeps plain words.
+ */
+class TranspositionTable_t
+{
+    public:
+        enum Bound_t {NONE = 0, LOWER = 1, UPPER = 2, EXACT = 3};
+
+        struct Entry_t
+        {
+            Entry_t() : lValue(0), eBound(NONE), lMove(-1), ulDepth(0) {}
+            int lValue;
+            Bound_t eBound;
+            int lMove;
+            unsigned ulDepth;
+        };
+
+        /// @param ulLog2Entries_arg  Table holds 2^ulLog2Entries_arg entries (8 bytes each), min 4
+        TranspositionTable_t(unsigned ulLog2Entries_arg) :
+                ulLog2Entries(ulLog2Entries_arg < 4 ? 4 : ulLog2Entries_arg),
+                ulTagBits(KEY_BITS - (ulLog2Entries - 1)),
+                pEntries(new Slot_t[size_t(1) << ulLog2Entries])
+        {
+            vClear();
+        }
+
+        void vClear()
+        {
+            for (size_t ulI = 0; ulI < (size_t(1) << ulLog2Entries); ++ulI)
+            {
+                vStore(pEntries[ulI], 0);
+            }
+        }
+
+        /// @returns true and fills xEntry if ulKey has a stored result
+        bool bGet(uint64_t ulKey, Entry_t& xEntry)
+        {
+            const uint64_t ulHash = ulScramble(ulKey);
+            const Slot_t* pBucket = pBucketFor(ulHash);
+            const uint64_t ulTag = ulTagOf(ulHash);
+            for (int lI = 0; lI < 2; ++lI)
+            {
+                uint64_t ulPacked = ulLoad(pBucket[lI]);
+                if ((ulPacked >> DATA_BITS) == ulTag && (ulPacked & BOUND_MASK))
+                {
+                    vUnpack(ulPacked, xEntry);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void vPut(uint64_t ulKey, int lValue, Bound_t eBound, int lMove, unsigned ulDepth)
+        {
+            const uint64_t ulHash = ulScramble(ulKey);
+            Slot_t* pBucket = pBucketFor(ulHash);
+            const uint64_t ulTag = ulTagOf(ulHash);
+            uint64_t ulPacked = ulPack(ulTag, lValue, eBound, lMove, ulDepth);
+
+            // Same position or a deeper result goes in the depth-preferred slot
+            uint64_t ulPreferred = ulLoad(pBucket[0]);
+            if ((ulPreferred >> DATA_BITS) == ulTag || ulDepth >= ulDepthOf(ulPreferred))
+            {
+                vStore(pBucket[0], ulPacked);
+            }
+            else
+            {
+                vStore(pBucket[1], ulPacked);
+            }
+        }
+
+        size_t ulBytes() const
+        {
+            return (size_t(1) << ulLog2Entries) * sizeof(Slot_t);
+        }
+
+        static const int VALUE_OFFSET = 64;
+
+    protected:
+#if defined(__arm__)
+        typedef uint64_t Slot_t;
+        static uint64_t ulLoad(const Slot_t& xSlot) { return xSlot; }
+        static void vStore(Slot_t& xSlot, uint64_t ulValue) { xSlot = ulValue; }
+#else
+        typedef std::atomic<uint64_t> Slot_t;
+        static uint64_t ulLoad(const Slot_t& xSlot)
+        {
+            return xSlot.load(std::memory_order_relaxed);
+        }
+        static void vStore(Slot_t& xSlot, uint64_t ulValue)
+        {
+            xSlot.store(ulValue, std::memory_order_relaxed);
+        }
+#endif
+
+        static const unsigned KEY_BITS = 49;
+        static const uint64_t KEY_MASK = (UINT64_C(1) << KEY_BITS) - 1;
+        static const unsigned VALUE_BITS = 7;
+        static const unsigned BOUND_BITS = 2;
+        static const unsigned MOVE_BITS = 3;
+        static const unsigned DEPTH_BITS = 6;
+        static const unsigned DATA_BITS = VALUE_BITS + BOUND_BITS + MOVE_BITS + DEPTH_BITS;
+        static const uint64_t BOUND_MASK = ((UINT64_C(1) << BOUND_BITS) - 1) << VALUE_BITS;
+
+        /// Odd multiplier, so the mapping is invertible modulo 2^KEY_BITS
+        static uint64_t ulScramble(uint64_t ulKey)
+        {
+            return (ulKey * UINT64_C(0x9E3779B97F4A7C15)) & KEY_MASK;
+        }
+
+        uint64_t ulTagOf(uint64_t ulHash) const
+        {
+            return ulHash & ((UINT64_C(1) << ulTagBits) - 1);
+        }
+
+        Slot_t* pBucketFor(uint64_t ulHash) const
+        {
+            return &pEntries[(ulHash >> ulTagBits) << 1];
+        }
+
+        static uint64_t ulPack(uint64_t ulTag, int lValue, Bound_t eBound,
+                               int lMove, unsigned ulDepth)
+        {
+            uint64_t ulMove = (lMove < 0) ? 7 : (uint64_t)lMove;
+            uint64_t ulDepthBits = (ulDepth > 63) ? 63 : ulDepth;
+            return (ulTag << DATA_BITS) |
+                   (ulDepthBits << (VALUE_BITS + BOUND_BITS + MOVE_BITS)) |
+                   (ulMove << (VALUE_BITS + BOUND_BITS)) |
+                   ((uint64_t)eBound << VALUE_BITS) |
+                   (uint64_t)(lValue + VALUE_OFFSET);
+        }
+
+        static void vUnpack(uint64_t ulPacked, Entry_t& xEntry)
+        {
+            xEntry.lValue = (int)(ulPacked & ((1 << VALUE_BITS) - 1)) - VALUE_OFFSET;
+            xEntry.eBound = (Bound_t)((ulPacked >> VALUE_BITS) & ((1 << BOUND_BITS) - 1));
+            int lMove = (ulPacked >> (VALUE_BITS + BOUND_BITS)) & ((1 << MOVE_BITS) - 1);
+            xEntry.lMove = (lMove == 7) ? -1 : lMove;
+            xEntry.ulDepth = ulDepthOf(ulPacked);
+        }
+
+        static unsigned ulDepthOf(uint64_t ulPacked)
+        {
+            return (ulPacked >> (VALUE_BITS + BOUND_BITS + MOVE_BITS)) &
+                   ((1 << DEPTH_BITS) - 1);
+        }
+
+        const unsigned ulLog2Entries;
+        const unsigned ulTagBits;
+        std::unique_ptr<Slot_t[]> pEntries;
+};
+
+} // namespace c4
+} // namespace team9
+
+#endif
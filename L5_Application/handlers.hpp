@@ -31,6 +31,9 @@ CMD_HANDLER_FUNC(gameHandler);
 /// Handler for motor control
 CMD_HANDLER_FUNC(motorHandler);
 
+/// Handler for the gantry's column table
+CMD_HANDLER_FUNC(gantryHandler);
+
 /// Handler for Pixy
 CMD_HANDLER_FUNC(pixyHandler);
 
@@ -46,6 +49,9 @@ CMD_HANDLER_FUNC(healthHandler);
 /// Handler for Logger stuff
 CMD_HANDLER_FUNC(logHandler);
 
+/// Handler for the binary event trace
+CMD_HANDLER_FUNC(traceHandler);
+
 /// Handler for setting and getting time
 CMD_HANDLER_FUNC(timeHandler);
 
@@ -1,7 +1,11 @@
 #include "tasks.hpp"
+#include "lpc_sys.h"
 
 int main(void)
 {
+	// Before the tasks, their constructors may log already
+	team9::pixy::xEvents().vSetClock(sys_get_uptime_us);
+
 	scheduler_add_task(new terminalTask(PRIORITY_MEDIUM));
 	scheduler_add_task(new team9::MotorTask_t(PRIORITY_MEDIUM));
 	scheduler_add_task(new team9::GameTask_t(PRIORITY_MEDIUM));
@@ -0,0 +1,19 @@
+#ifndef MOTOR_CONFIG_HPP
+#define MOTOR_CONFIG_HPP
+
+#include <stdint.h>
+
+/// Steps the gantry's stepper driver takes per rotation
+const uint32_t MOTOR_STEPS_PER_ROT = 400;
+
+/// Cruise speed and acceleration of a gantry move, in rotations.  The
+/// constant 1 rotation per second the gantry ran at before started and
+/// stopped dead; ramping lets it cruise faster.  Check against the belt
+/// before raising either: a missed step shifts every drop after it.
+const float MOTOR_MAX_RPS = 1.5f;
+const float MOTOR_ACCEL_RPS2 = 3.0f;
+
+/// Calibrated column positions, see motor/gantry.hpp
+const char* const MOTOR_COLUMNS_FILE = "/gantry.calib";
+
+#endif
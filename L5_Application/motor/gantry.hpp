@@ -0,0 +1,194 @@
+#ifndef MOTOR_GANTRY_HPP
+#define MOTOR_GANTRY_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "motor/config.hpp"
+
+namespace team9
+{
+namespace motor
+{
+
+/**
+ * Where the gantry is and where each column is, in steps from home.
+ *
+ * Columns start out on the line the gantry was built to, 1.6 rotations to
+ * the first and 0.4833 between columns.  To calibrate, jog the gantry over
+ * a column with "motor left|right <rotations>" and record it with "gantry
+ * set <col>"; "gantry save" writes the table to MOTOR_COLUMNS_FILE as text,
+ * one step count per column, and GameTask_t reads it back at start-up.
+ *
+ * The position is open loop: MotorTask_t adds up the steps it runs.  A
+ * gantry pushed by hand or powered off away from home needs "gantry zero"
+ * once it is back home.
+ */
+class Gantry_t
+{
+    public:
+        static const int COLS = 7;
+
+        /// Big enough for xStr()'s text and for what bParse() reads back
+        static const uint32_t STR_SIZE = 64;
+
+        Gantry_t() :
+            lPos(0)
+        {
+            vSetDefaults();
+        }
+
+        void vSetDefaults()
+        {
+            for (int lCol = 0; lCol < COLS; lCol++)
+            {
+                ulCol[lCol] = (uint32_t)(MOTOR_STEPS_PER_ROT * (0.4833f * lCol + 1.6f));
+            }
+        }
+
+        uint32_t ulColSteps(int lCol) const
+        {
+            return ulCol[lCol];
+        }
+
+        /// Refused unless lCol stays between its neighbors, away from home
+        bool bSetCol(int lCol, uint32_t ulSteps)
+        {
+            if (lCol < 0 || lCol >= COLS || !ulSteps ||
+                (lCol > 0 && ulSteps <= ulCol[lCol - 1]) ||
+                (lCol < COLS - 1 && ulSteps >= ulCol[lCol + 1]))
+            {
+                return false;
+            }
+            ulCol[lCol] = ulSteps;
+            return true;
+        }
+
+        /// Steps from home, negative past it
+        int32_t lPosition() const
+        {
+            return lPos;
+        }
+
+        void vMovedBy(int32_t lSteps)
+        {
+            lPos += lSteps;
+        }
+
+        /// The gantry is home
+        void vZero()
+        {
+            lPos = 0;
+        }
+
+        /// @returns the column the gantry is over, -1 if none
+        int lColAt() const
+        {
+            for (int lCol = 0; lCol < COLS; lCol++)
+            {
+                if ((int32_t)ulCol[lCol] == lPos)
+                {
+                    return lCol;
+                }
+            }
+            return -1;
+        }
+
+        /// Steps between two positions, either direction
+        static uint32_t ulDistance(int32_t lFrom, int32_t lTo)
+        {
+            return (lFrom < lTo) ? lTo - lFrom : lFrom - lTo;
+        }
+
+        /// "640 833 ...", the format bParse() reads
+        void vStr(char* pcBuf, uint32_t ulSize) const
+        {
+            snprintf(pcBuf, ulSize, "%u %u %u %u %u %u %u",
+                     (unsigned)ulCol[0], (unsigned)ulCol[1], (unsigned)ulCol[2], (unsigned)ulCol[3],
+                     (unsigned)ulCol[4], (unsigned)ulCol[5], (unsigned)ulCol[6]);
+        }
+
+        /// Takes a table only if it has every column, increasing away from home
+        bool bParse(const char* pcStr)
+        {
+            uint32_t ulNew[COLS];
+            for (int lCol = 0; lCol < COLS; lCol++)
+            {
+                char* pcEnd = NULL;
+                unsigned long ulVal = strtoul(pcStr, &pcEnd, 10);
+                if (pcEnd == pcStr || !ulVal || (lCol > 0 && ulVal <= ulNew[lCol - 1]))
+                {
+                    return false;
+                }
+                ulNew[lCol] = ulVal;
+                pcStr = pcEnd;
+            }
+            for (int lCol = 0; lCol < COLS; lCol++)
+            {
+                ulCol[lCol] = ulNew[lCol];
+            }
+            return true;
+        }
+
+        /**
+         * Orders a batch of drops for the least travel from where the gantry
+         * is, ending over the last one.  Columns lie on a line, so that is a
+         * sweep from whichever end of the batch is nearer to the other end,
+         * with a column's drops back to back.
+         * @param pucCols   columns 0 to COLS - 1, repeats allowed
+         * @param pucOrder  gets the same ulCount columns in the order to drop
+         * @returns the steps the gantry travels
+         */
+        uint32_t ulPlan(const uint8_t* pucCols, uint32_t ulCount, uint8_t* pucOrder) const
+        {
+            uint32_t ulDrops[COLS] = {0};
+            for (uint32_t i = 0; i < ulCount; i++)
+            {
+                ulDrops[pucCols[i]]++;
+            }
+            int lLo = 0;
+            int lHi = COLS - 1;
+            while (lLo < COLS && !ulDrops[lLo])
+            {
+                lLo++;
+            }
+            if (lLo == COLS)
+            {
+                return 0;
+            }
+            while (!ulDrops[lHi])
+            {
+                lHi--;
+            }
+
+            uint32_t ulSpan = ulCol[lHi] - ulCol[lLo];
+            bool bUp = ulDistance(lPos, ulCol[lLo]) <= ulDistance(lPos, ulCol[lHi]);
+            uint32_t ulOut = 0;
+            for (int i = 0; i < COLS; i++)
+            {
+                int lCol = bUp ? i : COLS - 1 - i;
+                for (uint32_t j = 0; j < ulDrops[lCol]; j++)
+                {
+                    pucOrder[ulOut++] = lCol;
+                }
+            }
+            return ulDistance(lPos, ulCol[bUp ? lLo : lHi]) + ulSpan;
+        }
+
+    private:
+        uint32_t ulCol[COLS];
+        int32_t lPos;
+};
+
+/// The gantry MotorTask_t moves, GameTask_t and the terminal share it
+inline Gantry_t& xGantry()
+{
+    static Gantry_t xInstance;
+    return xInstance;
+}
+
+} // namespace motor
+} // namespace team9
+
+#endif
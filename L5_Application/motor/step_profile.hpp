@@ -0,0 +1,167 @@
+#ifndef MOTOR_STEP_PROFILE_HPP
+#define MOTOR_STEP_PROFILE_HPP
+
+#include <math.h>
+#include <stdint.h>
+
+namespace team9
+{
+namespace motor
+{
+
+/**
+ * Trapezoidal velocity profile for a stepper, one step period at a time:
+ * ramp up at a constant acceleration, cruise at the top rate, ramp down in
+ * the mirror image of the way up.  A move too short to reach the top rate
+ * turns around halfway.
+ *
+ * Periods are in counter ticks, from David Austin's recurrence ("Generate
+ * stepper-motor speed profiles in real time", 2005):
+ *      c0 = 0.676 * f * sqrt(2 / a),   c(n) = c(n-1) - 2 c(n-1) / (4n + 1)
+ * with n counting down through negatives on the way down.  ulNextTicks()
+ * is integer only, one divide a step, so it runs in the step interrupt;
+ * the floats are in vSetRates() and ulMoveMs(), which run in a task.
+ */
+class StepProfile_t
+{
+    public:
+        StepProfile_t() :
+            ulFirstQ8(0),
+            ulMinQ8(0),
+            xMaxHz(0.0f),
+            xAccel(0.0f),
+            ulPeriodQ8(0),
+            lN(0),
+            ulLeft(0),
+            ulDone(0),
+            ulAccelSteps(0),
+            eRamp(UP)
+        {}
+
+        /**
+         * @param ulTickHz  what the periods count, the MCPWM's PCLK
+         * @param xMaxHz_arg  top rate, steps per second
+         * @param xAccel_arg  steps per second squared
+         */
+        void vSetRates(uint32_t ulTickHz, float xMaxHz_arg, float xAccel_arg)
+        {
+            xMaxHz = xMaxHz_arg;
+            xAccel = xAccel_arg;
+            ulMinQ8 = (uint32_t)(256.0f * ulTickHz / xMaxHz);
+            ulFirstQ8 = (uint32_t)(256.0f * 0.676f * ulTickHz * sqrtf(2.0f / xAccel));
+            if (ulFirstQ8 < ulMinQ8)
+            {
+                ulFirstQ8 = ulMinQ8; // the top rate is slow enough to start at
+            }
+        }
+
+        void vStart(uint32_t ulSteps)
+        {
+            ulLeft = ulSteps;
+            ulDone = 0;
+            ulAccelSteps = 0;
+            ulPeriodQ8 = ulFirstQ8;
+            lN = 0;
+            eRamp = (ulFirstQ8 > ulMinQ8) ? UP : CRUISE;
+        }
+
+        /// @returns the ticks of the next step, 0 once every step is given out
+        uint32_t ulNextTicks()
+        {
+            if (!ulLeft)
+            {
+                return 0;
+            }
+            uint32_t ulTicks = ulPeriodQ8 >> 8;
+            ulLeft--;
+            ulDone++;
+            if (!ulLeft)
+            {
+                return ulTicks;
+            }
+
+            switch (eRamp)
+            {
+                case UP:
+                    if (ulLeft <= ulDone)
+                    {
+                        vStartDown();
+                        break;
+                    }
+                    lN++;
+                    ulPeriodQ8 -= 2 * ulPeriodQ8 / (4 * lN + 1);
+                    if (ulPeriodQ8 <= ulMinQ8)
+                    {
+                        ulPeriodQ8 = ulMinQ8;
+                        ulAccelSteps = ulDone;
+                        eRamp = CRUISE;
+                    }
+                    break;
+                case CRUISE:
+                    if (ulLeft <= ulAccelSteps)
+                    {
+                        vStartDown();
+                    }
+                    break;
+                case DOWN:
+                    vStepDown();
+                    break;
+            }
+            return ulTicks;
+        }
+
+        uint32_t ulStepsLeft() const
+        {
+            return ulLeft;
+        }
+
+        /// The ideal trapezoid's time for ulSteps, for planning around a move
+        uint32_t ulMoveMs(uint32_t ulSteps) const
+        {
+            return ulMoveMs(ulSteps, xMaxHz, xAccel);
+        }
+
+        static uint32_t ulMoveMs(uint32_t ulSteps, float xMaxHz_arg, float xAccel_arg)
+        {
+            float xRampSteps = xMaxHz_arg * xMaxHz_arg / (2.0f * xAccel_arg);
+            float xSeconds = (ulSteps >= 2.0f * xRampSteps) ?
+                    2.0f * xMaxHz_arg / xAccel_arg + (ulSteps - 2.0f * xRampSteps) / xMaxHz_arg :
+                    2.0f * sqrtf(ulSteps / xAccel_arg);
+            return (uint32_t)(1000.0f * xSeconds + 0.5f);
+        }
+
+    private:
+        enum Ramp_t {UP, CRUISE, DOWN};
+
+        uint32_t ulFirstQ8;  // c0, ticks with 8 fraction bits
+        uint32_t ulMinQ8;    // the top rate's period
+        float xMaxHz;
+        float xAccel;
+
+        uint32_t ulPeriodQ8; // of the next step
+        int32_t lN;
+        uint32_t ulLeft;
+        uint32_t ulDone;
+        uint32_t ulAccelSteps;
+        Ramp_t eRamp;
+
+        /// Slows down over the ulLeft steps left, retracing the way up
+        void vStartDown()
+        {
+            eRamp = DOWN;
+            lN = -(int32_t)ulLeft;
+            vStepDown();
+        }
+
+        /// c(n) with n < 0: c(n-1) * (1 + 2 / (4|n| - 1))
+        void vStepDown()
+        {
+            ulPeriodQ8 += 2 * ulPeriodQ8 / (4 * (uint32_t)(-lN) - 1);
+            lN++;
+        }
+};
+
+} // namespace motor
+} // namespace team9
+
+#endif
@@ -51,7 +51,8 @@ enum {
     shared_PixyQueueRX,
     shared_PixyResetQueueTX,
     shared_PixyResetQueueRX,
-    shared_KillPixyQueue
+    shared_KillPixyQueue,
+    shared_PixyVerifyTX    ///< Pixy_t sends the column of each bot chip the camera saw land
 };
 
 
@@ -158,6 +158,87 @@ CMD_HANDLER_FUNC(motorHandler)
     return true;
 }
 
+CMD_HANDLER_FUNC(gantryHandler)
+{
+    using namespace team9;
+
+    motor::Gantry_t& gantry = motor::xGantry();
+    char columns[motor::Gantry_t::STR_SIZE] = "";
+
+    if (cmdParams.beginsWith("set ")) {
+        cmdParams.eraseFirstWords(1);
+        const int col = atoi(cmdParams());
+        if (gantry.lPosition() <= 0 || !gantry.bSetCol(col, gantry.lPosition())) {
+            output.printf("Column %d can't be at %d steps, columns increase away from home\n",
+                          col, (int) gantry.lPosition());
+        }
+    }
+    else if (cmdParams.beginsWith("col ")) {
+        cmdParams.eraseFirstWords(1);
+        const int col = atoi(cmdParams());
+        if (col < 0 || col >= motor::Gantry_t::COLS) {
+            output.printf("No column %d\n", col);
+            return false;
+        }
+        MotorTask_t::vMoveTo(gantry.ulColSteps(col));
+        MotorTask_t::vWaitMove();
+    }
+    else if (cmdParams == "home") {
+        MotorTask_t::vMoveTo(0);
+        MotorTask_t::vWaitMove();
+    }
+    else if (cmdParams == "zero") {
+        gantry.vZero();
+    }
+    else if (cmdParams == "default") {
+        gantry.vSetDefaults();
+    }
+    else if (cmdParams == "save") {
+        gantry.vStr(columns, sizeof(columns));
+        if (FR_OK != Storage::write(MOTOR_COLUMNS_FILE, columns, strlen(columns), 0)) {
+            output.printf("Failed to write %s\n", MOTOR_COLUMNS_FILE);
+        }
+        else {
+            output.printf("Saved to %s\n", MOTOR_COLUMNS_FILE);
+        }
+        return true;
+    }
+    else if (cmdParams.beginsWith("plan ")) {
+        cmdParams.eraseFirstWords(1);
+        uint8_t cols[32];
+        uint8_t order[32];
+        uint32_t count = 0;
+        const char *p = cmdParams();
+        char *end = NULL;
+        for (long col = strtol(p, &end, 10); end != p && count < sizeof(cols); col = strtol(p, &end, 10)) {
+            if (col < 0 || col >= motor::Gantry_t::COLS) {
+                output.printf("No column %ld\n", col);
+                return false;
+            }
+            cols[count++] = col;
+            p = end;
+        }
+        const uint32_t steps = gantry.ulPlan(cols, count, order);
+
+        // Every leg ramps up and down on its own
+        uint32_t ms = 0;
+        int32_t at = gantry.lPosition();
+        output.printf("Order:");
+        for (uint32_t i = 0; i < count; i++) {
+            output.printf(" %u", order[i]);
+            ms += MotorTask_t::ulMoveMs(motor::Gantry_t::ulDistance(at, gantry.ulColSteps(order[i])));
+            at = gantry.ulColSteps(order[i]);
+        }
+        output.printf("\n%u steps, %u ms of travel\n", (unsigned) steps, (unsigned) ms);
+        return true;
+    }
+
+    gantry.vStr(columns, sizeof(columns));
+    output.printf("Columns: %s\n", columns);
+    output.printf("At %d steps, column %d\n", (int) gantry.lPosition(), gantry.lColAt());
+    return true;
+}
+
 CMD_HANDLER_FUNC(pixyHandler)
 {
     char *opStr = NULL;
@@ -269,6 +350,12 @@ CMD_HANDLER_FUNC(taskListHandler)
     output.printf("OOPS, I can't do this for you.  Please set configUSE_TRACE_FACILITY to 1 at FreeRTOSConfig.h\n");
 #endif
 
+    /* What the Pixy task's debug output has cost so far */
+    const team9::pixy::Trace_t::Stats_t& trace = team9::pixy::xTrace().xGetStats();
+    output.printf("Pixy trace: %u lines, %u bytes, %u repeats dropped, %u truncated, %u us\n",
+                  (unsigned) trace.ulLines, (unsigned) trace.ulBytes, (unsigned) trace.ulSuppressed,
+                  (unsigned) trace.ulTruncated, (unsigned) trace.ullUs);
+
     return true;
 }
 
@@ -380,13 +467,63 @@ CMD_HANDLER_FUNC(logHandler)
     }
     else if (cmdParams == "status") {
         output.printf("Blocked calls  : %u\n", logger_get_blocked_call_count());
-        output.printf("Queue watermark: %u\n", logger_get_num_buffers_watermark());
+        output.printf("Ring watermark : %u/%u bytes\n", logger_get_ring_watermark(), FILE_LOGGER_RING_SIZE);
         output.printf("Highest file write time: %ums\n", logger_get_highest_file_write_time_ms());
         output.printf("Call counts    : %u dgb %u info %u warn %u err\n",
                       logger_get_logged_call_count(log_debug),
                       logger_get_logged_call_count(log_info),
                       logger_get_logged_call_count(log_warn),
                       logger_get_logged_call_count(log_error));
+        output.printf("Dropped calls  : %u dbg %u info %u warn %u err, %u dbg sampled out\n",
+                      logger_get_suppressed_call_count(log_debug),
+                      logger_get_suppressed_call_count(log_info),
+                      logger_get_suppressed_call_count(log_warn),
+                      logger_get_suppressed_call_count(log_error),
+                      logger_get_sampled_call_count());
+
+        logger_limited_t limited[FILE_LOGGER_LIMIT_SITES];
+        uint32_t limitedCount = logger_get_limited(limited, FILE_LOGGER_LIMIT_SITES, false);
+        for (uint32_t i = 0; i < limitedCount; i++) {
+            output.printf("  %s:%u dropped %u\n", limited[i].name[0] ? limited[i].name : "raw",
+                          limited[i].line, (unsigned) limited[i].dropped);
+        }
+        limitedCount = logger_get_limited(limited, FILE_LOGGER_LIMIT_TASKS, true);
+        for (uint32_t i = 0; i < limitedCount; i++) {
+            output.printf("  task %s dropped %u\n", limited[i].name, (unsigned) limited[i].dropped);
+        }
+
+        const unsigned bytes = logger_get_bytes_written();
+        const unsigned ms = logger_get_file_write_time_ms();
+        output.printf("Written        : %u bytes in %ums, %u KB/s while writing\n",
+                      bytes, ms, ms ? (unsigned) (1000ULL * bytes / 1024 / ms) : 0);
+
+        logger_segment_t segments[FILE_LOGGER_SEGMENTS + 2];
+        const uint32_t count = logger_get_segments(segments, sizeof(segments) / sizeof(segments[0]));
+        for (uint32_t i = 0; i < count; i++) {
+            if (0 == segments[i].seq) {
+                output.printf("  %-20s %7u bytes\n", FILE_LOGGER_FILENAME, (unsigned) segments[i].size);
+                continue;
+            }
+
+            char name[32];
+            snprintf(name, sizeof(name), FILE_LOGGER_SEGMENT_FORMAT "%s", (unsigned) segments[i].seq,
+                     segments[i].compressed ? FILE_LOGGER_LZ_EXT : FILE_LOGGER_EXT);
+            output.printf("  %-20s %7u bytes", name, (unsigned) segments[i].size);
+            if (segments[i].compressed && segments[i].log_size) {
+                output.printf(", %u of log (%u%%)", (unsigned) segments[i].log_size,
+                              (unsigned) (100ULL * segments[i].size / segments[i].log_size));
+            }
+            else if (segments[i].compressed) {
+                output.printf(", being compressed");
+            }
+            output.printf("\n");
+        }
+    }
+    else if (cmdParams.beginsWith("sample ")) {
+        cmdParams.eraseFirstWords(1);
+        const int oneIn = ((int) cmdParams > 0) ? (int) cmdParams : 1;
+        logger_set_debug_sampling(oneIn);
+        output.printf("Logging 1 in %i debug messages of each call site\n", oneIn);
     }
     else if (cmdParams.beginsWith("raw")) {
         cmdParams.eraseFirstWords(1);
@@ -417,6 +554,56 @@ CMD_HANDLER_FUNC(logHandler)
     return true;
 }
 
+CMD_HANDLER_FUNC(traceHandler)
+{
+    team9::pixy::EventTrace_t& events = team9::pixy::xEvents();
+
+    if (cmdParams == "dump") {
+        // One "EV <32 hex digits>" line per 16 bytes, pixy_trace_decode reads a capture of them
+        const char * const hex = "0123456789abcdef";
+        const uint32_t count = events.ulDump([&output, hex](const void *pData, uint32_t bytes) {
+            const uint8_t *p = (const uint8_t*) pData;
+            for (uint32_t i = 0; i + 16 <= bytes; i += 16) {
+                char line[3 + 32 + 1] = "EV ";
+                for (int j = 0; j < 16; j++) {
+                    line[3 + 2*j]     = hex[p[i + j] >> 4];
+                    line[3 + 2*j + 1] = hex[p[i + j] & 0xF];
+                }
+                line[sizeof(line) - 1] = '\0';
+                output.putline(line);
+            }
+            return true;
+        });
+        output.printf("%u events\n", (unsigned) count);
+    }
+    else if (cmdParams.beginsWith("save ")) {
+        cmdParams.eraseFirstWords(1);
+        FIL file;
+        if (FR_OK != f_open(&file, cmdParams(), FA_CREATE_ALWAYS | FA_WRITE)) {
+            output.printf("Failed to open: %s\n", cmdParams());
+        }
+        else {
+            const uint32_t count = events.ulDump([&file](const void *pData, uint32_t bytes) {
+                UINT written = 0;
+                return FR_OK == f_write(&file, pData, bytes, &written) && written == bytes;
+            });
+            f_close(&file);
+            output.printf("Saved %u events to %s\n", (unsigned) count, cmdParams());
+        }
+    }
+    else if (cmdParams == "clear") {
+        events.vClear();
+        output.putline("Events cleared");
+    }
+    else {
+        const uint32_t oldest = events.ulOldest();
+        const uint32_t logged = events.ulLogged();
+        output.printf("%u events logged since boot, %u kept of %u\n", (unsigned) logged,
+                      (unsigned) (logged - oldest), (unsigned) team9::pixy::EventTrace_t::CAPACITY);
+    }
+    return true;
+}
+
 CMD_HANDLER_FUNC(cpHandler)
 {
     char *srcFile = NULL;
@@ -2,16 +2,44 @@
 
 #include "tasks.hpp"
 #include "utilities.h"
+#include "lpc_sys.h"
 #include "shared_handles.h"
+#include "storage.hpp"
 
 #include "pixy/common.hpp"
+#include "pixy/common/event_trace.hpp"
+#include "pixy/common/state_table.hpp"
+#include "connect_four/config.hpp"
+#if GAME_LINKED_OPENING_BOOK
+#include "connect_four/opening_book_data.hpp"
+#endif
 
 namespace team9
 {
 
+/// Indexed by eGame_t
+static constexpr pixy::NameTable_t<eGame_t, GAME_COUNT> xGameNames = {{
+    "DEBUG",
+    "COMPETE",
+    "RESET"
+}};
+static_assert(xGameNames.bComplete(), "every eGame_t needs a name");
+
+static bool bReadOpeningBook(void* pData, uint32_t ulBytes, uint32_t ulOffset)
+{
+    unsigned int ulRead = 0;
+    return FR_OK == Storage::read(GAME_OPENING_BOOK_FILE, pData, ulBytes, ulOffset, &ulRead) &&
+           ulRead == ulBytes;
+}
+
+// The solver recurses once per ply, so the stack is sized for a mid-game search
 GameTask_t::GameTask_t (uint8_t ucPriority) :
-		scheduler_task("ServoSlave", 512*8, ucPriority)
+		scheduler_task("ServoSlave", 512*16, ucPriority),
+		xSolver(GAME_TT_LOG2_ENTRIES),
+		bHostTimedOut(false)
 {
+    xSolver.vSetClock(sys_get_uptime_ms);
+
     QueueHandle_t xQServoHandle = xQueueCreate(1, sizeof(int));
     QueueHandle_t xQGameHandleTX = xQueueCreate(1, sizeof(bool));
     QueueHandle_t xQGameHandleRX = xQueueCreate(1, sizeof(GameCommand_t));
@@ -24,74 +52,255 @@ GameTask_t::GameTask_t (uint8_t ucPriority) :
     xServo->set(xClosedPWM);
 }
 
-void GameTask_t::vRunServo(int lDropCount)
+bool GameTask_t::taskEntry(void)
+{
+    // The file system is mounted by now, a missing book only costs search time
+#if GAME_LINKED_OPENING_BOOK
+    bool bBook = xBook.bAttach(ucOpeningBookData, sizeof(ucOpeningBookData));
+#else
+    FILINFO xInfo = {};
+    bool bBook = FR_OK == f_stat(GAME_OPENING_BOOK_FILE, &xInfo) &&
+                 xBook.bAttach(bReadOpeningBook, xInfo.fsize);
+#endif
+    printf("Opening book: %u entries%s\n", (unsigned)xBook.ulSize(), bBook ? "" : " (not found)");
+
+    char cColumns[motor::Gantry_t::STR_SIZE] = "";
+    bool bColumns = FR_OK == Storage::read(MOTOR_COLUMNS_FILE, cColumns, sizeof(cColumns) - 1, 0) &&
+                    motor::xGantry().bParse(cColumns);
+    motor::xGantry().vStr(cColumns, sizeof(cColumns));
+    printf("Gantry columns: %s%s\n", cColumns, bColumns ? "" : " (not calibrated)");
+    return true;
+}
+
+/**
+ * Opens the gate until the camera sees the chip land in ucCol (Pixy_t sends
+ * the column on shared_PixyVerifyTX) or GAME_SERVO_OPEN_MS passes, then
+ * gives it GAME_SERVO_CLOSE_MS to shut.
+ * @returns how long the gate was open for the last chip
+ */
+uint32_t GameTask_t::ulRunServo(int lDropCount, uint8_t ucCol)
 {
+    pixy::xEvents().vLog(pixy::EV_GAME_SERVO, lDropCount);
+    QueueHandle_t xVerifyQueue = getSharedObject(shared_PixyVerifyTX);
+    uint32_t ulOpenMs = 0;
     for(int lI = 0; lI < lDropCount; ++lI)
     {
+        uint64_t ullOpened = sys_get_uptime_ms();
         xServo->set(xOpenPWM);
-        vTaskDelayMs(1000*0.65);
+        int lSeenCol = -1;
+        while (lSeenCol != ucCol)
+        {
+            uint32_t ulWaitedMs = sys_get_uptime_ms() - ullOpened;
+            if (ulWaitedMs >= GAME_SERVO_OPEN_MS ||
+                !xQueueReceive(xVerifyQueue, &lSeenCol, OS_MS(GAME_SERVO_OPEN_MS - ulWaitedMs)))
+            {
+                break;
+            }
+        }
         xServo->set(xClosedPWM);
-        vTaskDelayMs(1000*1);
+        ulOpenMs = sys_get_uptime_ms() - ullOpened;
+        pixy::xEvents().vLog(pixy::EV_GAME_DROP, ucCol, ulOpenMs);
+        if (lSeenCol != ucCol)
+        {
+            printf("Chip not seen in col %u, gate closed after %u ms\n", ucCol, (unsigned)ulOpenMs);
+        }
+        vTaskDelayMs(GAME_SERVO_CLOSE_MS);
     }
+    return ulOpenMs;
 }
 
-void GameTask_t::vRunStepper(uint8_t ucInsertCol)
+/**
+ * One robot move, from wherever the last one left the gantry: home, or
+ * over its column unless GAME_PARK_HOME.  Pixy_t is told about the chip as
+ * the gate opens and the gate shuts as soon as the camera sees it land.
+ * With GAME_PARK_HOME the solver ponders the human's reply on the way
+ * home, run() ponders it anyway until the human moves.  Pixy_t holds the
+ * human's next move back until run() asks for it.
+ * @param ullHumanMs  when the human's move came in
+ * @param ullMoveMs   when the robot's move was picked
+ */
+void GameTask_t::vRunStepper(uint8_t ucInsertCol, uint64_t ullHumanMs, uint64_t ullMoveMs)
 {
-    xMotorCommand_t xMotorCommand;
-    QueueHandle_t xMotorQueueRX;
-    QueueHandle_t xMotorQueueTX;
-
-    bool bInsert;
-    float xRotations = (0.4833 * (ucInsertCol) + 1.6);
+    PixyCmd_t xPixyCmd;
 
-    // Move over Column from home
-    xMotorQueueRX = getSharedObject(shared_MotorQueueRX);
-    xMotorCommand.Load(eDirection_t::LEFT, xRotations);
-    xQueueSend(xMotorQueueRX, &xMotorCommand, portMAX_DELAY);
+    // Move over the column
+    MotorTask_t::vMoveTo(motor::xGantry().ulColSteps(ucInsertCol));
+    MotorTask_t::vWaitMove();
+    uint64_t ullOverMs = sys_get_uptime_ms();
 
-    // Wait till we're over the column.
-    xMotorQueueTX = getSharedObject(shared_MotorQueueTX);
-    xQueueReceive(xMotorQueueTX, &bInsert, portMAX_DELAY);
+    // Informing Pixy of robot's chip insertion, it watches the column from now on
+    xQueueReset(getSharedObject(shared_PixyVerifyTX));
+    xPixyCmd.bReset = false;
+    xPixyCmd.lColor = pixy::ChipColor_t::RED;
+    xPixyCmd.lColumn = ucInsertCol;
+    xQueueSend(getSharedObject(shared_PixyQueueRX), &xPixyCmd, portMAX_DELAY);
 
     // Drop the chip into the board.
-    this->vRunServo(1);
+    uint32_t ulOpenMs = this->ulRunServo(1, ucInsertCol);
+
+    uint64_t ullParkMs = sys_get_uptime_ms();
+    uint32_t ulPonderMs = 0;
+    if (GAME_PARK_HOME)
+    {
+        ulPonderMs = ulTravelMs(0);
+        MotorTask_t::vMoveTo(0);
+    }
+
+    // Ponder the human's reply for as long as the trip home takes
+    if (ulPonderMs)
+    {
+        vPonder(sys_get_uptime_ms() + ulPonderMs);
+    }
+
+    if (GAME_PARK_HOME)
+    {
+        MotorTask_t::vWaitMove();
+    }
+    uint64_t ullParkedMs = sys_get_uptime_ms();
+
+    uint32_t ulCycleMs = ullParkedMs - ullHumanMs;
+    pixy::xEvents().vLog(pixy::EV_GAME_CYCLE, ucInsertCol, ulCycleMs);
+    printf("Move cycle: col %u in %u ms (think %u, out %u, gate %u + %u, park %u)\n",
+           ucInsertCol, (unsigned)ulCycleMs, (unsigned)(ullMoveMs - ullHumanMs),
+           (unsigned)(ullOverMs - ullMoveMs), (unsigned)ulOpenMs, GAME_SERVO_CLOSE_MS,
+           (unsigned)(ullParkedMs - ullParkMs));
+}
+
+static bool bHumanMoved(void)
+{
+    return uxQueueMessagesWaiting(scheduler_task::getSharedObject(shared_PixyQueueTX)) > 0;
+}
+
+/**
+ * Searches the human's reply until ulDeadlineMs (0 for none) or until
+ * Pixy_t reports the human's move, the table keeps the results for
+ * ucOnboardMove().  Runs at Pixy_t's priority so the camera keeps up.
+ */
+void GameTask_t::vPonder(uint64_t ulDeadlineMs)
+{
+    if (!GAME_ONBOARD_AI || xPosition.bFull() || xPosition.bLastMoveWon())
+    {
+        return;
+    }
+    UBaseType_t uxPriority = uxTaskPriorityGet(NULL);
+    vTaskPrioritySet(NULL, PRIORITY_LOW);
+    xSolver.vSetStop(bHumanMoved);
+    uint64_t ulStart = sys_get_uptime_ms();
+    c4::Solver_t::Result_t xResult = xSolver.xSearch(xPosition, ulDeadlineMs);
+    xSolver.vSetStop(NULL);
+    vTaskPrioritySet(NULL, uxPriority);
+    printf("Pondered depth %u%s in %ums, expecting col %d\n", xResult.ulDepth,
+           xResult.bExact ? " (exact)" : "", (unsigned)(sys_get_uptime_ms() - ulStart), xResult.lBestCol);
+}
 
-    // Send the platform back home.
-    xMotorCommand.Load(eDirection_t::RIGHT, xRotations);
-    xQueueSend(xMotorQueueRX, &xMotorCommand, portMAX_DELAY);
+/// @returns how long the gantry takes from where it is now to lToSteps from home
+uint32_t GameTask_t::ulTravelMs(int32_t lToSteps)
+{
+    return MotorTask_t::ulMoveMs(motor::Gantry_t::ulDistance(motor::xGantry().lPosition(), lToSteps));
+}
 
-    // Wait for Home
-    xQueueReceive(xMotorQueueTX, &bInsert, portMAX_DELAY);
+void GameTask_t::vTrackMove(int lCol)
+{
+    // A full board, a finished game or an impossible move means a new game
+    if (xPosition.bFull() || xPosition.bLastMoveWon() ||
+        lCol < 0 || lCol >= c4::Position_t::WIDTH || !xPosition.bCanPlay(lCol))
+    {
+        printf("Starting a new game position\n");
+        xPosition = c4::Position_t();
+    }
+    if (lCol >= 0 && lCol < c4::Position_t::WIDTH)
+    {
+        xPosition.vPlay(lCol);
+    }
+}
+
+/**
+ * Picks the robot's column.  Out of book, a shallow search guesses it and
+ * the gantry sets off for that column, the full search then thinks for as
+ * long as the trip takes.  vRunStepper() goes on from wherever it got to.
+ */
+uint8_t GameTask_t::ucOnboardMove(void)
+{
+    int lBookCol = 0;
+    int lBookScore = 0;
+    if (xBook.bLookup(xPosition, lBookCol, lBookScore))
+    {
+        printf("Book: col %d score %d\n", lBookCol, lBookScore);
+        return lBookCol;
+    }
+
+    uint64_t ulStart = sys_get_uptime_ms();
+    c4::Solver_t::Result_t xResult = xSolver.xSearch(xPosition, 0, GAME_GUESS_DEPTH);
+    if (xResult.lBestCol < 0 || xResult.bExact)
+    {
+        printf("Solver: col %d score %d%s depth %u\n", xResult.lBestCol, xResult.lScore,
+               xResult.bExact ? " (exact)" : "", xResult.ulDepth);
+        return (xResult.lBestCol < 0) ? 0 : xResult.lBestCol;
+    }
+
+    int32_t lGuessSteps = motor::xGantry().ulColSteps(xResult.lBestCol);
+    uint32_t ulThinkMs = ulTravelMs(lGuessSteps);
+    if (ulThinkMs < GAME_MIN_THINK_MS)
+    {
+        ulThinkMs = GAME_MIN_THINK_MS;
+    }
+    MotorTask_t::vMoveTo(lGuessSteps);
+    int lGuessCol = xResult.lBestCol;
+    xResult = xSolver.xSearch(xPosition, ulStart + ulThinkMs);
+    MotorTask_t::vWaitMove();
+
+    printf("Solver: col %d (guessed %d) score %d%s depth %u nodes %u in %ums of %ums\n",
+           xResult.lBestCol, lGuessCol, xResult.lScore, xResult.bExact ? " (exact)" : "",
+           xResult.ulDepth, (unsigned)xResult.ulNodes,
+           (unsigned)(sys_get_uptime_ms() - ulStart), (unsigned)ulThinkMs);
+    return (xResult.lBestCol < 0) ? lGuessCol : xResult.lBestCol;
 }
 
 bool GameTask_t::run(void *p)
 {
     GameCommand_t xGameCommand;
-    PixyCmd_t xPixyCmd;
 
     QueueHandle_t xPixyTXHandle;
-    QueueHandle_t xPixyRXHandle;
 
     int lHumanCol = 0;
-    xPixyCmd.bReset = false;
 
     printf("Waiting for human chip insertion\n");
 
+    // Pixy_t reports the human's move, and so lets the host answer it, only from here on
+    bool bReady = true;
+    xQueueOverwrite(getSharedObject(shared_GameQueueTX), &bReady);
+
+    // The human's turn is the longest wait of the game, think through it
+    vPonder(0);
+
     xPixyTXHandle = scheduler_task::getSharedObject(shared_PixyQueueTX);
     xQueueReceive(xPixyTXHandle, &lHumanCol, portMAX_DELAY);
+    uint64_t ullHumanMs = sys_get_uptime_ms();
+    pixy::xEvents().vLog(pixy::EV_GAME_HUMAN, lHumanCol);
+    vTrackMove(lHumanCol);
 
-    if (xQueueReceive(getSharedObject(shared_GameQueueRX), &xGameCommand,
-    				  portMAX_DELAY))
+    // Drop the late answer to the turn that timed out, if it came in since
+    if (bHostTimedOut)
     {
-        this->vRunStepper(xGameCommand.ucCol);
+        xQueueReset(getSharedObject(shared_GameQueueRX));
+        bHostTimedOut = false;
     }
 
-    // Informing Pixy of robot's chip insertion
-    xPixyCmd.lColor = pixy::ChipColor_t::RED;
-    xPixyCmd.lColumn = xGameCommand.ucCol;
-
-    xPixyRXHandle = scheduler_task::getSharedObject(shared_PixyQueueRX);
-    xQueueSend(xPixyRXHandle, &xPixyCmd, portMAX_DELAY);
+    if (GAME_ONBOARD_AI)
+    {
+        xGameCommand.Load(eGame_t::COMPETE, ucOnboardMove());
+    }
+    else if (!xQueueReceive(getSharedObject(shared_GameQueueRX), &xGameCommand,
+    				        OS_MS(GAME_HOST_AI_TIMEOUT_MS)))
+    {
+        printf("Host AI timed out, using the on-board solver\n");
+        bHostTimedOut = true;
+        xGameCommand.Load(eGame_t::COMPETE, ucOnboardMove());
+    }
+    pixy::xEvents().vLog(pixy::EV_GAME_MOVE, xGameCommand.eGame, xGameCommand.ucCol);
+    printf("%s move: col %u\n", xGameNames.pcName(xGameCommand.eGame), xGameCommand.ucCol);
+    vTrackMove(xGameCommand.ucCol);
+    this->vRunStepper(xGameCommand.ucCol, ullHumanMs, sys_get_uptime_ms());
 
     return true;
 }
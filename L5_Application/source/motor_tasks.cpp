@@ -1,13 +1,26 @@
 #include "tasks.hpp"
 #include "printf_lib.h"
 #include "utilities.h"
+#include "lpc_isr.h"
 #include "shared_handles.h" // shared_MotorQueue
 #include "pixy/common.hpp"
+#include "pixy/common/event_trace.hpp"
 #include <stdio.h>
 
 namespace team9
 {
 
+/// MCPWM channel 0's limit interrupt, one per step
+static const uint32_t ulLimit0 = (1 << 0);
+
+/// The MotorTask_t the MCPWM interrupt counts steps for
+static MotorTask_t* pxMotorTask = nullptr;
+
+static void vMotorISR(void)
+{
+    pxMotorTask->vStepISR();
+}
+
 MotorTask_t::MotorTask_t (uint8_t ucPriority) :
         scheduler_task("MotorSlave", 512 * 8, ucPriority),
         xPWM_DIR(P1_20), xPWM_EN(P1_23), ulSysClk(48000000)
@@ -16,10 +29,39 @@ MotorTask_t::MotorTask_t (uint8_t ucPriority) :
     QueueHandle_t xQueueHandleTX = xQueueCreate(1, sizeof(bool));
     addSharedObject(shared_MotorQueueRX, xQHandleRX);
     addSharedObject(shared_MotorQueueTX, xQueueHandleTX);
+    xMoveDone = xSemaphoreCreateBinary();
+    ulStepsDone = 0;
+    ulStepsTarget = 0;
     ulSysClk = sys_get_cpu_clock();
+    xProfile.vSetRates(ulSysClk / lPclkDivider,
+                       MOTOR_MAX_RPS * lStepsPerRot, MOTOR_ACCEL_RPS2 * lStepsPerRot);
     vInitGPIO();
     vInitPWM();
-    ulSetFrequency(xMotorFreq);
+    pxMotorTask = this;
+    isr_register(MCPWM_IRQn, vMotorISR);
+    NVIC_EnableIRQ(MCPWM_IRQn);
+}
+
+uint32_t MotorTask_t::ulMoveMs(uint32_t ulSteps)
+{
+    return motor::StepProfile_t::ulMoveMs(ulSteps,
+                                          MOTOR_MAX_RPS * MOTOR_STEPS_PER_ROT,
+                                          MOTOR_ACCEL_RPS2 * MOTOR_STEPS_PER_ROT);
+}
+
+void MotorTask_t::vMoveTo(int32_t lSteps)
+{
+    xMotorCommand_t xMotorCommand;
+    int32_t lDelta = lSteps - motor::xGantry().lPosition();
+    xMotorCommand.LoadSteps(lDelta >= 0 ? eDirection_t::LEFT : eDirection_t::RIGHT,
+                            lDelta >= 0 ? lDelta : -lDelta);
+    xQueueSend(getSharedObject(shared_MotorQueueRX), &xMotorCommand, portMAX_DELAY);
+}
+
+void MotorTask_t::vWaitMove()
+{
+    bool bDone;
+    xQueueReceive(getSharedObject(shared_MotorQueueTX), &bDone, portMAX_DELAY);
 }
 
 void MotorTask_t::vInitGPIO()
@@ -43,6 +85,8 @@ void MotorTask_t::vInitPWM()
     LPC_PINCON->PINSEL3 &= ~(3 << 6);     // Clear p1.19 MC0A0
     LPC_PINCON->PINSEL3 |= (1 << 6);      // Set p1.19 MC0A0
     LPC_MCPWM->MCCON_CLR = 0xE01F1F0F;    // Clear MCCON register
+    LPC_MCPWM->MCINTEN_CLR = 0xFFFFFFFF;  // Interrupt only while moving
+    LPC_MCPWM->MCINTFLAG_CLR = 0xFFFFFFFF;
 }
 
 bool MotorTask_t::run(void *p)
@@ -57,9 +101,10 @@ bool MotorTask_t::run(void *p)
         delay_ms(10);
         xPWM_DIR.set(xMotorCommandRX.eDirection == eDirection_t::LEFT ? true : false);
         delay_ms(10);
-        uint32_t ulCyclesPerStep = ulSetFrequency(xMotorFreq);
-        vStartCounter();
-        vPollEnd(ulCyclesPerStep, xMotorCommandRX);
+        bRunMove(xMotorCommandRX);
+        // The steps that ran, a timed out move included
+        motor::xGantry().vMovedBy(xMotorCommandRX.eDirection == eDirection_t::LEFT ?
+                                  (int32_t)ulStepsDone : -(int32_t)ulStepsDone);
         xPWM_DIR.setLow();
         xPWM_EN.setLow();
         // Indicate we've finished.
@@ -68,44 +113,64 @@ bool MotorTask_t::run(void *p)
     return true;
 }
 
-uint32_t MotorTask_t::ulSetFrequency(float ulFreqHz)
+bool MotorTask_t::bRunMove(xMotorCommand_t& xMotorCommand)
 {
-    float ulCntFreq = (1.0 * ulSysClk) / lPclkDivider;  // 6MHz iff 48MHz / 8
-    uint32_t ulLimitReg = ulCntFreq / (lStepsPerRot * ulFreqHz) + 0.5;
-    LPC_MCPWM->MCPER0 = ulLimitReg;                 // Setting Limit register
-    LPC_MCPWM->MCPW0 = ulLimitReg / 2.0 + 0.5;      // Setting Match register
-    return ulLimitReg;
+    // Steps are counted by vStepISR(), which also loads every next step's
+    // period from xProfile.  MCPER0 and MCPW0 are shadowed, a write lands
+    // at the end of the running period, so the ISR stays one step ahead.
+    ulStepsTarget = xMotorCommand.ulSteps;
+    ulStepsDone = 0;
+    pixy::xEvents().vLog(pixy::EV_MOTOR_START, (uint16_t)xMotorCommand.eDirection, ulStepsTarget);
+
+    xProfile.vStart(ulStepsTarget);
+    uint32_t ulTicks = xProfile.ulNextTicks();
+    if (!ulTicks)
+    {
+        pixy::xEvents().vLog(pixy::EV_MOTOR_END, (uint16_t)xMotorCommand.eDirection, 0);
+        return true;
+    }
+    xSemaphoreTake(xMoveDone, 0);           // Left over from a timed out move
+    vLoadPeriod(ulTicks);                   // Stopped: straight to the counter
+    vStartCounter();
+    vLoadPeriod(xProfile.ulNextTicks());    // The second step's, shadowed
+    LPC_MCPWM->MCINTFLAG_CLR = ulLimit0;
+    LPC_MCPWM->MCINTEN_SET = ulLimit0;
+
+    uint32_t ulTimeoutMs = 2 * xProfile.ulMoveMs(ulStepsTarget) + 1000;
+    bool bDone = xSemaphoreTake(xMoveDone, OS_MS(ulTimeoutMs));
+    if (!bDone)
+    {
+        LPC_MCPWM->MCINTEN_CLR = ulLimit0;
+        vStopCounter();
+        printf("Motor: %u of %u steps in %u ms\n",
+               (unsigned)ulStepsDone, (unsigned)ulStepsTarget, (unsigned)ulTimeoutMs);
+    }
+    pixy::xEvents().vLog(pixy::EV_MOTOR_END, (uint16_t)xMotorCommand.eDirection, ulStepsDone);
+    return bDone;
 }
 
-void MotorTask_t::vPollEnd(uint32_t ulCyclesPerStep,
-                           xMotorCommand_t& xMotorCommand)
+void MotorTask_t::vStepISR()
 {
-    // This method triggers the stop condition for the motor controller.
-    // Using upper and lower 10% of max counter value to trigger events.
-    bool bSeenUpperThresh = false;
-    uint32_t ulUpperThresh = ulCyclesPerStep * 0.9;
-    uint32_t ulLowerThresh = ulCyclesPerStep * 0.1;
-    uint32_t ulStepCount = 0;
-    uint32_t ulStepMax = lStepsPerRot * xMotorCommand.xRotations;
-
-    while(1 == 1)
+    LPC_MCPWM->MCINTFLAG_CLR = ulLimit0;
+    if (++ulStepsDone >= ulStepsTarget)
     {
-        if(LPC_MCPWM->MCTIM0 >= ulUpperThresh)
-        {
-            bSeenUpperThresh = true;
-        }
-        if(bSeenUpperThresh && LPC_MCPWM->MCTIM0 <= ulLowerThresh)
-        {
-            bSeenUpperThresh = false;
-            if (ulStepCount > ulStepMax)
-            {
-                vStopCounter();
-                break;
-            }
-            ulStepCount++;
-        }
+        LPC_MCPWM->MCINTEN_CLR = ulLimit0;
+        vStopCounter();
+        long lWoken = 0;
+        xSemaphoreGiveFromISR(xMoveDone, &lWoken);
+        portEND_SWITCHING_ISR(lWoken);
+        return;
+    }
+    vLoadPeriod(xProfile.ulNextTicks());
+}
+
+void MotorTask_t::vLoadPeriod(uint32_t ulTicks)
+{
+    if (ulTicks)                            // 0 past the last step, keep the period
+    {
+        LPC_MCPWM->MCPER0 = ulTicks;        // Setting Limit register
+        LPC_MCPWM->MCPW0 = ulTicks / 2;     // Setting Match register
     }
-    xPWM_DIR.setLow();
 }
 
 void MotorTask_t::vStartCounter()
@@ -73,6 +73,14 @@ bool terminalTask::taskEntry()
 
     // Bluetooth handler
     cp.addHandler(motorHandler, "motor", "Specify direction to spin and number of revolutions. Ex: motor left 2.5");
+    cp.addHandler(gantryHandler, "gantry", "'gantry'            : print the column table and where the gantry is\n"
+                                           "'gantry col <col>'  : move over a column\n"
+                                           "'gantry home'       : move home\n"
+                                           "'gantry set <col>'  : the gantry is over <col>, after jogging with 'motor'\n"
+                                           "'gantry save'       : write the table to /gantry.calib\n"
+                                           "'gantry zero'       : the gantry is home, after moving it by hand\n"
+                                           "'gantry default'    : back to the uncalibrated table\n"
+                                           "'gantry plan 6 0 3' : order drops for the least travel");
     cp.addHandler(gameHandler,  "gameplay", "Specify which column to insert into and whether we're in debug or competition mode.");
     cp.addHandler(pixyHandler,  "pixy", "'pixy insert 3 (inserts chip in col 3");
 
@@ -110,10 +118,16 @@ bool terminalTask::taskEntry()
     cp.addHandler(rebootHandler,   "reboot",   "Reboots the system");
     cp.addHandler(logHandler,      "log",      "'log <hello>': log an info message\n"
                                                "'log flush'  : flush the logs\n"
-                                               "' log status': get status of the logger\n"
+                                               "' log status': get status of the logger, its files, write rate and dropped calls\n"
+                                               "'log sample <n>': log 1 in <n> debug messages of each call site\n"
                                                "'log enableprint debug/info/warn/error' : Enables logger calls to printf\n"
                                                "'log disableprint debug/info/warn/error': Disables logger calls to printf\n"
                                                );
+    cp.addHandler(traceHandler,    "trace",    "'trace'             : count the events in the binary trace\n"
+                                               "'trace dump'        : print them as hex, for pixy_trace_decode\n"
+                                               "'trace save <file>' : save them to a file, e.g. 'trace save 1:trace.bin'\n"
+                                               "'trace clear'       : drop them\n"
+                                               );
     cp.addHandler(learnIrHandler,  "learn",    "Begin to learn IR codes for numbers 0-9");
     cp.addHandler(wirelessHandler, "wireless", "Use 'wireless' to see the nested commands");
 
@@ -37,6 +37,13 @@
 #include "lpc_pwm.hpp"
 #include "pixy.hpp"
 
+#include "connect_four/opening_book.hpp"
+#include "motor/config.hpp"
+#include "motor/gantry.hpp"
+#include "motor/step_profile.hpp"
+#include "connect_four/position.hpp"
+#include "connect_four/solver.hpp"
+
 class terminalTask : public scheduler_task
 {
     public:
@@ -69,21 +76,25 @@ class terminalTask : public scheduler_task
 namespace team9
 {
 
-enum eGame_t {DEBUG, COMPETE, RESET};
+enum eGame_t {DEBUG, COMPETE, RESET, GAME_COUNT};
 enum eDirection_t {LEFT, RIGHT};
 
+/// LEFT is away from home
 struct xMotorCommand_t
 {
-    xMotorCommand_t(void) : eDirection(LEFT), xRotations(0.0) {}
-    xMotorCommand_t(eDirection_t xDirection_arg, float& xRotations_arg) :
-        eDirection(LEFT), xRotations(xRotations_arg) {}
+    xMotorCommand_t(void) : eDirection(LEFT), ulSteps(0) {}
     void Load(eDirection_t eDirection_arg, float xRotation_arg)
     {
         eDirection = eDirection_arg;
-        xRotations = xRotation_arg;
+        ulSteps = MOTOR_STEPS_PER_ROT * xRotation_arg;
+    }
+    void LoadSteps(eDirection_t eDirection_arg, uint32_t ulSteps_arg)
+    {
+        eDirection = eDirection_arg;
+        ulSteps = ulSteps_arg;
     }
     eDirection_t eDirection;
-    float xRotations;
+    uint32_t ulSteps;
 };
 
 struct GameCommand_t
@@ -102,6 +113,7 @@ class GameTask_t : public scheduler_task
 {
     public:
         GameTask_t (uint8_t ucPriority);
+        bool taskEntry(void);
         bool run(void *p);
 
     private:
@@ -109,8 +121,17 @@ class GameTask_t : public scheduler_task
         //PWM my_servo(PWM::pwm2, 50);
         const float xClosedPWM = 5.5;
         const float xOpenPWM = 11.5;
-        void vRunServo(int lDropCount);
-        void vRunStepper(uint8_t ucInsertCol);
+        uint32_t ulRunServo(int lDropCount, uint8_t ucCol);
+        void vRunStepper(uint8_t ucInsertCol, uint64_t ullHumanMs, uint64_t ullMoveMs);
+        void vTrackMove(int lCol);
+        uint8_t ucOnboardMove(void);
+        void vPonder(uint64_t ulDeadlineMs);
+        static uint32_t ulTravelMs(int32_t lToSteps);
+
+        c4::Position_t xPosition;
+        c4::Solver_t xSolver;
+        c4::OpeningBook_t xBook;
+        bool bHostTimedOut;     ///< The last turn gave up on the host AI
 };
 
 class MotorTask_t : public scheduler_task
@@ -119,9 +140,21 @@ class MotorTask_t : public scheduler_task
 		MotorTask_t (uint8_t ucPriority);
 		bool run(void *p);
 
+        /// A gantry move's time, ramps included
+        static uint32_t ulMoveMs(uint32_t ulSteps);
+
+        /// Sends the gantry to lSteps from home (see motor::xGantry()), returns at once
+        static void vMoveTo(int32_t lSteps);
+
+        /// Waits for the move vMoveTo() or the "motor" command started
+        static void vWaitMove();
+
+        /// From the MCPWM interrupt, at the end of every step
+        void vStepISR();
+
 	private:
-		void vPollEnd(uint32_t ulLimitReg, xMotorCommand_t& xMotorCommand);
-        uint32_t ulSetFrequency(float ulFreqHz);
+        bool bRunMove(xMotorCommand_t& xMotorCommand);
+        void vLoadPeriod(uint32_t ulTicks);
 		void vInitPWM();
 		void vInitGPIO();
 		void vStopCounter();
@@ -130,9 +163,13 @@ class MotorTask_t : public scheduler_task
 		GPIO xPWM_DIR;
 		GPIO xPWM_EN;
         const int lPclkDivider = 8;
-        const int lStepsPerRot = 400;
+        const int lStepsPerRot = MOTOR_STEPS_PER_ROT;
         unsigned int ulSysClk;
-        float xMotorFreq = 1.0;
+
+        motor::StepProfile_t xProfile;
+        SemaphoreHandle_t xMoveDone;    ///< Given by vStepISR() after the last step
+        volatile uint32_t ulStepsDone;
+        uint32_t ulStepsTarget;
 };
 
 namespace pixy
@@ -143,16 +180,18 @@ class PixyTask_t : public scheduler_task
     public:
         PixyTask_t (uint8_t ucPriority) :
 				scheduler_task("pixy", 2048, ucPriority),
-				pPixy(new Pixy_t(CHIPS_AT_A_TIME, CHIPS_TO_CALIB, GREEN))
+				pPixy(new Pixy_t(CHIPS_AT_A_TIME, CHIPS_TO_CALIB, GREEN, pxBoardPixySource()))
 		{
             QueueHandle_t xQueueTXHandle = xQueueCreate(1, sizeof(int));
             QueueHandle_t xQueueRXHandle = xQueueCreate(1, sizeof(PixyCmd_t));
             QueueHandle_t xQueueResetTXHandle = xQueueCreate(1, sizeof(bool));
             QueueHandle_t xQueueResetRXHandle = xQueueCreate(1, sizeof(bool));
+            QueueHandle_t xQueueVerifyTXHandle = xQueueCreate(1, sizeof(int));
             addSharedObject(shared_PixyQueueTX, xQueueTXHandle);
             addSharedObject(shared_PixyQueueRX, xQueueRXHandle);
             addSharedObject(shared_PixyResetQueueTX, xQueueResetTXHandle);
             addSharedObject(shared_PixyResetQueueRX, xQueueResetRXHandle);
+            addSharedObject(shared_PixyVerifyTX, xQueueVerifyTXHandle);
             ssp1_set_max_clock(1);
 			delay_ms(128);
 			while(LPC_SSP1->SR & (1 << 4));
@@ -3,9 +3,11 @@
 
 - Matthew Carlis
 """
+import os
 import sys
 import copy
 import time
+import subprocess
 from game_socket import GameSocket
 #import random as rand
 
@@ -14,6 +16,11 @@ empty_row = '|-|-|-|-|-|-|-|'
 null_row = [0,0,0,0,0,0,0]
 
 GAME_STATES = {'earthquake': 3, 'human_player': 2, 'ai_player': 1}
+
+# Native bitboard solver built from tools/c4.cpp.  If it is missing we fall
+# back to the python minimax below.
+C4_ENGINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools', 'c4')
+C4_PROC = None
 """
 I am thinking we can represent the board like this
 0 if its empty and we can change the value to X or O
@@ -43,6 +50,8 @@ class GameBoard(object):
         if game_board is None:
             self.the_board = [self.row_gen(width) for row in range(init_height)]
             self.height_map = self.row_gen(width)
+            # Every column played so far, in order, for the native engine.
+            self.moves = []
             # Store each players longest sequence of connections
             self.players_heuristics = {}
             self.width = width
@@ -50,6 +59,7 @@ class GameBoard(object):
         else:
             self.the_board = copy.deepcopy(game_board.the_board)
             self.height_map = copy.deepcopy(game_board.height_map)
+            self.moves = list(game_board.moves)
             # Store each players longest sequence of connected moves.
             self.players_heuristics = copy.deepcopy(game_board.players_heuristics)
             self.width = game_board.width
@@ -91,6 +101,7 @@ class GameBoard(object):
         row_index = len(self.the_board) - col_index
         self.the_board[row_index][column_num] = value
         self.height_map[column_num] += 1
+        self.moves.append(column_num)
         heuristic = self.get_best_heuristic(value)
         return heuristic, True # Return the heuristic.
 
@@ -323,9 +334,35 @@ def human_player(node, state, player):
             invalid = True
     return start_slot-1
 
+def engine_move(moves):
+    """ Ask the native engine for the best column given the ordered list of
+    zero based columns played so far.  Returns None if the engine is not
+    available.
+    """
+    global C4_PROC
+    if not os.path.isfile(C4_ENGINE):
+        return None
+    try:
+        if C4_PROC is None or C4_PROC.poll() is not None:
+            C4_PROC = subprocess.Popen([C4_ENGINE], stdin=subprocess.PIPE,
+                                       stdout=subprocess.PIPE)
+        C4_PROC.stdin.write(''.join(str(col + 1) for col in moves) + '\n')
+        C4_PROC.stdin.flush()
+        answer = C4_PROC.stdout.readline().split()
+        column = int(answer[0]) - 1
+    except (OSError, IOError, ValueError, IndexError):
+        C4_PROC = None
+        return None
+    if column < 0:
+        return None
+    return column
+
 def computer_player(node, state, player):
     """ The computer player function call.
     """
+    move = engine_move(node.node_board.moves)
+    if move is not None:
+        return move
     #move_weight, move = minimax(node, 0, state, player, -float('inf'), float('inf'))
     move_weight, move = minimax(node, 0, state, player, -float('inf'), float('inf'))
     return move
@@ -0,0 +1,529 @@
+/**
+ * Host command line front-end for the Connect Four engine that also runs on
+ * the board (L5_Application/connect_four).
+ *
+ * Build:
+ *      g++ -O2 -std=c++11 -pthread -I../L5_Application -o c4 c4.cpp
+ *
+ * solve, think, book and the stdin mode search with one thread per core
+ * (lazy SMP, see parallel_solver.hpp).
+ *
+ * Usage:
+ *      c4 solve 4453        Prints best column (1-based), score and node count
+ *      c4 think 4453 500    Same with an iterative deepening search that stops
+ *                           after 500ms, also prints the depth reached
+ *      c4 board 4453 1000 [50]
+ *                           The board's search: one thread, the board's
+ *                           2^9 entry table and 1000ms of a CPU [50] times
+ *                           slower than this one; prints the depth reached
+ *      c4 threats 4453      Prints the threat analysis of a position
+ *      c4 bench             Solves a fixed set of openings with and without the
+ *                           transposition table and compares the node counts
+ *      c4 smp [threads]     Time to depth and nodes/s of the parallel search
+ *                           with 1, 2, 4, ... up to all (or [threads]) threads
+ *      c4 book 8 opening.bin [44]
+ *                           Writes an opening book for both colors covering
+ *                           the first 8 plies, optionally below a root line.
+ *                           A name ending in .hpp gets a const array instead.
+ *      c4 lookup opening.bin 4453
+ *                           Prints the book move for a position, if any
+ *      c4                   Reads one move sequence per line from stdin and
+ *                           answers each with "<col> <score> <nodes> <us>"
+ *
+ * Move sequences are 1-based column digits, first player first.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "connect_four/config.hpp"
+#include "connect_four/opening_book.hpp"
+#include "connect_four/position.hpp"
+#include "connect_four/solver.hpp"
+#include "connect_four/threats.hpp"
+#include "parallel_solver.hpp"
+
+using namespace team9::c4;
+
+static uint64_t ulHostClockMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void vThink(ParallelSolver_t& xSolver, const char* pcSeq, unsigned ulBudgetMs)
+{
+    Position_t xPosition;
+    if (xPosition.ulPlaySequence(pcSeq) != strlen(pcSeq))
+    {
+        printf("error invalid sequence '%s'\n", pcSeq);
+        return;
+    }
+
+    uint64_t ulStart = ulHostClockMs();
+    xSolver.vSetClock(ulHostClockMs);
+    Solver_t::Result_t xResult = xSolver.xSearch(xPosition, ulStart + ulBudgetMs);
+    printf("%d %d %llu %llu depth %u%s\n", xResult.lBestCol + 1, xResult.lScore,
+           (unsigned long long)xResult.ulNodes,
+           (unsigned long long)(ulHostClockMs() - ulStart) * 1000,
+           xResult.ulDepth, xResult.bExact ? " exact" : "");
+}
+
+/// How many times slower than the host the board is assumed to be, see vBoardThink()
+static unsigned ulBoardSlowdown = 1;
+
+/// The host clock run ulBoardSlowdown times faster, so a budget shrinks to what the board gets done
+static uint64_t ulBoardClockMs()
+{
+    return ulHostClockMs() * ulBoardSlowdown;
+}
+
+/**
+ * What GameTask_t's xSearch() reaches in ulBudgetMs on the LPC1758: no
+ * threads and a 2^9 entry table, the host's time divided by ulSlowdown.
+ * The board has never been timed, so ulSlowdown is an estimate: 100 MHz
+ * and 32-bit against a ~3 GHz 64-bit host core is 30x on clock alone.
+ */
+static void vBoardThink(const char* pcSeq, unsigned ulBudgetMs, unsigned ulSlowdown)
+{
+    Position_t xPosition;
+    if (xPosition.ulPlaySequence(pcSeq) != strlen(pcSeq))
+    {
+        printf("error invalid sequence '%s'\n", pcSeq);
+        return;
+    }
+
+    ulBoardSlowdown = std::max(ulSlowdown, 1u);
+    Solver_t xSolver(9);
+    xSolver.vSetClock(ulBoardClockMs);
+    uint64_t ulStart = ulBoardClockMs();
+    Solver_t::Result_t xResult = xSolver.xSearch(xPosition, ulStart + ulBudgetMs);
+    printf("%d %d %llu nodes, depth %u of %u%s in %llu board ms\n", xResult.lBestCol + 1, xResult.lScore,
+           (unsigned long long)xResult.ulNodes, xResult.ulDepth,
+           (unsigned)(Position_t::WIDTH * Position_t::HEIGHT - xPosition.ulNbMoves()),
+           xResult.bExact ? " exact" : "", (unsigned long long)(ulBoardClockMs() - ulStart));
+}
+
+static void vPrintCells(const char* pcName, uint64_t ulCells)
+{
+    printf("%-16s", pcName);
+    for (int lCol = 0; lCol < Position_t::WIDTH; ++lCol)
+    {
+        for (int lRow = 0; lRow < Position_t::HEIGHT; ++lRow)
+        {
+            if (ulCells & Position_t::ulCellMask(lRow, lCol))
+            {
+                printf(" %c%d", 'a' + lCol, lRow + 1);
+            }
+        }
+    }
+    printf("\n");
+}
+
+static int lThreats(const char* pcSeq)
+{
+    Position_t xPosition;
+    if (xPosition.ulPlaySequence(pcSeq) != strlen(pcSeq))
+    {
+        printf("error invalid sequence '%s'\n", pcSeq);
+        return 1;
+    }
+
+    // Cells are named by column letter and row, a1 is the bottom left
+    Threats_t xThreats = Threats_t::xAnalyze(xPosition);
+    vPrintCells("win cells", xThreats.ulWinCells[0]);
+    vPrintCells("opponent cells", xThreats.ulWinCells[1]);
+    vPrintCells("immediate wins", xThreats.ulImmediateWins);
+    vPrintCells("forced blocks", xThreats.ulForcedBlocks);
+    printf("open threes     %u / %u\n", xThreats.ulOpenThrees[0], xThreats.ulOpenThrees[1]);
+    printf("open twos       %u / %u\n", xThreats.ulOpenTwos[0], xThreats.ulOpenTwos[1]);
+    printf("evaluation      %d\n", lEvaluate(xPosition));
+    return 0;
+}
+
+static void vAnswer(ParallelSolver_t& xSolver, const char* pcSeq)
+{
+    Position_t xPosition;
+    size_t ulLen = strlen(pcSeq);
+    if (xPosition.ulPlaySequence(pcSeq) != ulLen)
+    {
+        printf("error invalid sequence '%s'\n", pcSeq);
+        fflush(stdout);
+        return;
+    }
+
+    auto xStart = std::chrono::steady_clock::now();
+    Solver_t::Result_t xResult = xSolver.xSolve(xPosition);
+    auto xUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - xStart).count();
+
+    printf("%d %d %llu %lld\n", xResult.lBestCol + 1, xResult.lScore,
+           (unsigned long long)xResult.ulNodes, (long long)xUs);
+    fflush(stdout);
+}
+
+/// Early middle-game positions that take a plain alpha-beta search seconds
+static const char* const pcBenchPositions[] =
+{
+    "54345566",
+    "36455443",
+    "1234567123",
+    "3344455662",
+    "4453521667",
+    "5433421166",
+    "2343545611",
+    "445352166733",
+};
+
+struct BenchTotal_t
+{
+    BenchTotal_t() : ulNodes(0), ulUs(0) {}
+    uint64_t ulNodes;
+    uint64_t ulUs;
+};
+
+static void vBenchOne(Solver_t& xSolver, const Position_t& xPosition,
+                      Solver_t::Result_t& xResult, BenchTotal_t& xTotal)
+{
+    auto xStart = std::chrono::steady_clock::now();
+    xResult = xSolver.xSolve(xPosition);
+    xTotal.ulUs += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - xStart).count();
+    xTotal.ulNodes += xResult.ulNodes;
+}
+
+static void vPrintTotal(const char* pcName, const BenchTotal_t& xTotal)
+{
+    printf("%-8s %12llu nodes %10.3f s %10.0f nodes/s\n", pcName,
+           (unsigned long long)xTotal.ulNodes, xTotal.ulUs / 1e6,
+           xTotal.ulUs ? xTotal.ulNodes * 1e6 / xTotal.ulUs : 0.0);
+}
+
+static int lBench()
+{
+    Solver_t xPlain;
+    Solver_t xCached(GAME_TT_LOG2_ENTRIES);
+    BenchTotal_t xPlainTotal, xCachedTotal;
+
+    printf("%-12s %5s %12s %12s\n", "position", "score", "no table", "table");
+    for (size_t ulI = 0; ulI < sizeof(pcBenchPositions) / sizeof(pcBenchPositions[0]); ++ulI)
+    {
+        Position_t xPosition;
+        const char* pcSeq = pcBenchPositions[ulI];
+        if (xPosition.ulPlaySequence(pcSeq) != strlen(pcSeq))
+        {
+            printf("error invalid sequence '%s'\n", pcSeq);
+            return 1;
+        }
+
+        // Every position starts from an empty table so both runs do the same work
+        Solver_t::Result_t xPlainResult, xCachedResult;
+        xCached.vClearTable();
+        vBenchOne(xPlain, xPosition, xPlainResult, xPlainTotal);
+        vBenchOne(xCached, xPosition, xCachedResult, xCachedTotal);
+        if (xPlainResult.lScore != xCachedResult.lScore)
+        {
+            printf("error score mismatch on '%s': %d vs %d\n", pcSeq,
+                   xPlainResult.lScore, xCachedResult.lScore);
+            return 1;
+        }
+        printf("%-12s %5d %12llu %12llu\n", pcSeq, xPlainResult.lScore,
+               (unsigned long long)xPlainResult.ulNodes,
+               (unsigned long long)xCachedResult.ulNodes);
+    }
+
+    vPrintTotal("no table", xPlainTotal);
+    vPrintTotal("table", xCachedTotal);
+    printf("table: %u KB, node reduction %.1fx, speedup %.1fx\n",
+           (unsigned)(xCached.pGetTable()->ulBytes() / 1024),
+           xCachedTotal.ulNodes ? (double)xPlainTotal.ulNodes / xCachedTotal.ulNodes : 0.0,
+           xCachedTotal.ulUs ? (double)xPlainTotal.ulUs / xCachedTotal.ulUs : 0.0);
+    return 0;
+}
+
+/// Openings searched to SMP_BENCH_DEPTH plies by "c4 smp"
+static const char* const pcSmpPositions[] =
+{
+    "",
+    "4",
+    "44",
+    "435",
+    "4453",
+    "3344",
+    "54345",
+    "445566",
+};
+static const unsigned SMP_BENCH_DEPTH = 16;
+
+static int lSmpBench(unsigned ulMaxThreads)
+{
+    std::vector<unsigned> xCounts;
+    for (unsigned ulThreads = 1; ulThreads < ulMaxThreads; ulThreads *= 2)
+    {
+        xCounts.push_back(ulThreads);
+    }
+    xCounts.push_back(ulMaxThreads);
+
+    printf("depth %u, %u positions, %u hardware threads\n", SMP_BENCH_DEPTH,
+           (unsigned)(sizeof(pcSmpPositions) / sizeof(pcSmpPositions[0])),
+           std::thread::hardware_concurrency());
+    printf("%7s %12s %10s %12s %8s\n", "threads", "nodes", "time s", "nodes/s", "speedup");
+
+    double xBaseSeconds = 0;
+    for (size_t ulC = 0; ulC < xCounts.size(); ++ulC)
+    {
+        ParallelSolver_t xSolver(xCounts[ulC], GAME_TT_LOG2_ENTRIES);
+        uint64_t ulNodes = 0;
+        double xSeconds = 0;
+        for (size_t ulI = 0; ulI < sizeof(pcSmpPositions) / sizeof(pcSmpPositions[0]); ++ulI)
+        {
+            Position_t xPosition;
+            xPosition.ulPlaySequence(pcSmpPositions[ulI]);
+
+            // Time to depth from an empty table, like the first move of a game
+            xSolver.xGetTable().vClear();
+            auto xStart = std::chrono::steady_clock::now();
+            Solver_t::Result_t xResult = xSolver.xSearch(xPosition, 0, SMP_BENCH_DEPTH);
+            xSeconds += std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - xStart).count();
+            ulNodes += xResult.ulNodes;
+        }
+        if (ulC == 0)
+        {
+            xBaseSeconds = xSeconds;
+        }
+        printf("%7u %12llu %10.3f %12.0f %7.2fx\n", xCounts[ulC], (unsigned long long)ulNodes,
+               xSeconds, ulNodes / xSeconds, xBaseSeconds / xSeconds);
+    }
+    return 0;
+}
+
+struct BookBuilder_t
+{
+    BookBuilder_t(ParallelSolver_t& xSolver_arg, unsigned ulPlies_arg) :
+            xSolver(xSolver_arg), ulPlies(ulPlies_arg) {}
+    ParallelSolver_t& xSolver;
+    unsigned ulPlies;
+    std::map<uint64_t, uint64_t> xEntries; ///< Canonical key to packed entry
+    std::set<uint64_t> xSeen[2];           ///< Canonical keys expanded per book side
+};
+
+/**
+ * Walks the game tree for the book side playing on plies of parity ulSide:
+ * every reply of the opponent is followed, but only the solved best move of
+ * the book side, since the board never plays anything else.
+ */
+static void vBookVisit(BookBuilder_t& xBook, const Position_t& xPosition, unsigned ulSide)
+{
+    bool bMirrored = false;
+    uint64_t ulKey = OpeningBook_t::ulCanonicalKey(xPosition, bMirrored);
+    if (xPosition.ulNbMoves() >= xBook.ulPlies || !xBook.xSeen[ulSide].insert(ulKey).second)
+    {
+        return;
+    }
+
+    if (xPosition.ulNbMoves() % 2 != ulSide)
+    {
+        for (int lCol = 0; lCol < Position_t::WIDTH; ++lCol)
+        {
+            if (xPosition.bCanPlay(lCol) && !xPosition.bIsWinningMove(lCol))
+            {
+                Position_t xChild(xPosition);
+                xChild.vPlay(lCol);
+                vBookVisit(xBook, xChild, ulSide);
+            }
+        }
+        return;
+    }
+
+    int lCol = 0;
+    auto xIt = xBook.xEntries.find(ulKey);
+    if (xIt != xBook.xEntries.end())
+    {
+        lCol = OpeningBook_t::lEntryColumn(xIt->second);
+        lCol = bMirrored ? Position_t::WIDTH - 1 - lCol : lCol;
+    }
+    else
+    {
+        auto xStart = std::chrono::steady_clock::now();
+        Solver_t::Result_t xResult = xBook.xSolver.xSolve(xPosition);
+        lCol = xResult.lBestCol;
+        xBook.xEntries[ulKey] = OpeningBook_t::ulPackEntry(
+                ulKey, bMirrored ? Position_t::WIDTH - 1 - lCol : lCol, xResult.lScore);
+        fprintf(stderr, "%5u: ply %2u col %d score %3d in %.1fs\n",
+                (unsigned)xBook.xEntries.size(), xPosition.ulNbMoves(), lCol + 1,
+                xResult.lScore, std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - xStart).count());
+    }
+
+    if (lCol >= 0 && !xPosition.bIsWinningMove(lCol))
+    {
+        Position_t xChild(xPosition);
+        xChild.vPlay(lCol);
+        vBookVisit(xBook, xChild, ulSide);
+    }
+}
+
+static int lWriteBook(const char* pcFile, const std::vector<uint8_t>& xImage)
+{
+    FILE* pFile = fopen(pcFile, "wb");
+    if (!pFile)
+    {
+        perror(pcFile);
+        return 1;
+    }
+
+    size_t ulLen = strlen(pcFile);
+    if (ulLen > 4 && strcmp(pcFile + ulLen - 4, ".hpp") == 0)
+    {
+        fprintf(pFile, "// Generated by tools/c4 book, see connect_four/opening_book.hpp\n");
+        fprintf(pFile, "#ifndef C4_OPENING_BOOK_DATA_HPP\n#define C4_OPENING_BOOK_DATA_HPP\n\n");
+        fprintf(pFile, "#include <stdint.h>\n\n");
+        fprintf(pFile, "const uint8_t ucOpeningBookData[%u] =\n{", (unsigned)xImage.size());
+        for (size_t ulI = 0; ulI < xImage.size(); ++ulI)
+        {
+            fprintf(pFile, "%s0x%02x,", (ulI % 12) ? " " : "\n    ", xImage[ulI]);
+        }
+        fprintf(pFile, "\n};\n\n#endif\n");
+    }
+    else
+    {
+        fwrite(&xImage[0], 1, xImage.size(), pFile);
+    }
+    return fclose(pFile) ? 1 : 0;
+}
+
+static int lBook(ParallelSolver_t& xSolver, unsigned ulPlies, const char* pcFile, const char* pcRoot)
+{
+    Position_t xRoot;
+    if (xRoot.ulPlaySequence(pcRoot) != strlen(pcRoot))
+    {
+        fprintf(stderr, "error invalid sequence '%s'\n", pcRoot);
+        return 1;
+    }
+
+    BookBuilder_t xBook(xSolver, ulPlies);
+    vBookVisit(xBook, xRoot, 0);
+    vBookVisit(xBook, xRoot, 1);
+
+    std::vector<uint8_t> xImage(OpeningBook_t::HEADER_BYTES +
+                                xBook.xEntries.size() * OpeningBook_t::ENTRY_BYTES);
+    OpeningBook_t::vWriteHeader(&xImage[0], xBook.xEntries.size());
+    uint8_t* pucOut = &xImage[OpeningBook_t::HEADER_BYTES];
+    for (auto xIt = xBook.xEntries.begin(); xIt != xBook.xEntries.end(); ++xIt)
+    {
+        OpeningBook_t::vWriteEntry(pucOut, xIt->second);
+        pucOut += OpeningBook_t::ENTRY_BYTES;
+    }
+
+    printf("%u entries, %u bytes\n", (unsigned)xBook.xEntries.size(), (unsigned)xImage.size());
+    return lWriteBook(pcFile, xImage);
+}
+
+static FILE* pLookupFile;
+
+static bool bReadLookupFile(void* pData, uint32_t ulBytes, uint32_t ulOffset)
+{
+    return fseek(pLookupFile, ulOffset, SEEK_SET) == 0 &&
+           fread(pData, 1, ulBytes, pLookupFile) == ulBytes;
+}
+
+static int lLookup(const char* pcFile, const char* pcSeq)
+{
+    Position_t xPosition;
+    if (xPosition.ulPlaySequence(pcSeq) != strlen(pcSeq))
+    {
+        printf("error invalid sequence '%s'\n", pcSeq);
+        return 1;
+    }
+
+    OpeningBook_t xBook;
+    pLookupFile = fopen(pcFile, "rb");
+    long lBytes = -1;
+    if (pLookupFile && fseek(pLookupFile, 0, SEEK_END) == 0)
+    {
+        lBytes = ftell(pLookupFile);
+    }
+    if (!pLookupFile || lBytes < 0 || !xBook.bAttach(bReadLookupFile, (uint32_t)lBytes))
+    {
+        printf("error cannot load book '%s'\n", pcFile);
+        return 1;
+    }
+
+    int lCol = -1, lScore = 0;
+    if (xBook.bLookup(xPosition, lCol, lScore))
+    {
+        printf("%d %d\n", lCol + 1, lScore);
+    }
+    else
+    {
+        printf("not in book (%u entries)\n", (unsigned)xBook.ulSize());
+    }
+    fclose(pLookupFile);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    ParallelSolver_t xSolver(0, GAME_TT_LOG2_ENTRIES);
+
+    if (argc == 3 && strcmp(argv[1], "solve") == 0)
+    {
+        vAnswer(xSolver, argv[2]);
+        return 0;
+    }
+    if (argc == 4 && strcmp(argv[1], "think") == 0)
+    {
+        vThink(xSolver, argv[2], atoi(argv[3]));
+        return 0;
+    }
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "board") == 0)
+    {
+        vBoardThink(argv[2], atoi(argv[3]), (argc == 5) ? atoi(argv[4]) : 50);
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "threats") == 0)
+    {
+        return lThreats(argv[2]);
+    }
+    if (argc == 2 && strcmp(argv[1], "bench") == 0)
+    {
+        return lBench();
+    }
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "smp") == 0)
+    {
+        unsigned ulThreads = (argc == 3) ? atoi(argv[2]) : xSolver.ulThreads();
+        return lSmpBench(std::max(ulThreads, 1u));
+    }
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "book") == 0)
+    {
+        return lBook(xSolver, atoi(argv[2]), argv[3], (argc == 5) ? argv[4] : "");
+    }
+    if (argc == 4 && strcmp(argv[1], "lookup") == 0)
+    {
+        return lLookup(argv[2], argv[3]);
+    }
+    if (argc != 1)
+    {
+        fprintf(stderr, "usage: %s [solve <moves> | think <moves> <ms> | board <moves> <ms> [slowdown] |\n"
+                        "           threats <moves> | bench |\n"
+                        "           smp [threads] |\n"
+                        "           book <plies> <file> [root moves] | lookup <file> <moves>]\n", argv[0]);
+        return 1;
+    }
+
+    char cLine[64];
+    while (fgets(cLine, sizeof(cLine), stdin))
+    {
+        cLine[strcspn(cLine, "\r\n")] = '\0';
+        vAnswer(xSolver, cLine);
+    }
+    return 0;
+}
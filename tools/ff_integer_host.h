@@ -0,0 +1,21 @@
+#ifndef TOOLS_FF_INTEGER_HOST_H
+#define TOOLS_FF_INTEGER_HOST_H
+
+/**
+ * FatFs' integer types at the widths it writes to the disk, for building
+ * ff.c on a 64-bit host, where L4_IO/fat/integer.h's DWORD (unsigned long)
+ * is 8 bytes.  Given to every file of the tool with -include, it takes
+ * integer.h's place through its include guard.
+ */
+#define _FF_INTEGER
+
+typedef unsigned char   BYTE;
+typedef short           SHORT;
+typedef unsigned short  WORD;
+typedef unsigned short  WCHAR;
+typedef int             INT;
+typedef unsigned int    UINT;
+typedef int             LONG;
+typedef unsigned int    DWORD;
+
+#endif
@@ -0,0 +1,173 @@
+/**
+ * Gantry time over recorded games: every bot move timed the way the board
+ * ran it before the column table (out from home and back, every move) and
+ * the way it runs it now (from the last drop straight to the next column,
+ * GAME_PARK_HOME false).  Move times are StepProfile_t's, step by step as
+ * MotorTask_t's interrupt runs them; gate and thinking times are left out,
+ * they are the same either way.
+ *
+ * Also plans each game's bot chips as one batch with Gantry_t::ulPlan()
+ * and compares the travel to dropping them in the order they were played.
+ * Fails if a plan travels more than the played order or than it says.
+ *
+ * Games are move strings, columns 1 to 7 with the human first, as pixy_sim
+ * and c4 take them: on the command line, or one per line on stdin with "-".
+ *
+ * Build (from this directory):
+ *      g++ -O2 -std=c++11 -I.. -I../L5_Application -o gantry_sim gantry_sim.cpp
+ *
+ * Usage:
+ *      gantry_sim [-f gantry.calib] [games ... | -]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "motor/config.hpp"
+#include "motor/gantry.hpp"
+#include "motor/step_profile.hpp"
+
+using namespace team9::motor;
+
+/// MotorTask_t's MCPWM clock at 48 MHz
+static const uint32_t TICK_HZ = 48000000 / 8;
+
+/// Example games when none are given, the one pixy_sim records first
+static const char* const pcDefaultGames[] = {
+    "445362714411",
+    "4444443336",
+    "1727374565",
+    "43443555366",
+    "7162534",
+    "44444455533123"
+};
+
+static StepProfile_t xProfile;
+
+static double xMoveMs(uint32_t ulSteps)
+{
+    uint64_t ullTicks = 0;
+    xProfile.vStart(ulSteps);
+    for (uint32_t ulTicks = xProfile.ulNextTicks(); ulTicks; ulTicks = xProfile.ulNextTicks())
+    {
+        ullTicks += ulTicks;
+    }
+    return 1000.0 * ullTicks / TICK_HZ;
+}
+
+/// Steps to drop in xCols' order, from home
+static uint32_t ulTravel(const Gantry_t& xGantry, const std::vector<uint8_t>& xCols)
+{
+    uint32_t ulSteps = 0;
+    int32_t lAt = 0;
+    for (size_t i = 0; i < xCols.size(); i++)
+    {
+        ulSteps += Gantry_t::ulDistance(lAt, xGantry.ulColSteps(xCols[i]));
+        lAt = xGantry.ulColSteps(xCols[i]);
+    }
+    return ulSteps;
+}
+
+int main(int argc, char** argv)
+{
+    Gantry_t xGantry;
+    std::vector<std::string> xGames;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-f") && i + 1 < argc)
+        {
+            char cTable[Gantry_t::STR_SIZE] = "";
+            FILE* pFile = fopen(argv[++i], "r");
+            size_t ulRead = pFile ? fread(cTable, 1, sizeof(cTable) - 1, pFile) : 0;
+            if (pFile)
+            {
+                fclose(pFile);
+            }
+            cTable[ulRead] = '\0';
+            if (!xGantry.bParse(cTable))
+            {
+                fprintf(stderr, "%s: not a column table\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (!strcmp(argv[i], "-"))
+        {
+            char cLine[128];
+            while (fgets(cLine, sizeof(cLine), stdin))
+            {
+                cLine[strcspn(cLine, " \r\n")] = '\0';
+                if (cLine[0])
+                {
+                    xGames.push_back(cLine);
+                }
+            }
+        }
+        else
+        {
+            xGames.push_back(argv[i]);
+        }
+    }
+    if (xGames.empty())
+    {
+        xGames.assign(pcDefaultGames, pcDefaultGames + sizeof(pcDefaultGames) / sizeof(pcDefaultGames[0]));
+    }
+
+    xProfile.vSetRates(TICK_HZ, MOTOR_MAX_RPS * MOTOR_STEPS_PER_ROT, MOTOR_ACCEL_RPS2 * MOTOR_STEPS_PER_ROT);
+    char cTable[Gantry_t::STR_SIZE];
+    xGantry.vStr(cTable, sizeof(cTable));
+    printf("columns %s, %.2f rot/s top, %.2f rot/s^2\n", cTable, MOTOR_MAX_RPS, MOTOR_ACCEL_RPS2);
+    printf("%-16s %5s %10s %10s %6s %12s %12s\n",
+           "game", "moves", "home ms", "direct ms", "saved", "played steps", "planned");
+
+    bool bPass = true;
+    double xTotalHomeMs = 0.0, xTotalDirectMs = 0.0;
+    for (size_t g = 0; g < xGames.size(); g++)
+    {
+        const std::string& xMoves = xGames[g];
+        std::vector<uint8_t> xBotCols;
+        bool bValid = !xMoves.empty();
+        for (size_t i = 0; i < xMoves.size(); i++)
+        {
+            bValid &= (xMoves[i] >= '1' && xMoves[i] <= '7');
+            if (bValid && (i % 2))
+            {
+                xBotCols.push_back(xMoves[i] - '1');
+            }
+        }
+        if (!bValid)
+        {
+            fprintf(stderr, "%s: moves are columns 1 to 7\n", xMoves.c_str());
+            return 2;
+        }
+
+        double xHomeMs = 0.0, xDirectMs = 0.0;
+        int32_t lAt = 0;
+        for (size_t i = 0; i < xBotCols.size(); i++)
+        {
+            uint32_t ulCol = xGantry.ulColSteps(xBotCols[i]);
+            xHomeMs += 2.0 * xMoveMs(ulCol);
+            xDirectMs += xMoveMs(Gantry_t::ulDistance(lAt, ulCol));
+            lAt = ulCol;
+        }
+        xTotalHomeMs += xHomeMs;
+        xTotalDirectMs += xDirectMs;
+
+        std::vector<uint8_t> xOrder(xBotCols.size());
+        uint32_t ulPlanned = xGantry.ulPlan(xBotCols.data(), xBotCols.size(), xOrder.data());
+        uint32_t ulPlayed = ulTravel(xGantry, xBotCols);
+        bool bPlanOk = ulPlanned <= ulPlayed && ulPlanned == ulTravel(xGantry, xOrder);
+        bPass &= bPlanOk;
+
+        printf("%-16s %5u %10.1f %10.1f %5.1f%% %12u %12u%s\n", xMoves.c_str(), (unsigned)xBotCols.size(),
+               xHomeMs, xDirectMs, xHomeMs > 0.0 ? 100.0 * (xHomeMs - xDirectMs) / xHomeMs : 0.0,
+               ulPlayed, ulPlanned, bPlanOk ? "" : "  bad plan");
+    }
+    printf("total %.1f ms from home, %.1f ms direct, %.1f%% saved\n", xTotalHomeMs, xTotalDirectMs,
+           xTotalHomeMs > 0.0 ? 100.0 * (xTotalHomeMs - xTotalDirectMs) / xTotalHomeMs : 0.0);
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    return bPass ? 0 : 1;
+}
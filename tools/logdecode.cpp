@@ -0,0 +1,689 @@
+/**
+ * Prints a binary log (FILE_LOGGER_BINARY, "0:log.bin") as the CSV lines
+ * the text mode writes.  The records hold the addresses of their format
+ * strings, filenames and function names, so the firmware's ELF file, the
+ * one built with the log's FILE_LOGGER_BINARY, is needed to read them; a
+ * log written by another build is detected by its start records and
+ * skipped.  Messages are never cut short here, unlike the text mode's.
+ *
+ * "test" logs every kind of conversion through file_logger.c (built with
+ * FILE_LOGGER_BINARY) on the host and checks each decoded line against
+ * the text mode's, reading the strings back from this program's own ELF
+ * file.  "bench" times a binary logging call against formatting the same
+ * line as text, and compares their sizes.
+ *
+ * Build (from this directory), without log rotation or rate limits:
+ *      gcc -O2 -std=gnu99 -DFILE_LOGGER_BINARY=1 -DFILE_LOGGER_SEGMENT_SIZE=0 -DFILE_LOGGER_RATE_LIMIT=0
+ *          -I.. -I../L3_Utils -I../L4_IO -I../L4_IO/fat -I../L2_Drivers -I../L0_LowLevel
+ *          -I../L1_FreeRTOS/include -I../L1_FreeRTOS/portable -I../L1_FreeRTOS
+ *          -c ../L3_Utils/src/file_logger.c -o file_logger_bin.o
+ *      g++ -O2 -std=c++11 -pthread -no-pie -DFILE_LOGGER_BINARY=1 -I.. -I../L3_Utils -I../L4_IO
+ *          -I../L4_IO/fat -I../L2_Drivers -I../L0_LowLevel -I../L1_FreeRTOS/include
+ *          -I../L1_FreeRTOS/portable -I../L1_FreeRTOS -o logdecode logdecode.cpp file_logger_bin.o
+ *
+ * Usage:
+ *      logdecode <firmware.elf> <log.bin>
+ *      logdecode test
+ *      logdecode bench [calls]
+ */
+#include <elf.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "logger_host.hpp"
+
+/**
+ * End of "flash" for file_logger.c on the host: this array is in .bss,
+ * after the read-only strings of a -no-pie program and below its heap and
+ * stack, as the end of the image is on the board.
+ */
+extern "C"
+{
+char _etext[1];
+}
+
+static bool bReadFile(const char* pcPath, std::vector<uint8_t>& xData)
+{
+    FILE* pFile = fopen(pcPath, "rb");
+    if (!pFile)
+    {
+        return false;
+    }
+    uint8_t ucBuf[4096];
+    size_t ulRead;
+    while ((ulRead = fread(ucBuf, 1, sizeof(ucBuf), pFile)) > 0)
+    {
+        xData.insert(xData.end(), ucBuf, ucBuf + ulRead);
+    }
+    fclose(pFile);
+    return true;
+}
+
+/// The strings of an ELF file, by the address they are loaded at
+class Elf_t
+{
+    public:
+        bool bLoad(const char* pcPath)
+        {
+            if (!bReadFile(pcPath, xFile) || xFile.size() < EI_NIDENT || memcmp(xFile.data(), ELFMAG, SELFMAG))
+            {
+                return false;
+            }
+            if (xFile[EI_CLASS] == ELFCLASS32)
+            {
+                return bLoadSections<Elf32_Ehdr, Elf32_Shdr>();
+            }
+            return xFile[EI_CLASS] == ELFCLASS64 && bLoadSections<Elf64_Ehdr, Elf64_Shdr>();
+        }
+
+        /// @returns the string at an address, NULL if none is loaded there
+        const char* pcString(uint32_t ulAddr) const
+        {
+            for (size_t i = 0; i < xSections.size(); i++)
+            {
+                const Section_t& xSection = xSections[i];
+                if (ulAddr >= xSection.ullAddr && ulAddr < xSection.ullAddr + xSection.ullSize)
+                {
+                    const char* pcStr = (const char*)xFile.data() + xSection.ullOffset + (ulAddr - xSection.ullAddr);
+                    size_t ulMax = xSection.ullAddr + xSection.ullSize - ulAddr;
+                    return memchr(pcStr, '\0', ulMax) ? pcStr : NULL;
+                }
+            }
+            return NULL;
+        }
+
+    private:
+        struct Section_t
+        {
+            uint64_t ullAddr;
+            uint64_t ullSize;
+            uint64_t ullOffset;
+        };
+
+        std::vector<uint8_t> xFile;
+        std::vector<Section_t> xSections;
+
+        template<typename EHDR_T, typename SHDR_T>
+        bool bLoadSections()
+        {
+            EHDR_T xHeader;
+            if (xFile.size() < sizeof(xHeader))
+            {
+                return false;
+            }
+            memcpy(&xHeader, xFile.data(), sizeof(xHeader));
+            for (uint32_t i = 0; i < xHeader.e_shnum; i++)
+            {
+                SHDR_T xSection;
+                uint64_t ullAt = xHeader.e_shoff + (uint64_t)i * xHeader.e_shentsize;
+                if (ullAt + sizeof(xSection) > xFile.size())
+                {
+                    return false;
+                }
+                memcpy(&xSection, xFile.data() + ullAt, sizeof(xSection));
+                if (xSection.sh_type == SHT_PROGBITS && (xSection.sh_flags & SHF_ALLOC) &&
+                    xSection.sh_offset + xSection.sh_size <= xFile.size())
+                {
+                    xSections.push_back({xSection.sh_addr, xSection.sh_size, xSection.sh_offset});
+                }
+            }
+            return !xSections.empty();
+        }
+};
+
+/// One argument of a record
+struct Arg_t
+{
+    char cTag;
+    int64_t llInt;
+    double xDouble;
+    const char* pcStr;
+};
+
+static bool bTakeArg(const Elf_t& xElf, const uint8_t*& p, const uint8_t* pEnd, Arg_t& xArg)
+{
+    if (p >= pEnd)
+    {
+        return false;
+    }
+    xArg.cTag = *p++;
+    uint32_t ulSize = (xArg.cTag == FILE_LOGGER_BIN_ARG_INT64 || xArg.cTag == FILE_LOGGER_BIN_ARG_DOUBLE) ? 8 : 4;
+    if (xArg.cTag == FILE_LOGGER_BIN_ARG_STR)
+    {
+        const uint8_t* pNul = (const uint8_t*)memchr(p, '\0', pEnd - p);
+        if (!pNul)
+        {
+            return false;
+        }
+        xArg.pcStr = (const char*)p;
+        p = pNul + 1;
+        return true;
+    }
+    if (p + ulSize > pEnd)
+    {
+        return false;
+    }
+
+    int32_t lValue = 0;
+    uint32_t ulValue = 0;
+    switch (xArg.cTag)
+    {
+        case FILE_LOGGER_BIN_ARG_INT32:
+            memcpy(&lValue, p, 4);
+            xArg.llInt = lValue;
+            break;
+        case FILE_LOGGER_BIN_ARG_INT64:
+            memcpy(&xArg.llInt, p, 8);
+            break;
+        case FILE_LOGGER_BIN_ARG_DOUBLE:
+            memcpy(&xArg.xDouble, p, 8);
+            break;
+        case FILE_LOGGER_BIN_ARG_PTR:
+            memcpy(&ulValue, p, 4);
+            xArg.llInt = ulValue;
+            break;
+        case FILE_LOGGER_BIN_ARG_STR_ADDR:
+            memcpy(&ulValue, p, 4);
+            xArg.pcStr = xElf.pcString(ulValue);
+            if (!xArg.pcStr)
+            {
+                return false;
+            }
+            break;
+        default:
+            return false;
+    }
+    p += ulSize;
+    return true;
+}
+
+/**
+ * Appends a format string with the record's arguments put back, walking it
+ * as file_logger.c did to record them.
+ * @returns false if the arguments ran out or don't match the format
+ */
+static bool bFormat(const Elf_t& xElf, const char* pcFmt, const uint8_t*& p, const uint8_t* pEnd, std::string& xOut)
+{
+    while (*pcFmt)
+    {
+        if (*pcFmt != '%')
+        {
+            xOut += *pcFmt++;
+            continue;
+        }
+        pcFmt++;
+        if (*pcFmt == '%')
+        {
+            xOut += *pcFmt++;
+            continue;
+        }
+
+        // Rebuilt without the length, a '*' replaced by its value
+        std::string xSpec = "%";
+        Arg_t xArg;
+        for (; *pcFmt && strchr("-+ #0'.123456789*", *pcFmt); pcFmt++)
+        {
+            if (*pcFmt != '*')
+            {
+                xSpec += *pcFmt;
+            }
+            else if (bTakeArg(xElf, p, pEnd, xArg) && xArg.cTag == FILE_LOGGER_BIN_ARG_INT32)
+            {
+                xSpec += std::to_string(xArg.llInt);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        uint32_t ulHalves = 0;
+        for (; *pcFmt && strchr("hlLqjzt", *pcFmt); pcFmt++)
+        {
+            ulHalves += (*pcFmt == 'h');
+        }
+
+        const char cConv = *pcFmt;
+        if (cConv == 'n')
+        {
+            pcFmt++;
+            continue;
+        }
+        if (!cConv || !strchr("diuxXocseEfFgGaAp", cConv) || !bTakeArg(xElf, p, pEnd, xArg))
+        {
+            return false;
+        }
+        pcFmt++;
+
+        char cBuf[1024];
+        bool bInt = (xArg.cTag == FILE_LOGGER_BIN_ARG_INT32 || xArg.cTag == FILE_LOGGER_BIN_ARG_INT64);
+        if (strchr("di", cConv) && bInt)
+        {
+            int64_t llValue = (ulHalves > 1) ? (signed char)xArg.llInt : (ulHalves ? (short)xArg.llInt : xArg.llInt);
+            snprintf(cBuf, sizeof(cBuf), (xSpec + "lld").c_str(), (long long)llValue);
+        }
+        else if (strchr("uxXo", cConv) && bInt)
+        {
+            uint64_t ullValue = xArg.llInt;
+            if (xArg.cTag == FILE_LOGGER_BIN_ARG_INT32)
+            {
+                ullValue &= 0xFFFFFFFFu;
+            }
+            ullValue &= (ulHalves > 1) ? 0xFFu : (ulHalves ? 0xFFFFu : ~0ull);
+            snprintf(cBuf, sizeof(cBuf), (xSpec + "ll" + cConv).c_str(), (unsigned long long)ullValue);
+        }
+        else if (cConv == 'c' && bInt)
+        {
+            snprintf(cBuf, sizeof(cBuf), (xSpec + "c").c_str(), (int)xArg.llInt);
+        }
+        else if (strchr("eEfFgGaA", cConv) && xArg.cTag == FILE_LOGGER_BIN_ARG_DOUBLE)
+        {
+            snprintf(cBuf, sizeof(cBuf), (xSpec + cConv).c_str(), xArg.xDouble);
+        }
+        else if (cConv == 's' && (xArg.cTag == FILE_LOGGER_BIN_ARG_STR || xArg.cTag == FILE_LOGGER_BIN_ARG_STR_ADDR))
+        {
+            snprintf(cBuf, sizeof(cBuf), (xSpec + "s").c_str(), xArg.pcStr);
+        }
+        else if (cConv == 'p' && xArg.cTag == FILE_LOGGER_BIN_ARG_PTR)
+        {
+            snprintf(cBuf, sizeof(cBuf), (xSpec + "p").c_str(), (void*)(uintptr_t)xArg.llInt);
+        }
+        else
+        {
+            return false;
+        }
+        xOut += cBuf;
+    }
+    return true;
+}
+
+enum Record_t
+{
+    RECORD_LINE,
+    RECORD_START,       // a start record of this ELF file's build
+    RECORD_OTHER_BUILD, // a start record of another build
+    RECORD_BAD
+};
+
+/// One record as its CSV line, without the '\n'
+static Record_t eDecode(const Elf_t& xElf, const uint8_t* pRecord, std::string& xLine)
+{
+    logger_bin_header_t xHeader;
+    memcpy(&xHeader, pRecord, sizeof(xHeader));
+    const uint8_t* p = pRecord + sizeof(xHeader);
+    const uint8_t* pEnd = pRecord + xHeader.len;
+
+    const char* pcFmt = NULL;
+    if (xHeader.flags & FILE_LOGGER_BIN_INLINE)
+    {
+        const uint8_t* pNul = (const uint8_t*)memchr(p, '\0', pEnd - p);
+        if (!pNul)
+        {
+            return RECORD_BAD;
+        }
+        pcFmt = (const char*)p;
+        p = pNul + 1;
+    }
+    else
+    {
+        pcFmt = xElf.pcString(xHeader.msg);
+    }
+
+    if (xHeader.flags & FILE_LOGGER_BIN_START)
+    {
+        return (pcFmt && !strcmp(pcFmt, FILE_LOGGER_BIN_MARKER)) ? RECORD_START : RECORD_OTHER_BUILD;
+    }
+    if (!pcFmt)
+    {
+        return RECORD_BAD;
+    }
+
+    xLine.clear();
+    if (!(xHeader.flags & FILE_LOGGER_BIN_RAW))
+    {
+        // As logger_log() writes it in text mode
+        static const char* const pcTypes[] = { "debug", "info", "warn", "error" };
+        uint32_t ulType = xHeader.flags & FILE_LOGGER_BIN_TYPE_MASK;
+        const char* pcFile = xHeader.filename ? xElf.pcString(xHeader.filename) : "";
+        const char* pcFunc = xHeader.func_name ? xElf.pcString(xHeader.func_name) : "";
+        if (ulType >= log_last || !pcFile || !pcFunc)
+        {
+            return RECORD_BAD;
+        }
+        char cHeader[512];
+        snprintf(cHeader, sizeof(cHeader), "%d/%d,%02d:%02d:%02d,%u,%s,%s,%s%s,%u,",
+                 xHeader.month, xHeader.day, xHeader.hour, xHeader.min, xHeader.sec,
+                 (unsigned)xHeader.uptime_ms, pcTypes[ulType], pcFile, pcFunc, pcFunc[0] ? "()" : "",
+                 (unsigned)xHeader.line);
+        xLine = cHeader;
+    }
+
+    // A truncated record ends where its arguments ran out
+    bool bOk = bFormat(xElf, pcFmt, p, pEnd, xLine);
+    return (bOk || (xHeader.flags & FILE_LOGGER_BIN_TRUNCATED)) ? RECORD_LINE : RECORD_BAD;
+}
+
+struct Decoded_t
+{
+    std::vector<std::string> xLines;
+    uint32_t ulStarts;
+    uint32_t ulSkipped;     // records of other builds
+    bool bBad;
+    size_t ulBadOffset;
+};
+
+static Decoded_t xDecodeLog(const Elf_t& xElf, const std::vector<uint8_t>& xLog)
+{
+    Decoded_t xDecoded = {std::vector<std::string>(), 0, 0, false, 0};
+    bool bOtherBuild = false;
+    size_t ulAt = 0;
+    while (ulAt + sizeof(logger_bin_header_t) <= xLog.size())
+    {
+        uint16_t usLen;
+        memcpy(&usLen, &xLog[ulAt], sizeof(usLen));
+        if (usLen < sizeof(logger_bin_header_t) || usLen > FILE_LOGGER_LOG_MSG_MAX_LEN || ulAt + usLen > xLog.size())
+        {
+            xDecoded.bBad = true;
+            xDecoded.ulBadOffset = ulAt;
+            return xDecoded;
+        }
+
+        std::string xLine;
+        Record_t eRecord = eDecode(xElf, &xLog[ulAt], xLine);
+        if (eRecord == RECORD_START || eRecord == RECORD_OTHER_BUILD)
+        {
+            bOtherBuild = (eRecord == RECORD_OTHER_BUILD);
+            xDecoded.ulStarts += !bOtherBuild;
+        }
+        if (bOtherBuild)
+        {
+            xDecoded.ulSkipped++;
+        }
+        else if (eRecord == RECORD_LINE)
+        {
+            xDecoded.xLines.push_back(xLine);
+        }
+        else if (eRecord == RECORD_BAD)
+        {
+            xDecoded.bBad = true;
+            xDecoded.ulBadOffset = ulAt;
+            return xDecoded;
+        }
+        ulAt += usLen;
+    }
+    if (ulAt != xLog.size())
+    {
+        xDecoded.bBad = true;
+        xDecoded.ulBadOffset = ulAt;
+    }
+    return xDecoded;
+}
+
+/// --- test ------------------------------------------------------------------
+
+struct Expected_t
+{
+    std::string xLine;
+    bool bPrefix;       // cut short to fit the record: the decoded line starts with it
+};
+
+static std::vector<Expected_t> xExpected;
+
+static const rtc_t xTestRtc = {56, 34, 12, 5, 17, 10, 2026, 290};
+static const uint64_t TEST_UPTIME_US = 1234567000ull;
+
+static void vExpectV(bool bPrefix, const char* pcHeader, const char* pcFmt, va_list xArgs)
+{
+    char cMsg[1024];
+    vsnprintf(cMsg, sizeof(cMsg), pcFmt, xArgs);
+    xExpected.push_back({std::string(pcHeader) + cMsg, bPrefix});
+}
+
+/// The line the text mode writes for a LOG_*() call
+static void vExpect(bool bPrefix, logger_msg_t eType, const char* pcFile, const char* pcFunc, unsigned ulLine,
+                    const char* pcFmt, ...)
+{
+    static const char* const pcTypes[] = { "debug", "info", "warn", "error" };
+    const char* pcSlash = pcFile ? strrchr(pcFile, '/') : NULL;
+    pcFile = pcSlash ? pcSlash + 1 : (pcFile ? pcFile : "");
+    pcFunc = pcFunc ? pcFunc : "";
+    char cHeader[256];
+    snprintf(cHeader, sizeof(cHeader), "%d/%d,%02d:%02d:%02d,%u,%s,%s,%s%s,%u,",
+             xTestRtc.month, xTestRtc.day, xTestRtc.hour, xTestRtc.min, xTestRtc.sec,
+             (unsigned)(TEST_UPTIME_US / 1000), pcTypes[eType], pcFile, pcFunc, pcFunc[0] ? "()" : "", ulLine);
+    va_list xArgs;
+    va_start(xArgs, pcFmt);
+    vExpectV(bPrefix, cHeader, pcFmt, xArgs);
+    va_end(xArgs);
+}
+
+static void vExpectRaw(const char* pcFmt, ...)
+{
+    va_list xArgs;
+    va_start(xArgs, pcFmt);
+    vExpectV(false, "", pcFmt, xArgs);
+    va_end(xArgs);
+}
+
+/// Logs with a LOG_*() macro and expects what the text mode would have written
+#define CHECK_LOG(LOG, eType, ...) \
+    do { LOG(__VA_ARGS__); vExpect(false, eType, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__); } while (0)
+
+static void vLogTestMessages()
+{
+    char cRam[32];
+    snprintf(cRam, sizeof(cRam), "from %s", "RAM");
+    char cRamFmt[32];
+    snprintf(cRamFmt, sizeof(cRamFmt), "format in RAM %%d|%%s|");
+    std::string xLong(300, 'x');
+
+    CHECK_LOG(LOG_INFO, log_info, "plain message");
+    CHECK_LOG(LOG_DEBUG, log_debug, "%d %i %u %x %X %o %c", -5, 7, 4000000000u, 0xbeef, 0xBEEF, 8, 'z');
+    CHECK_LOG(LOG_WARN, log_warn, "%ld %lu %lld %llx %zu", -123456L, 123456UL, -1234567890123LL,
+              0x123456789abcULL, sizeof(xLong));
+    CHECK_LOG(LOG_ERROR, log_error, "%hhd %hu %hhx %#08x %+d", 300, 70000, 511, 0x2a, 9);
+    CHECK_LOG(LOG_INFO, log_info, "%5.2f|%-10.3e|%g|%G", 3.14159, 0.000123, 1e10, 2.5e-7);
+    CHECK_LOG(LOG_INFO, log_info, "%s and %s, 100%% %-6s|", "a string in flash", cRam, "pad");
+    CHECK_LOG(LOG_INFO, log_info, "%*d|%-*.*s|%.*f", 6, 42, 8, 3, "abcdef", 2, 1.0 / 3);
+    CHECK_LOG(LOG_INFO, log_info, "%p", (void*)0x1234);
+    CHECK_LOG(LOG_INFO, log_info, cRamFmt, 5, "inline");
+    LOG_SIMPLE_MSG("simple %u", 10u);
+    vExpect(false, log_info, NULL, NULL, 0, "simple %u", 10u);
+    LOG_RAW_MSG("raw %s %d", "message", 3);
+    vExpectRaw("raw %s %d", "message", 3);
+
+    // Cut short to fit one record
+    LOG_INFO("long %s then %d", xLong.c_str(), 1);
+    vExpect(true, log_info, __FILE__, __FUNCTION__, __LINE__ - 1, "long %s", std::string(80, 'x').c_str());
+}
+
+static bool bWaitForLog(const Elf_t& xElf, size_t ulLines, Decoded_t& xDecoded)
+{
+    for (int lTry = 0; lTry < 2000; lTry++)
+    {
+        logger_send_flush_request();
+        vSleepMs(2);
+        std::vector<uint8_t> xLog;
+        {
+            std::lock_guard<std::mutex> xGuard(pxSink->xLock);
+            xLog.assign(pxSink->xData.begin(), pxSink->xData.end());
+        }
+        xDecoded = xDecodeLog(xElf, xLog);
+        if (xDecoded.bBad || xDecoded.xLines.size() >= ulLines)
+        {
+            return !xDecoded.bBad;
+        }
+    }
+    return false;
+}
+
+static int lTest()
+{
+    Elf_t xElf;
+    if (!xElf.bLoad("/proc/self/exe"))
+    {
+        fprintf(stderr, "can't read this program's ELF file\n");
+        return 2;
+    }
+    Sink_t xSink;
+    pxSink = &xSink;
+    ullHostUptimeUs = TEST_UPTIME_US;
+    xHostRtc = xTestRtc;
+    logger_init(1);
+    logger_set_printf(log_debug, false);
+
+    vLogTestMessages();
+    Decoded_t xDecoded;
+    bool bPass = bWaitForLog(xElf, xExpected.size(), xDecoded);
+    if (xDecoded.bBad)
+    {
+        printf("bad record at offset %u\n", (unsigned)xDecoded.ulBadOffset);
+    }
+    bPass &= (xDecoded.ulStarts == 1 && xDecoded.xLines.size() == xExpected.size());
+
+    size_t ulTextBytes = 0;
+    for (size_t i = 0; i < xExpected.size() && i < xDecoded.xLines.size(); i++)
+    {
+        const std::string& xGot = xDecoded.xLines[i];
+        const Expected_t& xWant = xExpected[i];
+        bool bMatch = xWant.bPrefix ? !xGot.compare(0, xWant.xLine.size(), xWant.xLine) : (xGot == xWant.xLine);
+        printf("%s %s\n", bMatch ? "ok  " : "FAIL", xGot.c_str());
+        if (!bMatch)
+        {
+            printf("     wanted %s%s\n", xWant.xLine.c_str(), xWant.bPrefix ? "..." : "");
+        }
+        bPass &= bMatch;
+        ulTextBytes += xGot.size() + 1;
+    }
+    printf("%u lines, %u start record, %u bytes binary, %u bytes as text\n", (unsigned)xDecoded.xLines.size(),
+           xDecoded.ulStarts, (unsigned)xSink.xData.size(), (unsigned)ulTextBytes);
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    return bPass ? 0 : 1;
+}
+
+/// --- bench -----------------------------------------------------------------
+
+/// What a text mode call formats, as logger_log() does it
+static uint32_t ulFormatText(char* pcBuf, const char* pcFile, const char* pcFunc, unsigned ulLine,
+                             const char* pcFmt, ...)
+{
+    const rtc_t xTime = rtc_gettime();
+    const char* pcSlash = strrchr(pcFile, '/');
+    pcFile = pcSlash ? pcSlash + 1 : pcFile;
+    int lLen = snprintf(pcBuf, FILE_LOGGER_LOG_MSG_MAX_LEN, "%d/%d,%02d:%02d:%02d,%u,%s,%s,%s%s,%u,",
+                        xTime.month, xTime.day, xTime.hour, xTime.min, xTime.sec, (unsigned)sys_get_uptime_ms(),
+                        "info", pcFile, pcFunc, "()", ulLine);
+    va_list xArgs;
+    va_start(xArgs, pcFmt);
+    lLen += vsnprintf(pcBuf + lLen, FILE_LOGGER_LOG_MSG_MAX_LEN - 1 - lLen, pcFmt, xArgs);
+    va_end(xArgs);
+    return lLen + 1;
+}
+
+static int lBench(uint32_t ulCalls)
+{
+    Sink_t xSink;
+    pxSink = &xSink;
+    ullHostUptimeUs = TEST_UPTIME_US;
+    xHostRtc = xTestRtc;
+    logger_init(1);
+    logger_set_printf(log_debug, false);
+
+    // Calls are timed in bursts the logger task sleeps through, as one core
+    // would run them, and the ring is written out between bursts
+    typedef std::chrono::steady_clock Clock_t;
+    const uint32_t BURST = 16;
+    char cText[FILE_LOGGER_LOG_MSG_MAX_LEN];
+    uint64_t ullTextBytes = 0;
+    double xTextNs = 0.0, xBinaryNs = 0.0;
+    for (uint32_t i = 0; i < ulCalls; i += BURST)
+    {
+        Clock_t::time_point xStart = Clock_t::now();
+        for (uint32_t j = i; j < i + BURST; j++)
+        {
+            ullTextBytes += ulFormatText(cText, __FILE__, __FUNCTION__, __LINE__,
+                                         "Moved %u steps to column %d in %u ms, %s", j, (int)(j % 7), j / 3, "ok");
+        }
+        Clock_t::time_point xMid = Clock_t::now();
+        for (uint32_t j = i; j < i + BURST; j++)
+        {
+            LOG_INFO("Moved %u steps to column %d in %u ms, %s", j, (int)(j % 7), j / 3, "ok");
+        }
+        Clock_t::time_point xEnd = Clock_t::now();
+        xTextNs += std::chrono::duration<double, std::nano>(xMid - xStart).count();
+        xBinaryNs += std::chrono::duration<double, std::nano>(xEnd - xMid).count();
+
+        logger_send_flush_request();
+        vSleepMs(0.2);
+    }
+    ulCalls = (ulCalls + BURST - 1) / BURST * BURST;
+    vSleepMs(50);
+
+    double xBinaryBytes = 0.0;
+    {
+        std::lock_guard<std::mutex> xGuard(xSink.xLock);
+        xBinaryBytes = (double)xSink.xData.size() / ulCalls;
+    }
+    xTextNs /= ulCalls;
+    xBinaryNs /= ulCalls;
+
+    printf("%u calls of LOG_INFO(\"Moved %%u steps to column %%d in %%u ms, %%s\", ...)\n", ulCalls);
+    printf("text:   %7.1f ns formatting alone, %6.1f bytes a line\n", xTextNs, (double)ullTextBytes / ulCalls);
+    printf("binary: %7.1f ns the whole call,   %6.1f bytes a record\n", xBinaryNs, xBinaryBytes);
+    printf("binary call %.1fx faster than text formatting, %.1fx fewer bytes, %u calls blocked\n",
+           xTextNs / xBinaryNs, ((double)ullTextBytes / ulCalls) / xBinaryBytes, logger_get_blocked_call_count());
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && !strcmp(argv[1], "test"))
+    {
+        return lTest();
+    }
+    if (argc >= 2 && !strcmp(argv[1], "bench"))
+    {
+        uint32_t ulCalls = (argc >= 3) ? strtoul(argv[2], NULL, 10) : 20000;
+        return lBench(ulCalls ? ulCalls : 1);
+    }
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s <firmware.elf> <log.bin> | test | bench [calls]\n", argv[0]);
+        return 2;
+    }
+
+    Elf_t xElf;
+    std::vector<uint8_t> xLog;
+    if (!xElf.bLoad(argv[1]))
+    {
+        fprintf(stderr, "%s: not an ELF file\n", argv[1]);
+        return 2;
+    }
+    if (!bReadFile(argv[2], xLog))
+    {
+        fprintf(stderr, "%s: can't read\n", argv[2]);
+        return 2;
+    }
+
+    Decoded_t xDecoded = xDecodeLog(xElf, xLog);
+    for (size_t i = 0; i < xDecoded.xLines.size(); i++)
+    {
+        printf("%s\n", xDecoded.xLines[i].c_str());
+    }
+    if (xDecoded.ulSkipped)
+    {
+        fprintf(stderr, "%s: %u records written by another build skipped\n", argv[2], xDecoded.ulSkipped);
+    }
+    if (xDecoded.bBad)
+    {
+        fprintf(stderr, "%s: bad record at offset %u\n", argv[2], (unsigned)xDecoded.ulBadOffset);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,364 @@
+/**
+ * Benchmarks file_logger.c on a PC against the logger it replaced: log calls per second and
+ * how long a caller waits, worst case and 99th percentile.  The old logger (a queue of empty
+ * 150-byte buffers, a queue of written ones, and a task copying them into a 1K file buffer) is
+ * kept below as it was, file_logger.c is the firmware's, built as is.
+ *
+ * Both run on std::threads, with the FreeRTOS, RTC and FatFs calls they use replaced by
+ * logger_host.hpp.  The log file is a string in memory that takes as long to open and write as
+ * asked, like the SD card.  Two runs of each logger, file_logger.c in text mode:
+ *      flood   producers log back to back, the file takes no time
+ *      paced   producers log every -p microseconds, opening the file takes -o ms and writing
+ *              it -k ms per KB
+ * Every line that reaches a file is checked, all there and in each producer's order; ends with
+ * PASS or FAIL.
+ *
+ * "blocked" is each logger's own count: for the old one, calls that found no empty buffer within
+ * FILE_LOGGER_BLOCK_TIME_MS, then 10 ms; for the ring, calls that found it full at all.
+ *
+ * Build (from this directory), without log rotation or rate limits:
+ *      gcc -O2 -std=gnu99 -DFILE_LOGGER_SEGMENT_SIZE=0 -DFILE_LOGGER_RATE_LIMIT=0 -I.. -I../L3_Utils -I../L4_IO
+ *          -I../L4_IO/fat -I../L2_Drivers -I../L0_LowLevel -I../L1_FreeRTOS/include -I../L1_FreeRTOS/portable
+ *          -I../L1_FreeRTOS -c ../L3_Utils/src/file_logger.c
+ *      g++ -O2 -std=c++11 -pthread -I.. -I../L3_Utils -I../L4_IO -I../L4_IO/fat -I../L2_Drivers
+ *          -I../L0_LowLevel -I../L1_FreeRTOS/include -I../L1_FreeRTOS/portable -I../L1_FreeRTOS
+ *          -o logger_bench logger_bench.cpp file_logger.o
+ *
+ * Usage:
+ *      logger_bench [-t producers] [-n messages each] [-p us] [-o ms] [-k ms]
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger_host.hpp"
+
+typedef std::chrono::steady_clock Clock_t;
+
+/// --- The logger file_logger.c replaced, as it was ---------------------------
+
+#define OLD_LOGGER_NUM_BUFFERS  10
+
+static uint16_t g_old_blocked_calls = 0;
+static char * gp_old_file_buffer = NULL;
+static QueueHandle_t g_write_buffer_queue = NULL;
+static QueueHandle_t g_empty_buffer_queue = NULL;
+
+static void old_logger_write_to_file(const void * buffer, const uint32_t bytes_to_write)
+{
+    FIL fatfs_file;
+    UINT bytes_written = 0;
+    if (bytes_to_write && FR_OK == f_open(&fatfs_file, FILE_LOGGER_FILENAME, FA_OPEN_ALWAYS | FA_WRITE))
+    {
+        f_lseek(&fatfs_file, f_size(&fatfs_file));
+        f_write(&fatfs_file, buffer, bytes_to_write, &bytes_written);
+        f_close(&fatfs_file);
+    }
+}
+
+static void old_logger_task(void *p)
+{
+    char * const start_ptr = gp_old_file_buffer;
+    char * const end_ptr = start_ptr + FILE_LOGGER_BUFFER_SIZE;
+    char * log_msg = NULL;
+    char * write_ptr = start_ptr;
+    size_t len = 0;
+    size_t buffer_overflow_cnt = 0;
+
+    while (1)
+    {
+        log_msg = NULL;
+        if (!xQueueReceive(g_write_buffer_queue, &log_msg, OS_MS(1000 * FILE_LOGGER_FLUSH_TIME_SEC)) ||
+            NULL == log_msg)
+        {
+            old_logger_write_to_file(start_ptr, (write_ptr - start_ptr));
+            write_ptr = start_ptr;
+            continue;
+        }
+
+        len = strlen(log_msg);
+        log_msg[len] = '\n';
+        log_msg[++len] = '\0';
+
+        if (len + write_ptr >= end_ptr)
+        {
+            buffer_overflow_cnt = (len + write_ptr - end_ptr);
+            memcpy(write_ptr, log_msg, (end_ptr - write_ptr));
+            old_logger_write_to_file(start_ptr, (end_ptr - start_ptr));
+            if (buffer_overflow_cnt > 0) {
+                memcpy(start_ptr, (log_msg + len - buffer_overflow_cnt), buffer_overflow_cnt);
+            }
+            write_ptr = start_ptr + buffer_overflow_cnt;
+        }
+        else {
+            memcpy(write_ptr, log_msg, len);
+            write_ptr += len;
+        }
+
+        xQueueSend(g_empty_buffer_queue, &log_msg, portMAX_DELAY);
+    }
+}
+
+static void old_logger_init(void)
+{
+    gp_old_file_buffer = (char*) malloc(FILE_LOGGER_BUFFER_SIZE);
+    g_write_buffer_queue = xQueueCreate(OLD_LOGGER_NUM_BUFFERS, sizeof(char*));
+    g_empty_buffer_queue = xQueueCreate(OLD_LOGGER_NUM_BUFFERS, sizeof(char*));
+    for (int i = 0; i < OLD_LOGGER_NUM_BUFFERS; i++)
+    {
+        char * ptr = (char*) malloc(FILE_LOGGER_LOG_MSG_MAX_LEN);
+        xQueueSend(g_empty_buffer_queue, &ptr, 0);
+    }
+    xTaskCreate(old_logger_task, "logger", FILE_LOGGER_STACK_SIZE, NULL, 1, NULL);
+}
+
+static void old_logger_flush(void)
+{
+    char * null_ptr_to_flush = NULL;
+    xQueueSend(g_write_buffer_queue, &null_ptr_to_flush, portMAX_DELAY);
+}
+
+static void old_logger_log(logger_msg_t type, const char * filename, const char * func_name, unsigned line_num,
+                           const char * msg, ...)
+{
+    char * buffer = NULL;
+    const rtc_t time = rtc_gettime();
+    const unsigned int uptime = sys_get_uptime_ms();
+    const char * const type_str[] = { "debug", "info", "warn", "error" };
+
+    const char * temp_ptr = strrchr(filename, '/');
+    if (temp_ptr) filename = temp_ptr + 1;
+
+    if (!xQueueReceive(g_empty_buffer_queue, &buffer, OS_MS(FILE_LOGGER_BLOCK_TIME_MS))) {
+        ++g_old_blocked_calls;
+        xQueueReceive(g_empty_buffer_queue, &buffer, portMAX_DELAY);
+    }
+
+    uint32_t len = sprintf(buffer, "%d/%d,%02d:%02d:%02d,%u,%s,%s,%s%s,%u,",
+                           time.month, time.day, time.hour, time.min, time.sec, uptime,
+                           type_str[type], filename, func_name, "()", line_num);
+    va_list args;
+    va_start(args, msg);
+    vsnprintf(buffer + len, FILE_LOGGER_LOG_MSG_MAX_LEN-len-1, msg, args);
+    va_end(args);
+
+    xQueueSend(g_write_buffer_queue, &buffer, portMAX_DELAY);
+}
+
+/// --- The benchmark -----------------------------------------------------------
+
+struct Run_t
+{
+    const char* pcName;
+    uint32_t ulProducers;
+    uint32_t ulMessages;
+    uint32_t ulPeriodUs;    // 0: back to back
+    uint32_t ulOpenMs;
+    uint32_t ulMsPerKb;
+};
+
+struct Result_t
+{
+    double xCallsPerSec;
+    double xMeanUs;
+    double xP99Us;
+    double xMaxUs;
+    uint32_t ulBlocked;
+    bool bIntact;
+};
+
+/// Every "p<producer> n<seq>" line there, each producer's in order
+static bool bCheckLines(const std::string& xData, uint32_t ulProducers, uint32_t ulMessages)
+{
+    std::vector<uint32_t> xNext(ulProducers, 0);
+    size_t ulStart = 0;
+    while (ulStart < xData.size())
+    {
+        size_t ulEnd = xData.find('\n', ulStart);
+        if (ulEnd == std::string::npos)
+        {
+            return false;
+        }
+        std::string xLine = xData.substr(ulStart, ulEnd - ulStart);
+        ulStart = ulEnd + 1;
+        unsigned ulProducer = 0, ulSeq = 0;
+        size_t ulComma = xLine.rfind(',');
+        if (ulComma == std::string::npos ||
+            2 != sscanf(xLine.c_str() + ulComma + 1, "p%u n%u", &ulProducer, &ulSeq) ||
+            ulProducer >= ulProducers || ulSeq != xNext[ulProducer])
+        {
+            return false;
+        }
+        xNext[ulProducer]++;
+    }
+    for (uint32_t i = 0; i < ulProducers; i++)
+    {
+        if (xNext[i] != ulMessages)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename LOG_T, typename FLUSH_T>
+static Result_t xRun(const Run_t& xRunCfg, LOG_T xLog, FLUSH_T xFlush, const uint16_t* pusBlocked)
+{
+    Sink_t xSink;
+    xSink.ulOpenMs = xRunCfg.ulOpenMs;
+    xSink.ulMsPerKb = xRunCfg.ulMsPerKb;
+    pxSink = &xSink;
+    const uint16_t usBlockedBefore = *pusBlocked;
+
+    std::vector<std::vector<double>> xLatencies(xRunCfg.ulProducers);
+    std::atomic<bool> bGo(false);
+    std::vector<std::thread> xThreads;
+    for (uint32_t p = 0; p < xRunCfg.ulProducers; p++)
+    {
+        xThreads.emplace_back([&, p] {
+            std::vector<double>& xMine = xLatencies[p];
+            xMine.reserve(xRunCfg.ulMessages);
+            while (!bGo.load())
+            {
+            }
+            Clock_t::time_point xNext = Clock_t::now();
+            for (uint32_t n = 0; n < xRunCfg.ulMessages; n++)
+            {
+                if (xRunCfg.ulPeriodUs)
+                {
+                    xNext += std::chrono::microseconds(xRunCfg.ulPeriodUs);
+                    std::this_thread::sleep_until(xNext);
+                }
+                Clock_t::time_point xStart = Clock_t::now();
+                xLog(p, n);
+                xMine.push_back(std::chrono::duration<double, std::micro>(Clock_t::now() - xStart).count());
+            }
+        });
+    }
+
+    Clock_t::time_point xStart = Clock_t::now();
+    bGo = true;
+    for (size_t i = 0; i < xThreads.size(); i++)
+    {
+        xThreads[i].join();
+    }
+    double xSeconds = std::chrono::duration<double>(Clock_t::now() - xStart).count();
+
+    // Flush and wait for the last line to land
+    xFlush();
+    size_t ulLines = 0;
+    for (int lTry = 0; lTry < 5000 && ulLines < xRunCfg.ulProducers * xRunCfg.ulMessages; lTry++)
+    {
+        vSleepMs(1);
+        std::lock_guard<std::mutex> xGuard(xSink.xLock);
+        ulLines = std::count(xSink.xData.begin(), xSink.xData.end(), '\n');
+    }
+
+    std::vector<double> xAll;
+    for (size_t i = 0; i < xLatencies.size(); i++)
+    {
+        xAll.insert(xAll.end(), xLatencies[i].begin(), xLatencies[i].end());
+    }
+    std::sort(xAll.begin(), xAll.end());
+    double xSum = 0.0;
+    for (size_t i = 0; i < xAll.size(); i++)
+    {
+        xSum += xAll[i];
+    }
+
+    Result_t xResult;
+    xResult.xCallsPerSec = xAll.size() / xSeconds;
+    xResult.xMeanUs = xSum / xAll.size();
+    xResult.xP99Us = xAll[xAll.size() * 99 / 100];
+    xResult.xMaxUs = xAll.back();
+    xResult.ulBlocked = (uint16_t)(*pusBlocked - usBlockedBefore);
+    {
+        std::lock_guard<std::mutex> xGuard(xSink.xLock);
+        xResult.bIntact = bCheckLines(xSink.xData, xRunCfg.ulProducers, xRunCfg.ulMessages);
+    }
+    pxSink = nullptr;
+    return xResult;
+}
+
+static uint16_t usNewBlocked;
+
+static void vPrint(const char* pcLogger, const Run_t& xRunCfg, const Result_t& xResult)
+{
+    printf("%-7s %-6s %12.0f %10.2f %10.2f %10.1f %8u  %s\n", xRunCfg.pcName, pcLogger,
+           xResult.xCallsPerSec, xResult.xMeanUs, xResult.xP99Us, xResult.xMaxUs,
+           xResult.ulBlocked, xResult.bIntact ? "intact" : "LINES LOST OR OUT OF ORDER");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t ulProducers = 4;
+    uint32_t ulMessages = 20000;
+    uint32_t ulPeriodUs = 2000;
+    uint32_t ulOpenMs = 3;
+    uint32_t ulMsPerKb = 2;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        uint32_t ulVal = strtoul(argv[i + 1], NULL, 10);
+        if (!strcmp(argv[i], "-t")) ulProducers = ulVal;
+        else if (!strcmp(argv[i], "-n")) ulMessages = ulVal;
+        else if (!strcmp(argv[i], "-p")) ulPeriodUs = ulVal;
+        else if (!strcmp(argv[i], "-o")) ulOpenMs = ulVal;
+        else if (!strcmp(argv[i], "-k")) ulMsPerKb = ulVal;
+        else
+        {
+            fprintf(stderr, "usage: %s [-t producers] [-n messages each] [-p us] [-o ms] [-k ms]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!ulProducers || !ulMessages)
+    {
+        fprintf(stderr, "need producers and messages\n");
+        return 2;
+    }
+
+    logger_init(1);
+    logger_set_printf(log_debug, false);
+    old_logger_init();
+
+    auto xNewLog = [](uint32_t p, uint32_t n) { LOG_INFO("p%u n%u", p, n); };
+    auto xNewFlush = [] { logger_send_flush_request(); };
+    auto xOldLog = [](uint32_t p, uint32_t n) {
+        old_logger_log(log_info, __FILE__, __FUNCTION__, __LINE__, "p%u n%u", p, n);
+    };
+    auto xOldFlush = [] { old_logger_flush(); };
+
+    // A paced run logs for (messages * period), keep it to a few seconds
+    uint32_t ulPacedMessages = std::min<uint32_t>(ulMessages, ulPeriodUs ? 3000000 / ulPeriodUs : ulMessages);
+    const Run_t xRuns[] = {
+        {"flood", ulProducers, ulMessages, 0, 0, 0},
+        {"paced", ulProducers, ulPacedMessages, ulPeriodUs, ulOpenMs, ulMsPerKb},
+    };
+
+    printf("%u producers; paced: a line every %u us each, file open %u ms + %u ms/KB\n",
+           ulProducers, ulPeriodUs, ulOpenMs, ulMsPerKb);
+    printf("%-7s %-6s %12s %10s %10s %10s %8s\n", "run", "logger", "calls/s", "mean us", "p99 us", "max us", "blocked");
+    bool bPass = true;
+    for (size_t r = 0; r < sizeof(xRuns) / sizeof(xRuns[0]); r++)
+    {
+        Result_t xOld = xRun(xRuns[r], xOldLog, xOldFlush, &g_old_blocked_calls);
+        vPrint("queues", xRuns[r], xOld);
+        usNewBlocked = logger_get_blocked_call_count();
+        Result_t xNew = xRun(xRuns[r], xNewLog, xNewFlush, &usNewBlocked);
+        xNew.ulBlocked = logger_get_blocked_call_count() - usNewBlocked;
+        vPrint("ring", xRuns[r], xNew);
+        bPass &= xOld.bIntact && xNew.bIntact;
+    }
+    printf("ring watermark %u of %u bytes\n", logger_get_ring_watermark(), FILE_LOGGER_RING_SIZE);
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    return bPass ? 0 : 1;
+}
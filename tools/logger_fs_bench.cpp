@@ -0,0 +1,500 @@
+/**
+ * The file logger writing through the real FatFs (L4_IO/fat/ff.c) to a disk
+ * image in memory, one build with FILE_LOGGER_KEEP_FILE_OPEN 0 and one with
+ * 1.  The disk counts what FatFs asks of it and what that would cost on the
+ * board, from rough figures for the two drives:
+ *      spi     the 2 MB AT45DB flash, drive 0: a 512 byte page is erased and
+ *              programmed on every write (17 ms) whether one sector or many
+ *              are written at once
+ *      sd      a 32 MB SD card on SPI: every command waits for the card, a
+ *              multi-block command is paid for once
+ * A line is logged every -p milliseconds of uptime (made up, the logger
+ * reads it for the sync cadence), so the run takes a few seconds whatever
+ * the drive.
+ *
+ * Before the logger starts, log.csv is given a few lines and a last one cut
+ * short, as a power loss leaves it.  The disk is copied halfway through and
+ * again before the last flush, as if power was lost there; each copy must
+ * mount, and the log must hold the old lines and then logged lines, whole
+ * and in order, as must the log after the flush with every line in it.
+ * With the file kept open, the cut line must also have been ended.
+ *
+ * The log is the retired segments, oldest first and ".lz" ones decompressed,
+ * then log.csv.  More than FILE_LOGGER_SEGMENT_SIZE of lines (-n 6000 at the
+ * 256K default) rotates it; the segments the segment task deleted take the
+ * old lines and the first logged lines with them.  Build with a smaller
+ * -DFILE_LOGGER_SEGMENT_SIZE=16384 to see segments deleted.
+ *
+ * Build (from this directory), every file with -include ff_integer_host.h,
+ * without rate limits since one line logs every -p ms:
+ *      INC="-I.. -I../L3_Utils -I../L4_IO -I../L4_IO/fat -I../L4_IO/fat/disk -I../L2_Drivers \
+ *           -I../L0_LowLevel -I../L1_FreeRTOS/include -I../L1_FreeRTOS/portable -I../L1_FreeRTOS \
+ *           -include ff_integer_host.h"
+ *      gcc -O2 -std=gnu99 $INC -c ../L4_IO/fat/ff.c ../L4_IO/fat/option/ccsbcs.c ../L3_Utils/src/lz_compress.c
+ *      for k in 0 1; do
+ *          gcc -O2 -std=gnu99 $INC -DFILE_LOGGER_KEEP_FILE_OPEN=$k -DFILE_LOGGER_RATE_LIMIT=0 \
+ *              -c ../L3_Utils/src/file_logger.c -o file_logger_k$k.o
+ *          g++ -O2 -std=c++11 -pthread $INC -DFILE_LOGGER_KEEP_FILE_OPEN=$k -o logger_fs_bench_k$k \
+ *              logger_fs_bench.cpp file_logger_k$k.o ff.o ccsbcs.o lz_compress.o
+ *      done
+ *
+ * Usage:
+ *      logger_fs_bench_k0|logger_fs_bench_k1 [spi|sd] [-n lines] [-p ms]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define LOGGER_HOST_REAL_FATFS
+#include "logger_host.hpp"
+#include "diskio.h"
+#include "lz_compress.h"
+
+/// What a drive costs, in milliseconds
+struct Drive_t
+{
+    const char* pcName;
+    uint32_t ulSectors;
+    double xReadCmdMs;
+    double xReadSectorMs;
+    double xWriteCmdMs;
+    double xWriteSectorMs;
+};
+
+static const Drive_t xSpiFlash = { "spi", 2 * 1024 * 1024 / 512, 0.05, 0.25, 0.05, 17.25 };
+static const Drive_t xSdCard   = { "sd", 32 * 1024 * 1024 / 512, 0.5, 0.3, 1.5, 0.3 };
+
+/// What was asked of the disk
+struct DiskCounts_t
+{
+    uint32_t ulReads;
+    uint32_t ulWrites;
+    uint32_t ulSectorsRead;
+    uint32_t ulSectorsWritten;
+    uint32_t ulRewrites;                ///< Sectors written again after the log started
+    double xBusyMs;
+};
+
+/// The disk image behind drive 0
+struct Disk_t
+{
+    const Drive_t* pxDrive;
+    std::mutex xLock;
+    std::vector<uint8_t> xImage;
+    std::vector<uint32_t> xWritesOf;    ///< By sector
+    DiskCounts_t xCounts;
+};
+
+static Disk_t xDisk;
+
+/// Counters from the start of logging
+static void vDiskReset()
+{
+    std::lock_guard<std::mutex> xGuard(xDisk.xLock);
+    xDisk.xWritesOf.assign(xDisk.pxDrive->ulSectors, 0);
+    memset(&xDisk.xCounts, 0, sizeof(xDisk.xCounts));
+}
+
+extern "C" DSTATUS disk_initialize(BYTE drv)
+{
+    return drv ? STA_NOINIT : 0;
+}
+
+extern "C" DSTATUS disk_status(BYTE drv)
+{
+    return drv ? STA_NOINIT : 0;
+}
+
+extern "C" DRESULT disk_read(BYTE drv, BYTE* buff, DWORD sector, BYTE count)
+{
+    std::lock_guard<std::mutex> xGuard(xDisk.xLock);
+    if (drv || sector + count > xDisk.pxDrive->ulSectors)
+    {
+        return RES_PARERR;
+    }
+    memcpy(buff, &xDisk.xImage[sector * 512], count * 512);
+    xDisk.xCounts.ulReads++;
+    xDisk.xCounts.ulSectorsRead += count;
+    xDisk.xCounts.xBusyMs += xDisk.pxDrive->xReadCmdMs + count * xDisk.pxDrive->xReadSectorMs;
+    return RES_OK;
+}
+
+extern "C" DRESULT disk_write(BYTE drv, const BYTE* buff, DWORD sector, BYTE count)
+{
+    std::lock_guard<std::mutex> xGuard(xDisk.xLock);
+    if (drv || sector + count > xDisk.pxDrive->ulSectors)
+    {
+        return RES_PARERR;
+    }
+    memcpy(&xDisk.xImage[sector * 512], buff, count * 512);
+    for (DWORD s = sector; s < sector + count; s++)
+    {
+        xDisk.xCounts.ulRewrites += (xDisk.xWritesOf[s]++ > 0);
+    }
+    xDisk.xCounts.ulWrites++;
+    xDisk.xCounts.ulSectorsWritten += count;
+    xDisk.xCounts.xBusyMs += xDisk.pxDrive->xWriteCmdMs + count * xDisk.pxDrive->xWriteSectorMs;
+    return RES_OK;
+}
+
+extern "C" DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void* buff)
+{
+    if (drv)
+    {
+        return RES_PARERR;
+    }
+    switch (ctrl)
+    {
+        case CTRL_SYNC:
+            return RES_OK;
+        case GET_SECTOR_COUNT:
+            *(DWORD*)buff = xDisk.pxDrive->ulSectors;
+            return RES_OK;
+        case GET_SECTOR_SIZE:
+            *(WORD*)buff = 512;
+            return RES_OK;
+        case GET_BLOCK_SIZE:
+            *(DWORD*)buff = 1;
+            return RES_OK;
+        default:
+            return RES_PARERR;
+    }
+}
+
+/// FatFs' time stamps and volume locks: the logger and segment tasks share drive 0
+extern "C" DWORD get_fattime(void)
+{
+    return ((DWORD)(2026 - 1980) << 25) | (10UL << 21) | (17UL << 16);
+}
+
+extern "C" int ff_cre_syncobj(BYTE vol, _SYNC_t* sobj)
+{
+    *sobj = (_SYNC_t) new std::timed_mutex;
+    return 1;
+}
+
+extern "C" int ff_del_syncobj(_SYNC_t sobj)
+{
+    delete (std::timed_mutex*) sobj;
+    return 1;
+}
+
+extern "C" int ff_req_grant(_SYNC_t sobj)
+{
+    return ((std::timed_mutex*) sobj)->try_lock_for(std::chrono::milliseconds(_FS_TIMEOUT));
+}
+
+extern "C" void ff_rel_grant(_SYNC_t sobj)
+{
+    ((std::timed_mutex*) sobj)->unlock();
+}
+
+static const char* const pcOldLines = "old line 1\nold line 2\nold line 3\n";
+static const char* const pcCutLine = "old line cut sh";
+
+static FATFS xFs;
+
+static bool bMount()
+{
+    f_mount(NULL, "0:", 0);
+    return FR_OK == f_mount(&xFs, "0:", 1);
+}
+
+/// @returns a whole file on drive 0, false if it can't be read
+static bool bReadFile(const std::string& xName, std::string& xText)
+{
+    FIL xFile;
+    if (FR_OK != f_open(&xFile, xName.c_str(), FA_READ))
+    {
+        return false;
+    }
+    xText.assign(f_size(&xFile), '\0');
+    UINT ulRead = 0;
+    FRESULT eErr = xText.empty() ? FR_OK : f_read(&xFile, &xText[0], xText.size(), &ulRead);
+    f_close(&xFile);
+    return FR_OK == eErr && ulRead == xText.size();
+}
+
+/// Decompresses a ".lz" segment: the header, then blocks each behind a 2 byte tag
+static bool bUnpackSegment(const std::string& xLz, std::string& xText)
+{
+    if (xLz.size() < 8 || xLz.compare(0, 4, FILE_LOGGER_LZ_MAGIC))
+    {
+        return false; // not finished
+    }
+    const uint8_t* pucLz = (const uint8_t*)xLz.data();
+    uint32_t ulLogSize = pucLz[4] | (pucLz[5] << 8) | (pucLz[6] << 16) | ((uint32_t)pucLz[7] << 24);
+    size_t ulPos = 8;
+    uint8_t ucBlock[FILE_LOGGER_LZ_BLOCK_SIZE];
+
+    xText.clear();
+    while (ulPos + 2 <= xLz.size())
+    {
+        uint32_t ulTag = pucLz[ulPos] | (pucLz[ulPos + 1] << 8);
+        uint32_t ulLen = ulTag & ~FILE_LOGGER_LZ_STORED;
+        ulPos += 2;
+        if (ulPos + ulLen > xLz.size())
+        {
+            return false;
+        }
+        if (ulTag & FILE_LOGGER_LZ_STORED)
+        {
+            xText.append(xLz, ulPos, ulLen);
+        }
+        else
+        {
+            int32_t lBytes = lz_decompress(pucLz + ulPos, ulLen, ucBlock, sizeof(ucBlock));
+            if (lBytes < 0)
+            {
+                return false;
+            }
+            xText.append((const char*)ucBlock, lBytes);
+        }
+        ulPos += ulLen;
+    }
+    return ulPos == xLz.size() && xText.size() == ulLogSize;
+}
+
+/// The segments on drive 0, by number, and whether each is compressed
+static std::map<uint32_t, bool> xListSegments()
+{
+    std::map<uint32_t, bool> xSegments;
+    DIR xDir;
+    FILINFO xInfo;
+    char cLfn[64];
+    xInfo.lfname = cLfn;
+    xInfo.lfsize = sizeof(cLfn);
+    if (FR_OK != f_opendir(&xDir, FILE_LOGGER_DIR))
+    {
+        return xSegments;
+    }
+    while (FR_OK == f_readdir(&xDir, &xInfo) && xInfo.fname[0])
+    {
+        const char* pcName = cLfn[0] ? cLfn : xInfo.fname;
+        unsigned ulSeq = 0;
+        char cExt[8] = "";
+        if (2 == sscanf(pcName, "log_%u.%7s", &ulSeq, cExt) || 2 == sscanf(pcName, "LOG_%u.%7s", &ulSeq, cExt))
+        {
+            /* A segment whose compression was cut short is there twice, its ".lz" file is unfinished */
+            xSegments[ulSeq] = xSegments[ulSeq] || !strcasecmp(cExt, FILE_LOGGER_LZ_EXT + 1);
+        }
+    }
+    f_closedir(&xDir);
+    return xSegments;
+}
+
+/**
+ * Reads the log back, the segments then log.csv, and checks its lines.
+ * @param pulSegments   Where to count the retired segments left, and pulPacked the compressed ones
+ * @returns how many logged lines it has, in order from seq=0, or -1 if it is broken
+ */
+static int lCheckLog(bool bCutEnded, uint32_t* pulSegments = NULL, uint32_t* pulPacked = NULL)
+{
+    std::string xText, xPart;
+    if (!bMount())
+    {
+        return -1;
+    }
+
+    std::map<uint32_t, bool> xSegments = xListSegments();
+    for (auto& xSegment : xSegments)
+    {
+        std::string xName = FILE_LOGGER_DIR "log_" + std::to_string(xSegment.first);
+        std::string xRaw;
+        if (xSegment.second && bReadFile(xName + FILE_LOGGER_LZ_EXT, xRaw) && bUnpackSegment(xRaw, xPart))
+        {
+            /* Compressed */
+        }
+        else if (!bReadFile(xName + FILE_LOGGER_EXT, xPart))
+        {
+            return -1;
+        }
+        xText += xPart;
+    }
+    if (!bReadFile(FILE_LOGGER_FILENAME, xPart))
+    {
+        return -1;
+    }
+    xText += xPart;
+    if (pulSegments)
+    {
+        *pulSegments = xSegments.size();
+        *pulPacked = 0;
+        for (auto& xSegment : xSegments)
+        {
+            *pulPacked += xSegment.second;
+        }
+    }
+
+    /* The old lines, then the cut line, ended or glued to the first logged line; gone with segment 1 */
+    size_t ulPos = 0;
+    int lSeq = -1;
+    if (xSegments.empty() || 1 == xSegments.begin()->first)
+    {
+        std::string xOld = std::string(pcOldLines) + pcCutLine;
+        if (xText.compare(0, xOld.size(), xOld))
+        {
+            return -1;
+        }
+        ulPos = xOld.size();
+        if (bCutEnded && ulPos < xText.size() && xText[ulPos++] != '\n')
+        {
+            return -1;
+        }
+        lSeq = 0;
+    }
+    else if (!xText.empty())
+    {
+        /* Without segment 1 the log starts where the oldest segment left does, maybe mid-line */
+        if ((ulPos = xText.find('\n')) == std::string::npos)
+        {
+            return -1;
+        }
+        ulPos++;
+    }
+
+    int lLines = 0;
+    while (ulPos < xText.size())
+    {
+        size_t ulEnd = xText.find('\n', ulPos);
+        if (ulEnd == std::string::npos)
+        {
+            return -1; // half a line
+        }
+        std::string xLine = xText.substr(ulPos, ulEnd - ulPos);
+        size_t ulAt = xLine.rfind("seq=");
+        if (ulAt == std::string::npos || (lSeq >= 0 && atoi(xLine.c_str() + ulAt + 4) != lSeq))
+        {
+            return -1;
+        }
+        lSeq = atoi(xLine.c_str() + ulAt + 4) + 1;
+        lLines++;
+        ulPos = ulEnd + 1;
+    }
+    return (xSegments.empty() || 1 == xSegments.begin()->first) ? lLines : lSeq;
+}
+
+int main(int argc, char** argv)
+{
+    const Drive_t* pxDrive = &xSpiFlash;
+    uint32_t ulLines = 2000;
+    double xPeriodMs = 10.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "spi"))
+        {
+            pxDrive = &xSpiFlash;
+        }
+        else if (!strcmp(argv[i], "sd"))
+        {
+            pxDrive = &xSdCard;
+        }
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            ulLines = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+        {
+            xPeriodMs = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [spi|sd] [-n lines] [-p ms]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    xDisk.pxDrive = pxDrive;
+    xDisk.xImage.assign(pxDrive->ulSectors * 512, 0xFF);
+    vDiskReset();
+    f_mount(&xFs, "0:", 0);
+    if (FR_OK != f_mkfs("0:", 0, 0) || !bMount())
+    {
+        fprintf(stderr, "can't format the %s image\n", pxDrive->pcName);
+        return 2;
+    }
+
+    FIL xFile;
+    UINT ulWritten = 0;
+    std::string xOld = std::string(pcOldLines) + pcCutLine;
+    if (FR_OK != f_open(&xFile, FILE_LOGGER_FILENAME, FA_CREATE_ALWAYS | FA_WRITE) ||
+        FR_OK != f_write(&xFile, xOld.data(), xOld.size(), &ulWritten) || FR_OK != f_close(&xFile))
+    {
+        fprintf(stderr, "can't write %s\n", FILE_LOGGER_FILENAME);
+        return 2;
+    }
+
+    ullHostUptimeUs = 1000000;
+    vDiskReset();
+    logger_init(1);
+
+    std::vector<uint8_t> xHalfway, xBeforeFlush;
+    for (uint32_t i = 0; i < ulLines; i++)
+    {
+        ullHostUptimeUs += (uint64_t)(1000.0 * xPeriodMs);
+        LOG_INFO("Reading %u from channel %u, seq=%u", (unsigned)(i * 7919 % 4096), (unsigned)(i % 8), (unsigned)i);
+        vSleepMs(0.02);
+        if (i == ulLines / 2)
+        {
+            std::lock_guard<std::mutex> xGuard(xDisk.xLock);
+            xHalfway = xDisk.xImage;
+        }
+    }
+    vSleepMs(50);
+    {
+        std::lock_guard<std::mutex> xGuard(xDisk.xLock);
+        xBeforeFlush = xDisk.xImage;
+    }
+
+    logger_send_flush_request();
+    uint32_t ulLastWrites = ~0u;
+    for (int lQuiet = 0; lQuiet < 10; )
+    {
+        vSleepMs(20);
+        std::lock_guard<std::mutex> xGuard(xDisk.xLock);
+        lQuiet = (xDisk.xCounts.ulWrites == ulLastWrites) ? lQuiet + 1 : 0;
+        ulLastWrites = xDisk.xCounts.ulWrites;
+    }
+
+    /* The logger is idle now, the images are checked on drive 0 behind its back */
+    DiskCounts_t xRun;
+    std::vector<uint8_t> xFinal;
+    {
+        std::lock_guard<std::mutex> xGuard(xDisk.xLock);
+        xRun = xDisk.xCounts;
+        xFinal = xDisk.xImage;
+    }
+
+    const uint64_t ullBytes = logger_get_bytes_written();
+    const bool bCutEnded = (FILE_LOGGER_KEEP_FILE_OPEN != 0);
+    uint32_t ulSegments = 0, ulPacked = 0;
+    int lFinal = lCheckLog(bCutEnded, &ulSegments, &ulPacked);
+    xDisk.xImage = xHalfway;
+    int lHalfway = lCheckLog(bCutEnded);
+    xDisk.xImage = xBeforeFlush;
+    int lBeforeFlush = lCheckLog(bCutEnded);
+
+    printf("%s, file %s, %u lines every %.1f ms, %llu bytes logged\n", pxDrive->pcName,
+           FILE_LOGGER_KEEP_FILE_OPEN ? "kept open" : "opened per write", (unsigned)ulLines, xPeriodMs,
+           (unsigned long long)ullBytes);
+    printf("  disk: %u reads (%u sectors), %u writes (%u sectors, %u written again)\n",
+           xRun.ulReads, xRun.ulSectorsRead, xRun.ulWrites, xRun.ulSectorsWritten, xRun.ulRewrites);
+    printf("  busy: %.0f ms, %.1f KB/s of log while busy, %.2f written per sector of log\n",
+           xRun.xBusyMs, xRun.xBusyMs > 0.0 ? ullBytes / 1.024 / xRun.xBusyMs : 0.0,
+           ullBytes ? xRun.ulSectorsWritten * 512.0 / ullBytes : 0.0);
+    printf("  segments of %u KB: %u left, %u compressed\n", (unsigned)(FILE_LOGGER_SEGMENT_SIZE / 1024),
+           (unsigned)ulSegments, (unsigned)ulPacked);
+    printf("  power lost halfway: %d lines, before the flush: %d lines; after the flush: %d of %u lines\n",
+           lHalfway, lBeforeFlush, lFinal, (unsigned)ulLines);
+
+    bool bPass = lHalfway >= 0 && lBeforeFlush >= lHalfway && lFinal == (int)ulLines;
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    fflush(stdout);
+    _exit(bPass ? 0 : 1); // the logger task is still waiting for work
+}
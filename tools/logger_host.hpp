@@ -0,0 +1,250 @@
+#ifndef TOOLS_LOGGER_HOST_HPP
+#define TOOLS_LOGGER_HOST_HPP
+
+/**
+ * What L3_Utils/src/file_logger.c uses from the firmware, on the host: the
+ * FreeRTOS queue, semaphore, task and critical section calls on std::threads,
+ * the uptime and RTC, and the FatFs calls writing to a string in memory (pxSink) that can
+ * be made as slow as the SD card.  For the tools linking file_logger.o
+ * (-pthread), one source file each.  A tool linking the real FatFs (ff.c)
+ * defines LOGGER_HOST_REAL_FATFS first and brings its own disk instead.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
+#include "semphr.h"
+#include "ff.h"
+#include "rtc.h"
+#include "lpc_sys.h"
+#include "file_logger.h"
+
+#ifndef LOGGER_HOST_REAL_FATFS
+/// The log file, and what it costs to write
+struct Sink_t
+{
+    std::mutex xLock;
+    std::string xData;
+    uint32_t ulOpenMs = 0;
+    uint32_t ulMsPerKb = 0;
+};
+
+static Sink_t* pxSink = nullptr;
+#endif
+
+static void vSleepMs(double xMs)
+{
+    if (xMs > 0.0)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(1000.0 * xMs)));
+    }
+}
+
+#ifndef LOGGER_HOST_REAL_FATFS
+
+static void vSinkWrite(const void* pData, uint32_t ulBytes)
+{
+    vSleepMs((double)pxSink->ulMsPerKb * ulBytes / 1024);
+    std::lock_guard<std::mutex> xGuard(pxSink->xLock);
+    pxSink->xData.append((const char*)pData, ulBytes);
+}
+
+extern "C" FRESULT f_open(FIL* fp, const TCHAR* path, BYTE mode)
+{
+    vSleepMs(pxSink->ulOpenMs);
+    std::lock_guard<std::mutex> xGuard(pxSink->xLock);
+    fp->fsize = pxSink->xData.size();
+    fp->fptr = 0;
+    return FR_OK;
+}
+
+extern "C" FRESULT f_lseek(FIL* fp, DWORD ofs)
+{
+    fp->fptr = ofs;
+    return FR_OK;
+}
+
+extern "C" FRESULT f_write(FIL* fp, const void* buff, UINT btw, UINT* bw)
+{
+    vSinkWrite(buff, btw);
+    fp->fptr += btw;
+    *bw = btw;
+    return FR_OK;
+}
+
+extern "C" FRESULT f_sync(FIL* fp)
+{
+    return FR_OK;
+}
+
+extern "C" FRESULT f_close(FIL* fp)
+{
+    return FR_OK;
+}
+
+extern "C" FRESULT f_stat(const TCHAR* path, FILINFO* fno)
+{
+    if (!pxSink)
+    {
+        return FR_NO_FILE;
+    }
+    std::lock_guard<std::mutex> xGuard(pxSink->xLock);
+    fno->fsize = pxSink->xData.size();
+    return FR_OK;
+}
+#endif
+
+/// What the logger reads for the time, the host's clock unless ullHostUptimeUs is set
+static uint64_t ullHostUptimeUs = 0;
+static rtc_t xHostRtc;
+
+extern "C" uint64_t sys_get_uptime_us(void)
+{
+    if (ullHostUptimeUs)
+    {
+        return ullHostUptimeUs;
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+extern "C" rtc_t rtc_gettime(void)
+{
+    return xHostRtc;
+}
+
+/// A FreeRTOS queue, or with items of 0 bytes a semaphore
+struct HostQueue_t
+{
+    std::mutex xLock;
+    std::condition_variable xChanged;
+    size_t ulLength;
+    size_t ulItemSize;
+    std::deque<std::vector<uint8_t>> xItems;
+};
+
+template<typename PRED_T>
+static bool bWait(std::unique_lock<std::mutex>& xLock, HostQueue_t* pQueue, TickType_t xTicks, PRED_T xReady)
+{
+    if (xTicks == portMAX_DELAY)
+    {
+        pQueue->xChanged.wait(xLock, xReady);
+        return true;
+    }
+    // A tick is a millisecond, see OS_MS()
+    return pQueue->xChanged.wait_for(xLock, std::chrono::milliseconds(xTicks), xReady);
+}
+
+extern "C" QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize,
+                                             const uint8_t ucQueueType)
+{
+    HostQueue_t* pQueue = new HostQueue_t;
+    pQueue->ulLength = uxQueueLength;
+    pQueue->ulItemSize = uxItemSize;
+    return (QueueHandle_t)pQueue;
+}
+
+extern "C" BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void* const pvItemToQueue,
+                                        TickType_t xTicksToWait, const BaseType_t xCopyPosition)
+{
+    HostQueue_t* pQueue = (HostQueue_t*)xQueue;
+    std::unique_lock<std::mutex> xLock(pQueue->xLock);
+    if (!bWait(xLock, pQueue, xTicksToWait, [pQueue] { return pQueue->xItems.size() < pQueue->ulLength; }))
+    {
+        return pdFALSE;
+    }
+    const uint8_t* pucItem = (const uint8_t*)pvItemToQueue;
+    pQueue->xItems.push_back(std::vector<uint8_t>(pucItem, pucItem + pQueue->ulItemSize));
+    pQueue->xChanged.notify_all();
+    return pdTRUE;
+}
+
+extern "C" BaseType_t xQueueGenericReceive(QueueHandle_t xQueue, void* const pvBuffer,
+                                           TickType_t xTicksToWait, const BaseType_t xJustPeek)
+{
+    HostQueue_t* pQueue = (HostQueue_t*)xQueue;
+    std::unique_lock<std::mutex> xLock(pQueue->xLock);
+    if (!bWait(xLock, pQueue, xTicksToWait, [pQueue] { return !pQueue->xItems.empty(); }))
+    {
+        return pdFALSE;
+    }
+    if (pQueue->ulItemSize)
+    {
+        memcpy(pvBuffer, pQueue->xItems.front().data(), pQueue->ulItemSize);
+    }
+    pQueue->xItems.pop_front();
+    pQueue->xChanged.notify_all();
+    return pdTRUE;
+}
+
+extern "C" UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue)
+{
+    HostQueue_t* pQueue = (HostQueue_t*)xQueue;
+    std::lock_guard<std::mutex> xGuard(pQueue->xLock);
+    return pQueue->xItems.size();
+}
+
+extern "C" void vQueueDelete(QueueHandle_t xQueue)
+{
+    delete (HostQueue_t*)xQueue;
+}
+
+/// The task a thread runs, by its name, which is also its handle: a test may switch it
+static thread_local const char* pcHostTaskName = "main";
+
+extern "C" BaseType_t xTaskGenericCreate(TaskFunction_t pxTaskCode, const char* const pcName,
+                                         const uint16_t usStackDepth, void* const pvParameters,
+                                         UBaseType_t uxPriority, TaskHandle_t* const pxCreatedTask,
+                                         StackType_t* const puxStackBuffer, const MemoryRegion_t* const xRegions)
+{
+    std::thread([pxTaskCode, pcName, pvParameters] {
+        pcHostTaskName = pcName;
+        pxTaskCode(pvParameters);
+    }).detach();
+    return pdPASS;
+}
+
+extern "C" TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t)pcHostTaskName;
+}
+
+extern "C" char* pcTaskGetTaskName(TaskHandle_t xTaskToQuery)
+{
+    return (char*)(xTaskToQuery ? xTaskToQuery : xTaskGetCurrentTaskHandle());
+}
+
+/// One critical section for every thread, as interrupts off are on the board
+static std::recursive_mutex xHostCritical;
+
+extern "C" void vPortEnterCritical(void)
+{
+    xHostCritical.lock();
+}
+
+extern "C" void vPortExitCritical(void)
+{
+    xHostCritical.unlock();
+}
+
+extern "C" BaseType_t xTaskGetSchedulerState(void)
+{
+    return taskSCHEDULER_RUNNING;
+}
+
+extern "C" void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    vSleepMs(xTicksToDelay);
+}
+
+#endif
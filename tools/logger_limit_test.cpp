@@ -0,0 +1,337 @@
+/**
+ * Tests file_logger.c's rate limits and debug sampling on the host: the
+ * uptime is made up and moved a millisecond at a time, and one thread
+ * plays each task in turn (logger_host.hpp's task handles are names), so
+ * the counts are exact.
+ *      site    "flood" logs from one call site every ms for a second while
+ *              "steady" logs every 200 ms: "flood" gets its burst and rate
+ *              and the rest is dropped, every "steady" line is logged
+ *      task    "chatty" logs from FILE_LOGGER_LIMIT_SITES call sites, each
+ *              at its limit, together over the task's
+ *      sample  1 in 4 debug messages of a call site are logged
+ *      churn   more call sites than FILE_LOGGER_LIMIT_SITES, round robin
+ * Each checks the counters (logged, dropped, sampled), logger_get_limited()
+ * and the lines in the file; ends with PASS or FAIL.  "bench" times a call
+ * that is dropped against one that is logged.
+ *
+ * Build (from this directory), without log rotation:
+ *      gcc -O2 -std=gnu99 -DFILE_LOGGER_SEGMENT_SIZE=0 -I.. -I../L3_Utils -I../L4_IO -I../L4_IO/fat
+ *          -I../L2_Drivers -I../L0_LowLevel -I../L1_FreeRTOS/include -I../L1_FreeRTOS/portable
+ *          -I../L1_FreeRTOS -c ../L3_Utils/src/file_logger.c -o file_logger_limit.o
+ *      g++ -O2 -std=c++11 -pthread -I.. -I../L3_Utils -I../L4_IO -I../L4_IO/fat -I../L2_Drivers
+ *          -I../L0_LowLevel -I../L1_FreeRTOS/include -I../L1_FreeRTOS/portable -I../L1_FreeRTOS
+ *          -o logger_limit_test logger_limit_test.cpp file_logger_limit.o
+ *
+ * Usage:
+ *      logger_limit_test [bench]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "logger_host.hpp"
+
+#if !(FILE_LOGGER_RATE_LIMIT)
+#error "logger_limit_test needs file_logger.c built with FILE_LOGGER_RATE_LIMIT"
+#endif
+
+static const char* const pcFlood = "flood";
+static const char* const pcSteady = "steady";
+static const char* const pcChatty = "chatty";
+static const char* const pcDebug = "debug";
+static const char* const pcChurn = "churn";
+
+/// Counters before a test, to check what it added
+struct Counts_t
+{
+    uint32_t ulLogged;
+    uint32_t ulDropped;
+    uint32_t ulSampled;
+};
+
+static Counts_t xCounts()
+{
+    Counts_t xNow = { 0, 0, logger_get_sampled_call_count() };
+    for (int i = 0; i < log_last; i++)
+    {
+        xNow.ulLogged += logger_get_logged_call_count((logger_msg_t)i);
+        xNow.ulDropped += logger_get_suppressed_call_count((logger_msg_t)i);
+    }
+    return xNow;
+}
+
+static void vTick(uint32_t ulMs = 1)
+{
+    ullHostUptimeUs += 1000ULL * ulMs;
+}
+
+/// @returns the lines of the file holding the text, after the logger wrote them all
+static uint32_t ulLinesWith(const char* pcText)
+{
+    size_t ulLast = ~(size_t)0;
+    for (int lQuiet = 0; lQuiet < 5; )
+    {
+        logger_send_flush_request();
+        vSleepMs(5);
+        std::lock_guard<std::mutex> xGuard(pxSink->xLock);
+        lQuiet = (pxSink->xData.size() == ulLast) ? lQuiet + 1 : 0;
+        ulLast = pxSink->xData.size();
+    }
+
+    std::lock_guard<std::mutex> xGuard(pxSink->xLock);
+    uint32_t ulLines = 0;
+    for (size_t ulPos = 0; (ulPos = pxSink->xData.find(pcText, ulPos)) != std::string::npos; ulPos++)
+    {
+        ulLines++;
+    }
+    return ulLines;
+}
+
+/// @returns how many messages were dropped for the call site or task, -1 if it isn't listed
+static int lDroppedFor(bool bTask, const char* pcName, unsigned ulLine)
+{
+    logger_limited_t xLimited[FILE_LOGGER_LIMIT_SITES + FILE_LOGGER_LIMIT_TASKS];
+    uint32_t ulCount = logger_get_limited(xLimited, sizeof(xLimited) / sizeof(xLimited[0]), bTask);
+    for (uint32_t i = 0; i < ulCount; i++)
+    {
+        if (!strcmp(xLimited[i].name, pcName) && xLimited[i].line == ulLine)
+        {
+            return xLimited[i].dropped;
+        }
+    }
+    return -1;
+}
+
+static bool bCheck(bool bOk, const char* pcWhat)
+{
+    printf("  %-58s %s\n", pcWhat, bOk ? "ok" : "FAILED");
+    return bOk;
+}
+
+/// Messages a bucket lets through, starting full, of calls made at the given ms
+static uint32_t ulExpected(uint32_t ulRate, uint32_t ulBurst, const std::vector<uint32_t>& xCallMs)
+{
+    const uint32_t ulInterval = 1000 / ulRate;
+    uint32_t ulFull = 0, ulPassed = 0;
+    for (uint32_t ulNow : xCallMs)
+    {
+        ulFull = std::max(ulFull, ulNow);
+        if (ulFull - ulNow + ulInterval <= ulBurst * ulInterval)
+        {
+            ulFull += ulInterval;
+            ulPassed++;
+        }
+    }
+    return ulPassed;
+}
+
+/// The ms of calls every given ms
+static std::vector<uint32_t> xEvery(uint32_t ulCalls, uint32_t ulEveryMs)
+{
+    std::vector<uint32_t> xCallMs;
+    for (uint32_t i = 0; i < ulCalls; i++)
+    {
+        xCallMs.push_back(i * ulEveryMs);
+    }
+    return xCallMs;
+}
+
+static bool bTestSite()
+{
+    printf("site: one call site every ms for a second, another every 200 ms\n");
+    Counts_t xBefore = xCounts();
+    unsigned ulFloodLine = 0;
+    for (uint32_t ulMs = 0; ulMs < 1000; ulMs++)
+    {
+        pcHostTaskName = pcFlood;
+        ulFloodLine = __LINE__ + 1;
+        LOG_INFO("flood %u", (unsigned)ulMs);
+        if (0 == ulMs % 200)
+        {
+            pcHostTaskName = pcSteady;
+            LOG_WARN("steady %u", (unsigned)ulMs);
+        }
+        vTick();
+    }
+    pcHostTaskName = "main";
+
+    const uint32_t ulFlood = ulExpected(FILE_LOGGER_SITE_RATE, FILE_LOGGER_SITE_BURST, xEvery(1000, 1));
+    Counts_t xAfter = xCounts();
+    bool bPass = true;
+    char cWhat[80];
+    snprintf(cWhat, sizeof(cWhat), "\"flood\" logs %u of 1000, its burst and rate", (unsigned)ulFlood);
+    bPass &= bCheck(ulLinesWith(",flood ") == ulFlood, cWhat);
+    bPass &= bCheck(ulLinesWith(",steady ") == 5, "\"steady\" logs all 5");
+    bPass &= bCheck(xAfter.ulLogged - xBefore.ulLogged == ulFlood + 5 &&
+                    xAfter.ulDropped - xBefore.ulDropped == 1000 - ulFlood, "logged and dropped counts");
+    bPass &= bCheck(lDroppedFor(false, "logger_limit_test.cpp", ulFloodLine) == (int)(1000 - ulFlood),
+                    "the call site is listed with its drops");
+    bPass &= bCheck(lDroppedFor(true, pcFlood, 0) < 0 && lDroppedFor(true, pcSteady, 0) < 0,
+                    "neither task had drops of its own");
+    return bPass;
+}
+
+static bool bTestTask()
+{
+    const uint32_t ulSites = FILE_LOGGER_LIMIT_SITES;
+    const uint32_t ulEveryMs = 1000 / FILE_LOGGER_SITE_RATE;
+    printf("task: %u call sites of one task, each at its rate for four seconds\n", (unsigned)ulSites);
+    std::vector<std::string> xFormats;
+    for (uint32_t i = 0; i < ulSites; i++)
+    {
+        xFormats.push_back("chatty " + std::to_string(i) + " %u");
+    }
+
+    Counts_t xBefore = xCounts();
+    std::vector<uint32_t> xCallMs;
+    pcHostTaskName = pcChatty;
+    for (uint32_t ulMs = 0; ulMs < 4000; ulMs += ulEveryMs)
+    {
+        for (uint32_t i = 0; i < ulSites; i++)
+        {
+            logger_log(log_info, __FILE__, __FUNCTION__, 200 + i, xFormats[i].c_str(), (unsigned)ulMs);
+            xCallMs.push_back(ulMs);
+        }
+        vTick(ulEveryMs);
+    }
+    pcHostTaskName = "main";
+
+    /* No call site goes over its limit, together they go over the task's */
+    const uint32_t ulCalls = xCallMs.size();
+    const uint32_t ulTask = ulExpected(FILE_LOGGER_TASK_RATE, FILE_LOGGER_TASK_BURST, xCallMs);
+    Counts_t xAfter = xCounts();
+    logger_limited_t xLimited[FILE_LOGGER_LIMIT_SITES];
+    bool bPass = true;
+    char cWhat[80];
+    snprintf(cWhat, sizeof(cWhat), "the task logs %u of %u", (unsigned)ulTask, (unsigned)ulCalls);
+    bPass &= bCheck(xAfter.ulLogged - xBefore.ulLogged == ulTask && ulLinesWith(",chatty ") == ulTask, cWhat);
+    bPass &= bCheck(xAfter.ulDropped - xBefore.ulDropped == ulCalls - ulTask, "logged and dropped counts");
+    bPass &= bCheck(lDroppedFor(true, pcChatty, 0) == (int)(ulCalls - ulTask), "the task is listed with its drops");
+    bPass &= bCheck(0 == logger_get_limited(xLimited, FILE_LOGGER_LIMIT_SITES, false), "no call site had drops");
+    return bPass;
+}
+
+static bool bTestSample()
+{
+    printf("sample: 1 in 4 debug messages, every 200 ms\n");
+    Counts_t xBefore = xCounts();
+    logger_set_debug_sampling(4);
+    pcHostTaskName = pcDebug;
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        LOG_DEBUG("sampled %u", (unsigned)i);
+        vTick(200);
+    }
+    pcHostTaskName = "main";
+    logger_set_debug_sampling(1);
+
+    Counts_t xAfter = xCounts();
+    bool bPass = true;
+    bPass &= bCheck(ulLinesWith(",sampled ") == 25 && ulLinesWith(",sampled 0\n") == 1 &&
+                    ulLinesWith(",sampled 4\n") == 1, "25 logged, the first and every fourth");
+    bPass &= bCheck(xAfter.ulSampled - xBefore.ulSampled == 75 && xAfter.ulDropped == xBefore.ulDropped,
+                    "75 sampled out, none dropped");
+    return bPass;
+}
+
+static bool bTestChurn()
+{
+    const uint32_t ulSites = 3 * FILE_LOGGER_LIMIT_SITES;
+    printf("churn: %u call sites in turn, 2 ms apart\n", (unsigned)ulSites);
+    std::vector<std::string> xFormats;
+    for (uint32_t i = 0; i < ulSites; i++)
+    {
+        xFormats.push_back("churn " + std::to_string(i) + " %u");
+    }
+
+    Counts_t xBefore = xCounts();
+    pcHostTaskName = pcChurn;
+    for (uint32_t ulRound = 0; ulRound < 10; ulRound++)
+    {
+        for (uint32_t i = 0; i < ulSites; i++)
+        {
+            logger_log(log_info, __FILE__, __FUNCTION__, 300 + i, xFormats[i].c_str(), (unsigned)ulRound);
+            vTick(2);
+        }
+    }
+    pcHostTaskName = "main";
+
+    /* Each call site is forgotten before it comes around again, so only the task's limit binds */
+    const uint32_t ulCalls = 10 * ulSites;
+    const uint32_t ulTask = ulExpected(FILE_LOGGER_TASK_RATE, FILE_LOGGER_TASK_BURST, xEvery(ulCalls, 2));
+    Counts_t xAfter = xCounts();
+    bool bPass = true;
+    char cWhat[80];
+    snprintf(cWhat, sizeof(cWhat), "the task logs %u of %u", (unsigned)ulTask, (unsigned)ulCalls);
+    bPass &= bCheck(xAfter.ulLogged - xBefore.ulLogged == ulTask && ulLinesWith(",churn ") == ulTask, cWhat);
+    bPass &= bCheck(lDroppedFor(true, pcChurn, 0) == (int)(ulCalls - ulTask), "the task is listed with its drops");
+    return bPass;
+}
+
+static int lBench()
+{
+    typedef std::chrono::steady_clock Clock_t;
+    const uint32_t ulCalls = 1000000;
+
+    /* The uptime stands still: after the burst, every call is dropped */
+    pcHostTaskName = pcFlood;
+    Clock_t::time_point xStart = Clock_t::now();
+    for (uint32_t i = 0; i < ulCalls; i++)
+    {
+        LOG_INFO("bench %u", (unsigned)i);
+    }
+    double xDroppedNs = std::chrono::duration<double, std::nano>(Clock_t::now() - xStart).count() / ulCalls;
+
+    /* A call site and task each, a new one every call: every call is logged */
+    const uint32_t ulLogged = 20000;
+    xStart = Clock_t::now();
+    for (uint32_t i = 0; i < ulLogged; i++)
+    {
+        pcHostTaskName = (i & 1) ? pcSteady : pcChatty;
+        vTick(100);
+        LOG_INFO("bench %u", (unsigned)i);
+    }
+    double xLoggedNs = std::chrono::duration<double, std::nano>(Clock_t::now() - xStart).count() / ulLogged;
+    pcHostTaskName = "main";
+
+    printf("dropped call: %.0f ns, logged call: %.0f ns (formatted into the ring)\n", xDroppedNs, xLoggedNs);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    Sink_t xSink;
+    pxSink = &xSink;
+    ullHostUptimeUs = 1000000;
+    logger_set_printf(log_debug, false);
+    logger_init(1);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+    {
+        return lBench();
+    }
+    if (argc > 1)
+    {
+        fprintf(stderr, "usage: %s [bench]\n", argv[0]);
+        return 2;
+    }
+
+    /* Each test starts with the buckets full */
+    bool bPass = bTestSite();
+    vTick(60 * 1000);
+    bPass &= bTestTask();
+    vTick(60 * 1000);
+    bPass &= bTestSample();
+    vTick(60 * 1000);
+    bPass &= bTestChurn();
+
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    fflush(stdout);
+    _exit(bPass ? 0 : 1); // the logger task is still waiting for work
+}
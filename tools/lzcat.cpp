@@ -0,0 +1,344 @@
+/**
+ * Prints the log in compressed log segments (FILE_LOGGER_COMPRESS, the
+ * "0:log_<n>.lz" files the segment task leaves): each one's header, then
+ * blocks of FILE_LOGGER_LZ_BLOCK_SIZE bytes of log, each behind a 2 byte
+ * tag, compressed by lz_compress.c or stored as they are.  Segments not
+ * compressed yet ("0:log_<n>.csv" or ".bin") are printed as they are, so
+ * "lzcat log_*" in order of number, then log.csv, prints the whole log.
+ *
+ * "test" packs a synthetic log, or the given files, the way the segment
+ * task does, unpacks it, and checks it comes back the same; it also feeds
+ * the decompressor cut and corrupt blocks, which it must reject without
+ * writing past its buffer.  "bench" times lz_compress and lz_decompress on
+ * the same data and reports the ratio.
+ *
+ * Build (from this directory):
+ *      gcc -O2 -std=gnu99 -I../L3_Utils -c ../L3_Utils/src/lz_compress.c
+ *      g++ -O2 -std=c++11 -I../L3_Utils -o lzcat lzcat.cpp lz_compress.o
+ *
+ * Usage:
+ *      lzcat <segment>...
+ *      lzcat test [file...]
+ *      lzcat bench [file...]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "file_logger.h"
+#include "lz_compress.h"
+
+static const size_t ulHeaderLen = 8; ///< FILE_LOGGER_LZ_MAGIC and the length of the log
+
+static bool bReadFile(const char* pcPath, std::vector<uint8_t>& xData)
+{
+    FILE* pFile = fopen(pcPath, "rb");
+    if (!pFile)
+    {
+        return false;
+    }
+    uint8_t ucBuf[4096];
+    size_t ulRead;
+    while ((ulRead = fread(ucBuf, 1, sizeof(ucBuf), pFile)) > 0)
+    {
+        xData.insert(xData.end(), ucBuf, ucBuf + ulRead);
+    }
+    fclose(pFile);
+    return true;
+}
+
+static bool bIsSegment(const std::vector<uint8_t>& xData)
+{
+    return xData.size() >= ulHeaderLen && !memcmp(xData.data(), FILE_LOGGER_LZ_MAGIC, 4);
+}
+
+/// Packs a log as logger_compress_segment() does
+static std::vector<uint8_t> xPack(const std::vector<uint8_t>& xLog)
+{
+    std::vector<uint8_t> xOut(ulHeaderLen);
+    std::vector<uint16_t> xTable(LZ_HASH_ENTRIES);
+    uint8_t ucPacked[2 + LZ_COMPRESS_BOUND(FILE_LOGGER_LZ_BLOCK_SIZE)];
+
+    memcpy(&xOut[0], FILE_LOGGER_LZ_MAGIC, 4);
+    for (int i = 0; i < 4; i++)
+    {
+        xOut[4 + i] = (uint8_t)(xLog.size() >> (8 * i));
+    }
+    for (size_t ulPos = 0; ulPos < xLog.size(); ulPos += FILE_LOGGER_LZ_BLOCK_SIZE)
+    {
+        uint32_t ulBytes = std::min<size_t>(FILE_LOGGER_LZ_BLOCK_SIZE, xLog.size() - ulPos);
+        uint32_t ulLen = lz_compress(&xLog[ulPos], ulBytes, ucPacked + 2, sizeof(ucPacked) - 2, xTable.data());
+        uint32_t ulTag = ulLen;
+        if (0 == ulLen || ulLen >= ulBytes)
+        {
+            memcpy(ucPacked + 2, &xLog[ulPos], ulBytes);
+            ulLen = ulBytes;
+            ulTag = ulBytes | FILE_LOGGER_LZ_STORED;
+        }
+        ucPacked[0] = ulTag & 0xFF;
+        ucPacked[1] = ulTag >> 8;
+        xOut.insert(xOut.end(), ucPacked, ucPacked + 2 + ulLen);
+    }
+    return xOut;
+}
+
+/// Unpacks a segment; @returns false if it is cut short or corrupt
+static bool bUnpack(const std::vector<uint8_t>& xSegment, std::vector<uint8_t>& xLog)
+{
+    if (!bIsSegment(xSegment))
+    {
+        return false;
+    }
+    const uint8_t* p = xSegment.data();
+    uint32_t ulLogSize = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+    uint8_t ucBlock[FILE_LOGGER_LZ_BLOCK_SIZE];
+    size_t ulPos = ulHeaderLen;
+
+    xLog.clear();
+    while (ulPos + 2 <= xSegment.size())
+    {
+        uint32_t ulTag = p[ulPos] | (p[ulPos + 1] << 8);
+        uint32_t ulLen = ulTag & ~FILE_LOGGER_LZ_STORED;
+        ulPos += 2;
+        if (ulPos + ulLen > xSegment.size())
+        {
+            return false;
+        }
+        if (ulTag & FILE_LOGGER_LZ_STORED)
+        {
+            xLog.insert(xLog.end(), p + ulPos, p + ulPos + ulLen);
+        }
+        else
+        {
+            int32_t lBytes = lz_decompress(p + ulPos, ulLen, ucBlock, sizeof(ucBlock));
+            if (lBytes < 0)
+            {
+                return false;
+            }
+            xLog.insert(xLog.end(), ucBlock, ucBlock + lBytes);
+        }
+        ulPos += ulLen;
+    }
+    return ulPos == xSegment.size() && xLog.size() == ulLogSize;
+}
+
+/// CSV lines like the text mode's, as the gantry and vision tasks log them
+static std::vector<uint8_t> xSyntheticLog(size_t ulBytes)
+{
+    static const char* const pcLines[] = {
+        "%02u/%02u,%02u:%02u:%02u,%u,info,gantry.cpp,vMove(),%u,Moved to column %u in %u ms\n",
+        "%02u/%02u,%02u:%02u:%02u,%u,info,pixy_eyes.cpp,vAction(),%u,Frame %u: %u blocks\n",
+        "%02u/%02u,%02u:%02u:%02u,%u,warn,pixy_brain.cpp,vUpdate(),%u,Chip at column %u unsure, %u votes\n",
+        "%02u/%02u,%02u:%02u:%02u,%u,debug,c4.cpp,lThink(),%u,Depth %u, score %u\n",
+    };
+    std::mt19937 xRand(1);
+    std::string xLog;
+    char cLine[160];
+    for (unsigned i = 0; xLog.size() < ulBytes; i++)
+    {
+        unsigned ulSec = i / 20;
+        snprintf(cLine, sizeof(cLine), pcLines[xRand() % 4], 10, 17, ulSec / 3600 % 24, ulSec / 60 % 60, ulSec % 60,
+                 i * 50, 40 + (unsigned)(xRand() % 200), (unsigned)(xRand() % 7), (unsigned)(xRand() % 5000));
+        xLog += cLine;
+    }
+    xLog.resize(ulBytes);
+    return std::vector<uint8_t>(xLog.begin(), xLog.end());
+}
+
+/// The test and bench data: the given files, or synthetic logs and data that doesn't compress
+static std::vector<std::pair<std::string, std::vector<uint8_t>>> xInputs(int argc, char** argv)
+{
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> xIn;
+    for (int i = 0; i < argc; i++)
+    {
+        std::vector<uint8_t> xData;
+        if (!bReadFile(argv[i], xData))
+        {
+            fprintf(stderr, "can't read %s\n", argv[i]);
+            exit(2);
+        }
+        xIn.push_back(std::make_pair(std::string(argv[i]), xData));
+    }
+    if (xIn.empty())
+    {
+        std::mt19937 xRand(2);
+        std::vector<uint8_t> xNoise(256 * 1024); // a segment at the default size
+        for (auto& ucByte : xNoise)
+        {
+            ucByte = xRand();
+        }
+        xIn.push_back(std::make_pair(std::string("log"), xSyntheticLog(xNoise.size())));
+        xIn.push_back(std::make_pair(std::string("noise"), xNoise));
+        xIn.push_back(std::make_pair(std::string("zeros"), std::vector<uint8_t>(xNoise.size(), 0)));
+        xIn.push_back(std::make_pair(std::string("short log"), xSyntheticLog(FILE_LOGGER_LZ_BLOCK_SIZE + 100)));
+        xIn.push_back(std::make_pair(std::string("empty"), std::vector<uint8_t>()));
+    }
+    return xIn;
+}
+
+/**
+ * Corrupt blocks must be rejected or decode to something, never write past the buffer: the
+ * output goes into a buffer with guard bytes after dst_max.
+ */
+static bool bFuzz(const std::vector<uint8_t>& xLog, uint32_t ulRounds)
+{
+    std::mt19937 xRand(3);
+    std::vector<uint16_t> xTable(LZ_HASH_ENTRIES);
+    std::vector<uint8_t> xPacked(LZ_COMPRESS_BOUND(FILE_LOGGER_LZ_BLOCK_SIZE));
+    const uint32_t ulGuard = 64;
+    std::vector<uint8_t> xOut(FILE_LOGGER_LZ_BLOCK_SIZE + ulGuard);
+
+    for (uint32_t i = 0; i < ulRounds; i++)
+    {
+        size_t ulPos = xRand() % (xLog.size() - FILE_LOGGER_LZ_BLOCK_SIZE);
+        uint32_t ulLen = lz_compress(&xLog[ulPos], FILE_LOGGER_LZ_BLOCK_SIZE, xPacked.data(), xPacked.size(),
+                                     xTable.data());
+        std::vector<uint8_t> xBad(xPacked.begin(), xPacked.begin() + ulLen);
+        switch (i % 3)
+        {
+            case 0: // cut short
+                xBad.resize(xRand() % ulLen);
+                break;
+            case 1: // bytes flipped
+                for (int j = 0; j < 4; j++)
+                {
+                    xBad[xRand() % ulLen] ^= 1 << (xRand() % 8);
+                }
+                break;
+            default: // garbage
+                for (auto& ucByte : xBad)
+                {
+                    ucByte = xRand();
+                }
+                break;
+        }
+
+        uint32_t ulMax = FILE_LOGGER_LZ_BLOCK_SIZE - (xRand() % 2) * (xRand() % 512);
+        memset(&xOut[ulMax], 0xA5, xOut.size() - ulMax);
+        int32_t lBytes = lz_decompress(xBad.data(), xBad.size(), xOut.data(), ulMax);
+        for (size_t j = ulMax; j < xOut.size(); j++)
+        {
+            if (xOut[j] != 0xA5)
+            {
+                printf("  fuzz round %u wrote past %u bytes\n", (unsigned)i, (unsigned)ulMax);
+                return false;
+            }
+        }
+        if (lBytes > (int32_t)ulMax)
+        {
+            printf("  fuzz round %u returned %d for %u bytes\n", (unsigned)i, (int)lBytes, (unsigned)ulMax);
+            return false;
+        }
+    }
+    return true;
+}
+
+static int lTest(int argc, char** argv)
+{
+    bool bPass = true;
+    for (auto& xIn : xInputs(argc, argv))
+    {
+        std::vector<uint8_t> xSegment = xPack(xIn.second), xLog;
+        bool bSame = bUnpack(xSegment, xLog) && xLog == xIn.second;
+
+        /* A segment whose compression was cut short must not pass for a whole one */
+        std::vector<uint8_t> xCut(xSegment.begin(), xSegment.end() - (xSegment.size() > ulHeaderLen ? 1 : 0));
+        bool bCutRejected = (xSegment.size() == ulHeaderLen) || !bUnpack(xCut, xLog);
+
+        printf("%-12s %8u bytes -> %8u (%5.1f%%) %s%s\n", xIn.first.c_str(), (unsigned)xIn.second.size(),
+               (unsigned)xSegment.size(), xIn.second.empty() ? 100.0 : 100.0 * xSegment.size() / xIn.second.size(),
+               bSame ? "round-trips" : "DIFFERS", bCutRejected ? "" : ", CUT SEGMENT ACCEPTED");
+        bPass = bPass && bSame && bCutRejected;
+    }
+
+    std::vector<uint8_t> xLog = xSyntheticLog(256 * 1024);
+    bool bFuzzed = bFuzz(xLog, 30000);
+    printf("corrupt blocks: %s\n", bFuzzed ? "rejected or kept in the buffer" : "WRITTEN PAST THE BUFFER");
+    bPass = bPass && bFuzzed;
+
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    return bPass ? 0 : 1;
+}
+
+static int lBench(int argc, char** argv)
+{
+    typedef std::chrono::steady_clock Clock_t;
+    const double xMinSec = 0.5;
+
+    for (auto& xIn : xInputs(argc, argv))
+    {
+        if (xIn.second.empty())
+        {
+            continue;
+        }
+        std::vector<uint8_t> xSegment, xLog;
+        uint32_t ulRuns = 0;
+        Clock_t::time_point xStart = Clock_t::now();
+        do
+        {
+            xSegment = xPack(xIn.second);
+            ulRuns++;
+        } while (std::chrono::duration<double>(Clock_t::now() - xStart).count() < xMinSec);
+        double xPackSec = std::chrono::duration<double>(Clock_t::now() - xStart).count() / ulRuns;
+
+        ulRuns = 0;
+        xStart = Clock_t::now();
+        do
+        {
+            bUnpack(xSegment, xLog);
+            ulRuns++;
+        } while (std::chrono::duration<double>(Clock_t::now() - xStart).count() < xMinSec);
+        double xUnpackSec = std::chrono::duration<double>(Clock_t::now() - xStart).count() / ulRuns;
+
+        double xMb = xIn.second.size() / (1024.0 * 1024.0);
+        printf("%-12s %8u bytes -> %8u (%5.1f%%), compress %7.1f MB/s, decompress %7.1f MB/s\n",
+               xIn.first.c_str(), (unsigned)xIn.second.size(), (unsigned)xSegment.size(),
+               100.0 * xSegment.size() / xIn.second.size(), xMb / xPackSec, xMb / xUnpackSec);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && !strcmp(argv[1], "test"))
+    {
+        return lTest(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "bench"))
+    {
+        return lBench(argc - 2, argv + 2);
+    }
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <segment>... | test [file...] | bench [file...]\n", argv[0]);
+        return 2;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::vector<uint8_t> xData, xLog;
+        if (!bReadFile(argv[i], xData))
+        {
+            fprintf(stderr, "can't read %s\n", argv[i]);
+            return 2;
+        }
+        if (!bIsSegment(xData))
+        {
+            xLog.swap(xData); // not compressed yet
+        }
+        else if (!bUnpack(xData, xLog))
+        {
+            fprintf(stderr, "%s is cut short or corrupt\n", argv[i]);
+            return 1;
+        }
+        fwrite(xLog.data(), 1, xLog.size(), stdout);
+    }
+    return 0;
+}
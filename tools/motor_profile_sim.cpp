@@ -0,0 +1,185 @@
+/**
+ * Runs the gantry's StepProfile_t (L5_Application/motor/step_profile.hpp)
+ * the way MotorTask_t's step interrupt does, one period at a time, and
+ * reports each move: steps, time, peak rate and steps spent ramping, next
+ * to the ideal trapezoid GameTask_t plans with and the constant 1 rotation
+ * per second the gantry ran at before.
+ *
+ * Fails if a move gives out a step too many or too few, goes over the top
+ * rate, or speeds up on the way down; ends with PASS or FAIL.
+ *
+ * Build (from this directory):
+ *      g++ -O2 -std=c++11 -I.. -I../L5_Application -o motor_profile_sim motor_profile_sim.cpp
+ *
+ * Usage:
+ *      motor_profile_sim [-r rot/s] [-a rot/s^2] [-c cpu Hz] [rotations ...]
+ *
+ * Without rotations, runs the move to every column (GameTask_t's
+ * xRotationsTo()).
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "motor/config.hpp"
+#include "motor/step_profile.hpp"
+
+using namespace team9::motor;
+
+/// MotorTask_t runs the MCPWM off CCLK / 8
+static const uint32_t PCLK_DIVIDER = 8;
+
+/// As GameTask_t::xRotationsTo()
+static float xRotationsTo(int lCol)
+{
+    return 0.4833f * lCol + 1.6f;
+}
+
+struct Move_t
+{
+    uint32_t ulSteps;
+    uint32_t ulGiven;
+    double xSeconds;
+    double xPeakHz;
+    uint32_t ulRampSteps;
+    bool bOverTop;
+    bool bSpedUpDown;
+};
+
+static Move_t xRun(StepProfile_t& xProfile, uint32_t ulSteps, uint32_t ulTickHz, uint32_t ulMinTicks)
+{
+    Move_t xMove = {ulSteps, 0, 0.0, 0.0, 0, false, false};
+    std::vector<uint32_t> xTicks;
+    xProfile.vStart(ulSteps);
+    for (uint32_t ulTick = xProfile.ulNextTicks(); ulTick; ulTick = xProfile.ulNextTicks())
+    {
+        xTicks.push_back(ulTick);
+    }
+    xMove.ulGiven = xTicks.size();
+
+    uint32_t ulFastest = ~0u;
+    for (size_t i = 0; i < xTicks.size(); i++)
+    {
+        xMove.xSeconds += (double)xTicks[i] / ulTickHz;
+        if (xTicks[i] < ulFastest)
+        {
+            ulFastest = xTicks[i];
+        }
+        // One tick of slack: the top rate's period is rounded down
+        xMove.bOverTop |= (xTicks[i] + 1 < ulMinTicks);
+    }
+    xMove.xPeakHz = xTicks.empty() ? 0.0 : (double)ulTickHz / ulFastest;
+
+    // Up to the first fastest step, down from the last one
+    size_t ulFirst = xTicks.size(), ulLast = 0;
+    for (size_t i = 0; i < xTicks.size(); i++)
+    {
+        if (xTicks[i] == ulFastest)
+        {
+            if (ulFirst == xTicks.size())
+            {
+                ulFirst = i;
+            }
+            ulLast = i;
+        }
+    }
+    xMove.ulRampSteps = xTicks.empty() ? 0 : ulFirst;
+    for (size_t i = ulLast + 1; i < xTicks.size(); i++)
+    {
+        xMove.bSpedUpDown |= (xTicks[i] < xTicks[i - 1]);
+    }
+    return xMove;
+}
+
+int main(int argc, char** argv)
+{
+    float xMaxRps = MOTOR_MAX_RPS;
+    float xAccelRps2 = MOTOR_ACCEL_RPS2;
+    uint32_t ulCpuHz = 48000000;
+    std::vector<float> xRotations;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc)
+        {
+            xMaxRps = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-a") && i + 1 < argc)
+        {
+            xAccelRps2 = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+        {
+            ulCpuHz = strtoul(argv[++i], NULL, 10);
+        }
+        else
+        {
+            xRotations.push_back(atof(argv[i]));
+        }
+    }
+    if (xMaxRps <= 0.0f || xAccelRps2 <= 0.0f || !ulCpuHz)
+    {
+        fprintf(stderr, "usage: %s [-r rot/s] [-a rot/s^2] [-c cpu Hz] [rotations ...]\n", argv[0]);
+        return 2;
+    }
+    bool bColumns = xRotations.empty();
+    for (int lCol = 0; bColumns && lCol < 7; lCol++)
+    {
+        xRotations.push_back(xRotationsTo(lCol));
+    }
+
+    uint32_t ulTickHz = ulCpuHz / PCLK_DIVIDER;
+    float xMaxHz = xMaxRps * MOTOR_STEPS_PER_ROT;
+    StepProfile_t xProfile;
+    xProfile.vSetRates(ulTickHz, xMaxHz, xAccelRps2 * MOTOR_STEPS_PER_ROT);
+    uint32_t ulMinTicks = (uint32_t)(ulTickHz / xMaxHz);
+
+    printf("%.2f rot/s top, %.2f rot/s^2, %u steps/rot, %u Hz ticks\n",
+           xMaxRps, xAccelRps2, MOTOR_STEPS_PER_ROT, ulTickHz);
+    printf("%-4s %6s %6s %8s %8s %8s %9s %6s\n",
+           bColumns ? "col" : "", "rot", "steps", "ms", "ideal", "1 rot/s", "peak/s", "ramp");
+
+    bool bPass = true;
+    double xTotalMs = 0.0, xTotalOldMs = 0.0;
+    for (size_t i = 0; i < xRotations.size(); i++)
+    {
+        // MotorTask_t truncates the same way
+        uint32_t ulSteps = (uint32_t)(MOTOR_STEPS_PER_ROT * xRotations[i]);
+        Move_t xMove = xRun(xProfile, ulSteps, ulTickHz, ulMinTicks);
+        double xMs = 1000.0 * xMove.xSeconds;
+        double xOldMs = 1000.0 * ulSteps / MOTOR_STEPS_PER_ROT;
+        xTotalMs += xMs;
+        xTotalOldMs += xOldMs;
+
+        char cLabel[12] = "";
+        if (bColumns)
+        {
+            snprintf(cLabel, sizeof(cLabel), "%u", (unsigned)i);
+        }
+        printf("%-4s %6.3f %6u %8.1f %8u %8.1f %9.1f %6u", cLabel, xRotations[i], ulSteps,
+               xMs, xProfile.ulMoveMs(ulSteps), xOldMs, xMove.xPeakHz, xMove.ulRampSteps);
+
+        if (xMove.ulGiven != ulSteps)
+        {
+            printf("  %u steps given", xMove.ulGiven);
+            bPass = false;
+        }
+        if (xMove.bOverTop)
+        {
+            printf("  over the top rate");
+            bPass = false;
+        }
+        if (xMove.bSpedUpDown)
+        {
+            printf("  sped up ramping down");
+            bPass = false;
+        }
+        printf("\n");
+    }
+    printf("total %.1f ms, %.1f ms at 1 rot/s\n", xTotalMs, xTotalOldMs);
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    return bPass ? 0 : 1;
+}
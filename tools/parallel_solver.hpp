@@ -0,0 +1,160 @@
+#ifndef C4_PARALLEL_SOLVER_HPP
+#define C4_PARALLEL_SOLVER_HPP
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "connect_four/position.hpp"
+#include "connect_four/solver.hpp"
+#include "connect_four/transposition_table.hpp"
+
+namespace team9
+{
+namespace c4
+{
+
+/**
+ * Lazy SMP search for the host, every thread runs Solver_t::xSearch() on
+ * the same position and they only cooperate through one shared
+ * transposition table.  Odd helpers start one ply deeper so they fill the
+ * table with the results the others need next.  The first thread to finish
+ * stops the rest and the most complete result (exact, then deepest, then
+ * the main thread) is returned.
+ *
+ * xSolve() is the exception: the main thread runs Solver_t::xSolve(), which
+ * beats deepening one ply at a time when the answer has to be exact, and the
+ * helpers only deepen to feed it table entries.
+ */
+class ParallelSolver_t
+{
+    public:
+        /// @param ulThreads  Search threads, 0 for one per hardware thread
+        ParallelSolver_t(unsigned ulThreads, unsigned ulTTLog2Entries) :
+                xTable(ulTTLog2Entries), bAbort(false)
+        {
+            if (ulThreads == 0)
+            {
+                ulThreads = std::thread::hardware_concurrency();
+            }
+            for (unsigned ulI = 0; ulI < (ulThreads ? ulThreads : 1); ++ulI)
+            {
+                xWorkers.push_back(std::unique_ptr<Worker_t>(new Worker_t(xTable, bAbort, ulI)));
+            }
+        }
+
+        /// Same contract as Solver_t::xSearch(), ulNodes is the sum over all threads
+        Solver_t::Result_t xSearch(const Position_t& xPosition, uint64_t ulDeadlineMs,
+                                   unsigned ulMaxDepth = 0)
+        {
+            return xRunAll(xPosition, ulDeadlineMs, ulMaxDepth, false);
+        }
+
+        /// Searches to the end of the game, the result is exact
+        Solver_t::Result_t xSolve(const Position_t& xPosition)
+        {
+            return xRunAll(xPosition, 0, 0, true);
+        }
+
+        void vSetClock(Solver_t::ClockMs_t pfClock)
+        {
+            for (size_t ulI = 0; ulI < xWorkers.size(); ++ulI)
+            {
+                xWorkers[ulI]->vSetClock(pfClock);
+            }
+        }
+
+        unsigned ulThreads() const
+        {
+            return xWorkers.size();
+        }
+
+        TranspositionTable_t& xGetTable()
+        {
+            return xTable;
+        }
+
+    private:
+        class Worker_t : public Solver_t
+        {
+            public:
+                Worker_t(TranspositionTable_t& xTable, const std::atomic<bool>& bAbort_arg,
+                         unsigned ulIndex) :
+                        Solver_t(xTable), bAbort(bAbort_arg)
+                {
+                    ulFirstDepth = 1 + (ulIndex % 2);
+                }
+
+            protected:
+                bool bTimeUp()
+                {
+                    return bAbort.load(std::memory_order_relaxed) || Solver_t::bTimeUp();
+                }
+
+                const std::atomic<bool>& bAbort;
+        };
+
+        Solver_t::Result_t xRunAll(const Position_t& xPosition, uint64_t ulDeadlineMs,
+                                   unsigned ulMaxDepth, bool bSolve)
+        {
+            std::vector<Solver_t::Result_t> xResults(xWorkers.size());
+            std::vector<std::thread> xThreads;
+            bAbort.store(false);
+
+            for (size_t ulI = 1; ulI < xWorkers.size(); ++ulI)
+            {
+                xThreads.push_back(std::thread(&ParallelSolver_t::vRun, this, ulI,
+                                               std::cref(xPosition), ulDeadlineMs,
+                                               ulMaxDepth, std::ref(xResults[ulI])));
+            }
+            if (bSolve)
+            {
+                xResults[0] = xWorkers[0]->xSolve(xPosition);
+                bAbort.store(true);
+            }
+            else
+            {
+                vRun(0, xPosition, ulDeadlineMs, ulMaxDepth, xResults[0]);
+            }
+            for (size_t ulI = 0; ulI < xThreads.size(); ++ulI)
+            {
+                xThreads[ulI].join();
+            }
+
+            size_t ulBest = 0;
+            uint64_t ulNodes = 0;
+            for (size_t ulI = 0; ulI < xResults.size(); ++ulI)
+            {
+                ulNodes += xResults[ulI].ulNodes;
+                const Solver_t::Result_t& xBest = xResults[ulBest];
+                const Solver_t::Result_t& xResult = xResults[ulI];
+                if (xResult.bExact > xBest.bExact ||
+                    (xResult.bExact == xBest.bExact && xResult.ulDepth > xBest.ulDepth))
+                {
+                    ulBest = ulI;
+                }
+            }
+            Solver_t::Result_t xResult = xResults[ulBest];
+            xResult.ulNodes = ulNodes;
+            return xResult;
+        }
+
+        void vRun(size_t ulIndex, const Position_t& xPosition, uint64_t ulDeadlineMs,
+                  unsigned ulMaxDepth, Solver_t::Result_t& xResult)
+        {
+            xResult = xWorkers[ulIndex]->xSearch(xPosition, ulDeadlineMs, ulMaxDepth);
+            bAbort.store(true);
+        }
+
+        TranspositionTable_t xTable;
+        std::atomic<bool> bAbort;
+        std::vector<std::unique_ptr<Worker_t> > xWorkers;
+};
+
+} // namespace c4
+} // namespace team9
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ * Checks that the steady-state vision cycle does not touch the heap: Pixy
+ * bytes are parsed into a Frame_t and run through Board_t::lProcessFrame(),
+ * the same path as PixyBrain_t::lSampleChips(), while operator new counts
+ * allocations.  Exits non-zero if any cycle after the first allocates.
+ *
+ * Build (from this directory), --gc-sections drops the libfixmatrix functions
+ * whose libfixmath sources (sqrt, trig) are not in the tree:
+ *      gcc -O2 -ffunction-sections -I.. -I../L4_IO -c ../L4_IO/pixy/libfixmath/fix16.c
+ *          ../L4_IO/pixy/libfixmatrix/fixvector2d.c
+ *      g++ -O2 -std=c++11 -I.. -I../L4_IO -I../L3_Utils -I../L4_IO/fat -I../L2_Drivers
+ *          -I../L0_LowLevel -I../L5_Application -I../L1_FreeRTOS/include
+ *          -I../L1_FreeRTOS/portable -I../L1_FreeRTOS -Wl,--gc-sections
+ *          -o pixy_alloc_test pixy_alloc_test.cpp fix16.o fixvector2d.o
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <new>
+#include <vector>
+
+#include "pixy/common/board.hpp"
+#include "pixy/common/frame.hpp"
+#include "pixy/pixy_parser.hpp"
+
+using namespace team9::pixy;
+
+static const int CYCLES = 200;
+
+static bool bCounting = false;
+static uint32_t ulAllocations = 0;
+
+void* operator new(size_t ulBytes)
+{
+    if (bCounting)
+    {
+        ulAllocations++;
+    }
+    void* pMem = malloc(ulBytes ? ulBytes : 1);
+    if (!pMem)
+    {
+        throw std::bad_alloc();
+    }
+    return pMem;
+}
+
+void* operator new[](size_t ulBytes)
+{
+    return operator new(ulBytes);
+}
+
+void operator delete(void* pMem) noexcept
+{
+    free(pMem);
+}
+
+void operator delete[](void* pMem) noexcept
+{
+    free(pMem);
+}
+
+/// The board prints through UART0, stdout is enough here
+extern "C" int u0_dbg_printf(const char* pcFormat, ...)
+{
+    va_list xArgs;
+    va_start(xArgs, pcFormat);
+    int lLen = vprintf(pcFormat, xArgs);
+    va_end(xArgs);
+    return lLen;
+}
+
+static void vPutWord(std::vector<uint8_t>& xOut, uint16_t usWord)
+{
+    xOut.push_back(usWord >> 8);
+    xOut.push_back(usWord & 0xff);
+}
+
+static void vPutBlock(std::vector<uint8_t>& xOut, uint16_t usSignature, float xY, float xX)
+{
+    uint16_t usWords[5] = {usSignature, (uint16_t)(xX + 0.5f), (uint16_t)(xY + 0.5f), 10, 10};
+    vPutWord(xOut, 0xaa55);
+    vPutWord(xOut, usWords[0] + usWords[1] + usWords[2] + usWords[3] + usWords[4]);
+    for (int lW = 0; lW < 5; ++lW)
+    {
+        vPutWord(xOut, usWords[lW]);
+    }
+}
+
+int main()
+{
+    // Board 280 x 160 pixels, 40 pixels between columns and 32 between rows
+    const float xTop = 20, xBottom = 180, xLeft = 20, xRight = 300;
+    Corners_t xCorners;
+    Block_t xCorner;
+    Quadrant_t eQuadrants[4] = {TOP_LEFT, TOP_RIGHT, BOT_LEFT, BOT_RIGHT};
+    for (int lQ = 0; lQ < 4; ++lQ)
+    {
+        xCorner.xPoint.xY = (eQuadrants[lQ] == BOT_LEFT || eQuadrants[lQ] == BOT_RIGHT) ? xBottom : xTop;
+        xCorner.xPoint.xX = (eQuadrants[lQ] == TOP_RIGHT || eQuadrants[lQ] == BOT_RIGHT) ? xRight : xLeft;
+        xCorners.vUpdate(eQuadrants[lQ], xCorner);
+    }
+    Board_t xBoard(xCorners, GREEN);
+
+    // Every frame shows a green chip at the bottom of column 3 and red
+    // noise across the top row, then CHIPS_AT_A_TIME more blocks are cut
+    // off by the arena's capacity
+    std::vector<uint8_t> xStream;
+    vPutWord(xStream, 0xaa55);
+    vPutBlock(xStream, GREEN, xBottom, xLeft + 3 * (xRight - xLeft) / 6);
+    for (uint32_t ulB = 0; ulB < CHIPS_AT_A_TIME + 6; ++ulB)
+    {
+        vPutBlock(xStream, RED, xTop, xLeft + (ulB % 7) * (xRight - xLeft) / 6);
+    }
+
+    PixyParser_t xParser;
+    Frame_t xFrame;
+    int lChanges = 0;
+    uint32_t ulWarmup = 0;
+    for (int lCycle = 0; lCycle < CYCLES; ++lCycle)
+    {
+        // The first cycle may set up stdio buffers, everything after must not allocate
+        bCounting = (lCycle > 0);
+
+        uint32_t ulCount = 0;
+        xFrame.vClear();
+        xParser.vReset();
+        xParser.ulParse(xStream.data(), xStream.size(), xFrame.xBlocks.xStorage(), ulCount);
+        xFrame.xBlocks.vResize(ulCount);
+        if (xBoard.lProcessFrame(xFrame) >= 0)
+        {
+            lChanges++;
+        }
+
+        if (lCycle == 0)
+        {
+            ulWarmup = ulAllocations;
+        }
+    }
+    bCounting = false;
+
+    // Make sure the counter itself works
+    uint32_t ulBefore = ulAllocations;
+    bCounting = true;
+    delete new int(0);
+    bCounting = false;
+
+    fprintf(stderr, "\n%d cycles, %u blocks per frame, %d column changes\n",
+            CYCLES, (unsigned)xFrame.xBlocks.size(), lChanges);
+    fprintf(stderr, "heap allocations after the first cycle: %u\n", ulAllocations - ulWarmup - 1);
+    if (ulAllocations != ulBefore + 1 || lChanges == 0 || xFrame.xBlocks.size() != CHIPS_AT_A_TIME)
+    {
+        fprintf(stderr, "FAIL: test setup\n");
+        return 2;
+    }
+    if (ulAllocations - ulWarmup - 1 != 0)
+    {
+        fprintf(stderr, "FAIL\n");
+        return 1;
+    }
+    fprintf(stderr, "PASS\n");
+    return 0;
+}
@@ -0,0 +1,211 @@
+/**
+ * Compares Pixy_t's state dispatch before and after StateTable_t: the old
+ * FuncMap_t (std::function handlers in a std::map) with std::map<enum,
+ * std::string> names, against the constexpr StateTable_t and NameTable_t.
+ * Both drive the same six-state machine, each tick looks up the state's
+ * name the way Pixy_t::vAction() prints it and calls its handler.
+ *
+ * Reports ns per tick, heap allocations and bytes to set each one up, and
+ * the size of the objects.  The host's std::map nodes are bigger than the
+ * board's, the allocation counts carry over.
+ *
+ * Build (from this directory):
+ *      g++ -O2 -std=c++11 -I.. -I../L4_IO -o pixy_dispatch_bench pixy_dispatch_bench.cpp
+ *
+ * Usage:
+ *      pixy_dispatch_bench [ticks]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <new>
+#include <string>
+
+#include "pixy/common/state_table.hpp"
+
+using namespace team9::pixy;
+
+static bool bCounting = false;
+static uint32_t ulAllocations = 0;
+static size_t ulAllocatedBytes = 0;
+
+void* operator new(size_t ulBytes)
+{
+    if (bCounting)
+    {
+        ulAllocations++;
+        ulAllocatedBytes += ulBytes;
+    }
+    void* pMem = malloc(ulBytes ? ulBytes : 1);
+    if (!pMem)
+    {
+        throw std::bad_alloc();
+    }
+    return pMem;
+}
+
+void operator delete(void* pMem) noexcept
+{
+    free(pMem);
+}
+
+void operator delete(void* pMem, size_t) noexcept
+{
+    free(pMem);
+}
+
+enum State_t {CALIB_STATE, RESET_STATE, WAITING_FOR_HUMAN, WAITING_FOR_BOT, WAITING_FOR_RESET, ERROR,
+              STATE_COUNT};
+
+/// The FuncMap_t Pixy_t used to hold its handlers in
+template<typename KEY_T, typename FUN_T, typename ... ARG_T>
+struct FuncMap_t
+{
+    std::map<KEY_T, std::function<FUN_T(ARG_T ... xArgs)>> fpMap;
+
+    void vSetHandler(KEY_T xElem, std::function<FUN_T(ARG_T ... xArgs)> fnHandler)
+    {
+        fpMap[xElem] = fnHandler;
+    }
+
+    std::function<FUN_T(ARG_T ... xArgs)>& vResponse(KEY_T xElem)
+    {
+        return fpMap[xElem];
+    }
+};
+
+/// Walks the states in order, like a game does
+struct Machine_t
+{
+    Machine_t() : eState(CALIB_STATE), ulNameChars(0)
+    {}
+
+    void vNext()
+    {
+        eState = (State_t)((eState + 1) % STATE_COUNT);
+    }
+
+    State_t eState;
+    uint32_t ulNameChars; // keeps the name lookups from being optimized out
+};
+
+/// Before: Pixy_t's maps, filled at startup
+struct MapMachine_t : Machine_t
+{
+    MapMachine_t()
+    {
+        xFuncMap.vSetHandler(CALIB_STATE, [&] () { vNext(); });
+        xFuncMap.vSetHandler(RESET_STATE, [&] () { vNext(); });
+        xFuncMap.vSetHandler(WAITING_FOR_HUMAN, [&] () { vNext(); });
+        xFuncMap.vSetHandler(WAITING_FOR_BOT, [&] () { vNext(); });
+        xFuncMap.vSetHandler(WAITING_FOR_RESET, [&] () { vNext(); });
+        xFuncMap.vSetHandler(ERROR, [&] () { vNext(); });
+        xStateStrMap[CALIB_STATE] = std::string("CALIB_STATE");
+        xStateStrMap[RESET_STATE] = std::string("RESET_STATE");
+        xStateStrMap[WAITING_FOR_HUMAN] = std::string("WAITING_FOR_HUMAN");
+        xStateStrMap[WAITING_FOR_BOT] = std::string("WAITING_FOR_BOT");
+        xStateStrMap[WAITING_FOR_RESET] = std::string("WAITING_FOR_RESET");
+        xStateStrMap[ERROR] = std::string("ERROR");
+    }
+
+    void vTick()
+    {
+        ulNameChars += xStateStrMap[eState].c_str()[0];
+        xFuncMap.vResponse(eState)();
+    }
+
+    std::map<State_t, std::string> xStateStrMap;
+    FuncMap_t<State_t, void> xFuncMap;
+};
+
+/// After: tables in flash
+struct TableMachine_t : Machine_t
+{
+    void vCalibState() { vNext(); }
+    void vResetState() { vNext(); }
+    void vWaitingForHuman() { vNext(); }
+    void vWaitingForBot() { vNext(); }
+    void vWaitingForReset() { vNext(); }
+    void vErrorState() { vNext(); }
+
+    void vTick();
+};
+
+static constexpr NameTable_t<State_t, STATE_COUNT> xStateNames = {{
+    "CALIB_STATE", "RESET_STATE", "WAITING_FOR_HUMAN", "WAITING_FOR_BOT", "WAITING_FOR_RESET", "ERROR"
+}};
+static_assert(xStateNames.bComplete(), "every State_t needs a name");
+
+static constexpr StateTable_t<TableMachine_t, State_t, STATE_COUNT> xStates = {{
+    &TableMachine_t::vCalibState,
+    &TableMachine_t::vResetState,
+    &TableMachine_t::vWaitingForHuman,
+    &TableMachine_t::vWaitingForBot,
+    &TableMachine_t::vWaitingForReset,
+    &TableMachine_t::vErrorState
+}};
+static_assert(xStates.bComplete(), "every State_t needs a handler");
+
+void TableMachine_t::vTick()
+{
+    ulNameChars += xStateNames.pcName(eState)[0];
+    xStates.bDispatch(*this, eState);
+}
+
+template<typename Machine_t>
+static double xNsPerTick(Machine_t& xMachine, uint32_t ulTicks)
+{
+    auto xStart = std::chrono::steady_clock::now();
+    for (uint32_t ulI = 0; ulI < ulTicks; ++ulI)
+    {
+        xMachine.vTick();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - xStart).count() / ulTicks;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t ulTicks = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000000;
+
+    ulAllocations = 0;
+    ulAllocatedBytes = 0;
+    bCounting = true;
+    MapMachine_t* pMaps = new MapMachine_t;
+    bCounting = false;
+    uint32_t ulMapAllocs = ulAllocations;
+    size_t ulMapBytes = ulAllocatedBytes;
+
+    ulAllocations = 0;
+    ulAllocatedBytes = 0;
+    bCounting = true;
+    TableMachine_t* pTables = new TableMachine_t;
+    bCounting = false;
+    uint32_t ulTableAllocs = ulAllocations;
+    size_t ulTableBytes = ulAllocatedBytes;
+
+    bCounting = true;
+    ulAllocations = 0;
+    double xMapNs = xNsPerTick(*pMaps, ulTicks);
+    double xTableNs = xNsPerTick(*pTables, ulTicks);
+    bCounting = false;
+
+    printf("%u ticks, %d states\n", ulTicks, (int)STATE_COUNT);
+    printf("std::map + std::function  %6.2f ns/tick  setup: %2u allocations, %4zu heap bytes, object %3zu bytes\n",
+           xMapNs, ulMapAllocs, ulMapBytes, sizeof(MapMachine_t));
+    printf("StateTable_t              %6.2f ns/tick  setup: %2u allocations, %4zu heap bytes, object %3zu bytes\n",
+           xTableNs, ulTableAllocs, ulTableBytes, sizeof(TableMachine_t));
+    printf("constant tables: handlers %zu bytes, names %zu bytes of pointers, in flash on the board\n",
+           sizeof(xStates), sizeof(xStateNames));
+    printf("allocations while ticking: %u\n", ulAllocations);
+
+    bool bPass = (pMaps->ulNameChars == pTables->ulNameChars) && (pMaps->eState == pTables->eState) &&
+                 ulTableAllocs == 1 && ulAllocations == 0;
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    delete pMaps;
+    delete pTables;
+    return bPass ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+/**
+ * Compares the ways of finding the nearest block to each chip center on
+ * random 200-block frames against the 42 centers of a board:
+ *
+ *      xCalcDist   Point_t::xCalcDist per pair, sqrt and pow (the old loop)
+ *      scalar      vDist2Scalar, squared float distances from a PointBatch_t
+ *      simd        vDist2Simd, the same with SSE2 or AVX (-mavx)
+ *      simd fused  ulNearestSimd, SSE2 with the minimum kept in registers,
+ *                  what Board_t uses on the host
+ *      int         vDist2Int, fix16_t coordinates and exact int64 distances
+ *      int fused   ulNearestInt, the same in one pass, what Board_t uses on
+ *                  the board
+ *
+ * and checks they all pick the same block, apart from exact ties.
+ *
+ * Build (from this directory), add -mavx for the AVX kernel:
+ *      g++ -O2 -std=c++11 -I.. -I../L4_IO -I../L3_Utils -o pixy_dist_bench pixy_dist_bench.cpp
+ *
+ * Usage:
+ *      pixy_dist_bench [frames]
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include "pixy/config.hpp"
+#include "pixy/common.hpp"
+#include "pixy/common/point.hpp"
+#include "pixy/common/point_batch.hpp"
+
+using namespace team9::pixy;
+
+static const uint32_t CENTERS = 42;
+
+typedef PointBatch_t<float, CHIPS_AT_A_TIME> FloatBatch_t;
+typedef PointBatch_t<fix16_t, CHIPS_AT_A_TIME> IntBatch_t;
+
+struct Frame_t
+{
+    std::vector<Point_t<uint16_t>> xBlocks;
+    FloatBatch_t xFloat;
+    IntBatch_t xInt;
+};
+
+template<typename Func_t>
+static double xTime(int lReps, uint32_t ulPairs, Func_t xFunc)
+{
+    auto xStart = std::chrono::steady_clock::now();
+    for (int lRep = 0; lRep < lReps; ++lRep)
+    {
+        xFunc();
+    }
+    double xNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - xStart).count();
+    return xNs / ((double)lReps * ulPairs);
+}
+
+int main(int argc, char** argv)
+{
+    const int lFrames = (argc > 1) ? atoi(argv[1]) : 500;
+
+    // Chip centers on a 280 x 160 pixel board, a little off the pixel grid
+    std::vector<Point_t<float>> xCenters;
+    for (uint32_t ulI = 0; ulI < CENTERS; ++ulI)
+    {
+        xCenters.push_back(Point_t<float>(20.3f + (ulI / 7) * 32.1f, 20.7f + (ulI % 7) * 46.6f));
+    }
+
+    srand(11);
+    std::vector<Frame_t> xFrames(lFrames);
+    for (Frame_t& xFrame : xFrames)
+    {
+        for (uint32_t ulB = 0; ulB < CHIPS_AT_A_TIME; ++ulB)
+        {
+            Point_t<uint16_t> xPt(rand() % PIXY_CAM_ROWS, rand() % PIXY_CAM_COLS);
+            xFrame.xBlocks.push_back(xPt);
+            xFrame.xFloat.push_back(xPt.xY, xPt.xX);
+            xFrame.xInt.push_back(fix16_from_int(xPt.xY), fix16_from_int(xPt.xX));
+        }
+    }
+
+    // Nearest block per frame and center, one table per method
+    const size_t ulResults = (size_t)lFrames * CENTERS;
+    std::vector<uint32_t> xRef(ulResults), xScalar(ulResults), xSimd(ulResults), xInt(ulResults);
+    float xDist2[CHIPS_AT_A_TIME];
+    int64_t llDist2[CHIPS_AT_A_TIME];
+    const uint32_t ulPairs = lFrames * CENTERS * CHIPS_AT_A_TIME;
+    const int lReps = 5;
+
+    double xRefNs = xTime(lReps, ulPairs, [&]()
+    {
+        for (int lF = 0; lF < lFrames; ++lF)
+        {
+            for (uint32_t ulC = 0; ulC < CENTERS; ++ulC)
+            {
+                float xBest = 9999;
+                uint32_t ulBest = 0;
+                for (uint32_t ulB = 0; ulB < CHIPS_AT_A_TIME; ++ulB)
+                {
+                    float xDist = Point_t<float>::xCalcDist(xCenters[ulC], xFrames[lF].xBlocks[ulB]);
+                    if (xDist < xBest)
+                    {
+                        xBest = xDist;
+                        ulBest = ulB;
+                    }
+                }
+                xRef[lF * CENTERS + ulC] = ulBest;
+            }
+        }
+    });
+
+    double xScalarNs = xTime(lReps, ulPairs, [&]()
+    {
+        for (int lF = 0; lF < lFrames; ++lF)
+        {
+            const FloatBatch_t& xBatch = xFrames[lF].xFloat;
+            for (uint32_t ulC = 0; ulC < CENTERS; ++ulC)
+            {
+                vDist2Scalar(xBatch.pxY(), xBatch.pxX(), xBatch.size(),
+                             xCenters[ulC].xY, xCenters[ulC].xX, xDist2);
+                xScalar[lF * CENTERS + ulC] = ulArgMin(xDist2, xBatch.size());
+            }
+        }
+    });
+
+    double xSimdNs = xTime(lReps, ulPairs, [&]()
+    {
+        for (int lF = 0; lF < lFrames; ++lF)
+        {
+            const FloatBatch_t& xBatch = xFrames[lF].xFloat;
+            for (uint32_t ulC = 0; ulC < CENTERS; ++ulC)
+            {
+                vDist2Simd(xBatch.pxY(), xBatch.pxX(), xBatch.size(),
+                           xCenters[ulC].xY, xCenters[ulC].xX, xDist2);
+                xSimd[lF * CENTERS + ulC] = ulArgMin(xDist2, xBatch.size());
+            }
+        }
+    });
+
+    std::vector<uint32_t> xFused(ulResults);
+    double xFusedNs = xTime(lReps, ulPairs, [&]()
+    {
+        for (int lF = 0; lF < lFrames; ++lF)
+        {
+            const FloatBatch_t& xBatch = xFrames[lF].xFloat;
+            for (uint32_t ulC = 0; ulC < CENTERS; ++ulC)
+            {
+                float xBest;
+                xFused[lF * CENTERS + ulC] = ulNearestSimd(xBatch.pxY(), xBatch.pxX(), xBatch.size(),
+                                                           xCenters[ulC].xY, xCenters[ulC].xX, xBest);
+            }
+        }
+    });
+
+    double xIntNs = xTime(lReps, ulPairs, [&]()
+    {
+        for (int lF = 0; lF < lFrames; ++lF)
+        {
+            const IntBatch_t& xBatch = xFrames[lF].xInt;
+            for (uint32_t ulC = 0; ulC < CENTERS; ++ulC)
+            {
+                vDist2Int(xBatch.pxY(), xBatch.pxX(), xBatch.size(), fix16_from_float(xCenters[ulC].xY),
+                          fix16_from_float(xCenters[ulC].xX), llDist2);
+                xInt[lF * CENTERS + ulC] = ulArgMin(llDist2, xBatch.size());
+            }
+        }
+    });
+
+    std::vector<uint32_t> xIntFused(ulResults);
+    double xIntFusedNs = xTime(lReps, ulPairs, [&]()
+    {
+        for (int lF = 0; lF < lFrames; ++lF)
+        {
+            const IntBatch_t& xBatch = xFrames[lF].xInt;
+            for (uint32_t ulC = 0; ulC < CENTERS; ++ulC)
+            {
+                int64_t llBest;
+                xIntFused[lF * CENTERS + ulC] = ulNearestInt(xBatch.pxY(), xBatch.pxX(), xBatch.size(),
+                                                             fix16_from_float(xCenters[ulC].xY),
+                                                             fix16_from_float(xCenters[ulC].xX), llBest);
+            }
+        }
+    });
+
+    // A different pick only counts if it is not as close as the reference's
+    const int METHODS = 5;
+    uint32_t ulDiffs[METHODS] = {0, 0, 0, 0, 0};
+    std::vector<uint32_t>* pxMethods[METHODS] = {&xScalar, &xSimd, &xFused, &xInt, &xIntFused};
+    for (size_t ulR = 0; ulR < ulResults; ++ulR)
+    {
+        const Point_t<float>& xCenter = xCenters[ulR % CENTERS];
+        const Frame_t& xFrame = xFrames[ulR / CENTERS];
+        double xRefDist = Point_t<float>::xCalcDist(xCenter, xFrame.xBlocks[xRef[ulR]]);
+        for (int lM = 0; lM < METHODS; ++lM)
+        {
+            uint32_t ulPick = (*pxMethods[lM])[ulR];
+            double xDist = Point_t<float>::xCalcDist(xCenter, xFrame.xBlocks[ulPick]);
+            if (ulPick != xRef[ulR] && fabs(xDist - xRefDist) > 1e-4)
+            {
+                ulDiffs[lM]++;
+            }
+        }
+    }
+
+#ifdef PIXY_DIST_SIMD
+    const char* pcSimd = PIXY_DIST_SIMD;
+#else
+    const char* pcSimd = "none, scalar";
+#endif
+    printf("%d frames x %u blocks x %u centers\n", lFrames, (unsigned)CHIPS_AT_A_TIME, (unsigned)CENTERS);
+    printf("xCalcDist  %6.2f ns/pair\n", xRefNs);
+    printf("scalar     %6.2f ns/pair  (%.1fx)  %u different picks\n", xScalarNs, xRefNs / xScalarNs, ulDiffs[0]);
+    printf("simd       %6.2f ns/pair  (%.1fx)  %u different picks  [%s]\n", xSimdNs, xRefNs / xSimdNs,
+           ulDiffs[1], pcSimd);
+    printf("simd fused %6.2f ns/pair  (%.1fx)  %u different picks\n", xFusedNs, xRefNs / xFusedNs,
+           ulDiffs[2]);
+    printf("int        %6.2f ns/pair  (%.1fx)  %u different picks\n", xIntNs, xRefNs / xIntNs, ulDiffs[3]);
+    printf("int fused  %6.2f ns/pair  (%.1fx)  %u different picks\n", xIntFusedNs, xRefNs / xIntFusedNs,
+           ulDiffs[4]);
+
+    bool bPass = true;
+    for (int lM = 0; lM < METHODS; ++lM)
+    {
+        bPass = bPass && !ulDiffs[lM];
+    }
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    return bPass ? 0 : 1;
+}
@@ -0,0 +1,307 @@
+/**
+ * Checks Homography_t, the fixed point camera-to-board map behind
+ * Board_t::vChipAlgoHomography(), against the same map in double precision
+ * and times the per-block projection.
+ *
+ *  - Chip centers on a keystoned board: the homography against the old
+ *    interpolation along the board's edges (Point_t::xPointsOnLine)
+ *  - Every pixel of the image: board coordinates and the cell they round to
+ *  - A recorded stream (tools/pixy_sim.cpp or RecordingPixySource_t), if
+ *    given: corners calibrated from its green blocks like
+ *    PixyBrain_t::vCalibCorners(), then every block projected
+ *
+ * Cycles are read with rdtsc on x86, the Cortex-M3 has no FPU and a slower
+ * 64-bit divide so expect more there.
+ *
+ * Build (from this directory), see pixy_alloc_test.cpp for the C objects:
+ *      gcc -O2 -ffunction-sections -I.. -I../L4_IO -c ../L4_IO/pixy/libfixmath/fix16.c
+ *          ../L4_IO/pixy/libfixmatrix/fixvector2d.c
+ *      g++ -O2 -std=c++11 -I.. -I../L4_IO -I../L3_Utils -I../L4_IO/fat -I../L2_Drivers
+ *          -I../L0_LowLevel -I../L5_Application -I../L1_FreeRTOS/include
+ *          -I../L1_FreeRTOS/portable -I../L1_FreeRTOS -Wl,--gc-sections
+ *          -o pixy_homography_bench pixy_homography_bench.cpp fix16.o fixvector2d.o
+ *
+ * Usage:
+ *      pixy_homography_bench [recording]
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "pixy/config.hpp"
+#include "pixy/common.hpp"
+#include "pixy/common/block.hpp"
+#include "pixy/common/corners.hpp"
+#include "pixy/common/frame.hpp"
+#include "pixy/common/homography.hpp"
+#include "pixy/pixy_parser.hpp"
+
+using namespace team9::pixy;
+
+static const int ROWS = 6;
+static const int COLS = 7;
+
+extern "C" int u0_dbg_printf(const char* pcFormat, ...)
+{
+    return 0;
+}
+
+/// Homography_t's math in double, the reference
+struct RefHomography_t
+{
+    double xFwd[9];
+    double xInv[9];
+
+    void vFit(const Point_t<float>& xTL, const Point_t<float>& xTR,
+              const Point_t<float>& xBL, const Point_t<float>& xBR)
+    {
+        double x0 = xTL.xX, y0 = xTL.xY, x1 = xTR.xX, y1 = xTR.xY;
+        double x2 = xBR.xX, y2 = xBR.xY, x3 = xBL.xX, y3 = xBL.xY;
+        double xSX = x0 - x1 + x2 - x3, xSY = y0 - y1 + y2 - y3;
+        double xDX1 = x1 - x2, xDX2 = x3 - x2, xDY1 = y1 - y2, xDY2 = y3 - y2;
+        double xDen = xDX1 * xDY2 - xDX2 * xDY1;
+        double xG = (xSX * xDY2 - xDX2 * xSY) / xDen;
+        double xH = (xDX1 * xSY - xSX * xDY1) / xDen;
+        double xM[9] = {x1 - x0 + xG * x1, x3 - x0 + xH * x3, x0,
+                        y1 - y0 + xG * y1, y3 - y0 + xH * y3, y0, xG, xH, 1};
+        std::copy(xM, xM + 9, xFwd);
+        double xA[9] = {xM[4] * xM[8] - xM[5] * xM[7], xM[2] * xM[7] - xM[1] * xM[8],
+                        xM[1] * xM[5] - xM[2] * xM[4], xM[5] * xM[6] - xM[3] * xM[8],
+                        xM[0] * xM[8] - xM[2] * xM[6], xM[2] * xM[3] - xM[0] * xM[5],
+                        xM[3] * xM[7] - xM[4] * xM[6], xM[1] * xM[6] - xM[0] * xM[7],
+                        xM[0] * xM[4] - xM[1] * xM[3]};
+        std::copy(xA, xA + 9, xInv);
+    }
+
+    Point_t<double> xToCamera(double xRow, double xCol) const
+    {
+        double xS = xCol / (COLS - 1), xT = xRow / (ROWS - 1);
+        double xW = xFwd[6] * xS + xFwd[7] * xT + xFwd[8];
+        return Point_t<double>((xFwd[3] * xS + xFwd[4] * xT + xFwd[5]) / xW,
+                               (xFwd[0] * xS + xFwd[1] * xT + xFwd[2]) / xW);
+    }
+
+    void vToBoard(double xY, double xX, double& xRow, double& xCol) const
+    {
+        double xW = xInv[6] * xX + xInv[7] * xY + xInv[8];
+        xCol = (xInv[0] * xX + xInv[1] * xY + xInv[2]) / xW * (COLS - 1);
+        xRow = (xInv[3] * xX + xInv[4] * xY + xInv[5]) / xW * (ROWS - 1);
+    }
+};
+
+static double xPixelDist(const Point_t<float>& xA, const Point_t<double>& xB)
+{
+    return hypot(xA.xY - xB.xY, xA.xX - xB.xX);
+}
+
+static uint64_t ullTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/// @returns the largest error in cells, counts pixels whose rounded cell differs
+static double xCompare(const Homography_t& xFix, const RefHomography_t& xRef,
+                       const std::vector<Point_t<uint16_t>>& xPixels, uint32_t& ulCellDiffs,
+                       uint32_t& ulOnBoard)
+{
+    double xMaxErr = 0;
+    ulCellDiffs = 0;
+    ulOnBoard = 0;
+    for (const Point_t<uint16_t>& xPx : xPixels)
+    {
+        fix16_t xRow, xCol;
+        double xRefRow, xRefCol;
+        xRef.vToBoard(xPx.xY, xPx.xX, xRefRow, xRefCol);
+        if (!xFix.bToBoard(xPx.xY, xPx.xX, xRow, xCol))
+        {
+            continue;
+        }
+        double xErr = std::max(fabs(fix16_to_dbl(xRow) - xRefRow), fabs(fix16_to_dbl(xCol) - xRefCol));
+        xMaxErr = std::max(xMaxErr, xErr);
+        // Within fix16_t's error of a cell edge either cell is right
+        bool bOnEdge = fabs(fabs(xRefRow - lround(xRefRow)) - 0.5) < 0.001 ||
+                       fabs(fabs(xRefCol - lround(xRefCol)) - 0.5) < 0.001;
+        if (!bOnEdge && (fix16_to_int(xRow) != (int)lround(xRefRow) ||
+                         fix16_to_int(xCol) != (int)lround(xRefCol)))
+        {
+            ulCellDiffs++;
+        }
+        if (hypot(xRefRow - lround(xRefRow), xRefCol - lround(xRefCol)) < CHIP_PROXIM_TOLERANCE &&
+            xRefRow > -0.5 && xRefRow < ROWS - 0.5 && xRefCol > -0.5 && xRefCol < COLS - 0.5)
+        {
+            ulOnBoard++;
+        }
+    }
+    return xMaxErr;
+}
+
+static bool bReadFile(const char* pcFile, std::vector<uint8_t>& xOut)
+{
+    FILE* pFile = fopen(pcFile, "rb");
+    if (!pFile)
+    {
+        return false;
+    }
+    uint8_t ucBuf[4096];
+    size_t ulRead;
+    while ((ulRead = fread(ucBuf, 1, sizeof(ucBuf), pFile)) > 0)
+    {
+        xOut.insert(xOut.end(), ucBuf, ucBuf + ulRead);
+    }
+    fclose(pFile);
+    return true;
+}
+
+static int lRecorded(const char* pcFile)
+{
+    std::vector<uint8_t> xStream;
+    if (!bReadFile(pcFile, xStream))
+    {
+        fprintf(stderr, "cannot read %s\n", pcFile);
+        return 2;
+    }
+
+    // Every block of the stream, then the first CHIPS_TO_CALIB green ones by quadrant
+    std::vector<Block_t> xBlocks(xStream.size() / 14 + 1);
+    uint32_t ulCount = 0;
+    PixyParser_t xParser;
+    xParser.ulParse(xStream.data(), xStream.size(),
+                    Span_t<Block_t>(xBlocks.data(), xBlocks.size()), ulCount);
+    xBlocks.resize(ulCount);
+
+    Corners_t xCorners;
+    uint32_t ulCalib = 0;
+    for (uint32_t ulI = 0; ulI < ulCount && ulI < CHIPS_TO_CALIB; ++ulI)
+    {
+        Block_t& xBlock = xBlocks[ulI];
+        if (xBlock.usSignature != GREEN || xBlock.xPoint.xY >= PIXY_CAM_ROWS ||
+            xBlock.xPoint.xX >= PIXY_CAM_COLS)
+        {
+            continue;
+        }
+        bool bBottom = xBlock.xPoint.xY > PIXY_CAM_ROWS / 2;
+        bool bRight = xBlock.xPoint.xX > PIXY_CAM_COLS / 2;
+        Quadrant_t eQuadrant = bBottom ? (bRight ? BOT_RIGHT : BOT_LEFT) : (bRight ? TOP_RIGHT : TOP_LEFT);
+        xCorners.vUpdate(eQuadrant, xBlock);
+        ulCalib++;
+    }
+
+    Homography_t xFix;
+    RefHomography_t xRef;
+    if (!ulCalib || !xFix.bFit(xCorners(TOP_LEFT), xCorners(TOP_RIGHT), xCorners(BOT_LEFT),
+                               xCorners(BOT_RIGHT), COLS, ROWS))
+    {
+        fprintf(stderr, "%s: no usable calibration in the first %u blocks\n", pcFile,
+                (unsigned)CHIPS_TO_CALIB);
+        return 1;
+    }
+    xRef.vFit(xCorners(TOP_LEFT), xCorners(TOP_RIGHT), xCorners(BOT_LEFT), xCorners(BOT_RIGHT));
+
+    std::vector<Point_t<uint16_t>> xPixels;
+    for (const Block_t& xBlock : xBlocks)
+    {
+        xPixels.push_back(xBlock.xPoint);
+    }
+    uint32_t ulCellDiffs, ulOnBoard;
+    double xMaxErr = xCompare(xFix, xRef, xPixels, ulCellDiffs, ulOnBoard);
+    printf("recording %s: %u blocks, %u on a cell, max error %.5f cells, %u cell mismatches\n",
+           pcFile, ulCount, ulOnBoard, xMaxErr, ulCellDiffs);
+    return ulCellDiffs ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    // Camera tilted down at the board: the far (top) row is narrower
+    Point_t<float> xTL(40, 75), xTR(38, 250), xBL(178, 18), xBR(175, 300);
+
+    Homography_t xFix;
+    RefHomography_t xRef;
+    if (!xFix.bFit(xTL, xTR, xBL, xBR, COLS, ROWS))
+    {
+        printf("FAIL: fit\n");
+        return 1;
+    }
+    xRef.vFit(xTL, xTR, xBL, xBR);
+
+    // Chip centers, against the board's old edge interpolation
+    std::vector<Point_t<float>> xLeft, xRight, xRow;
+    Point_t<float>::xPointsOnLine(xTL, xBL, ROWS, xLeft);
+    Point_t<float>::xPointsOnLine(xTR, xBR, ROWS, xRight);
+    double xMaxFix = 0, xMaxLerp = 0;
+    for (int lRow = 0; lRow < ROWS; ++lRow)
+    {
+        Point_t<float>::xPointsOnLine(xLeft[lRow], xRight[lRow], COLS, xRow);
+        for (int lCol = 0; lCol < COLS; ++lCol)
+        {
+            Point_t<double> xTrue = xRef.xToCamera(lRow, lCol);
+            xMaxFix = std::max(xMaxFix, xPixelDist(xFix.xToCamera(fix16_from_int(lRow),
+                                                                  fix16_from_int(lCol)), xTrue));
+            xMaxLerp = std::max(xMaxLerp, xPixelDist(xRow[lCol], xTrue));
+        }
+    }
+    printf("chip centers, max error: homography %.3f px, edge interpolation %.3f px\n",
+           xMaxFix, xMaxLerp);
+
+    // Every pixel of the image
+    std::vector<Point_t<uint16_t>> xPixels;
+    for (uint16_t usY = 0; usY < PIXY_CAM_ROWS; ++usY)
+    {
+        for (uint16_t usX = 0; usX < PIXY_CAM_COLS; ++usX)
+        {
+            xPixels.push_back(Point_t<uint16_t>(usY, usX));
+        }
+    }
+    uint32_t ulCellDiffs, ulOnBoard;
+    double xMaxErr = xCompare(xFix, xRef, xPixels, ulCellDiffs, ulOnBoard);
+    printf("%zu pixels: max error %.5f cells, %u pixels round to another cell\n",
+           xPixels.size(), xMaxErr, ulCellDiffs);
+
+    // Timing, in random order so the branch predictor does not learn the image
+    srand(5);
+    std::random_shuffle(xPixels.begin(), xPixels.end(), [](int lN) { return rand() % lN; });
+    const int lReps = 20;
+    volatile int32_t lSink = 0;
+    uint64_t ullStart = ullTicks();
+    auto xStart = std::chrono::steady_clock::now();
+    for (int lRep = 0; lRep < lReps; ++lRep)
+    {
+        for (const Point_t<uint16_t>& xPx : xPixels)
+        {
+            fix16_t xR, xC;
+            if (xFix.bToBoard(xPx.xY, xPx.xX, xR, xC))
+            {
+                lSink += xR ^ xC;
+            }
+        }
+    }
+    double xNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - xStart).count();
+    uint64_t ullCycles = ullTicks() - ullStart;
+    double xBlocks = (double)lReps * xPixels.size();
+    printf("bToBoard: %.1f ns/block", xNs / xBlocks);
+    if (ullCycles)
+    {
+        printf(", %.1f cycles/block (rdtsc)", ullCycles / xBlocks);
+    }
+    printf("\n");
+
+    int lRet = (ulCellDiffs || xMaxFix > 0.05) ? 1 : 0;
+    if (argc > 1)
+    {
+        lRet |= lRecorded(argv[1]);
+    }
+    printf("%s\n", lRet ? "FAIL" : "PASS");
+    return lRet;
+}
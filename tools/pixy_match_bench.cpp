@@ -0,0 +1,220 @@
+/**
+ * Times Board_t's chip-to-block matching algorithms (STUPID, DOWN_RIGHT, GRID
+ * and HOMOGRAPHY) on random 200-block frames over a skewed board, and counts
+ * the frames where GRID and HOMOGRAPHY disagree with STUPID.  Here STUPID
+ * measures every chip against every block with SIMD floats (point_batch.hpp),
+ * on the LPC1758 with 64-bit integers, so GRID's one distance per block
+ * gains more on the board.  STUPID_SQRT is STUPID as it was before
+ * point_batch.hpp, one float sqrt per chip and block, as a baseline.  Then times the bookkeeping after matching,
+ * vUpdate() and lColChanged(), over GRID's matches.  Each algorithm's time
+ * is its fastest of ten passes over the frames, the algorithms taking turns,
+ * so a busy host adds little.
+ *
+ * Build (from this directory), see pixy_alloc_test.cpp for the C objects:
+ *      gcc -O2 -ffunction-sections -I.. -I../L4_IO -c ../L4_IO/pixy/libfixmath/fix16.c
+ *          ../L4_IO/pixy/libfixmatrix/fixvector2d.c
+ *      g++ -O2 -std=c++11 -I.. -I../L4_IO -I../L3_Utils -I../L4_IO/fat -I../L2_Drivers
+ *          -I../L0_LowLevel -I../L5_Application -I../L1_FreeRTOS/include
+ *          -I../L1_FreeRTOS/portable -I../L1_FreeRTOS -Wl,--gc-sections
+ *          -o pixy_match_bench pixy_match_bench.cpp fix16.o fixvector2d.o
+ *
+ * Usage:
+ *      pixy_match_bench [frames]
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "pixy/common/board.hpp"
+#include "pixy/common/frame.hpp"
+
+using namespace team9::pixy;
+
+/// Board_t prints its calibration, nobody is listening on UART0 here
+extern "C" int u0_dbg_printf(const char* pcFormat, ...)
+{
+    return 0;
+}
+
+static Point_t<float> xLerp(const Point_t<float>& xA, const Point_t<float>& xB, float xT)
+{
+    return Point_t<float>(xA.xY + (xB.xY - xA.xY) * xT, xA.xX + (xB.xX - xA.xX) * xT);
+}
+
+/// One pass over the frames, keeps the faster of this pass and xBest (0 for none)
+template<typename Algo_t>
+static void vTime(const std::vector<BlockArena_t>& xFrames, std::vector<SeenChips_t>& xOut,
+                  double& xBest, Algo_t xAlgo)
+{
+    xOut.assign(xFrames.size(), SeenChips_t());
+    auto xStart = std::chrono::steady_clock::now();
+    for (size_t ulF = 0; ulF < xFrames.size(); ++ulF)
+    {
+        // The algorithms take a mutable span but only read the blocks
+        xAlgo(const_cast<BlockArena_t&>(xFrames[ulF]), xOut[ulF]);
+    }
+    double xUs = std::chrono::duration<double>(std::chrono::steady_clock::now() - xStart).count() /
+                 xFrames.size() * 1e6;
+    xBest = (xBest == 0) ? xUs : std::min(xBest, xUs);
+}
+
+/// vChipAlgoStupid() before point_batch.hpp
+static void vStupidSqrt(const Board_t& xBoard, const BlockArena_t& xBlocks, float xMaxDist,
+                        SeenChips_t& xSeenChips)
+{
+    for (int lCol = 0; lCol < 7; ++lCol)
+    {
+        int lRow = xBoard.lWatchedRow(lCol);
+        if (!xBoard.bInBounds<Board_t::ROW>(lRow))
+        {
+            continue;
+        }
+        int lIdx = xBoard.lBoardIdx(lRow, lCol);
+        const Point_t<float> xChipPt = xBoard.xChipPoint(lIdx);
+        ChipColor_t eColor = NONE;
+        float xBestDist = 9999;
+        for (const Block_t& xBlock : xBlocks)
+        {
+            float xDist = Point_t<float>::xCalcDist(xChipPt, xBlock.xPoint);
+            if (xDist < xBestDist)
+            {
+                eColor = (ChipColor_t)xBlock.usSignature;
+                xBestDist = xDist;
+            }
+        }
+        if (xBestDist < xMaxDist)
+        {
+            xSeenChips.push_back(std::make_pair(lIdx, eColor));
+        }
+    }
+}
+
+static bool bSame(const SeenChips_t& xA, const SeenChips_t& xB)
+{
+    std::vector<SeenChip_t> xSortedA(xA.begin(), xA.end());
+    std::vector<SeenChip_t> xSortedB(xB.begin(), xB.end());
+    std::sort(xSortedA.begin(), xSortedA.end());
+    std::sort(xSortedB.begin(), xSortedB.end());
+    return xSortedA == xSortedB;
+}
+
+int main(int argc, char** argv)
+{
+    const int lFrames = (argc > 1) ? atoi(argv[1]) : 500;
+
+    // Slightly rotated and keystoned, like a real calibration
+    Point_t<float> xTL(30, 25), xTR(22, 305), xBL(185, 15), xBR(178, 300);
+    Corners_t xCorners;
+    Quadrant_t eQuadrants[4] = {TOP_LEFT, TOP_RIGHT, BOT_LEFT, BOT_RIGHT};
+    Point_t<float> xPoints[4] = {xTL, xTR, xBL, xBR};
+    for (int lQ = 0; lQ < 4; ++lQ)
+    {
+        Block_t xCorner;
+        xCorner.xPoint.xY = xPoints[lQ].xY;
+        xCorner.xPoint.xX = xPoints[lQ].xX;
+        xCorners.vUpdate(eQuadrants[lQ], xCorner);
+    }
+    Board_t xBoard(xCorners, GREEN);
+
+    // Partly filled board so every column watches a different row
+    srand(7);
+    for (int lCol = 0; lCol < 7; ++lCol)
+    {
+        PixyCmd_t xCmd = {false, lCol, RED};
+        for (int lRow = rand() % 6; lRow > 0; --lRow)
+        {
+            xBoard.lInsert(xCmd);
+        }
+    }
+
+    // Half the blocks sit near a chip (anywhere on the board), half are noise
+    std::vector<BlockArena_t> xFrames(lFrames);
+    for (int lF = 0; lF < lFrames; ++lF)
+    {
+        for (uint32_t ulB = 0; ulB < CHIPS_AT_A_TIME; ++ulB)
+        {
+            Block_t xBlock = Block_t();
+            xBlock.usSignature = 1 + rand() % 2;
+            if (rand() % 2)
+            {
+                int lRow = rand() % 6;
+                int lCol = rand() % 7;
+                Point_t<float> xPt = xLerp(xLerp(xTL, xBL, lRow / 5.0f), xLerp(xTR, xBR, lRow / 5.0f),
+                                           lCol / 6.0f);
+                xBlock.xPoint.xY = (uint16_t)std::max(0.0f, xPt.xY + (rand() % 25) - 12);
+                xBlock.xPoint.xX = (uint16_t)std::max(0.0f, xPt.xX + (rand() % 25) - 12);
+            }
+            else
+            {
+                xBlock.xPoint.xY = rand() % PIXY_CAM_ROWS;
+                xBlock.xPoint.xX = rand() % PIXY_CAM_COLS;
+            }
+            xFrames[lF].push_back(xBlock);
+        }
+    }
+
+    std::vector<SeenChips_t> xStupidSqrt, xStupid, xDownRight, xGrid, xHomography;
+    const int lReps = 10;
+    const float xMaxDist = xBoard.xMatchDist();
+    double xStupidSqrtUs = 0, xStupidUs = 0, xDownRightUs = 0, xGridUs = 0, xHomographyUs = 0;
+    // Round robin, so load on the host slows every algorithm alike
+    for (int lRep = 0; lRep < lReps; ++lRep)
+    {
+        vTime(xFrames, xStupidSqrt, xStupidSqrtUs, [&](BlockArena_t& xB, SeenChips_t& xS)
+              { vStupidSqrt(xBoard, xB, xMaxDist, xS); });
+        vTime(xFrames, xStupid, xStupidUs, [&](BlockArena_t& xB, SeenChips_t& xS)
+              { xBoard.vChipAlgoStupid(xB, xS); });
+        vTime(xFrames, xDownRight, xDownRightUs, [&](BlockArena_t& xB, SeenChips_t& xS)
+              { xBoard.vChipAlgoDownRight(xB, xS); });
+        vTime(xFrames, xGrid, xGridUs, [&](BlockArena_t& xB, SeenChips_t& xS)
+              { xBoard.vChipAlgoGrid(xB, xS); });
+        vTime(xFrames, xHomography, xHomographyUs, [&](BlockArena_t& xB, SeenChips_t& xS)
+              { xBoard.vChipAlgoHomography(xB, xS); });
+    }
+
+    int lMismatches = 0;
+    int lSqrtDiffs = 0;
+    int lHomographyDiffs = 0;
+    size_t ulMatches = 0;
+    for (int lF = 0; lF < lFrames; ++lF)
+    {
+        lMismatches += !bSame(xStupid[lF], xGrid[lF]);
+        lSqrtDiffs += !bSame(xStupidSqrt[lF], xStupid[lF]);
+        lHomographyDiffs += !bSame(xStupid[lF], xHomography[lF]);
+        ulMatches += xGrid[lF].size();
+    }
+
+    // Last, it moves the watched rows along as chips become known
+    auto xStart = std::chrono::steady_clock::now();
+    int lChanges = 0;
+    for (int lRep = 0; lRep < lReps; ++lRep)
+    {
+        for (int lF = 0; lF < lFrames; ++lF)
+        {
+            xBoard.vUpdate(xGrid[lF]);
+            lChanges += xBoard.lColChanged() >= 0;
+        }
+    }
+    double xTrackUs = std::chrono::duration<double>(std::chrono::steady_clock::now() - xStart).count() /
+                      (lReps * lFrames) * 1e6;
+
+    printf("%d frames of %u blocks, %zu chips matched by GRID\n", lFrames,
+           (unsigned)CHIPS_AT_A_TIME, ulMatches);
+    printf("STUPID_SQRT %8.2f us/frame\n", xStupidSqrtUs);
+    printf("STUPID      %8.2f us/frame  (%.2fx STUPID_SQRT)\n", xStupidUs, xStupidSqrtUs / xStupidUs);
+    printf("DOWN_RIGHT  %8.2f us/frame\n", xDownRightUs);
+    printf("GRID        %8.2f us/frame  (%.2fx STUPID, %.2fx STUPID_SQRT)\n", xGridUs,
+           xStupidUs / xGridUs, xStupidSqrtUs / xGridUs);
+    printf("HOMOGRAPHY  %8.2f us/frame  (%.2fx STUPID)\n", xHomographyUs, xStupidUs / xHomographyUs);
+    printf("vUpdate + lColChanged %8.2f us/frame, %d columns changed\n", xTrackUs, lChanges);
+    printf("frames where STUPID and STUPID_SQRT differ: %d\n", lSqrtDiffs);
+    printf("frames where GRID and STUPID differ: %d\n", lMismatches);
+    printf("frames where HOMOGRAPHY and STUPID differ: %d (tolerance in cells, not pixels)\n",
+           lHomographyDiffs);
+    return 0;
+}
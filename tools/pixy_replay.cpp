@@ -0,0 +1,171 @@
+/**
+ * Replays a captured Pixy SPI byte stream through the board's PixyParser_t
+ * and reports the parse rate.
+ *
+ * Build (from this directory):
+ *      g++ -O2 -std=c++11 -I.. -I../L4_IO -I../L3_Utils -o pixy_replay pixy_replay.cpp
+ *
+ * Usage:
+ *      pixy_replay gen <file> [frames]         Writes a synthetic capture
+ *      pixy_replay <file> [chunk] [passes]     Parses <file> chunk bytes at a time
+ *
+ * A capture is the raw bytes received on MISO, as ssp1_dma_exchange_block()
+ * stores them.  The chunk size defaults to PIXY_DMA_CHUNK_BYTES so the
+ * parser sees the same splits as on the board.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "pixy/config.hpp"
+#include "pixy/common/frame.hpp"
+#include "pixy/pixy_parser.hpp"
+
+using namespace team9::pixy;
+
+static void vPutWord(std::vector<uint8_t>& xOut, uint16_t usWord)
+{
+    xOut.push_back(usWord >> 8);
+    xOut.push_back(usWord & 0xff);
+}
+
+/// Frames of 20 to 60 blocks, one in 16 color coded and one in 64 corrupted
+static int lGenerate(const char* pcFile, uint32_t ulFrames)
+{
+    std::vector<uint8_t> xOut;
+    uint32_t ulGood = 0;
+    uint32_t ulBad = 0;
+    srand(1);
+    for (uint32_t ulFrame = 0; ulFrame < ulFrames; ++ulFrame)
+    {
+        vPutWord(xOut, 0xaa55);
+        uint32_t ulBlocks = 20 + rand() % 41;
+        for (uint32_t ulB = 0; ulB < ulBlocks; ++ulB)
+        {
+            bool bColorCoded = (rand() % 16) == 0;
+            uint16_t usWords[6] = {(uint16_t)(1 + rand() % 2), (uint16_t)(rand() % 320),
+                                   (uint16_t)(rand() % 200), (uint16_t)(1 + rand() % 20),
+                                   (uint16_t)(1 + rand() % 20), (uint16_t)(rand() % 360)};
+            uint32_t ulWords = bColorCoded ? 6 : 5;
+            uint16_t usSum = 0;
+            for (uint32_t ulW = 0; ulW < ulWords; ++ulW)
+            {
+                usSum += usWords[ulW];
+            }
+            if ((rand() % 64) == 0)
+            {
+                usSum ^= 1;
+                ulBad++;
+            }
+            else
+            {
+                ulGood++;
+            }
+
+            vPutWord(xOut, bColorCoded ? 0xaa56 : 0xaa55);
+            vPutWord(xOut, usSum);
+            for (uint32_t ulW = 0; ulW < ulWords; ++ulW)
+            {
+                vPutWord(xOut, usWords[ulW]);
+            }
+        }
+        // End of frame, then idle words until the next one
+        for (uint32_t ulIdle = 0; ulIdle < 4; ++ulIdle)
+        {
+            vPutWord(xOut, 0x0000);
+        }
+    }
+
+    FILE* pxFile = fopen(pcFile, "wb");
+    if (!pxFile || fwrite(xOut.data(), 1, xOut.size(), pxFile) != xOut.size())
+    {
+        printf("error writing %s\n", pcFile);
+        return 1;
+    }
+    fclose(pxFile);
+    printf("%u frames, %zu bytes, blocks %u, checksum errors %u\n",
+           ulFrames, xOut.size(), ulGood, ulBad);
+    return 0;
+}
+
+static int lReplay(const char* pcFile, uint32_t ulChunk, uint32_t ulPasses)
+{
+    std::vector<uint8_t> xData;
+    FILE* pxFile = fopen(pcFile, "rb");
+    if (!pxFile)
+    {
+        printf("error opening %s\n", pcFile);
+        return 1;
+    }
+    uint8_t ucBuffer[4096];
+    size_t ulRead;
+    while ((ulRead = fread(ucBuffer, 1, sizeof(ucBuffer), pxFile)) > 0)
+    {
+        xData.insert(xData.end(), ucBuffer, ucBuffer + ulRead);
+    }
+    fclose(pxFile);
+
+    // Same batching as PixyEyes_t::lSeenBlocks()
+    PixyParser_t xParser;
+    BlockArena_t xBlocks;
+    uint64_t ulTotalBlocks = 0;
+    uint64_t ulErrors = 0;
+
+    auto xStart = std::chrono::steady_clock::now();
+    for (uint32_t ulPass = 0; ulPass < ulPasses; ++ulPass)
+    {
+        uint32_t ulCount = 0;
+        xParser.vReset();
+        for (size_t ulOffset = 0; ulOffset < xData.size(); ulOffset += ulChunk)
+        {
+            uint32_t ulBytes = (uint32_t)std::min<size_t>(ulChunk, xData.size() - ulOffset);
+            uint32_t ulUsed = 0;
+            while (ulUsed < ulBytes)
+            {
+                ulUsed += xParser.ulParse(&xData[ulOffset + ulUsed], ulBytes - ulUsed,
+                                          xBlocks.xStorage(), ulCount);
+                if (ulCount == xBlocks.capacity())
+                {
+                    ulTotalBlocks += ulCount;
+                    ulCount = 0;
+                }
+            }
+        }
+        ulTotalBlocks += ulCount;
+        ulErrors += xParser.ulGetChecksumErrors();
+    }
+    double xSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - xStart).count();
+
+    printf("%zu bytes x %u passes, chunk %u\n", xData.size(), ulPasses, ulChunk);
+    printf("blocks %llu, checksum errors %llu\n",
+           (unsigned long long)(ulTotalBlocks / ulPasses), (unsigned long long)(ulErrors / ulPasses));
+    printf("%.3f s, %.1f Mblocks/s, %.1f MB/s\n", xSeconds, ulTotalBlocks / xSeconds / 1e6,
+           (double)xData.size() * ulPasses / xSeconds / 1e6);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "gen") == 0)
+    {
+        return lGenerate(argv[2], (argc > 3) ? atoi(argv[3]) : 1000);
+    }
+    if (argc >= 2 && strcmp(argv[1], "gen") != 0)
+    {
+        uint32_t ulChunk = (argc > 2) ? atoi(argv[2]) : PIXY_DMA_CHUNK_BYTES;
+        uint32_t ulPasses = (argc > 3) ? atoi(argv[3]) : 100;
+        if (ulChunk == 0 || ulPasses == 0)
+        {
+            printf("chunk and passes must be positive\n");
+            return 1;
+        }
+        return lReplay(argv[1], ulChunk, ulPasses);
+    }
+    fprintf(stderr, "usage: %s gen <file> [frames] | <file> [chunk] [passes]\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,537 @@
+/**
+ * Runs the board's Pixy task code (Pixy_t::vAction, PixyBrain_t, Board_t)
+ * on a PC against a recorded SPI stream, as fast as it can, and reports
+ * frames/sec, the human moves it detected, the bot chips it saw land, its
+ * state transitions and what its debug output cost.
+ *
+ * The recording is what RecordingPixySource_t appends to the SD card when
+ * PIXY_RECORD_PATH is set: the bytes PixyEyes_t read, in order.  Replaying
+ * them with the same bot moves takes Pixy_t down the same path, so a run
+ * on the board can be debugged here.  "gen" records a synthetic game: a
+ * simulated camera shows the corner chips for calibration, then the chips
+ * of <moves> as they are played, through the same recorder.
+ *
+ * Moves are columns 1 to 7, human first, as in c4.cpp: "4453" is human 4,
+ * bot 4, human 5, bot 3.  The bot's moves are fed to Pixy_t's queue when it
+ * reports a human move, the human ones are what it should detect.  The
+ * simulated GameTask_t is ready for the next human move straight away.
+ *
+ * FreeRTOS queues, the shared object table, Storage and the uptime counter
+ * are replaced below; files Pixy_t saves (/corners.calib) live in memory,
+ * so every run starts uncalibrated, like the recording did.
+ *
+ * Build (from this directory), see pixy_alloc_test.cpp for the C objects:
+ *      gcc -O2 -ffunction-sections -I.. -I../L4_IO -c ../L4_IO/pixy/libfixmath/fix16.c
+ *          ../L4_IO/pixy/libfixmatrix/fixvector2d.c
+ *      g++ -O2 -std=c++11 -I.. -I../L4_IO -I../L3_Utils -I../L4_IO/fat -I../L2_Drivers
+ *          -I../L0_LowLevel -I../L5_Application -I../L1_FreeRTOS/include
+ *          -I../L1_FreeRTOS/portable -I../L1_FreeRTOS -Wl,--gc-sections
+ *          -o pixy_sim pixy_sim.cpp ../L4_IO/src/pixy.cpp fix16.o fixvector2d.o
+ *
+ * Usage:
+ *      pixy_sim gen <file> <moves>         Records a synthetic game to <file>
+ *      pixy_sim <file> <moves> [-v] [-t <dump>]
+ *                                          Replays <file>, -v keeps Pixy_t's output,
+ *                                          -t saves its EventTrace_t for pixy_trace_decode
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pixy.hpp"
+
+using namespace team9::pixy;
+
+/// Where RecordingPixySource_t writes during "gen", as on the board
+static const char* const RECORD_PATH = "1:pixy.raw";
+
+/// --- Host replacements for what Pixy_t uses from the firmware -------------
+
+static std::map<std::string, std::vector<uint8_t>> xFiles;
+static bool bVerbose = false;
+
+extern "C" int u0_dbg_printf(const char* pcFormat, ...)
+{
+    if (!bVerbose)
+    {
+        return 0;
+    }
+    va_list xArgs;
+    va_start(xArgs, pcFormat);
+    int lLen = vfprintf(stderr, pcFormat, xArgs);
+    va_end(xArgs);
+    return lLen;
+}
+
+extern "C" uint64_t sys_get_uptime_us(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FRESULT Storage::read(const char* pFilename, void* pData, unsigned int bytesToRead, unsigned int offset,
+                      unsigned int* pBytesRead)
+{
+    auto xIt = xFiles.find(pFilename);
+    if (xIt == xFiles.end())
+    {
+        return FR_NO_FILE;
+    }
+    const std::vector<uint8_t>& xFile = xIt->second;
+    unsigned int ulBytes = (offset < xFile.size()) ? xFile.size() - offset : 0;
+    memcpy(pData, xFile.data() + offset, std::min(ulBytes, bytesToRead));
+    if (pBytesRead)
+    {
+        *pBytesRead = std::min(ulBytes, bytesToRead);
+    }
+    return FR_OK;
+}
+
+FRESULT Storage::write(const char* pFilename, void* pData, unsigned int bytesToWrite, unsigned int offset)
+{
+    std::vector<uint8_t>& xFile = xFiles[pFilename];
+    xFile.resize(std::max<size_t>(xFile.size(), offset + bytesToWrite));
+    memcpy(xFile.data() + offset, pData, bytesToWrite);
+    return FR_OK;
+}
+
+FRESULT Storage::append(const char* pFilename, void* pData, unsigned int bytesToAppend, unsigned int offset)
+{
+    std::vector<uint8_t>& xFile = xFiles[pFilename];
+    return write(pFilename, pData, bytesToAppend, offset ? offset : xFile.size());
+}
+
+/// A queue never blocks here: the loop in main() empties it after every vAction()
+struct SimQueue_t
+{
+    size_t ulItemSize;
+    std::deque<std::vector<uint8_t>> xItems;
+};
+
+static SimQueue_t xQueues[shared_PixyVerifyTX + 1];
+
+void* scheduler_task::getSharedObject(uint8_t index)
+{
+    return &xQueues[index];
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void* const pvItemToQueue,
+                             TickType_t xTicksToWait, const BaseType_t xCopyPosition)
+{
+    SimQueue_t* pQueue = (SimQueue_t*)xQueue;
+    const uint8_t* pucItem = (const uint8_t*)pvItemToQueue;
+    pQueue->xItems.push_back(std::vector<uint8_t>(pucItem, pucItem + pQueue->ulItemSize));
+    return pdTRUE;
+}
+
+BaseType_t xQueueGenericReceive(QueueHandle_t xQueue, void* const pvBuffer,
+                                TickType_t xTicksToWait, const BaseType_t xJustPeek)
+{
+    SimQueue_t* pQueue = (SimQueue_t*)xQueue;
+    if (pQueue->xItems.empty())
+    {
+        return pdFALSE;
+    }
+    memcpy(pvBuffer, pQueue->xItems.front().data(), pQueue->ulItemSize);
+    if (!xJustPeek)
+    {
+        pQueue->xItems.pop_front();
+    }
+    return pdTRUE;
+}
+
+/// --- Simulated camera for "gen" -------------------------------------------
+
+/**
+ * What the Pixy would send looking at the board: every chip on it, jittered
+ * by a pixel or two, plus a few red blocks below the board, frame after
+ * frame.  Board 6 x 7, 24 pixels between rows and 40 between columns.
+ */
+class ScenePixySource_t : public PixySource_t
+{
+public:
+    static const int ROWS = 6;
+    static const int COLS = 7;
+
+    ScenePixySource_t() : ulPos(0), bCorners(true)
+    {
+        memset(eCells, 0, sizeof(eCells));
+        memset(lHeights, 0, sizeof(lHeights));
+        srand(3);
+    }
+
+    /// Calibration: a green chip in each corner of the empty board
+    void vShowCorners(bool bCorners_arg)
+    {
+        bCorners = bCorners_arg;
+    }
+
+    /// @returns false if the column is full
+    bool bDrop(int lCol, ChipColor_t eColor)
+    {
+        if (lCol < 0 || lCol >= COLS || lHeights[lCol] >= ROWS)
+        {
+            return false;
+        }
+        eCells[lHeights[lCol]++][lCol] = eColor;
+        return true;
+    }
+
+    int32_t lRead(uint8_t* pucData, uint32_t ulBytes)
+    {
+        while (xPending.size() - ulPos < ulBytes)
+        {
+            vFrame();
+        }
+        memcpy(pucData, xPending.data() + ulPos, ulBytes);
+        ulPos += ulBytes;
+        if (ulPos > 64 * 1024)
+        {
+            xPending.erase(xPending.begin(), xPending.begin() + ulPos);
+            ulPos = 0;
+        }
+        return (int32_t)ulBytes;
+    }
+
+private:
+    void vWord(uint16_t usWord)
+    {
+        xPending.push_back(usWord >> 8);
+        xPending.push_back(usWord & 0xff);
+    }
+
+    void vBlock(uint16_t usSignature, int lY, int lX)
+    {
+        uint16_t usWords[5] = {usSignature, (uint16_t)(lX + rand() % 5 - 2),
+                               (uint16_t)(lY + rand() % 5 - 2), 12, 12};
+        vWord(0xaa55);
+        vWord(usWords[0] + usWords[1] + usWords[2] + usWords[3] + usWords[4]);
+        for (int lW = 0; lW < 5; ++lW)
+        {
+            vWord(usWords[lW]);
+        }
+    }
+
+    /// Row 0 is the bottom row
+    static int lCellY(int lRow) { return 160 - lRow * 24; }
+    static int lCellX(int lCol) { return 40 + lCol * 40; }
+
+    void vFrame()
+    {
+        vWord(0xaa55);
+        if (bCorners)
+        {
+            vBlock(GREEN, lCellY(ROWS - 1), lCellX(0));
+            vBlock(GREEN, lCellY(ROWS - 1), lCellX(COLS - 1));
+            vBlock(GREEN, lCellY(0), lCellX(0));
+            vBlock(GREEN, lCellY(0), lCellX(COLS - 1));
+        }
+        for (int lRow = 0; lRow < ROWS; ++lRow)
+        {
+            for (int lCol = 0; lCol < COLS; ++lCol)
+            {
+                if (eCells[lRow][lCol] != NONE)
+                {
+                    vBlock(eCells[lRow][lCol], lCellY(lRow), lCellX(lCol));
+                }
+            }
+        }
+        for (int lNoise = 0; lNoise < 4; ++lNoise)
+        {
+            vBlock(RED, 194, 20 + rand() % 280);
+        }
+        // End of frame, then idle words until the next one
+        for (int lIdle = 0; lIdle < 4; ++lIdle)
+        {
+            vWord(0x0000);
+        }
+    }
+
+    std::vector<uint8_t> xPending;
+    size_t ulPos;
+    bool bCorners;
+    ChipColor_t eCells[ROWS][COLS];
+    int lHeights[COLS];
+};
+
+/// --- Driver -----------------------------------------------------------------
+
+static const char* pcStateName(Pixy_t::State_t eState)
+{
+    return xPixyStateNames.pcName(eState);
+}
+
+/// Pixy frames start with two sync words, 0xaa55 0xaa55
+static uint32_t ulCountFrames(const uint8_t* pucData, size_t ulSize)
+{
+    uint32_t ulFrames = 0;
+    for (size_t ulI = 0; ulI + 3 < ulSize; ++ulI)
+    {
+        if (pucData[ulI] == 0xaa && pucData[ulI + 1] == 0x55 &&
+            pucData[ulI + 2] == 0xaa && pucData[ulI + 3] == 0x55)
+        {
+            ulFrames++;
+            ulI += 3;
+        }
+    }
+    return ulFrames;
+}
+
+static bool bReadFile(const char* pcFile, std::vector<uint8_t>& xOut)
+{
+    FILE* pFile = fopen(pcFile, "rb");
+    if (!pFile)
+    {
+        return false;
+    }
+    uint8_t ucBuf[4096];
+    size_t ulRead;
+    while ((ulRead = fread(ucBuf, 1, sizeof(ucBuf), pFile)) > 0)
+    {
+        xOut.insert(xOut.end(), ucBuf, ucBuf + ulRead);
+    }
+    fclose(pFile);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    bool bGen = argc >= 4 && strcmp(argv[1], "gen") == 0;
+    if (!bGen && argc < 3)
+    {
+        fprintf(stderr, "usage: pixy_sim gen <file> <moves>\n"
+                        "       pixy_sim <file> <moves> [-v] [-t <dump>]\n");
+        return 2;
+    }
+    const char* pcFile = argv[bGen ? 2 : 1];
+    const char* pcMoves = argv[bGen ? 3 : 2];
+    const char* pcEventDump = 0;
+    for (int lArg = 3; !bGen && lArg < argc; ++lArg)
+    {
+        if (strcmp(argv[lArg], "-v") == 0)
+        {
+            bVerbose = true;
+        }
+        else if (strcmp(argv[lArg], "-t") == 0 && lArg + 1 < argc)
+        {
+            pcEventDump = argv[++lArg];
+        }
+    }
+
+    std::vector<int> xHumanMoves, xBotMoves;
+    for (int lI = 0; pcMoves[lI]; ++lI)
+    {
+        if (pcMoves[lI] < '1' || pcMoves[lI] > '7')
+        {
+            fprintf(stderr, "moves are columns 1 to 7\n");
+            return 2;
+        }
+        ((lI % 2) ? xBotMoves : xHumanMoves).push_back(pcMoves[lI] - '1');
+    }
+
+    xQueues[shared_PixyQueueTX].ulItemSize = sizeof(int);
+    xQueues[shared_PixyQueueRX].ulItemSize = sizeof(PixyCmd_t);
+    xQueues[shared_PixyResetQueueTX].ulItemSize = sizeof(bool);
+    xQueues[shared_PixyResetQueueRX].ulItemSize = sizeof(bool);
+    xQueues[shared_PixyVerifyTX].ulItemSize = sizeof(int);
+    xQueues[shared_GameQueueTX].ulItemSize = sizeof(bool);
+
+    // GameTask_t is always done with its move here, Pixy_t may report the human's at once
+    const bool bGameReady = true;
+    xQueueSend(scheduler_task::getSharedObject(shared_GameQueueTX), &bGameReady, 0);
+
+    std::vector<uint8_t> xRecording;
+    ScenePixySource_t* pScene = 0;
+    MemoryPixySource_t* pReplay = 0;
+    PixySource_t* pSource;
+    if (bGen)
+    {
+        pScene = new ScenePixySource_t;
+        pSource = new RecordingPixySource_t(pScene, RECORD_PATH);
+    }
+    else
+    {
+        if (!bReadFile(pcFile, xRecording))
+        {
+            fprintf(stderr, "cannot read %s\n", pcFile);
+            return 2;
+        }
+        pReplay = new MemoryPixySource_t(xRecording.data(), xRecording.size());
+        pSource = pReplay;
+    }
+
+    // Pixy_t talks a lot on stdout, the report goes to stderr
+    if (!bVerbose)
+    {
+        freopen("/dev/null", "w", stdout);
+    }
+
+    xEvents().vSetClock(sys_get_uptime_us);
+    Pixy_t xPixy(CHIPS_AT_A_TIME, CHIPS_TO_CALIB, GREEN, pSource);
+
+    std::map<std::string, int> xTransitions;
+    std::vector<int> xDetected;
+    std::vector<int> xBotSeen;
+    size_t ulBotSent = 0;
+    uint32_t ulActions = 0;
+    bool bDone = false;
+
+    auto xStart = std::chrono::steady_clock::now();
+    while (!bDone)
+    {
+        // The operator presses RESET once the corners are calibrated
+        Pixy_t::State_t eBefore = xPixy.eState;
+        int lButtons = (eBefore == Pixy_t::WAITING_FOR_RESET) ? Pixy_t::RESET_BUTTON : 0;
+        xPixy.vAction((Pixy_t::Button_t)lButtons);
+        ulActions++;
+
+        if (xPixy.eState != eBefore)
+        {
+            xTransitions[std::string(pcStateName(eBefore)) + " -> " + pcStateName(xPixy.eState)]++;
+        }
+        if (pScene && eBefore == Pixy_t::CALIB_STATE && xPixy.eState != Pixy_t::CALIB_STATE)
+        {
+            // Calibrated, take the corner chips off and make the first move
+            pScene->vShowCorners(false);
+            if (!xHumanMoves.empty())
+            {
+                pScene->bDrop(xHumanMoves[0], GREEN);
+            }
+        }
+
+        std::deque<std::vector<uint8_t>>& xTx = xQueues[shared_PixyQueueTX].xItems;
+        while (!xTx.empty())
+        {
+            int lCol;
+            memcpy(&lCol, xTx.front().data(), sizeof(lCol));
+            xTx.pop_front();
+            xDetected.push_back(lCol);
+            xQueueSend(scheduler_task::getSharedObject(shared_GameQueueTX), &bGameReady, 0);
+
+            if (ulBotSent < xBotMoves.size() && xDetected.size() <= xHumanMoves.size())
+            {
+                PixyCmd_t xCmd = {false, xBotMoves[ulBotSent], RED};
+                xQueueSend(scheduler_task::getSharedObject(shared_PixyQueueRX), &xCmd, 0);
+                if (pScene)
+                {
+                    pScene->bDrop(xBotMoves[ulBotSent], RED);
+                    if (ulBotSent + 1 < xHumanMoves.size())
+                    {
+                        pScene->bDrop(xHumanMoves[ulBotSent + 1], GREEN);
+                    }
+                }
+                ulBotSent++;
+            }
+        }
+
+        std::deque<std::vector<uint8_t>>& xSeen = xQueues[shared_PixyVerifyTX].xItems;
+        while (!xSeen.empty())
+        {
+            int lCol;
+            memcpy(&lCol, xSeen.front().data(), sizeof(lCol));
+            xSeen.pop_front();
+            xBotSeen.push_back(lCol);
+        }
+
+        if (xPixy.eState == Pixy_t::WAITING_FOR_BOT && xQueues[shared_PixyQueueRX].xItems.empty())
+        {
+            bDone = true; // nothing will answer the last human move
+        }
+        if (xPixy.eState == Pixy_t::WAITING_FOR_HUMAN && xDetected.size() >= xHumanMoves.size() &&
+            ulBotSent == xBotMoves.size() && xBotSeen.size() >= ulBotSent && bGen)
+        {
+            bDone = true; // the script is played out
+        }
+        if (pReplay && pReplay->bEnded() && xQueues[shared_PixyQueueRX].xItems.empty())
+        {
+            bDone = true;
+        }
+        if (ulActions > 1000000)
+        {
+            fprintf(stderr, "giving up after %u actions in %s\n", ulActions, pcStateName(xPixy.eState));
+            bDone = true;
+        }
+    }
+    double xSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - xStart).count();
+
+    const uint8_t* pucStream;
+    size_t ulStream;
+    if (bGen)
+    {
+        std::vector<uint8_t>& xRecorded = xFiles[RECORD_PATH];
+        FILE* pFile = fopen(pcFile, "wb");
+        if (!pFile || fwrite(xRecorded.data(), 1, xRecorded.size(), pFile) != xRecorded.size())
+        {
+            fprintf(stderr, "cannot write %s\n", pcFile);
+            return 2;
+        }
+        fclose(pFile);
+        pucStream = xRecorded.data();
+        ulStream = xRecorded.size();
+    }
+    else
+    {
+        pucStream = xRecording.data();
+        ulStream = pReplay->ulGetPos();
+    }
+
+    uint32_t ulFrames = ulCountFrames(pucStream, ulStream);
+    fprintf(stderr, "%s %zu bytes, %u Pixy frames, %u vActions in %.3f s\n",
+            bGen ? "recorded" : "replayed", ulStream, ulFrames, ulActions, xSeconds);
+    if (!bGen)
+    {
+        fprintf(stderr, "%.0f frames/sec, %.1f MB/s\n", ulFrames / xSeconds, ulStream / xSeconds / 1e6);
+    }
+    const Trace_t::Stats_t& xTraceStats = xTrace().xGetStats();
+    fprintf(stderr, "trace: %u lines, %u bytes, %u repeats dropped, %llu us\n",
+            xTraceStats.ulLines, xTraceStats.ulBytes, xTraceStats.ulSuppressed,
+            (unsigned long long)xTraceStats.ullUs);
+    fprintf(stderr, "state transitions:\n");
+    for (auto& xEntry : xTransitions)
+    {
+        fprintf(stderr, "  %-45s %d\n", xEntry.first.c_str(), xEntry.second);
+    }
+
+    if (pcEventDump)
+    {
+        FILE* pDump = fopen(pcEventDump, "wb");
+        uint32_t ulEvents = pDump ? xEvents().ulDump([pDump](const void* pvData, uint32_t ulBytes)
+        {
+            return fwrite(pvData, 1, ulBytes, pDump) == ulBytes;
+        }) : 0;
+        if (!pDump || fclose(pDump) != 0)
+        {
+            fprintf(stderr, "cannot write %s\n", pcEventDump);
+            return 2;
+        }
+        fprintf(stderr, "%u of %u events saved to %s\n", ulEvents, xEvents().ulLogged(), pcEventDump);
+    }
+
+    bool bMatch = xDetected.size() == xHumanMoves.size();
+    fprintf(stderr, "human moves detected:");
+    for (size_t ulI = 0; ulI < xDetected.size(); ++ulI)
+    {
+        fprintf(stderr, " %d", xDetected[ulI] + 1);
+        bMatch = bMatch && ulI < xHumanMoves.size() && xDetected[ulI] == xHumanMoves[ulI];
+    }
+    fprintf(stderr, "\nbot moves sent:      ");
+    for (size_t ulI = 0; ulI < ulBotSent; ++ulI)
+    {
+        fprintf(stderr, " %d", xBotMoves[ulI] + 1);
+    }
+    fprintf(stderr, "\nbot chips seen:      ");
+    for (int lCol : xBotSeen)
+    {
+        fprintf(stderr, " %d", lCol + 1);
+    }
+    fprintf(stderr, "\n%s\n", bMatch ? "human moves match <moves>" : "human moves differ from <moves>");
+    return bMatch ? 0 : 1;
+}
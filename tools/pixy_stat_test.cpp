@@ -0,0 +1,376 @@
+/**
+ * Tests the streaming statistics of stat.hpp (Welford_t, Ema_t, Vote_t)
+ * and the Chip_t color classifier built on them, and times them against
+ * the Stat_t they replaced, which went through float on every update.
+ *
+ * The tests check the fix16 stats against the same stats in double, the
+ * vote's k of n and hysteresis, and that Chip_t still knows a chip on the
+ * same frame the old StatEMA_t and in-a-row counter did for random votes.
+ * "bench" reports cycles per update (rdtsc) for each.
+ *
+ * Build (from this directory), see pixy_alloc_test.cpp for fix16.o:
+ *      g++ -O2 -std=c++11 -I.. -I../L4_IO -I../L3_Utils -I../L4_IO/fat -I../L2_Drivers
+ *          -I../L0_LowLevel -I../L5_Application -I../L1_FreeRTOS/include
+ *          -I../L1_FreeRTOS/portable -I../L1_FreeRTOS -Wl,--gc-sections
+ *          -o pixy_stat_test pixy_stat_test.cpp fix16.o
+ *
+ * Usage:
+ *      pixy_stat_test
+ *      pixy_stat_test bench [updates]
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "pixy/common.hpp"
+#include "pixy/common/chip.hpp"
+#include "pixy/common/stat.hpp"
+
+using namespace team9::pixy;
+
+static uint64_t ullTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/// Stat_t and StatEMA_t as they were, for the comparisons
+class OldStat_t
+{
+    public:
+        OldStat_t(float xAlpha_arg = CHIP_COLOR_EMA_ALPHA) :
+            xAlpha(xAlpha_arg),
+            xOneMinusAlpha(1.0f - xAlpha_arg)
+        {}
+
+        void vUpdate(float xVal)
+        {
+            xCnt += int16_t(1);
+            if (xCnt == int16_t(1))
+            {
+                xNewMean = xOldMean = Fix16(xVal);
+                xNewStdDev = xOldStdDev = Fix16();
+                return;
+            }
+            xNewMean = (xAlpha * xVal) + (xOneMinusAlpha * xOldMean);
+            xNewStdDev = xOldStdDev + (Fix16(xVal) - xOldMean) * (Fix16(xVal) - xNewMean);
+            xOldMean = xNewMean;
+            xOldStdDev = xNewStdDev;
+        }
+
+        void vReset()
+        {
+            xNewMean = xOldMean = xNewStdDev = xOldStdDev = xCnt = int16_t(0);
+        }
+
+        float xMean() const
+        {
+            return (xCnt >= int16_t(1)) ? fix16_to_float(xNewMean) : 0.0;
+        }
+
+    private:
+        Fix16 xNewMean;
+        Fix16 xOldMean;
+        Fix16 xNewStdDev;
+        Fix16 xOldStdDev;
+        Fix16 xCnt;
+        Fix16 xAlpha;
+        Fix16 xOneMinusAlpha;
+};
+
+/// Chip_t::vUpdateFreq as it was, NUM_TIMES_FOR_CNT = 2
+class OldChip_t
+{
+    public:
+        OldChip_t(ChipColor_t eHuman_arg) :
+            eKnown(NONE),
+            eLast(NONE),
+            eHuman(eHuman_arg),
+            bEnabled(true),
+            lInARowCnt(0)
+        {}
+
+        void vUpdateFreq(int xNoneFreq, int xGreenFreq, int xRedFreq)
+        {
+            xNone.vUpdate(xNoneFreq);
+            xGreen.vUpdate(xGreenFreq);
+            xRed.vUpdate(xRedFreq);
+            float xIsNone = xNone.xMean();
+            float xIsGreen = xGreen.xMean();
+            float xIsRed = xRed.xMean();
+            ChipColor_t eTemp = NONE;
+            if ((xIsGreen > xIsNone) && (xIsGreen > xIsRed)) eTemp = GREEN;
+            else if ((xIsRed > xIsNone) && (xIsRed > xIsGreen)) eTemp = RED;
+            if (eTemp != eHuman)
+            {
+                lInARowCnt = 0;
+                return;
+            }
+            if (eLast == NONE)
+            {
+                eLast = eTemp;
+                lInARowCnt = 1;
+                return;
+            }
+            if (lInARowCnt++ == 2)
+            {
+                eKnown = eLast;
+                bEnabled = false;
+            }
+        }
+
+        bool bChipKnown() const { return !bEnabled; }
+
+        void vResetCounters()
+        {
+            xNone.vReset();
+            xGreen.vReset();
+            xRed.vReset();
+            eKnown = eLast = NONE;
+            bEnabled = true;
+        }
+
+    private:
+        OldStat_t xNone;
+        OldStat_t xGreen;
+        OldStat_t xRed;
+        ChipColor_t eKnown;
+        ChipColor_t eLast;
+        ChipColor_t eHuman;
+        bool bEnabled;
+        int lInARowCnt;
+};
+
+static uint32_t ulFailures = 0;
+
+static void vCheck(bool bOk, const char* pcWhat, double xGot, double xWant)
+{
+    if (!bOk)
+    {
+        printf("FAIL %s: got %f, want %f\n", pcWhat, xGot, xWant);
+        ulFailures++;
+    }
+}
+
+static void vTestWelford()
+{
+    std::mt19937 xRng(1);
+    std::uniform_real_distribution<float> xPixel(0.0f, 320.0f);
+    Welford_t<Fix16> xFix;
+    Welford_t<float> xFloat;
+    double xSum = 0, xSumSq = 0;
+    const uint32_t ulSamples = 5000;
+    std::vector<float> xSamples;
+    for (uint32_t ulI = 0; ulI < ulSamples; ++ulI)
+    {
+        float xVal = xPixel(xRng);
+        xSamples.push_back(xVal);
+        xFix.vUpdate(Fix16(xVal));
+        xFloat.vUpdate(xVal);
+        xSum += xVal;
+    }
+    double xMean = xSum / ulSamples;
+    for (float xVal : xSamples)
+    {
+        xSumSq += (xVal - xMean) * (xVal - xMean);
+    }
+    double xVar = xSumSq / ulSamples;
+    float xFixMean = fix16_to_float(xFix.xMean().value);
+    float xFixStdDev = fix16_to_float(xFix.xStdDev().value);
+    vCheck(xFix.ulCount() == ulSamples, "Welford count", xFix.ulCount(), ulSamples);
+    vCheck(fabs(xFixMean - xMean) < 0.5, "Welford<Fix16> mean", xFixMean, xMean);
+    // 320 px uniform has a variance of 8533, past what fix16 rounds to 1%
+    vCheck(fabs(xFixStdDev - sqrt(xVar)) < 1.0, "Welford<Fix16> std dev", xFixStdDev, sqrt(xVar));
+    vCheck(fabs(xFloat.xMean() - xMean) < 0.01, "Welford<float> mean", xFloat.xMean(), xMean);
+    vCheck(fabs(xFloat.xVariance() - xVar) < 1.0, "Welford<float> variance", xFloat.xVariance(), xVar);
+
+    xFix.vSet(Fix16(12.5f));
+    vCheck(xFix.ulCount() == 1 && xFix.xMean() == 12.5f && xFix.xVariance() == fix16_t(0),
+           "Welford vSet", fix16_to_float(xFix.xMean().value), 12.5);
+    xFix.vReset();
+    vCheck(xFix.ulCount() == 0 && xFix.xMean() == fix16_t(0), "Welford vReset", xFix.ulCount(), 0);
+}
+
+static void vTestEma()
+{
+    const float xAlpha = 0.9f;
+    Ema_t<Fix16> xFix(xAlpha);
+    double xMean = 0, xVar = 0;
+    std::mt19937 xRng(2);
+    std::uniform_int_distribution<int> xVotes(0, 200);
+    for (int lI = 0; lI < 1000; ++lI)
+    {
+        int lVal = xVotes(xRng);
+        xFix.vUpdate(StatNum_t<Fix16>::xFromInt(lVal));
+        if (lI == 0)
+        {
+            xMean = lVal;
+            continue;
+        }
+        double xDelta = lVal - xMean;
+        xMean += xAlpha * xDelta;
+        xVar = (1 - xAlpha) * (xVar + xAlpha * xDelta * xDelta);
+    }
+    float xFixMean = fix16_to_float(xFix.xMean().value);
+    float xFixVar = fix16_to_float(xFix.xVariance().value);
+    vCheck(fabs(xFixMean - xMean) < 0.01, "Ema<Fix16> mean", xFixMean, xMean);
+    vCheck(fabs(xFixVar - xVar) < 0.05 * xVar + 0.1, "Ema<Fix16> variance", xFixVar, xVar);
+
+    vCheck(!xFix.bSetAlpha(1.0f) && !xFix.bSetAlpha(0.0f), "Ema alpha outside (0, 1)", 1, 0);
+    vCheck(fabs(xFix.xGetAlpha() - xAlpha) < 0.0001, "Ema alpha kept", xFix.xGetAlpha(), xAlpha);
+    xFix.vReset();
+    xFix.vUpdate(Fix16(7.0f));
+    vCheck(xFix.xMean() == 7.0f, "Ema first sample after vReset", fix16_to_float(xFix.xMean().value), 7);
+}
+
+static void vTestVote()
+{
+    // 3 of 5, off again at 1 of 5
+    Vote_t<> xVote(3, 5, 1);
+    const bool bIn[]   = {1, 0, 1, 0, 1, 0, 0, 1, 0, 0, 0, 1, 1, 1};
+    const bool bWant[] = {0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1};
+    for (uint32_t ulI = 0; ulI < sizeof(bIn) / sizeof(bIn[0]); ++ulI)
+    {
+        bool bOn = xVote.bPush(bIn[ulI]);
+        if (bOn != bWant[ulI])
+        {
+            printf("FAIL Vote 3 of 5, off at 1: vote %u is %d\n", ulI, bOn);
+            ulFailures++;
+        }
+    }
+
+    // The whole word
+    Vote_t<uint8_t> xWide(8, 40);
+    for (int lI = 0; lI < 7; ++lI)
+    {
+        xWide.bPush(true);
+    }
+    vCheck(!xWide.bIsOn() && xWide.bPush(true) && xWide.ulYesCount() == 8, "Vote<uint8_t> window", xWide.ulYesCount(), 8);
+    xWide.vReset();
+    vCheck(!xWide.bIsOn() && xWide.ulYesCount() == 0, "Vote vReset", xWide.ulYesCount(), 0);
+}
+
+/// Random frames of votes, leaning toward one color, both classifiers side by side
+static void vTestChip()
+{
+    std::mt19937 xRng(3);
+    uint32_t ulChips = 0, ulDiffer = 0;
+    for (int lRun = 0; lRun < 20000; ++lRun)
+    {
+        ChipColor_t eHuman = (lRun & 1) ? RED : GREEN;
+        Chip_t xNew(CHIP_LOC_EMA_ALPHA, eHuman);
+        OldChip_t xOld(eHuman);
+        std::uniform_int_distribution<int> xVotes(0, 6 + lRun % 20);
+        for (int lFrame = 0; lFrame < 40 && !xNew.bChipKnown() && !xOld.bChipKnown(); ++lFrame)
+        {
+            int lNone = xVotes(xRng);
+            int lGreen = xVotes(xRng);
+            int lRed = xVotes(xRng);
+            xNew.vUpdateFreq(lNone, lGreen, lRed);
+            xOld.vUpdateFreq(lNone, lGreen, lRed);
+        }
+        ulChips += xOld.bChipKnown();
+        ulDiffer += xNew.bChipKnown() != xOld.bChipKnown();
+    }
+    printf("Chip_t: %u of 20000 runs known, %u known on a different frame than before\n", ulChips, ulDiffer);
+    // The old means went through float and rounded differently: a tie now and then
+    vCheck(ulDiffer * 1000 <= ulChips, "Chip_t against the old classifier", ulDiffer, 0);
+}
+
+template<typename UPDATE_T>
+static double xCycles(uint32_t ulUpdates, UPDATE_T xUpdate)
+{
+    uint64_t ullStart = ullTicks();
+    for (uint32_t ulI = 0; ulI < ulUpdates; ++ulI)
+    {
+        xUpdate(ulI);
+    }
+    return (double)(ullTicks() - ullStart) / ulUpdates;
+}
+
+static int lBench(uint32_t ulUpdates)
+{
+    std::vector<int> xVotes(1024);
+    std::mt19937 xRng(4);
+    for (int& lVote : xVotes)
+    {
+        lVote = xRng() % 200;
+    }
+
+    OldStat_t xOld;
+    Ema_t<Fix16> xEma;
+    Ema_t<float> xEmaFloat;
+    Welford_t<Fix16> xWelford;
+    Vote_t<> xVote(3, 3);
+    volatile float xSink = 0;
+
+    printf("%-28s %8.1f cycles/update\n", "old StatEMA_t (float in)",
+           xCycles(ulUpdates, [&](uint32_t ulI) { xOld.vUpdate(xVotes[ulI & 1023]); }));
+    xSink = xOld.xMean();
+    printf("%-28s %8.1f cycles/update\n", "Ema_t<Fix16>",
+           xCycles(ulUpdates, [&](uint32_t ulI) { xEma.vUpdate(StatNum_t<Fix16>::xFromInt(xVotes[ulI & 1023])); }));
+    xSink = fix16_to_float(xEma.xMean().value);
+    printf("%-28s %8.1f cycles/update\n", "Ema_t<float>",
+           xCycles(ulUpdates, [&](uint32_t ulI) { xEmaFloat.vUpdate((float)xVotes[ulI & 1023]); }));
+    xSink = xEmaFloat.xMean();
+    printf("%-28s %8.1f cycles/update\n", "Welford_t<Fix16>",
+           xCycles(ulUpdates, [&](uint32_t ulI) { xWelford.vUpdate(StatNum_t<Fix16>::xFromInt(xVotes[ulI & 1023])); }));
+    xSink = fix16_to_float(xWelford.xMean().value);
+    printf("%-28s %8.1f cycles/update\n", "Vote_t 3 of 3",
+           xCycles(ulUpdates, [&](uint32_t ulI) { xVote.bPush(xVotes[ulI & 1023] & 1); }));
+    xSink = xVote.ulYesCount();
+
+    // A watched chip's frame: three EMAs, the compare and the vote, reset once known
+    Chip_t xChip(CHIP_LOC_EMA_ALPHA, GREEN);
+    OldChip_t xOldChip(GREEN);
+    uint32_t ulKnown = 0;
+    printf("%-28s %8.1f cycles/frame\n", "old Chip_t::vUpdateFreq",
+           xCycles(ulUpdates, [&](uint32_t ulI)
+           {
+               xOldChip.vUpdateFreq(xVotes[ulI & 1023], xVotes[(ulI + 1) & 1023], xVotes[(ulI + 2) & 1023]);
+               if (xOldChip.bChipKnown())
+               {
+                   ulKnown++;
+                   xOldChip.vResetCounters();
+               }
+           }));
+    printf("%-28s %8.1f cycles/frame\n", "Chip_t::vUpdateFreq",
+           xCycles(ulUpdates, [&](uint32_t ulI)
+           {
+               xChip.vUpdateFreq(xVotes[ulI & 1023], xVotes[(ulI + 1) & 1023], xVotes[(ulI + 2) & 1023]);
+               if (xChip.bChipKnown())
+               {
+                   ulKnown++;
+                   xChip.vResetCounters();
+               }
+           }));
+    xSink = ulKnown;
+    (void)xSink;
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        return lBench((argc > 2) ? atoi(argv[2]) : 10000000);
+    }
+    vTestWelford();
+    vTestEma();
+    vTestVote();
+    vTestChip();
+    printf("%s\n", ulFailures ? "FAIL" : "PASS");
+    return ulFailures ? 1 : 0;
+}
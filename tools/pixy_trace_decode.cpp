@@ -0,0 +1,274 @@
+/**
+ * Prints an EventTrace_t dump: the binary events PixyEyes_t, Board_t,
+ * Pixy_t, MotorTask_t and GameTask_t log on the board, formatted here
+ * instead of there.
+ *
+ * A dump is either the file "trace save 1:trace.bin" writes to the SD card,
+ * or a capture of the terminal while "trace dump" prints it as "EV <hex>"
+ * lines; anything else in the capture is skipped.  pixy_sim -t writes one
+ * too.  Times are the board's uptime, unwrapped from the records' 32 bits.
+ *
+ * "bench" times EventTrace_t::vLog() against the text trace (Trace_t
+ * formatting the same event into a sink that drops it) and against what
+ * the formatted line costs on UART0 at 38400 baud.
+ *
+ * Build (from this directory):
+ *      g++ -O2 -std=c++11 -I.. -I../L4_IO -o pixy_trace_decode pixy_trace_decode.cpp
+ *
+ * Usage:
+ *      pixy_trace_decode <dump>
+ *      pixy_trace_decode bench [events]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "pixy/common/event_trace.hpp"
+#include "pixy/common/trace.hpp"
+
+using namespace team9::pixy;
+
+static const uint32_t UART0_BAUD = 38400;
+
+static uint64_t ullTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint64_t ullUptimeUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int lHexDigit(char cDigit)
+{
+    if (cDigit >= '0' && cDigit <= '9') return cDigit - '0';
+    if (cDigit >= 'a' && cDigit <= 'f') return cDigit - 'a' + 10;
+    if (cDigit >= 'A' && cDigit <= 'F') return cDigit - 'A' + 10;
+    return -1;
+}
+
+/// The bytes of a binary dump, or of the "EV <hex>" lines of a terminal capture
+static bool bReadDump(const char* pcPath, std::vector<uint8_t>& xDump)
+{
+    FILE* pFile = fopen(pcPath, "rb");
+    if (!pFile)
+    {
+        return false;
+    }
+    std::vector<uint8_t> xFile;
+    uint8_t ucBuf[4096];
+    size_t ulRead;
+    while ((ulRead = fread(ucBuf, 1, sizeof(ucBuf), pFile)) > 0)
+    {
+        xFile.insert(xFile.end(), ucBuf, ucBuf + ulRead);
+    }
+    fclose(pFile);
+
+    uint32_t ulMagic = 0;
+    if (xFile.size() >= sizeof(ulMagic))
+    {
+        memcpy(&ulMagic, xFile.data(), sizeof(ulMagic));
+    }
+    if (ulMagic == EventDumpHeader_t::MAGIC)
+    {
+        xDump.swap(xFile);
+        return true;
+    }
+
+    std::string xText(xFile.begin(), xFile.end());
+    for (size_t ulPos = 0; (ulPos = xText.find("EV ", ulPos)) != std::string::npos; ulPos += 3)
+    {
+        if (ulPos > 0 && xText[ulPos - 1] != '\n' && xText[ulPos - 1] != '\r')
+        {
+            continue;
+        }
+        uint8_t ucLine[16];
+        bool bHex = ulPos + 3 + 32 <= xText.size();
+        for (int lI = 0; bHex && lI < 16; ++lI)
+        {
+            int lHigh = lHexDigit(xText[ulPos + 3 + 2 * lI]);
+            int lLow = lHexDigit(xText[ulPos + 3 + 2 * lI + 1]);
+            bHex = lHigh >= 0 && lLow >= 0;
+            ucLine[lI] = (uint8_t)(lHigh << 4 | lLow);
+        }
+        if (bHex)
+        {
+            xDump.insert(xDump.end(), ucLine, ucLine + sizeof(ucLine));
+        }
+    }
+    return true;
+}
+
+static int lDecode(const char* pcPath)
+{
+    std::vector<uint8_t> xDump;
+    if (!bReadDump(pcPath, xDump))
+    {
+        fprintf(stderr, "cannot read %s\n", pcPath);
+        return 2;
+    }
+    EventDumpHeader_t xHeader;
+    if (xDump.size() < sizeof(xHeader))
+    {
+        fprintf(stderr, "%s: no event dump in it\n", pcPath);
+        return 2;
+    }
+    memcpy(&xHeader, xDump.data(), sizeof(xHeader));
+    if (xHeader.ulMagic != EventDumpHeader_t::MAGIC || xHeader.usVersion != EventDumpHeader_t::VERSION ||
+        xHeader.usRecordBytes != sizeof(EventRecord_t))
+    {
+        fprintf(stderr, "%s: not a version %u dump of %u byte records\n", pcPath,
+                (unsigned)EventDumpHeader_t::VERSION, (unsigned)sizeof(EventRecord_t));
+        return 2;
+    }
+
+    const uint8_t* pucRecords = xDump.data() + sizeof(xHeader);
+    uint32_t ulRecords = (xDump.size() - sizeof(xHeader)) / sizeof(EventRecord_t);
+    printf("%u events, %u logged since boot, ring of %u\n", ulRecords, xHeader.ulLogged, xHeader.ulCapacity);
+    printf("%10s %14s %10s  %-18s\n", "seq", "time ms", "+ms", "event");
+
+    uint64_t ullHighUs = 0;
+    uint32_t ulLastUs = 0;
+    uint64_t ullPrevUs = 0;
+    uint32_t ulNextSeq = 0;
+    uint32_t ulMissing = 0;
+    for (uint32_t ulR = 0; ulR < ulRecords; ++ulR)
+    {
+        EventRecord_t xRecord;
+        memcpy(&xRecord, pucRecords + ulR * sizeof(EventRecord_t), sizeof(xRecord));
+
+        // Only a backward jump of half the range is a wrap, tasks may log slightly out of order
+        if (ulR > 0 && xRecord.ulTimeUs < ulLastUs && ulLastUs - xRecord.ulTimeUs > 0x80000000u)
+        {
+            ullHighUs += 1ull << 32;
+        }
+        ulLastUs = xRecord.ulTimeUs;
+        uint64_t ullUs = ullHighUs + xRecord.ulTimeUs;
+
+        if (ulR > 0 && xRecord.ulSeq != ulNextSeq)
+        {
+            ulMissing += xRecord.ulSeq - ulNextSeq;
+            printf("%10s  (%u events overwritten while dumping)\n", "", xRecord.ulSeq - ulNextSeq);
+        }
+        ulNextSeq = xRecord.ulSeq + 1;
+
+        EventId_t eEvent = (EventId_t)xRecord.usEvent;
+        char cArgs[96];
+        if (xRecord.usEvent < EV_COUNT)
+        {
+            snprintf(cArgs, sizeof(cArgs), xEventArgs.pcName(eEvent), (int)xRecord.usArg, (int)xRecord.lArg);
+        }
+        else
+        {
+            snprintf(cArgs, sizeof(cArgs), "event %u: %u %d", xRecord.usEvent, xRecord.usArg, xRecord.lArg);
+        }
+        printf("%10u %14.3f %10.3f  %-18s %s\n", xRecord.ulSeq, ullUs / 1000.0,
+               ulR ? (double)(int64_t)(ullUs - ullPrevUs) / 1000.0 : 0.0,
+               xEventNames.pcName(eEvent), cArgs);
+        ullPrevUs = ullUs;
+    }
+    if (ulMissing)
+    {
+        printf("%u events missing\n", ulMissing);
+    }
+    return 0;
+}
+
+static void vDropLine(const char* pcText)
+{
+    (void)pcText;
+}
+
+static int lBench(uint32_t ulEvents)
+{
+    // The ring is 2 KB, keep it off the stack like on the board
+    static EventTrace_t xRing;
+
+    auto xTimeLoop = [ulEvents](const char* pcName, void (*pxLog)(uint32_t)) -> double
+    {
+        uint64_t ullStartTicks = ullTicks();
+        auto xStart = std::chrono::steady_clock::now();
+        for (uint32_t ulI = 0; ulI < ulEvents; ++ulI)
+        {
+            pxLog(ulI);
+        }
+        double xNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - xStart).count();
+        double xCycles = (double)(ullTicks() - ullStartTicks) / ulEvents;
+        printf("%-32s %8.1f ns/event  %8.1f cycles/event (rdtsc)\n", pcName, xNs / ulEvents, xCycles);
+        return xNs / ulEvents;
+    };
+
+    xRing.vSetClock(nullptr);
+    xTimeLoop("EventTrace_t::vLog, no clock", [](uint32_t ulI)
+    {
+        xRing.vLog(EV_BOARD_CHIP_KNOWN, ulI & 7, ulI);
+    });
+    xRing.vSetClock(ullUptimeUs);
+    xTimeLoop("EventTrace_t::vLog, clock", [](uint32_t ulI)
+    {
+        xRing.vLog(EV_BOARD_CHIP_KNOWN, ulI & 7, ulI);
+    });
+
+    // The text trace with its repeat filter off and a sink that writes nothing
+    xTrace().vClearSinks();
+    xTrace().bAddSink(vDropLine);
+    xTrace().vSetRepeatUs(0);
+    xTimeLoop("PIXY_TRACE, formatted, no UART", [](uint32_t ulI)
+    {
+        PIXY_TRACE(TRACE_ERROR, "Chip known in row %d, col %d\n", (int)(ulI & 7), (int)ulI);
+    });
+    const Trace_t::Stats_t& xStats = xTrace().xGetStats();
+    double xBytesPerLine = (double)xStats.ulBytes / (xStats.ulLines ? xStats.ulLines : 1);
+    printf("%-32s %8.1f ms/event  (%.0f bytes at %u baud, 10 bits a byte)\n", "PIXY_TRACE on UART0",
+           xBytesPerLine * 10 * 1000 / UART0_BAUD, xBytesPerLine, UART0_BAUD);
+
+    // Every event of the last loop made it into the ring, in order
+    uint32_t ulSeq = xRing.ulOldest();
+    EventRecord_t xRecords[EventTrace_t::CAPACITY];
+    uint32_t ulKept = xRing.ulRead(ulSeq, xRing.ulLogged(), xRecords, EventTrace_t::CAPACITY);
+    bool bPass = ulKept == EventTrace_t::CAPACITY;
+    for (uint32_t ulI = 0; bPass && ulI < ulKept; ++ulI)
+    {
+        bPass = xRecords[ulI].lArg == (int32_t)(ulEvents - ulKept + ulI) &&
+                xRecords[ulI].usEvent == EV_BOARD_CHIP_KNOWN;
+    }
+
+    // After vClear() only what comes next is kept
+    xRing.vClear();
+    xRing.vLog(EV_GAME_HUMAN, 3);
+    ulSeq = xRing.ulOldest();
+    bPass &= xRing.ulRead(ulSeq, xRing.ulLogged(), xRecords, EventTrace_t::CAPACITY) == 1 &&
+             xRecords[0].usEvent == EV_GAME_HUMAN && xRecords[0].usArg == 3;
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    return bPass ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: pixy_trace_decode <dump>\n"
+                        "       pixy_trace_decode bench [events]\n");
+        return 2;
+    }
+    if (strcmp(argv[1], "bench") == 0)
+    {
+        return lBench((argc > 2) ? atoi(argv[2]) : 1000000);
+    }
+    return lDecode(argv[1]);
+}